@@ -8,6 +8,7 @@
 #include <iostream>
 #include <optional>
 #include <variant>
+#include <atomic>
 #include "yen/value.h"
 
 // Source location for error reporting and debug info
@@ -53,6 +54,8 @@ struct ImplStmt;
 struct RepeatStmt;
 struct ExtendStmt;
 struct ObjectDestructureLetStmt;
+struct ParallelForStmt;
+struct ReduceStmt;
 
 // Visitors
 class Visitor {
@@ -113,6 +116,8 @@ public:
     virtual void visit(const RepeatStmt&) = 0;
     virtual void visit(const ExtendStmt&) = 0;
     virtual void visit(const ObjectDestructureLetStmt&) = 0;
+    virtual void visit(const ParallelForStmt&) = 0;
+    virtual void visit(const ReduceStmt&) = 0;
     virtual ~StatementVisitor() = default;
 };
 
@@ -632,6 +637,7 @@ struct SetStmt : Statement {
 struct GetExpr : Expression {
     std::unique_ptr<Expression> object;
     std::string name;
+    mutable std::atomic<int> methodId{0};  // name interned for built-in method calls; 0 until first call
 
     GetExpr(std::unique_ptr<Expression> object, const std::string& name)
         : object(std::move(object)), name(name) {}
@@ -828,6 +834,39 @@ struct ObjectDestructureLetStmt : Statement {
     DEFINE_ACCEPT();
 };
 
+// Loop scheduling for parallel for: how the iteration space is split into chunks
+enum class ParallelSchedule {
+    Static,   // contiguous blocks per worker (or round-robin chunks if a size is given)
+    Dynamic,  // workers claim fixed-size chunks from a shared counter
+    Guided    // like Dynamic, but chunk size shrinks with the remaining work
+};
+
+// parallel for x in xs { ... }
+// parallel(dynamic, 64) for x in xs { ... }
+struct ParallelForStmt : Statement {
+    std::string var;
+    std::unique_ptr<Expression> iterable;
+    std::unique_ptr<Statement> body;
+    ParallelSchedule schedule;
+    std::unique_ptr<Expression> chunkSize;  // optional (nullptr = schedule default)
+
+    ParallelForStmt(std::string v, std::unique_ptr<Expression> i, std::unique_ptr<Statement> b,
+                    ParallelSchedule s = ParallelSchedule::Static, std::unique_ptr<Expression> chunk = nullptr)
+        : var(std::move(v)), iterable(std::move(i)), body(std::move(b)),
+          schedule(s), chunkSize(std::move(chunk)) {}
+    DEFINE_ACCEPT();
+};
+
+// reduce sum += expr; (reduction inside a parallel for body)
+struct ReduceStmt : Statement {
+    std::string name;
+    BinaryOp op;  // Add, Sub or Mul
+    std::unique_ptr<Expression> expression;
+    ReduceStmt(std::string n, BinaryOp o, std::unique_ptr<Expression> expr)
+        : name(std::move(n)), op(o), expression(std::move(expr)) {}
+    DEFINE_ACCEPT();
+};
+
 // BinaryOp extension
 // NotIn is handled as separate BinaryOp
 
@@ -40,6 +40,8 @@ public:
 };
 
 class Interpreter {
+    friend struct BuiltinMethods;
+
 public:
     Interpreter();
     void execute(const std::vector<std::unique_ptr<Statement>>& statements);
@@ -79,14 +81,20 @@ private:
     // Native module registry: maps dotted paths (e.g. "net.http") to initializer functions
     std::unordered_map<std::string, std::function<void(std::unordered_map<std::string, Value>&)>> nativeModules;
     std::unordered_set<std::string> loadedNativeModules;  // Track which native modules are loaded
+    // parallel for: per-chunk partial values of 'reduce' targets (worker copies only)
+    std::unordered_map<std::string, Value> reductionSlots;
+    bool inParallelBody = false;
     void initNativeModuleRegistry();
     bool loadNativeModule(const std::string& modulePath);
     Value evalExpr(const Expression* expr);
     Value call(const Value& callee, std::vector<Value>& args);
     void executeDeferredStatements();
+    void executeParallelFor(const ParallelForStmt* stmt);
     bool matchPattern(const Pattern* pattern, const Value& value, std::unordered_map<std::string, Value>& bindings);
     std::string valueToString(const Value& val);
     bool isTruthy(const Value& val);
+    Value* findVariableSlot(const std::string& name);
+    bool appendInPlace(Value& target, const Value& rhs);
 };
 
 #endif // COMPILER_H
@@ -7,6 +7,8 @@
 #include <vector>
 #include <unordered_map>
 #include <string>
+#include <functional>
+#include <string_view>
 
 // Native library registration system
 namespace YenNative {
@@ -17,6 +19,29 @@ using LibraryInitializer = void(*)(std::unordered_map<std::string, Value>&);
 // Register all native libraries
 void registerAllLibraries(std::unordered_map<std::string, Value>& globals);
 
+// Buffered standard output shared by print, printf and the native libraries.
+// Fully buffered when stdout is a file or pipe, line buffered on a terminal.
+namespace Console {
+    void init();
+    void write(std::string_view text);
+    void flush();
+}
+
+// Methods on built-in values that libraries add, e.g. s.add(x) on sets.
+// Method names are interned to small ids that each call site resolves
+// once; a call is then one lookup in the receiver type's table. The
+// receiver arrives as args[0] and counts toward the arity. Register while
+// libraries load, not while scripts run.
+namespace Methods {
+    constexpr int kMaxMethods = 1024;
+    int intern(const std::string& name);   // 0 once kMaxMethods names exist
+    void add(size_t typeIndex, const std::string& name, NativeFunction fn);
+    const NativeFunction* find(size_t typeIndex, int id);
+
+    template<typename T>
+    void add(const std::string& name, NativeFunction fn) { add(valueTypeIndex<T>(), name, fn); }
+}
+
 // Individual library registrars
 namespace Core {
     void registerFunctions(std::unordered_map<std::string, Value>& globals);
@@ -28,6 +53,9 @@ namespace Math {
 
 namespace String {
     void registerFunctions(std::unordered_map<std::string, Value>& globals);
+    // Offset of the first needle at or after from, or npos (SIMD search
+    // shared by str_contains, str_replace and the string methods)
+    size_t findText(std::string_view hay, std::string_view needle, size_t from = 0);
 }
 
 namespace Collections {
@@ -54,6 +82,10 @@ namespace FS {
     void registerFunctions(std::unordered_map<std::string, Value>& globals);
 }
 
+namespace AsyncIO {
+    void registerFunctions(std::unordered_map<std::string, Value>& globals);
+}
+
 namespace Time {
     void registerFunctions(std::unordered_map<std::string, Value>& globals);
 }
@@ -62,6 +94,10 @@ namespace Crypto {
     void registerFunctions(std::unordered_map<std::string, Value>& globals);
 }
 
+namespace Hash {
+    void registerFunctions(std::unordered_map<std::string, Value>& globals);
+}
+
 namespace Encoding {
     void registerFunctions(std::unordered_map<std::string, Value>& globals);
 }
@@ -110,6 +146,10 @@ namespace NetSocket {
 
 namespace NetHTTP {
     void registerFunctions(std::unordered_map<std::string, Value>& globals);
+    // Called on a worker thread with the worker index and the request map
+    using RequestHandler = std::function<Value(size_t worker, Value& request)>;
+    // Serves HTTP on an http_server() socket until http_serve_stop() is called
+    void serve(int serverFd, size_t workerCount, const RequestHandler& handler);
 }
 
 namespace OS {
@@ -120,6 +160,16 @@ namespace Async {
     void registerFunctions(std::unordered_map<std::string, Value>& globals);
 }
 
+namespace EventLoop {
+    void registerFunctions(std::unordered_map<std::string, Value>& globals);
+    // Waits up to timeoutMs (-1 = until the next timer) and returns ready [callback, event] pairs
+    std::vector<std::pair<Value, Value>> poll(int loopId, int timeoutMs);
+    // True while the loop is not stopped and still has fds or timers registered
+    bool hasWork(int loopId);
+    // False once a callback earlier in the same batch removed the event's fd or timer
+    bool isLive(int loopId, const Value& event);
+}
+
 namespace DateTime {
     void registerFunctions(std::unordered_map<std::string, Value>& globals);
 }
@@ -146,6 +196,11 @@ namespace CSV {
 
 namespace Event {
     void registerFunctions(std::unordered_map<std::string, Value>& globals);
+    // Callbacks registered for event (once-listeners are removed as they are taken)
+    std::vector<Value> takeListeners(int emitterId, const std::string& event);
+    // Runs job(worker) on the event worker pool; event_wait(emitter) waits for it
+    void post(int emitterId, std::function<void(size_t)> job);
+    size_t workerCount();
 }
 
 } // namespace YenNative
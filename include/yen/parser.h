@@ -85,6 +85,8 @@ private:
     std::unique_ptr<Statement> tryCatchStatement();
     std::unique_ptr<Statement> throwStatement();
     std::unique_ptr<Statement> forDestructureStatement();
+    std::unique_ptr<Statement> parallelForStatement();
+    std::unique_ptr<Statement> reduceStatement();
     std::unique_ptr<Statement> traitStatement();
     std::unique_ptr<Statement> implStatement();
     std::unique_ptr<Statement> repeatStatement();
@@ -4,7 +4,19 @@
 #include <unordered_map>
 #include <string>
 #include <memory>
+#include <functional>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include <stdexcept>
+#include <initializer_list>
+#include <iterator>
 #include <iostream> // For std::ostream
+#include <string_view>
+#include <atomic>
+#include <mutex>
+#include <charconv>
+#include <type_traits>
 
 template<class... Ts> struct overloaded : Ts... { using Ts::operator()...; };
 template<class... Ts> overloaded(Ts...) -> overloaded<Ts...>;
@@ -23,6 +35,10 @@ struct ClassInstance {
 struct FunctionStmt;
 struct Expression;
 struct Statement;
+struct LambdaExpr;
+struct SetValue;
+struct IteratorValue;
+struct StringBuilderValue;
 
 struct NativeFunction {
     using FunctionType = Value(*)(std::vector<struct Value>&);
@@ -35,26 +51,275 @@ struct NativeFunction {
     // No operator< for NativeFunction as it doesn't have a meaningful order
 };
 
-// Lambda/closure representation
+// Lambda/closure representation. Parameters, defaults and body are read from
+// the LambdaExpr, which outlives every value created from it.
 struct LambdaValue {
-    std::vector<std::string> parameters;
-    const Expression* body;           // Pointer to lambda body expression (may be null for block)
-    const Statement* blockBody;       // Pointer to block body (may be null for expr)
+    const LambdaExpr* expr;
     std::shared_ptr<std::unordered_map<std::string, Value>> captured_env;  // Captured variables
-    std::shared_ptr<std::vector<const Expression*>> defaultExprs;  // Default parameter expressions
 
-    LambdaValue(std::vector<std::string> params, const Expression* body_expr,
+    LambdaValue(const LambdaExpr* lambda_expr,
                 std::shared_ptr<std::unordered_map<std::string, Value>> env = nullptr)
-        : parameters(std::move(params)), body(body_expr), blockBody(nullptr), captured_env(env) {}
-
-    LambdaValue(std::vector<std::string> params, const Expression* body_expr,
-                const Statement* block_body,
-                std::shared_ptr<std::unordered_map<std::string, Value>> env = nullptr)
-        : parameters(std::move(params)), body(body_expr), blockBody(block_body), captured_env(env) {}
+        : expr(lambda_expr), captured_env(std::move(env)) {}
 
     bool operator==(const LambdaValue& other) const {
-        return body == other.body && blockBody == other.blockBody;
+        return expr == other.expr;
+    }
+};
+
+// Insertion-ordered hash map keyed by any hashable Value (strings, numbers,
+// bools, lists as tuples). Entries live densely in insertion order; maps with
+// up to kSmallMap entries are searched linearly and carry no index. Larger
+// maps add one heap block holding an open-addressing slot table and a bitmap
+// of erased entries, which stay as tombstones until the next rebuild.
+//
+// Member functions that touch Value are defined after Value below.
+class MapValue {
+public:
+    using Entry = std::pair<Value, Value>;
+    static constexpr size_t kSmallMap = 8;
+
+    template<bool Const> class Iter;
+    using iterator = Iter<false>;
+    using const_iterator = Iter<true>;
+
+    MapValue() = default;
+    MapValue(std::initializer_list<Entry> init);
+    MapValue(const MapValue& other);
+    MapValue(MapValue&& other) noexcept;
+    MapValue& operator=(const MapValue& other);
+    MapValue& operator=(MapValue&& other) noexcept;
+    ~MapValue();
+
+    size_t size() const { return entries_.size() - (index_ ? index_[1] : 0); }
+    bool empty() const { return size() == 0; }
+    void reserve(size_t n);
+    void clear();
+
+    iterator begin();
+    iterator end();
+    const_iterator begin() const;
+    const_iterator end() const;
+
+    iterator find(const Value& key);
+    iterator find(const std::string& key);
+    iterator find(const char* key) { return find(std::string(key)); }
+    const_iterator find(const Value& key) const;
+    const_iterator find(const std::string& key) const;
+    const_iterator find(const char* key) const { return find(std::string(key)); }
+
+    size_t count(const Value& key) const;
+    size_t count(const std::string& key) const;
+    size_t count(const char* key) const { return count(std::string(key)); }
+
+    Value& operator[](const Value& key);
+    Value& operator[](const std::string& key);
+    Value& operator[](std::string&& key);
+    Value& operator[](const char* key) { return (*this)[std::string(key)]; }
+
+    Value& at(const std::string& key);
+    const Value& at(const std::string& key) const;
+
+    size_t erase(const Value& key);
+    size_t erase(const std::string& key);
+    size_t erase(const char* key) { return erase(std::string(key)); }
+
+    template<bool Const>
+    class Iter {
+        using Map = std::conditional_t<Const, const MapValue, MapValue>;
+        using Ref = std::conditional_t<Const, const Entry&, Entry&>;
+        using Ptr = std::conditional_t<Const, const Entry*, Entry*>;
+        Map* map_;
+        size_t pos_;
+
+        void skipDead() {
+            while (pos_ < map_->entries_.size() && map_->isDead(pos_)) ++pos_;
+        }
+
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = Entry;
+        using difference_type = std::ptrdiff_t;
+        using pointer = Ptr;
+        using reference = Ref;
+
+        Iter(Map* map, size_t pos) : map_(map), pos_(pos) { skipDead(); }
+        operator Iter<true>() const { return Iter<true>(map_, pos_); }
+
+        Ref operator*() const { return map_->entries_[pos_]; }
+        Ptr operator->() const { return &map_->entries_[pos_]; }
+        Iter& operator++() { ++pos_; skipDead(); return *this; }
+        Iter operator++(int) { Iter tmp = *this; ++*this; return tmp; }
+        bool operator==(const Iter& other) const { return pos_ == other.pos_; }
+        bool operator!=(const Iter& other) const { return pos_ != other.pos_; }
+    };
+
+private:
+    // index_ layout in uint32 words: [0] slot count (cap), [1] tombstones,
+    // [2, 2 + cap) slots, then cap bits marking erased entries
+    static constexpr uint32_t kEmpty = 0xFFFFFFFFu;
+    static constexpr uint32_t kDeleted = 0xFFFFFFFEu;
+
+    std::vector<Entry> entries_;
+    uint32_t* index_ = nullptr;
+
+    bool isDead(size_t pos) const {
+        return index_ && ((index_[2 + index_[0] + (pos >> 5)] >> (pos & 31)) & 1u);
     }
+    static size_t indexWords(uint32_t cap) { return 2 + cap + cap / 32; }
+
+    static size_t mix(size_t h);
+    static size_t keyHash(const Value& key);
+    static size_t keyHash(const std::string& key);
+    static bool keyEquals(const Value& a, const Value& key);
+    static bool keyEquals(const Value& a, const std::string& key);
+
+    template<typename K> long locate(const K& key, size_t h, size_t* slot) const;
+    template<typename K> Value& insertKey(K&& key);
+    template<typename K> size_t eraseKey(const K& key);
+    void rebuild(size_t n);
+};
+
+// Same text as std::to_string (floating point as fixed with six decimals),
+// formatted with std::to_chars instead of through snprintf and the C locale
+template<typename T>
+inline std::string numberToString(T v) {
+    char buf[400];  // Fixed notation of DBL_MAX needs 316
+    std::to_chars_result res;
+    if constexpr (std::is_floating_point_v<T>) res = std::to_chars(buf, buf + sizeof(buf), static_cast<double>(v), std::chars_format::fixed, 6);
+    else res = std::to_chars(buf, buf + sizeof(buf), v);
+    return std::string(buf, res.ptr);
+}
+
+// print's rendering of a float: numberToString with trailing zeros trimmed,
+// keeping at least one decimal ("2.0", "0.125")
+inline std::string doubleToDisplay(double v) {
+    std::string s = numberToString(v);
+    size_t dot = s.find('.');
+    if (dot != std::string::npos) {
+        size_t last = s.find_last_not_of('0');
+        s.resize(last > dot ? last + 1 : dot + 2);
+    }
+    return s;
+}
+
+// Immutable text behind string Values. Up to kInline bytes live inline, in
+// std::string's small buffer; longer text sits in a reference-counted block
+// shared by every copy, so reading a variable or passing an argument never
+// copies the bytes. slice() of a long string is a view into its parent's
+// block (keeping that block alive) and only builds a std::string of its own
+// when str() is called. Writers go through mutableText(), which unshares.
+class StringValue {
+public:
+    static constexpr size_t kInline = 15;
+
+    StringValue() = default;
+    StringValue(std::string text) {
+        if (text.size() <= kInline) inline_ = std::move(text);
+        else rep_ = new Rep(std::move(text));
+    }
+    StringValue(const char* text) : StringValue(std::string(text)) {}
+    StringValue(const StringValue& other) : inline_(other.inline_), rep_(other.rep_) {
+        if (rep_) rep_->refs.fetch_add(1, std::memory_order_relaxed);
+    }
+    StringValue(StringValue&& other) noexcept : inline_(std::move(other.inline_)), rep_(other.rep_) {
+        other.rep_ = nullptr;
+    }
+    StringValue& operator=(const StringValue& other) {
+        if (this != &other) *this = StringValue(other);
+        return *this;
+    }
+    StringValue& operator=(StringValue&& other) noexcept {
+        if (this != &other) {
+            release(rep_);
+            inline_ = std::move(other.inline_);
+            rep_ = other.rep_;
+            other.rep_ = nullptr;
+        }
+        return *this;
+    }
+    ~StringValue() { release(rep_); }
+
+    size_t size() const {
+        if (!rep_) return inline_.size();
+        return rep_->root ? rep_->length : rep_->text.size();
+    }
+    bool empty() const { return size() == 0; }
+
+    // The bytes, without materializing a view
+    std::string_view view() const {
+        if (!rep_) return inline_;
+        if (!rep_->root) return rep_->text;
+        return std::string_view(rep_->root->text.data() + rep_->offset, rep_->length);
+    }
+
+    // The text as a std::string. A view copies its range out on first use;
+    // concurrent callers race to publish one copy and the losers free theirs.
+    const std::string& str() const {
+        if (!rep_) return inline_;
+        if (!rep_->root) return rep_->text;
+        std::string* flat = rep_->flat.load(std::memory_order_acquire);
+        if (!flat) {
+            std::string* made = new std::string(view());
+            if (rep_->flat.compare_exchange_strong(flat, made, std::memory_order_acq_rel)) flat = made;
+            else delete made;
+        }
+        return *flat;
+    }
+
+    // Substring with std::string::substr clamping. Short results are copied
+    // inline; longer ones share this string's block.
+    StringValue slice(size_t pos, size_t len = std::string::npos) const {
+        size_t n = size();
+        if (pos > n) pos = n;
+        len = std::min(len, n - pos);
+        if (len == n) return *this;
+        if (len <= kInline) return StringValue(std::string(view().substr(pos, len)));
+        Rep* root = rep_->root ? rep_->root : rep_;
+        root->refs.fetch_add(1, std::memory_order_relaxed);
+        StringValue out;
+        out.rep_ = new Rep(root, (rep_->root ? rep_->offset : 0) + pos, len);
+        return out;
+    }
+
+    // Writable text, copied first unless this string is its block's only owner
+    std::string& mutableText() {
+        if (!rep_) {
+            rep_ = new Rep(std::move(inline_));
+            inline_.clear();
+        } else if (rep_->root || rep_->refs.load(std::memory_order_acquire) != 1) {
+            Rep* own = new Rep(std::string(view()));
+            release(rep_);
+            rep_ = own;
+        }
+        return rep_->text;
+    }
+
+    bool operator==(const StringValue& other) const { return view() == other.view(); }
+    bool operator<(const StringValue& other) const { return view() < other.view(); }
+
+private:
+    struct Rep {
+        std::atomic<size_t> refs{1};
+        std::string text;                         // Root blocks: the text
+        Rep* root = nullptr;                      // Views: the block they slice
+        size_t offset = 0;
+        size_t length = 0;
+        std::atomic<std::string*> flat{nullptr};  // Views: copy made by str()
+
+        explicit Rep(std::string t) : text(std::move(t)) {}
+        Rep(Rep* r, size_t off, size_t len) : root(r), offset(off), length(len) {}
+        ~Rep() { delete flat.load(std::memory_order_relaxed); }
+    };
+
+    static void release(Rep* rep) {
+        if (rep && rep->refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            release(rep->root);
+            delete rep;
+        }
+    }
+
+    std::string inline_;   // Text when rep_ is null
+    Rep* rep_ = nullptr;
 };
 
 // Global operator<< for NativeFunction
@@ -76,16 +341,31 @@ using ValueVariant = std::variant<
     double,
     float,
     bool,
-    std::string,
+    StringValue,
     std::vector<struct Value>,
-    std::unordered_map<std::string, struct Value>,
+    MapValue,
     std::shared_ptr<ClassInstance>,
     std::shared_ptr<ObjectInstance>,
     const FunctionStmt*,
     NativeFunction,
-    LambdaValue
+    LambdaValue,
+    std::shared_ptr<SetValue>,
+    std::shared_ptr<IteratorValue>,
+    std::shared_ptr<StringBuilderValue>
 >;
 
+// Position of T among ValueVariant's alternatives, as returned by
+// Value::index(). std::string names the StringValue alternative.
+template<typename T, size_t I = 0>
+constexpr size_t valueTypeIndex() {
+    using U = std::conditional_t<std::is_same_v<T, std::string>, StringValue, T>;
+    static_assert(I < std::variant_size_v<ValueVariant>, "valueTypeIndex: not a Value alternative");
+    if constexpr (std::is_same_v<std::variant_alternative_t<I, ValueVariant>, U>) return I;
+    else return valueTypeIndex<U, I + 1>();
+}
+
+bool setsEqual(const SetValue& a, const SetValue& b);
+
 struct Value {
     ValueVariant data;
 
@@ -119,12 +399,19 @@ struct Value {
         return *this;
     }
 
-    // Accessors for std::variant functionality
+    // Accessors for std::variant functionality. std::string names the
+    // StringValue alternative; get<std::string>() materializes a view.
     template<typename T>
-    bool holds_alternative() const { return std::holds_alternative<T>(data); }
+    bool holds_alternative() const {
+        if constexpr (std::is_same_v<T, std::string>) return std::holds_alternative<StringValue>(data);
+        else return std::holds_alternative<T>(data);
+    }
 
     template<typename T>
-    const T& get() const { return std::get<T>(data); }
+    const T& get() const {
+        if constexpr (std::is_same_v<T, std::string>) return std::get<StringValue>(data).str();
+        else return std::get<T>(data);
+    }
 
     size_t index() const { return data.index(); }
 
@@ -136,7 +423,7 @@ struct Value {
             [](double a, double b) { return a == b; },
             [](float a, float b) { return a == b; },
             [](bool a, bool b) { return a == b; },
-            [](const std::string& a, const std::string& b) { return a == b; },
+            [](const StringValue& a, const StringValue& b) { return a == b; },
             [](const std::vector<Value>& a, const std::vector<Value>& b) {
                 if (a.size() != b.size()) return false;
                 for (size_t i = 0; i < a.size(); ++i) {
@@ -144,7 +431,7 @@ struct Value {
                 }
                 return true;
             },
-            [](const std::unordered_map<std::string, Value>& a, const std::unordered_map<std::string, Value>& b) {
+            [](const MapValue& a, const MapValue& b) {
                 if (a.size() != b.size()) return false;
                 for (const auto& pair : a) {
                     auto it = b.find(pair.first);
@@ -157,6 +444,9 @@ struct Value {
             [](const FunctionStmt* a, const FunctionStmt* b) { return a == b; },
             [](const NativeFunction& a, const NativeFunction& b) { return a.function == b.function; },
             [](const LambdaValue& a, const LambdaValue& b) { return a == b; },
+            [](const std::shared_ptr<SetValue>& a, const std::shared_ptr<SetValue>& b) { return setsEqual(*a, *b); },
+            [](const std::shared_ptr<IteratorValue>& a, const std::shared_ptr<IteratorValue>& b) { return a == b; },
+            [](const std::shared_ptr<StringBuilderValue>& a, const std::shared_ptr<StringBuilderValue>& b) { return a == b; },
             [](auto&&, auto&&) { return false; } // Fallback for unmatched types (should not happen if all are listed)
         }, data, other.data);
     }
@@ -174,15 +464,436 @@ struct Value {
             [](double a, double b) { return a < b; },
             [](float a, float b) { return a < b; },
             [](bool a, bool b) { return a < b; },
-            [](const std::string& a, const std::string& b) { return a < b; },
+            [](const StringValue& a, const StringValue& b) { return a < b; },
             [](const std::vector<Value>&, const std::vector<Value>&) { return false; }, // Arbitrary for vector
-            [](const std::unordered_map<std::string, Value>&, const std::unordered_map<std::string, Value>&) { return false; }, // Arbitrary for map
+            [](const MapValue&, const MapValue&) { return false; }, // Arbitrary for map
             [](const std::shared_ptr<ClassInstance>& a, const std::shared_ptr<ClassInstance>& b) { return a < b; }, // Pointer comparison
             [](const std::shared_ptr<ObjectInstance>& a, const std::shared_ptr<ObjectInstance>& b) { return a < b; }, // Pointer comparison
             [](const FunctionStmt* a, const FunctionStmt* b) { return a < b; }, // Pointer comparison
             [](const NativeFunction&, const NativeFunction&) { return false; }, // No meaningful order
-            [](const LambdaValue& a, const LambdaValue& b) { return a.body < b.body; }, // Compare by body pointer
+            [](const LambdaValue& a, const LambdaValue& b) { return a.expr < b.expr; }, // Compare by expression pointer
+            [](const std::shared_ptr<SetValue>& a, const std::shared_ptr<SetValue>& b) { return a < b; }, // Pointer comparison
+            [](const std::shared_ptr<IteratorValue>& a, const std::shared_ptr<IteratorValue>& b) { return a < b; }, // Pointer comparison
+            [](const std::shared_ptr<StringBuilderValue>& a, const std::shared_ptr<StringBuilderValue>& b) { return a < b; }, // Pointer comparison
             [](auto&&, auto&&) { return false; } // Fallback for unmatched types
         }, data, other.data);
     }
-};
\ No newline at end of file
+};
+
+// ============================================================================
+// Hashing (used by sets and maps)
+// ============================================================================
+
+inline size_t hashCombine(size_t seed, size_t h) {
+    return seed ^ (h + 0x9e3779b97f4a7c15ULL + (seed << 6) + (seed >> 2));
+}
+
+size_t hashValue(const Value& val);
+
+struct ValueHash {
+    size_t operator()(const Value& val) const { return hashValue(val); }
+};
+
+// Hashed set of Values. Shared by reference like class instances, so
+// set_add and friends update it in place. Iteration follows insertion order.
+//
+// Layout: items in insertion order (removals leave tombstones until the next
+// rebuild) plus an open-addressing table of int32 positions into items.
+// Handles may be shared with goroutines and parallel for workers, so every
+// operation takes the set's lock. It is recursive because comparing items
+// can reach a set nested inside this one (or the set itself).
+struct SetValue {
+    size_t size() const {
+        std::lock_guard<std::recursive_mutex> lock(mutex);
+        return count;
+    }
+
+    bool contains(const Value& val) const {
+        size_t h = hashValue(val);
+        std::lock_guard<std::recursive_mutex> lock(mutex);
+        return find(val, h) >= 0;
+    }
+
+    // Returns false if val was already present
+    bool insert(const Value& val) {
+        size_t h = hashValue(val);
+        std::lock_guard<std::recursive_mutex> lock(mutex);
+        if (find(val, h) >= 0) return false;
+        if ((items.size() + 1) * 4 > table.size() * 3) rebuild(count + 1);
+        size_t mask = table.size() - 1;
+        size_t i = mix(h) & mask;
+        while (table[i] >= 0) i = (i + 1) & mask;
+        table[i] = static_cast<int32_t>(items.size());
+        items.push_back(val);
+        hashes.push_back(h);
+        live.push_back(true);
+        ++count;
+        return true;
+    }
+
+    // Returns false if val was not present
+    bool erase(const Value& val) {
+        size_t h = hashValue(val);
+        std::lock_guard<std::recursive_mutex> lock(mutex);
+        if (table.empty()) return false;
+        size_t mask = table.size() - 1;
+        for (size_t i = mix(h) & mask; table[i] != kEmpty; i = (i + 1) & mask) {
+            int32_t e = table[i];
+            if (e >= 0 && hashes[e] == h && items[e] == val) {
+                table[i] = kDeleted;
+                live[e] = false;
+                items[e] = Value();
+                --count;
+                if (items.size() > 16 && items.size() > count * 2) rebuild(count);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void reserve(size_t n) {
+        std::lock_guard<std::recursive_mutex> lock(mutex);
+        if (n * 4 > table.size() * 3) rebuild(n);
+        items.reserve(n);
+        hashes.reserve(n);
+    }
+
+    // Calls fn on a snapshot, so fn may read or update this set
+    template<typename F>
+    void forEach(F&& fn) const {
+        for (const auto& v : toList()) fn(v);
+    }
+
+    std::vector<Value> toList() const {
+        std::lock_guard<std::recursive_mutex> lock(mutex);
+        std::vector<Value> out;
+        out.reserve(count);
+        for (size_t i = 0; i < items.size(); ++i) {
+            if (live[i]) out.push_back(items[i]);
+        }
+        return out;
+    }
+
+private:
+    std::vector<Value> items;
+    std::vector<size_t> hashes;
+    std::vector<bool> live;
+    std::vector<int32_t> table;   // kEmpty, kDeleted, or a position in items
+    size_t count = 0;
+    mutable std::recursive_mutex mutex;
+
+    static constexpr int32_t kEmpty = -1;
+    static constexpr int32_t kDeleted = -2;
+
+    static size_t mix(size_t h) {
+        // splitmix64 finalizer: spreads sequential ints across the table
+        h ^= h >> 30; h *= 0xbf58476d1ce4e5b9ULL;
+        h ^= h >> 27; h *= 0x94d049bb133111ebULL;
+        return h ^ (h >> 31);
+    }
+
+    long find(const Value& val, size_t h) const {
+        if (table.empty()) return -1;
+        size_t mask = table.size() - 1;
+        for (size_t i = mix(h) & mask; table[i] != kEmpty; i = (i + 1) & mask) {
+            int32_t e = table[i];
+            if (e >= 0 && hashes[e] == h && items[e] == val) return e;
+        }
+        return -1;
+    }
+
+    // Drops tombstones and resizes the table for at least n live items
+    void rebuild(size_t n) {
+        size_t cap = 8;
+        while (cap * 3 < n * 4 + 4) cap <<= 1;
+        size_t out = 0;
+        for (size_t i = 0; i < items.size(); ++i) {
+            if (!live[i]) continue;
+            if (out != i) {
+                items[out] = std::move(items[i]);
+                hashes[out] = hashes[i];
+            }
+            ++out;
+        }
+        items.resize(out);
+        hashes.resize(out);
+        live.assign(out, true);
+        table.assign(cap, kEmpty);
+        for (size_t e = 0; e < out; ++e) {
+            size_t i = mix(hashes[e]) & (cap - 1);
+            while (table[i] != kEmpty) i = (i + 1) & (cap - 1);
+            table[i] = static_cast<int32_t>(e);
+        }
+    }
+};
+
+// Lazily produced sequence (e.g. io_lines) consumed by for loops and list
+// comprehensions. next() stores the following item in `out` and returns false
+// once the sequence is exhausted; an iterator can be walked only once.
+struct IteratorValue {
+    std::string kind;   // Shown by print, e.g. "lines"
+    std::function<bool(Value& out)> next;
+};
+
+// Mutable text buffer behind a shared handle: appends go through every
+// variable holding it, and never copy what was already written
+struct StringBuilderValue {
+    std::string buffer;
+};
+
+// The text + gives a number, bool or null next to a string; false for the
+// operands + does not concatenate
+inline bool appendConcatScalar(std::string& out, const Value& val) {
+    if (val.holds_alternative<int>()) out += numberToString(val.get<int>());
+    else if (val.holds_alternative<double>()) out += numberToString(val.get<double>());
+    else if (val.holds_alternative<float>()) out += numberToString(val.get<float>());
+    else if (val.holds_alternative<bool>()) out += val.get<bool>() ? "true" : "false";
+    else if (val.holds_alternative<std::monostate>()) out += "null";
+    else return false;
+    return true;
+}
+
+inline bool setsEqual(const SetValue& a, const SetValue& b) {
+    if (a.size() != b.size()) return false;
+    bool equal = true;
+    a.forEach([&](const Value& v) { if (equal && !b.contains(v)) equal = false; });
+    return equal;
+}
+
+inline size_t hashValue(const Value& val) {
+    return std::visit(overloaded {
+        [](std::monostate) -> size_t { return 0; },
+        [](int v) -> size_t { return std::hash<int>{}(v); },
+        [](double v) -> size_t { return std::hash<double>{}(v); },
+        [](float v) -> size_t { return std::hash<float>{}(v); },
+        [](bool v) -> size_t { return v ? 1231 : 1237; },
+        [](const StringValue& v) -> size_t { return std::hash<std::string_view>{}(v.view()); },
+        [](const std::vector<Value>& v) -> size_t {
+            size_t h = 0x345678;
+            for (const auto& item : v) h = hashCombine(h, hashValue(item));
+            return h;
+        },
+        [](const MapValue& v) -> size_t {
+            size_t h = v.size();  // Order-independent: maps compare without order
+            for (const auto& [key, item] : v) h ^= hashCombine(hashValue(key), hashValue(item));
+            return h;
+        },
+        [](const std::shared_ptr<ClassInstance>& v) -> size_t { return std::hash<void*>{}(v.get()); },
+        [](const std::shared_ptr<ObjectInstance>& v) -> size_t { return std::hash<void*>{}(v.get()); },
+        [](const FunctionStmt* v) -> size_t { return std::hash<const void*>{}(v); },
+        [](const NativeFunction& v) -> size_t { return std::hash<void*>{}(reinterpret_cast<void*>(v.function)); },
+        [](const LambdaValue& v) -> size_t { return std::hash<const void*>{}(v.expr); },
+        [](const std::shared_ptr<SetValue>& v) -> size_t { return v->size(); },  // Content-equal sets must hash alike
+        [](const std::shared_ptr<IteratorValue>& v) -> size_t { return std::hash<void*>{}(v.get()); },
+        [](const std::shared_ptr<StringBuilderValue>& v) -> size_t { return std::hash<void*>{}(v.get()); }
+    }, val.data);
+}
+
+// ============================================================================
+// MapValue members
+// ============================================================================
+
+inline MapValue::MapValue(std::initializer_list<Entry> init) {
+    reserve(init.size());
+    for (const auto& entry : init) (*this)[entry.first] = entry.second;
+}
+
+inline MapValue::MapValue(const MapValue& other) : entries_(other.entries_) {
+    if (other.index_) {
+        size_t words = indexWords(other.index_[0]);
+        index_ = new uint32_t[words];
+        std::memcpy(index_, other.index_, words * sizeof(uint32_t));
+    }
+}
+
+inline MapValue::MapValue(MapValue&& other) noexcept
+    : entries_(std::move(other.entries_)), index_(other.index_) {
+    other.entries_.clear();
+    other.index_ = nullptr;
+}
+
+inline MapValue& MapValue::operator=(const MapValue& other) {
+    if (this != &other) *this = MapValue(other);
+    return *this;
+}
+
+inline MapValue& MapValue::operator=(MapValue&& other) noexcept {
+    if (this != &other) {
+        entries_ = std::move(other.entries_);
+        other.entries_.clear();
+        delete[] index_;
+        index_ = other.index_;
+        other.index_ = nullptr;
+    }
+    return *this;
+}
+
+inline MapValue::~MapValue() { delete[] index_; }
+
+inline void MapValue::reserve(size_t n) {
+    entries_.reserve(n);
+    if (n > kSmallMap && (!index_ || n * 2 > index_[0])) rebuild(n);
+}
+
+inline void MapValue::clear() {
+    entries_.clear();
+    delete[] index_;
+    index_ = nullptr;
+}
+
+inline MapValue::iterator MapValue::begin() { return iterator(this, 0); }
+inline MapValue::iterator MapValue::end() { return iterator(this, entries_.size()); }
+inline MapValue::const_iterator MapValue::begin() const { return const_iterator(this, 0); }
+inline MapValue::const_iterator MapValue::end() const { return const_iterator(this, entries_.size()); }
+
+inline size_t MapValue::mix(size_t h) {
+    // splitmix64 finalizer: spreads sequential ints across the table
+    h ^= h >> 30; h *= 0xbf58476d1ce4e5b9ULL;
+    h ^= h >> 27; h *= 0x94d049bb133111ebULL;
+    return h ^ (h >> 31);
+}
+
+inline size_t MapValue::keyHash(const Value& key) { return mix(hashValue(key)); }
+
+// Must agree with hashValue() for string Values
+inline size_t MapValue::keyHash(const std::string& key) { return mix(std::hash<std::string_view>{}(key)); }
+
+inline bool MapValue::keyEquals(const Value& a, const Value& key) { return a == key; }
+
+inline bool MapValue::keyEquals(const Value& a, const std::string& key) {
+    return a.holds_alternative<std::string>() && std::get<StringValue>(a.data).view() == key;
+}
+
+template<typename K>
+long MapValue::locate(const K& key, size_t h, size_t* slot) const {
+    if (!index_) {
+        for (size_t e = 0; e < entries_.size(); ++e) {
+            if (keyEquals(entries_[e].first, key)) return static_cast<long>(e);
+        }
+        return -1;
+    }
+    const uint32_t* slots = index_ + 2;
+    size_t mask = index_[0] - 1;
+    for (size_t i = h & mask; slots[i] != kEmpty; i = (i + 1) & mask) {
+        uint32_t e = slots[i];
+        if (e != kDeleted && keyEquals(entries_[e].first, key)) {
+            if (slot) *slot = i;
+            return static_cast<long>(e);
+        }
+    }
+    return -1;
+}
+
+template<typename K>
+Value& MapValue::insertKey(K&& key) {
+    size_t h = index_ ? keyHash(key) : 0;
+    long e = locate(key, h, nullptr);
+    if (e >= 0) return entries_[e].second;
+
+    if (!index_) {
+        if (entries_.size() < kSmallMap) {
+            entries_.emplace_back(Value(std::forward<K>(key)), Value());
+            return entries_.back().second;
+        }
+        rebuild(entries_.size() + 1);
+        h = keyHash(key);
+    } else if ((entries_.size() + 1) * 2 > index_[0]) {
+        rebuild(size() + 1);
+    }
+
+    uint32_t* slots = index_ + 2;
+    size_t mask = index_[0] - 1;
+    size_t i = h & mask;
+    while (slots[i] < kDeleted) i = (i + 1) & mask;
+    slots[i] = static_cast<uint32_t>(entries_.size());
+    entries_.emplace_back(Value(std::forward<K>(key)), Value());
+    return entries_.back().second;
+}
+
+template<typename K>
+size_t MapValue::eraseKey(const K& key) {
+    if (!index_) {
+        long e = locate(key, 0, nullptr);
+        if (e < 0) return 0;
+        entries_.erase(entries_.begin() + e);
+        return 1;
+    }
+    size_t slot = 0;
+    long e = locate(key, keyHash(key), &slot);
+    if (e < 0) return 0;
+    index_[2 + slot] = kDeleted;
+    index_[2 + index_[0] + (e >> 5)] |= 1u << (e & 31);
+    entries_[e] = Entry();
+    ++index_[1];
+    if (index_[1] > 16 && index_[1] * 2 > entries_.size()) rebuild(size());
+    return 1;
+}
+
+// Drops tombstones and sizes the index for n live entries at load <= 1/2
+inline void MapValue::rebuild(size_t n) {
+    uint32_t cap = 32;
+    while (cap < n * 2) cap <<= 1;
+    if (index_ && index_[1]) {
+        size_t out = 0;
+        for (size_t e = 0; e < entries_.size(); ++e) {
+            if (isDead(e)) continue;
+            if (out != e) entries_[out] = std::move(entries_[e]);
+            ++out;
+        }
+        entries_.resize(out);
+    }
+    delete[] index_;
+    index_ = new uint32_t[indexWords(cap)];
+    index_[0] = cap;
+    index_[1] = 0;
+    std::fill(index_ + 2, index_ + 2 + cap, kEmpty);
+    std::fill(index_ + 2 + cap, index_ + indexWords(cap), 0u);
+    uint32_t* slots = index_ + 2;
+    for (size_t e = 0; e < entries_.size(); ++e) {
+        size_t i = keyHash(entries_[e].first) & (cap - 1);
+        while (slots[i] != kEmpty) i = (i + 1) & (cap - 1);
+        slots[i] = static_cast<uint32_t>(e);
+    }
+}
+
+inline MapValue::iterator MapValue::find(const Value& key) {
+    long e = locate(key, index_ ? keyHash(key) : 0, nullptr);
+    return iterator(this, e < 0 ? entries_.size() : static_cast<size_t>(e));
+}
+
+inline MapValue::iterator MapValue::find(const std::string& key) {
+    long e = locate(key, index_ ? keyHash(key) : 0, nullptr);
+    return iterator(this, e < 0 ? entries_.size() : static_cast<size_t>(e));
+}
+
+inline MapValue::const_iterator MapValue::find(const Value& key) const {
+    long e = locate(key, index_ ? keyHash(key) : 0, nullptr);
+    return const_iterator(this, e < 0 ? entries_.size() : static_cast<size_t>(e));
+}
+
+inline MapValue::const_iterator MapValue::find(const std::string& key) const {
+    long e = locate(key, index_ ? keyHash(key) : 0, nullptr);
+    return const_iterator(this, e < 0 ? entries_.size() : static_cast<size_t>(e));
+}
+
+inline size_t MapValue::count(const Value& key) const { return find(key) != end() ? 1 : 0; }
+inline size_t MapValue::count(const std::string& key) const { return find(key) != end() ? 1 : 0; }
+
+inline Value& MapValue::operator[](const Value& key) { return insertKey(key); }
+inline Value& MapValue::operator[](const std::string& key) { return insertKey(key); }
+inline Value& MapValue::operator[](std::string&& key) { return insertKey(std::move(key)); }
+
+inline Value& MapValue::at(const std::string& key) {
+    auto it = find(key);
+    if (it == end()) throw std::out_of_range("map key not found: " + key);
+    return it->second;
+}
+
+inline const Value& MapValue::at(const std::string& key) const {
+    auto it = find(key);
+    if (it == end()) throw std::out_of_range("map key not found: " + key);
+    return it->second;
+}
+
+inline size_t MapValue::erase(const Value& key) { return eraseKey(key); }
+inline size_t MapValue::erase(const std::string& key) { return eraseKey(key); }
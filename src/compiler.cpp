@@ -10,6 +10,9 @@
 #include <cmath>
 #include <filesystem>
 #include <thread>
+#include <mutex>
+#include <atomic>
+#include <map>
 
 // ============================================================================
 // Helper: Convert any Value to a string representation
@@ -17,36 +20,11 @@
 std::string Interpreter::valueToString(const Value& val) {
     return std::visit(overloaded {
         [](std::monostate) -> std::string { return "null"; },
-        [](int v) -> std::string { return std::to_string(v); },
-        [](double v) -> std::string {
-            std::string s = std::to_string(v);
-            // Remove trailing zeros after decimal point for cleaner output
-            size_t dot = s.find('.');
-            if (dot != std::string::npos) {
-                size_t last = s.find_last_not_of('0');
-                if (last != std::string::npos && last > dot) {
-                    s = s.substr(0, last + 1);
-                } else if (last == dot) {
-                    s = s.substr(0, dot + 2); // Keep at least one digit after dot
-                }
-            }
-            return s;
-        },
-        [](float v) -> std::string {
-            std::string s = std::to_string(v);
-            size_t dot = s.find('.');
-            if (dot != std::string::npos) {
-                size_t last = s.find_last_not_of('0');
-                if (last != std::string::npos && last > dot) {
-                    s = s.substr(0, last + 1);
-                } else if (last == dot) {
-                    s = s.substr(0, dot + 2);
-                }
-            }
-            return s;
-        },
+        [](int v) -> std::string { return numberToString(v); },
+        [](double v) -> std::string { return doubleToDisplay(v); },
+        [](float v) -> std::string { return doubleToDisplay(v); },
         [](bool v) -> std::string { return v ? "true" : "false"; },
-        [](const std::string& v) -> std::string { return v; },
+        [](const StringValue& v) -> std::string { return std::string(v.view()); },
         [this](const std::vector<Value>& v) -> std::string {
             std::string result = "[";
             for (size_t i = 0; i < v.size(); ++i) {
@@ -56,13 +34,13 @@ std::string Interpreter::valueToString(const Value& val) {
             result += "]";
             return result;
         },
-        [this](const std::unordered_map<std::string, Value>& v) -> std::string {
+        [this](const MapValue& v) -> std::string {
             std::string result = "{";
             bool first = true;
             for (const auto& [key, val] : v) {
                 if (!first) result += ", ";
                 first = false;
-                result += key + ": " + valueToString(val);
+                result += valueToString(key) + ": " + valueToString(val);
             }
             result += "}";
             return result;
@@ -118,10 +96,289 @@ std::string Interpreter::valueToString(const Value& val) {
         },
         [](const LambdaValue&) -> std::string {
             return "{lambda}";
-        }
+        },
+        [this](const std::shared_ptr<SetValue>& v) -> std::string {
+            if (v->size() == 0) return "set()";
+            std::string result = "{";
+            bool first = true;
+            v->forEach([&](const Value& item) {
+                if (!first) result += ", ";
+                first = false;
+                result += valueToString(item);
+            });
+            result += "}";
+            return result;
+        },
+        [](const std::shared_ptr<IteratorValue>& v) -> std::string {
+            return "{iterator " + v->kind + "}";
+        },
+        [](const std::shared_ptr<StringBuilderValue>& v) -> std::string { return v->buffer; }
     }, val.data);
 }
 
+// ============================================================================
+// Helper: the storage a plain assignment to `name` writes to, or nullptr
+// ============================================================================
+Value* Interpreter::findVariableSlot(const std::string& name) {
+    if (environment) {
+        auto it = environment->values.find(name);
+        if (it != environment->values.end()) return &it->second;
+    }
+    auto it = variables.find(name);
+    return it != variables.end() ? &it->second : nullptr;
+}
+
+// ============================================================================
+// Helper: target + rhs for a string or string builder target, appended in
+// place (same text as the + operator). False if the pair needs the generic +.
+// ============================================================================
+bool Interpreter::appendInPlace(Value& target, const Value& rhs) {
+    if (target.holds_alternative<std::shared_ptr<StringBuilderValue>>()) {
+        auto& buffer = target.get<std::shared_ptr<StringBuilderValue>>()->buffer;
+        if (rhs.holds_alternative<std::string>()) buffer += rhs.get<std::string>();
+        else if (!appendConcatScalar(buffer, rhs)) buffer += valueToString(rhs);
+        return true;
+    }
+    if (!target.holds_alternative<std::string>()) return false;
+    std::string& str = std::get<StringValue>(target.data).mutableText();
+    if (rhs.holds_alternative<std::string>()) {
+        str += std::get<StringValue>(rhs.data).view();
+        return true;
+    }
+    return appendConcatScalar(str, rhs);
+}
+
+// ============================================================================
+// Built-in methods on strings, lists, string builders and numbers. One table
+// per Value alternative, indexed by the method's interned name.
+// ============================================================================
+struct BuiltinMethods {
+    using Fn = Value (*)(Interpreter& interp, Value& self, std::vector<Value>& args);
+
+    static Fn find(size_t type, int id) {
+        const auto& row = tables().byType[type];
+        return static_cast<size_t>(id) < row.size() ? row[id] : nullptr;
+    }
+
+private:
+    struct Tables {
+        std::vector<Fn> byType[std::variant_size_v<ValueVariant>];
+    };
+
+    template<typename T>
+    static void add(Tables& t, const char* name, Fn fn) {
+        size_t id = static_cast<size_t>(YenNative::Methods::intern(name));
+        auto& row = t.byType[valueTypeIndex<T>()];
+        if (row.size() <= id) row.resize(id + 1, nullptr);
+        row[id] = fn;
+    }
+
+    static const Tables& tables() {
+        static const Tables t = build();
+        return t;
+    }
+
+    static Tables build() {
+        using Builder = std::shared_ptr<StringBuilderValue>;
+        using List = std::vector<Value>;
+        Tables t;
+        add<std::string>(t, "length", strLength);
+        add<std::string>(t, "upper", strUpper);
+        add<std::string>(t, "lower", strLower);
+        add<std::string>(t, "trim", strTrim);
+        add<std::string>(t, "split", strSplit);
+        add<std::string>(t, "replace", strReplace);
+        add<std::string>(t, "contains", strContains);
+        add<std::string>(t, "starts_with", strStartsWith);
+        add<std::string>(t, "ends_with", strEndsWith);
+        add<std::string>(t, "reverse", strReverse);
+        add<std::string>(t, "chars", strChars);
+        add<List>(t, "length", listLength);
+        add<List>(t, "push", listPush);
+        add<List>(t, "pop", listPop);
+        add<List>(t, "reverse", listReverse);
+        add<List>(t, "sort", listSort);
+        add<List>(t, "contains", listContains);
+        add<List>(t, "join", listJoin);
+        add<Builder>(t, "append", sbAppend);
+        add<Builder>(t, "append_many", sbAppendMany);
+        add<Builder>(t, "reserve", sbReserve);
+        add<Builder>(t, "to_string", sbToString);
+        add<Builder>(t, "length", sbLength);
+        add<Builder>(t, "clear", sbClear);
+        add<int>(t, "abs", intAbs);
+        add<double>(t, "abs", floatAbs);
+        add<double>(t, "floor", floatFloor);
+        add<double>(t, "ceil", floatCeil);
+        add<double>(t, "round", floatRound);
+        return t;
+    }
+
+    static const StringValue& str(const Value& self) { return std::get<StringValue>(self.data); }
+
+    static std::string argText(Interpreter& interp, std::vector<Value>& args, size_t i, const char* method) {
+        if (args.size() <= i) throw std::runtime_error(std::string(method) + "() requires " + std::to_string(i + 1) + " argument(s).");
+        return interp.valueToString(args[i]);
+    }
+
+    // ---- String ----
+    static Value strLength(Interpreter&, Value& self, std::vector<Value>&) {
+        return Value(static_cast<int>(str(self).size()));
+    }
+    static Value strUpper(Interpreter&, Value& self, std::vector<Value>&) {
+        std::string r(str(self).view());
+        std::transform(r.begin(), r.end(), r.begin(), ::toupper);
+        return Value(std::move(r));
+    }
+    static Value strLower(Interpreter&, Value& self, std::vector<Value>&) {
+        std::string r(str(self).view());
+        std::transform(r.begin(), r.end(), r.begin(), ::tolower);
+        return Value(std::move(r));
+    }
+    static Value strTrim(Interpreter&, Value& self, std::vector<Value>&) {
+        std::string_view v = str(self).view();
+        size_t s = v.find_first_not_of(" \t\n\r");
+        size_t e = v.find_last_not_of(" \t\n\r");
+        if (s == std::string_view::npos) return Value(std::string(""));
+        return Value(str(self).slice(s, e - s + 1));
+    }
+    static Value strSplit(Interpreter& interp, Value& self, std::vector<Value>& args) {
+        std::string delim = args.empty() ? " " : interp.valueToString(args[0]);
+        const StringValue& whole = str(self);
+        std::string_view v = whole.view();
+        std::vector<Value> parts;
+        size_t pos = 0;
+        while (true) {
+            size_t found = YenNative::String::findText(v, delim, pos);
+            if (found == std::string_view::npos) {
+                parts.push_back(Value(whole.slice(pos)));
+                break;
+            }
+            parts.push_back(Value(whole.slice(pos, found - pos)));
+            pos = found + delim.size();
+        }
+        return Value(std::move(parts));
+    }
+    static Value strReplace(Interpreter& interp, Value& self, std::vector<Value>& args) {
+        if (args.size() < 2) throw std::runtime_error("replace() requires 2 arguments.");
+        std::string from = interp.valueToString(args[0]);
+        std::string to = interp.valueToString(args[1]);
+        std::string_view v = str(self).view();
+        size_t pos = from.empty() ? std::string_view::npos : YenNative::String::findText(v, from);
+        if (pos == std::string_view::npos) return self;
+        std::string r;
+        size_t start = 0;
+        do {
+            r.append(v, start, pos - start).append(to);
+            start = pos + from.size();
+        } while ((pos = YenNative::String::findText(v, from, start)) != std::string_view::npos);
+        r.append(v, start);
+        return Value(std::move(r));
+    }
+    static Value strContains(Interpreter& interp, Value& self, std::vector<Value>& args) {
+        return Value(YenNative::String::findText(str(self).view(), argText(interp, args, 0, "contains")) != std::string_view::npos);
+    }
+    static Value strStartsWith(Interpreter& interp, Value& self, std::vector<Value>& args) {
+        std::string prefix = argText(interp, args, 0, "starts_with");
+        return Value(str(self).view().substr(0, prefix.size()) == prefix);
+    }
+    static Value strEndsWith(Interpreter& interp, Value& self, std::vector<Value>& args) {
+        std::string suffix = argText(interp, args, 0, "ends_with");
+        std::string_view v = str(self).view();
+        return Value(suffix.size() <= v.size() && v.substr(v.size() - suffix.size()) == suffix);
+    }
+    static Value strReverse(Interpreter&, Value& self, std::vector<Value>&) {
+        std::string_view v = str(self).view();
+        return Value(std::string(v.rbegin(), v.rend()));
+    }
+    static Value strChars(Interpreter&, Value& self, std::vector<Value>&) {
+        std::string_view v = str(self).view();
+        std::vector<Value> chars;
+        chars.reserve(v.size());
+        for (char c : v) chars.push_back(Value(std::string(1, c)));
+        return Value(std::move(chars));
+    }
+
+    // ---- List: self is the caller's temporary, so methods that return a
+    // changed list take its elements instead of copying them ----
+    static std::vector<Value>& list(Value& self) { return std::get<std::vector<Value>>(self.data); }
+
+    static Value listLength(Interpreter&, Value& self, std::vector<Value>&) {
+        return Value(static_cast<int>(list(self).size()));
+    }
+    static Value listPush(Interpreter&, Value& self, std::vector<Value>& args) {
+        if (args.empty()) throw std::runtime_error("push() requires 1 argument(s).");
+        list(self).push_back(std::move(args[0]));
+        return std::move(self);
+    }
+    static Value listPop(Interpreter&, Value& self, std::vector<Value>&) {
+        if (list(self).empty()) throw std::runtime_error("pop() on empty list.");
+        return std::move(list(self).back());
+    }
+    static Value listReverse(Interpreter&, Value& self, std::vector<Value>&) {
+        std::reverse(list(self).begin(), list(self).end());
+        return std::move(self);
+    }
+    static Value listSort(Interpreter&, Value& self, std::vector<Value>&) {
+        std::sort(list(self).begin(), list(self).end());
+        return std::move(self);
+    }
+    static Value listContains(Interpreter&, Value& self, std::vector<Value>& args) {
+        if (args.empty()) throw std::runtime_error("contains() requires 1 argument(s).");
+        for (const auto& item : list(self)) {
+            if (item == args[0]) return Value(true);
+        }
+        return Value(false);
+    }
+    static Value listJoin(Interpreter& interp, Value& self, std::vector<Value>& args) {
+        std::string delim = args.empty() ? "" : interp.valueToString(args[0]);
+        const auto& items = list(self);
+        std::string r;
+        for (size_t i = 0; i < items.size(); ++i) {
+            if (i > 0) r += delim;
+            r += interp.valueToString(items[i]);
+        }
+        return Value(std::move(r));
+    }
+
+    // ---- String builder: the builder is shared, so these update it in place ----
+    static std::string& buffer(Value& self) { return std::get<std::shared_ptr<StringBuilderValue>>(self.data)->buffer; }
+
+    static Value sbAppend(Interpreter& interp, Value& self, std::vector<Value>& args) {
+        for (const auto& arg : args) interp.appendInPlace(self, arg);
+        return self;
+    }
+    static Value sbAppendMany(Interpreter& interp, Value& self, std::vector<Value>& args) {
+        if (args.empty() || !args[0].holds_alternative<std::vector<Value>>())
+            throw std::runtime_error("append_many() expects a list.");
+        std::string separator = args.size() > 1 ? interp.valueToString(args[1]) : "";
+        const auto& items = args[0].get<std::vector<Value>>();
+        for (size_t i = 0; i < items.size(); ++i) {
+            if (i > 0) buffer(self) += separator;
+            interp.appendInPlace(self, items[i]);
+        }
+        return self;
+    }
+    static Value sbReserve(Interpreter&, Value& self, std::vector<Value>& args) {
+        if (args.empty()) throw std::runtime_error("reserve() expects a capacity.");
+        buffer(self).reserve(static_cast<size_t>(std::max(0, args[0].holds_alternative<int>() ? args[0].get<int>() : 0)));
+        return self;
+    }
+    static Value sbToString(Interpreter&, Value& self, std::vector<Value>&) { return Value(buffer(self)); }
+    static Value sbLength(Interpreter&, Value& self, std::vector<Value>&) { return Value(static_cast<int>(buffer(self).size())); }
+    static Value sbClear(Interpreter&, Value& self, std::vector<Value>&) {
+        buffer(self).clear();
+        return self;
+    }
+
+    // ---- Numbers ----
+    static Value intAbs(Interpreter&, Value& self, std::vector<Value>&) { return Value(std::abs(self.get<int>())); }
+    static Value floatAbs(Interpreter&, Value& self, std::vector<Value>&) { return Value(std::abs(self.get<double>())); }
+    static Value floatFloor(Interpreter&, Value& self, std::vector<Value>&) { return Value(static_cast<int>(std::floor(self.get<double>()))); }
+    static Value floatCeil(Interpreter&, Value& self, std::vector<Value>&) { return Value(static_cast<int>(std::ceil(self.get<double>()))); }
+    static Value floatRound(Interpreter&, Value& self, std::vector<Value>&) { return Value(static_cast<int>(std::round(self.get<double>()))); }
+};
+
 // ============================================================================
 // Helper: Convert any Value to bool (truthiness)
 // ============================================================================
@@ -132,14 +389,17 @@ bool Interpreter::isTruthy(const Value& val) {
         [](double v) { return v != 0.0; },
         [](float v) { return v != 0.0f; },
         [](bool v) { return v; },
-        [](const std::string& v) { return !v.empty(); },
+        [](const StringValue& v) { return !v.empty(); },
         [](const std::vector<Value>&) { return true; },
-        [](const std::unordered_map<std::string, Value>&) { return true; },
+        [](const MapValue&) { return true; },
         [](const std::shared_ptr<ClassInstance>&) { return true; },
         [](const std::shared_ptr<ObjectInstance>&) { return true; },
         [](const FunctionStmt*) { return true; },
         [](const NativeFunction&) { return true; },
-        [](const LambdaValue&) { return true; }
+        [](const LambdaValue&) { return true; },
+        [](const std::shared_ptr<SetValue>&) { return true; },
+        [](const std::shared_ptr<IteratorValue>&) { return true; },
+        [](const std::shared_ptr<StringBuilderValue>&) { return true; }
     }, val.data);
 }
 
@@ -157,6 +417,7 @@ void Interpreter::initNativeModuleRegistry() {
     nativeModules["net.http"] = YenNative::NetHTTP::registerFunctions;
     nativeModules["os"] = YenNative::OS::registerFunctions;
     nativeModules["async"] = YenNative::Async::registerFunctions;
+    nativeModules["loop"] = YenNative::EventLoop::registerFunctions;
     // Phase 5: Standard libraries
     nativeModules["datetime"] = YenNative::DateTime::registerFunctions;
     nativeModules["testing"] = YenNative::Testing::registerFunctions;
@@ -165,6 +426,8 @@ void Interpreter::initNativeModuleRegistry() {
     nativeModules["path"] = YenNative::Path::registerFunctions;
     nativeModules["csv"] = YenNative::CSV::registerFunctions;
     nativeModules["event"] = YenNative::Event::registerFunctions;
+    nativeModules["hash"] = YenNative::Hash::registerFunctions;
+    nativeModules["aio"] = YenNative::AsyncIO::registerFunctions;
     // Aliases for convenience
     nativeModules["net"] = [](std::unordered_map<std::string, Value>& g) {
         YenNative::NetSocket::registerFunctions(g);
@@ -241,20 +504,7 @@ Value Interpreter::evalExpr(const Expression* expr) {
     // ---- LambdaExpr (expression or block body) ----
     if (auto lambdaExpr = dynamic_cast<const LambdaExpr*>(expr)) {
         auto captured = std::make_shared<std::unordered_map<std::string, Value>>(variables);
-        LambdaValue lambda = lambdaExpr->blockBody
-            ? LambdaValue(lambdaExpr->parameters, nullptr, lambdaExpr->blockBody.get(), captured)
-            : LambdaValue(lambdaExpr->parameters, lambdaExpr->body.get(), captured);
-
-        // Capture default expressions
-        if (!lambdaExpr->parameterDefaults.empty()) {
-            auto defaults = std::make_shared<std::vector<const Expression*>>();
-            for (const auto& d : lambdaExpr->parameterDefaults) {
-                defaults->push_back(d ? d.get() : nullptr);
-            }
-            lambda.defaultExprs = defaults;
-        }
-
-        return lambda;
+        return LambdaValue(lambdaExpr, captured);
     }
 
     // ---- RangeExpr ----
@@ -303,7 +553,7 @@ Value Interpreter::evalExpr(const Expression* expr) {
         if (typeName == "string" || typeName == "str") return Value(obj.holds_alternative<std::string>());
         if (typeName == "bool") return Value(obj.holds_alternative<bool>());
         if (typeName == "list") return Value(obj.holds_alternative<std::vector<Value>>());
-        if (typeName == "map") return Value(obj.holds_alternative<std::unordered_map<std::string, Value>>());
+        if (typeName == "map") return Value(obj.holds_alternative<MapValue>());
         if (typeName == "function" || typeName == "func") {
             return Value(obj.holds_alternative<const FunctionStmt*>() ||
                         obj.holds_alternative<NativeFunction>() ||
@@ -384,8 +634,8 @@ Value Interpreter::evalExpr(const Expression* expr) {
             if (it != instance->fields.end()) return it->second;
             return Value();  // field not found → null
         }
-        if (object.holds_alternative<std::unordered_map<std::string, Value>>()) {
-            const auto& map = object.get<std::unordered_map<std::string, Value>>();
+        if (object.holds_alternative<MapValue>()) {
+            const auto& map = object.get<MapValue>();
             auto it = map.find(optGet->name);
             if (it != map.end()) return it->second;
             return Value();
@@ -489,8 +739,8 @@ Value Interpreter::evalExpr(const Expression* expr) {
                 }
             }
             throw std::runtime_error("Field '" + getExpr->name + "' not found in ClassInstance.");
-        } else if (object.holds_alternative<std::unordered_map<std::string, Value>>()) {
-            const auto& map = object.get<std::unordered_map<std::string, Value>>();
+        } else if (object.holds_alternative<MapValue>()) {
+            const auto& map = object.get<MapValue>();
             auto it = map.find(getExpr->name);
             if (it != map.end()) {
                 return it->second;
@@ -558,6 +808,7 @@ Value Interpreter::evalExpr(const Expression* expr) {
     if (auto input = dynamic_cast<const InputExpr*>(expr)) {
         std::string response;
         std::cout << input->prompt << " ";
+        YenNative::Console::flush();
         std::getline(std::cin, response);
 
         if (input->type == "int") {
@@ -590,16 +841,11 @@ Value Interpreter::evalExpr(const Expression* expr) {
 
     // ---- MapExpr: evaluate key-value pairs ----
     if (auto mapExpr = dynamic_cast<const MapExpr*>(expr)) {
-        std::unordered_map<std::string, Value> result;
+        MapValue result;
+        result.reserve(mapExpr->pairs.size());
         for (const auto& [keyExpr, valExpr] : mapExpr->pairs) {
             Value key = evalExpr(keyExpr.get());
-            Value val = evalExpr(valExpr.get());
-            if (!key.holds_alternative<std::string>()) {
-                // Convert key to string if not already
-                result[valueToString(key)] = val;
-            } else {
-                result[key.get<std::string>()] = val;
-            }
+            result[key] = evalExpr(valExpr.get());
         }
         return result;
     }
@@ -628,19 +874,12 @@ Value Interpreter::evalExpr(const Expression* expr) {
 
             return list[idx];
         }
-        else if (container.holds_alternative<std::unordered_map<std::string, Value>>()) {
-            const auto& map = container.get<std::unordered_map<std::string, Value>>();
-
-            std::string key;
-            if (index.holds_alternative<std::string>()) {
-                key = index.get<std::string>();
-            } else {
-                key = valueToString(index);
-            }
+        else if (container.holds_alternative<MapValue>()) {
+            const auto& map = container.get<MapValue>();
 
-            auto it = map.find(key);
+            auto it = map.find(index);
             if (it == map.end())
-                throw std::runtime_error("Field '" + key + "' not found in struct.");
+                throw std::runtime_error("Field '" + valueToString(index) + "' not found in struct.");
 
             return it->second;
         }
@@ -656,7 +895,7 @@ Value Interpreter::evalExpr(const Expression* expr) {
         }
         else if (container.holds_alternative<std::string>()) {
             // String indexing: return character at index
-            const auto& str = container.get<std::string>();
+            std::string_view str = std::get<StringValue>(container.data).view();
             int idx;
             if (index.holds_alternative<int>()) {
                 idx = index.get<int>();
@@ -704,7 +943,7 @@ Value Interpreter::evalExpr(const Expression* expr) {
             return std::vector<Value>(list.begin() + start, list.begin() + end);
         }
         else if (container.holds_alternative<std::string>()) {
-            const auto& str = container.get<std::string>();
+            const auto& str = std::get<StringValue>(container.data);
             int size = static_cast<int>(str.size());
             int start = 0, end = size;
             if (sliceExpr->start) {
@@ -718,7 +957,7 @@ Value Interpreter::evalExpr(const Expression* expr) {
                 if (end > size) end = size;
             }
             if (start >= end) return std::string("");
-            return str.substr(start, end - start);
+            return str.slice(start, end - start);
         }
         throw std::runtime_error("Slice requires a list or string.");
     }
@@ -939,151 +1178,157 @@ Value Interpreter::evalExpr(const Expression* expr) {
                 throw std::runtime_error("Method '" + getExpr->name + "' not found in class '" + instance->className + "'.");
             }
 
-            // Method calls on primitives: "hello".upper(), [1,2,3].length(), etc.
-            std::vector<Value> primArgs;
-            for (const auto& argExpr : callExpr->arguments) {
-                primArgs.push_back(evalExpr(argExpr.get()));
+            // Method calls on built-in values: "hello".upper(), [1,2,3].length(), etc.
+            // The call site interns its method name once; dispatch is then a
+            // lookup in the receiver type's built-in table, then in the methods
+            // native libraries add.
+            int methodId = getExpr->methodId.load(std::memory_order_relaxed);
+            if (methodId == 0) {
+                methodId = YenNative::Methods::intern(getExpr->name);
+                getExpr->methodId.store(methodId, std::memory_order_relaxed);
+            }
+            if (auto builtin = BuiltinMethods::find(object.index(), methodId)) {
+                std::vector<Value> primArgs;
+                primArgs.reserve(callExpr->arguments.size());
+                for (const auto& argExpr : callExpr->arguments) {
+                    primArgs.push_back(evalExpr(argExpr.get()));
+                }
+                return builtin(*this, object, primArgs);
+            }
+            if (auto native = YenNative::Methods::find(object.index(), methodId)) {
+                std::vector<Value> nativeArgs;
+                nativeArgs.reserve(callExpr->arguments.size() + 1);
+                nativeArgs.push_back(std::move(object));
+                for (const auto& argExpr : callExpr->arguments) {
+                    nativeArgs.push_back(evalExpr(argExpr.get()));
+                }
+                return call(Value(*native), nativeArgs);
             }
-            const std::string& method = getExpr->name;
 
-            // String methods
+            const std::string& method = getExpr->name;
             if (object.holds_alternative<std::string>()) {
-                const auto& str = object.get<std::string>();
-                if (method == "length") return Value(static_cast<int>(str.size()));
-                if (method == "upper") {
-                    std::string r = str;
-                    std::transform(r.begin(), r.end(), r.begin(), ::toupper);
-                    return Value(r);
-                }
-                if (method == "lower") {
-                    std::string r = str;
-                    std::transform(r.begin(), r.end(), r.begin(), ::tolower);
-                    return Value(r);
-                }
-                if (method == "trim") {
-                    std::string r = str;
-                    size_t s = r.find_first_not_of(" \t\n\r");
-                    size_t e = r.find_last_not_of(" \t\n\r");
-                    if (s == std::string::npos) return Value(std::string(""));
-                    return Value(r.substr(s, e - s + 1));
-                }
-                if (method == "split") {
-                    std::string delim = primArgs.empty() ? " " : valueToString(primArgs[0]);
-                    std::vector<Value> parts;
-                    size_t pos = 0;
-                    while (true) {
-                        size_t found = str.find(delim, pos);
-                        if (found == std::string::npos) {
-                            parts.push_back(Value(str.substr(pos)));
-                            break;
-                        }
-                        parts.push_back(Value(str.substr(pos, found - pos)));
-                        pos = found + delim.size();
-                    }
-                    return Value(parts);
-                }
-                if (method == "replace") {
-                    if (primArgs.size() < 2) throw std::runtime_error("replace() requires 2 arguments.");
-                    std::string from = valueToString(primArgs[0]);
-                    std::string to = valueToString(primArgs[1]);
-                    std::string r = str;
-                    size_t pos = 0;
-                    while ((pos = r.find(from, pos)) != std::string::npos) {
-                        r.replace(pos, from.length(), to);
-                        pos += to.length();
-                    }
-                    return Value(r);
-                }
-                if (method == "contains") {
-                    std::string sub = valueToString(primArgs[0]);
-                    return Value(str.find(sub) != std::string::npos);
-                }
-                if (method == "starts_with") {
-                    std::string prefix = valueToString(primArgs[0]);
-                    return Value(str.substr(0, prefix.size()) == prefix);
-                }
-                if (method == "ends_with") {
-                    std::string suffix = valueToString(primArgs[0]);
-                    if (suffix.size() > str.size()) return Value(false);
-                    return Value(str.substr(str.size() - suffix.size()) == suffix);
-                }
-                if (method == "reverse") {
-                    std::string r(str.rbegin(), str.rend());
-                    return Value(r);
-                }
-                if (method == "chars") {
-                    std::vector<Value> chars;
-                    for (char c : str) chars.push_back(Value(std::string(1, c)));
-                    return Value(chars);
-                }
                 // Check extension methods
                 auto extIt = extensionMethods.find("String." + method);
                 if (extIt != extensionMethods.end()) {
-                    std::vector<Value> extArgs = {Value(str)};
-                    extArgs.insert(extArgs.end(), primArgs.begin(), primArgs.end());
+                    std::vector<Value> extArgs = {object};
+                    for (const auto& argExpr : callExpr->arguments) {
+                        extArgs.push_back(evalExpr(argExpr.get()));
+                    }
                     return call(Value(extIt->second), extArgs);
                 }
                 throw std::runtime_error("Unknown string method: " + method);
             }
-
-            // List methods
-            if (object.holds_alternative<std::vector<Value>>()) {
-                auto list = object.get<std::vector<Value>>();
-                if (method == "length") return Value(static_cast<int>(list.size()));
-                if (method == "push") {
-                    list.push_back(primArgs[0]);
-                    return Value(list);
-                }
-                if (method == "pop") {
-                    if (list.empty()) throw std::runtime_error("pop() on empty list.");
-                    Value last = list.back();
-                    list.pop_back();
-                    return last;
-                }
-                if (method == "reverse") {
-                    std::reverse(list.begin(), list.end());
-                    return Value(list);
-                }
-                if (method == "sort") {
-                    std::sort(list.begin(), list.end());
-                    return Value(list);
-                }
-                if (method == "contains") {
-                    for (const auto& item : list) {
-                        if (item == primArgs[0]) return Value(true);
-                    }
-                    return Value(false);
-                }
-                if (method == "join") {
-                    std::string delim = primArgs.empty() ? "" : valueToString(primArgs[0]);
-                    std::string r;
-                    for (size_t i = 0; i < list.size(); ++i) {
-                        if (i > 0) r += delim;
-                        r += valueToString(list[i]);
-                    }
-                    return Value(r);
-                }
+            if (object.holds_alternative<std::vector<Value>>())
                 throw std::runtime_error("Unknown list method: " + method);
-            }
-
-            // Number methods
-            if (object.holds_alternative<int>()) {
-                int n = object.get<int>();
-                if (method == "abs") return Value(std::abs(n));
+            if (object.holds_alternative<std::shared_ptr<StringBuilderValue>>())
+                throw std::runtime_error("Unknown string builder method: " + method);
+            if (object.holds_alternative<int>())
                 throw std::runtime_error("Unknown int method: " + method);
-            }
-            if (object.holds_alternative<double>()) {
-                double n = object.get<double>();
-                if (method == "abs") return Value(std::abs(n));
-                if (method == "floor") return Value(static_cast<int>(std::floor(n)));
-                if (method == "ceil") return Value(static_cast<int>(std::ceil(n)));
-                if (method == "round") return Value(static_cast<int>(std::round(n)));
+            if (object.holds_alternative<double>())
                 throw std::runtime_error("Unknown float method: " + method);
-            }
         }
 
         // Built-in higher-order functions: map, filter, reduce
         if (auto varExpr = dynamic_cast<const VariableExpr*>(callExpr->callee.get())) {
+            // loop_run(loop): dispatch event loop callbacks until no fds/timers remain
+            if (varExpr->name == "loop_run" && callExpr->arguments.size() == 1 &&
+                variables.count("loop_run")) {
+                Value loopVal = evalExpr(callExpr->arguments[0].get());
+                if (!loopVal.holds_alternative<int>())
+                    throw std::runtime_error("loop_run() argument must be a loop handle.");
+                int loopId = loopVal.get<int>();
+                while (YenNative::EventLoop::hasWork(loopId)) {
+                    for (auto& [callback, event] : YenNative::EventLoop::poll(loopId, -1)) {
+                        if (!YenNative::EventLoop::isLive(loopId, event)) continue;
+                        std::vector<Value> callArgs = {event};
+                        call(callback, callArgs);
+                    }
+                }
+                return Value();
+            }
+            // event_emit(emitter, event, data): calls each listener with data in
+            // registration order and returns their results
+            if (varExpr->name == "event_emit" && callExpr->arguments.size() == 3 &&
+                variables.count("event_emit")) {
+                Value emitterVal = evalExpr(callExpr->arguments[0].get());
+                Value eventVal = evalExpr(callExpr->arguments[1].get());
+                Value data = evalExpr(callExpr->arguments[2].get());
+                if (!emitterVal.holds_alternative<int>())
+                    throw std::runtime_error("event_emit() first argument must be an emitter handle.");
+                if (!eventVal.holds_alternative<std::string>())
+                    throw std::runtime_error("event_emit() event name must be a string.");
+                std::vector<Value> results;
+                for (const auto& callback : YenNative::Event::takeListeners(emitterVal.get<int>(), eventVal.get<std::string>())) {
+                    std::vector<Value> callArgs = {data};
+                    results.push_back(call(callback, callArgs));
+                }
+                return Value(std::move(results));
+            }
+            // event_emit_async(emitter, event, data): queues each listener on the event
+            // worker pool, where every worker calls it on its own interpreter copy
+            if (varExpr->name == "event_emit_async" && callExpr->arguments.size() == 3 &&
+                variables.count("event_emit_async")) {
+                Value emitterVal = evalExpr(callExpr->arguments[0].get());
+                Value eventVal = evalExpr(callExpr->arguments[1].get());
+                Value data = evalExpr(callExpr->arguments[2].get());
+                if (!emitterVal.holds_alternative<int>())
+                    throw std::runtime_error("event_emit_async() first argument must be an emitter handle.");
+                if (!eventVal.holds_alternative<std::string>())
+                    throw std::runtime_error("event_emit_async() event name must be a string.");
+                int emitterId = emitterVal.get<int>();
+                auto callbacks = YenNative::Event::takeListeners(emitterId, eventVal.get<std::string>());
+                if (callbacks.empty()) return Value(0);
+                // Listeners see the globals as of this emit; each worker copies
+                // the snapshot before its first job from it
+                auto snapshot = std::make_shared<Interpreter>(*this);
+                snapshot->environment = std::make_shared<Environment>(*environment);
+                auto workers = std::make_shared<std::vector<std::unique_ptr<Interpreter>>>(YenNative::Event::workerCount());
+                for (const auto& callback : callbacks) {
+                    YenNative::Event::post(emitterId, [snapshot, workers, callback, data](size_t w) {
+                        std::vector<Value> callArgs = {data};
+                        try {
+                            auto& worker = (*workers)[w];
+                            if (!worker) {
+                                worker = std::make_unique<Interpreter>(*snapshot);
+                                worker->environment = std::make_shared<Environment>(*snapshot->environment);
+                            }
+                            worker->call(callback, callArgs);
+                        } catch (const std::exception& e) {
+                            YenNative::Console::flush();
+                            std::cerr << "[event error] " << e.what() << std::endl;
+                        } catch (...) {}
+                    });
+                }
+                return Value(static_cast<int>(callbacks.size()));
+            }
+            // http_serve(server, handler[, workers]): each worker thread calls the
+            // handler on its own interpreter copy (as goroutines do)
+            if (varExpr->name == "http_serve" && (callExpr->arguments.size() == 2 || callExpr->arguments.size() == 3) &&
+                variables.count("http_serve")) {
+                Value serverVal = evalExpr(callExpr->arguments[0].get());
+                Value handler = evalExpr(callExpr->arguments[1].get());
+                if (!serverVal.holds_alternative<int>())
+                    throw std::runtime_error("http_serve() first argument must be a server handle.");
+                size_t workerCount = std::max(1u, std::thread::hardware_concurrency());
+                if (callExpr->arguments.size() == 3) {
+                    Value countVal = evalExpr(callExpr->arguments[2].get());
+                    if (!countVal.holds_alternative<int>() || countVal.get<int>() <= 0)
+                        throw std::runtime_error("http_serve() worker count must be a positive integer.");
+                    workerCount = static_cast<size_t>(countVal.get<int>());
+                }
+                std::vector<std::unique_ptr<Interpreter>> workers;
+                for (size_t w = 0; w < workerCount; ++w) {
+                    auto worker = std::make_unique<Interpreter>(*this);
+                    worker->environment = std::make_shared<Environment>(*environment);
+                    workers.push_back(std::move(worker));
+                }
+                YenNative::NetHTTP::serve(serverVal.get<int>(), workerCount,
+                    [&](size_t w, Value& request) {
+                        std::vector<Value> callArgs = {request};
+                        return workers[w]->call(handler, callArgs);
+                    });
+                return Value();
+            }
             if (varExpr->name == "map" && callExpr->arguments.size() == 2) {
                 Value listVal = evalExpr(callExpr->arguments[0].get());
                 Value funcVal = evalExpr(callExpr->arguments[1].get());
@@ -1293,15 +1538,15 @@ Value Interpreter::evalExpr(const Expression* expr) {
                 if (!listVal.holds_alternative<std::vector<Value>>())
                     throw std::runtime_error("group_by() first argument must be a list.");
                 const auto& list = listVal.get<std::vector<Value>>();
-                std::unordered_map<std::string, Value> result;
+                MapValue result;
                 for (const auto& item : list) {
                     std::vector<Value> callArgs = {item};
                     Value key = call(funcVal, callArgs);
-                    std::string keyStr = valueToString(key);
-                    if (result.find(keyStr) == result.end()) {
-                        result[keyStr] = std::vector<Value>();
+                    Value& slot = result[key];
+                    if (!slot.holds_alternative<std::vector<Value>>()) {
+                        slot = std::vector<Value>();
                     }
-                    auto& group = const_cast<std::vector<Value>&>(result[keyStr].get<std::vector<Value>>());
+                    auto& group = const_cast<std::vector<Value>&>(slot.get<std::vector<Value>>());
                     group.push_back(item);
                 }
                 return Value(result);
@@ -1310,10 +1555,10 @@ Value Interpreter::evalExpr(const Expression* expr) {
             if (varExpr->name == "map_map_values" && callExpr->arguments.size() == 2) {
                 Value mapVal = evalExpr(callExpr->arguments[0].get());
                 Value funcVal = evalExpr(callExpr->arguments[1].get());
-                if (!mapVal.holds_alternative<std::unordered_map<std::string, Value>>())
+                if (!mapVal.holds_alternative<MapValue>())
                     throw std::runtime_error("map_map_values() first argument must be a map.");
-                const auto& map = mapVal.get<std::unordered_map<std::string, Value>>();
-                std::unordered_map<std::string, Value> result;
+                const auto& map = mapVal.get<MapValue>();
+                MapValue result;
                 for (const auto& [key, val] : map) {
                     std::vector<Value> callArgs = {val};
                     result[key] = call(funcVal, callArgs);
@@ -1551,24 +1796,31 @@ Value Interpreter::evalExpr(const Expression* expr) {
         Value iterableVal = evalExpr(listComp->iterable.get());
         std::vector<Value> result;
 
-        auto iterate = [&](const std::vector<Value>& items) {
-            for (const auto& item : items) {
-                auto savedVars = variables;
-                variables[listComp->varName] = item;
-                if (listComp->condition) {
-                    Value condVal = evalExpr(listComp->condition.get());
-                    if (!isTruthy(condVal)) {
-                        variables = savedVars;
-                        continue;
-                    }
+        auto visit = [&](const Value& item) {
+            auto savedVars = variables;
+            variables[listComp->varName] = item;
+            if (listComp->condition) {
+                Value condVal = evalExpr(listComp->condition.get());
+                if (!isTruthy(condVal)) {
+                    variables = savedVars;
+                    return;
                 }
-                result.push_back(evalExpr(listComp->body.get()));
-                variables = savedVars;
             }
+            result.push_back(evalExpr(listComp->body.get()));
+            variables = savedVars;
+        };
+        auto iterate = [&](const std::vector<Value>& items) {
+            for (const auto& item : items) visit(item);
         };
 
         if (iterableVal.holds_alternative<std::vector<Value>>()) {
             iterate(iterableVal.get<std::vector<Value>>());
+        } else if (iterableVal.holds_alternative<std::shared_ptr<SetValue>>()) {
+            iterate(iterableVal.get<std::shared_ptr<SetValue>>()->toList());
+        } else if (iterableVal.holds_alternative<std::shared_ptr<IteratorValue>>()) {
+            auto iter = iterableVal.get<std::shared_ptr<IteratorValue>>();
+            Value item;
+            while (iter->next(item)) visit(item);
         } else {
             throw std::runtime_error("List comprehension requires an iterable.");
         }
@@ -1578,7 +1830,7 @@ Value Interpreter::evalExpr(const Expression* expr) {
     // ---- MapComprehensionExpr ----
     if (auto mapComp = dynamic_cast<const MapComprehensionExpr*>(expr)) {
         Value iterableVal = evalExpr(mapComp->iterable.get());
-        std::unordered_map<std::string, Value> result;
+        MapValue result;
 
         if (iterableVal.holds_alternative<std::vector<Value>>()) {
             const auto& items = iterableVal.get<std::vector<Value>>();
@@ -1592,7 +1844,7 @@ Value Interpreter::evalExpr(const Expression* expr) {
                         continue;
                     }
                 }
-                std::string key = valueToString(evalExpr(mapComp->keyExpr.get()));
+                Value key = evalExpr(mapComp->keyExpr.get());
                 Value val = evalExpr(mapComp->valueExpr.get());
                 result[key] = val;
                 variables = savedVars;
@@ -1727,29 +1979,36 @@ Value Interpreter::evalExpr(const Expression* expr) {
                     [](float l, double r) { return Value(static_cast<double>(l) + r); },
                     [](double l, float r) { return Value(l + static_cast<double>(r)); },
 
-                    [](const std::string& l, const std::string& r) { return Value(l + r); },
+                    [](const StringValue& l, const StringValue& r) {
+                        std::string out;
+                        out.reserve(l.size() + r.size());
+                        out.append(l.view()).append(r.view());
+                        return Value(std::move(out));
+                    },
 
-                    [](const std::string& l, auto r) -> Value {
+                    [](const StringValue& sl, auto r) -> Value {
+                        std::string l(sl.view());
                         using T = std::decay_t<decltype(r)>;
                         if constexpr (std::is_same_v<T, std::monostate>) {
                             return Value(l + "null");
                         } else if constexpr (std::is_same_v<T, bool>) {
                             return Value(l + (r ? "true" : "false"));
                         } else if constexpr (std::is_arithmetic_v<T>) {
-                            return Value(l + std::to_string(r));
+                            return Value(l + numberToString(r));
                         } else {
                             throw std::runtime_error("Invalid type for string concatenation (right side).");
                         }
                     },
 
-                    [](auto l, const std::string& r) -> Value {
+                    [](auto l, const StringValue& sr) -> Value {
+                        std::string_view r = sr.view();
                         using T = std::decay_t<decltype(l)>;
                         if constexpr (std::is_same_v<T, std::monostate>) {
-                            return Value("null" + r);
+                            return Value("null" + std::string(r));
                         } else if constexpr (std::is_same_v<T, bool>) {
-                            return Value((l ? "true" : "false") + r);
+                            return Value((l ? "true" : "false") + std::string(r));
                         } else if constexpr (std::is_arithmetic_v<T>) {
-                            return Value(std::to_string(l) + r);
+                            return Value(numberToString(l).append(r));
                         } else {
                             throw std::runtime_error("Invalid type for string concatenation (left side).");
                         }
@@ -1795,14 +2054,16 @@ Value Interpreter::evalExpr(const Expression* expr) {
                     [](float l, double r) { return Value(static_cast<double>(l) * r); },
                     [](double l, float r) { return Value(l * static_cast<double>(r)); },
                     // String multiplication: "abc" * 3 or 3 * "abc"
-                    [](const std::string& s, int n) -> Value {
+                    [](const StringValue& sv, int n) -> Value {
+                        std::string_view s = sv.view();
                         if (n <= 0) return Value(std::string(""));
                         std::string result;
                         result.reserve(s.size() * n);
                         for (int i = 0; i < n; ++i) result += s;
                         return Value(result);
                     },
-                    [](int n, const std::string& s) -> Value {
+                    [](int n, const StringValue& sv) -> Value {
+                        std::string_view s = sv.view();
                         if (n <= 0) return Value(std::string(""));
                         std::string result;
                         result.reserve(s.size() * n);
@@ -1932,7 +2193,7 @@ Value Interpreter::evalExpr(const Expression* expr) {
                     [](double l, int r) { return Value(l < static_cast<double>(r)); },
                     [](float l, double r) { return Value(static_cast<double>(l) < r); },
                     [](double l, float r) { return Value(l < static_cast<double>(r)); },
-                    [](const std::string& l, const std::string& r) { return Value(l < r); },
+                    [](const StringValue& l, const StringValue& r) { return Value(l.view() < r.view()); },
                     [](auto, auto) -> Value { throw std::runtime_error("Incompatible types for < operator."); }
                 }, left.data, right.data);
 
@@ -1947,7 +2208,7 @@ Value Interpreter::evalExpr(const Expression* expr) {
                     [](double l, int r) { return Value(l > static_cast<double>(r)); },
                     [](float l, double r) { return Value(static_cast<double>(l) > r); },
                     [](double l, float r) { return Value(l > static_cast<double>(r)); },
-                    [](const std::string& l, const std::string& r) { return Value(l > r); },
+                    [](const StringValue& l, const StringValue& r) { return Value(l.view() > r.view()); },
                     [](auto, auto) -> Value { throw std::runtime_error("Incompatible types for > operator."); }
                 }, left.data, right.data);
 
@@ -1962,7 +2223,7 @@ Value Interpreter::evalExpr(const Expression* expr) {
                     [](double l, int r) { return Value(l >= static_cast<double>(r)); },
                     [](float l, double r) { return Value(static_cast<double>(l) >= r); },
                     [](double l, float r) { return Value(l >= static_cast<double>(r)); },
-                    [](const std::string& l, const std::string& r) { return Value(l >= r); },
+                    [](const StringValue& l, const StringValue& r) { return Value(l.view() >= r.view()); },
                     [](auto, auto) -> Value { throw std::runtime_error("Incompatible types for >= operator."); }
                 }, left.data, right.data);
 
@@ -1977,7 +2238,7 @@ Value Interpreter::evalExpr(const Expression* expr) {
                     [](double l, int r) { return Value(l <= static_cast<double>(r)); },
                     [](float l, double r) { return Value(static_cast<double>(l) <= r); },
                     [](double l, float r) { return Value(l <= static_cast<double>(r)); },
-                    [](const std::string& l, const std::string& r) { return Value(l <= r); },
+                    [](const StringValue& l, const StringValue& r) { return Value(l.view() <= r.view()); },
                     [](auto, auto) -> Value { throw std::runtime_error("Incompatible types for <= operator."); }
                 }, left.data, right.data);
 
@@ -2035,6 +2296,10 @@ Value Interpreter::evalExpr(const Expression* expr) {
 
             // ---- NEW: In operator (membership) ----
             case BinaryOp::In: {
+                // x in set → hashed lookup
+                if (right.holds_alternative<std::shared_ptr<SetValue>>()) {
+                    return Value(right.get<std::shared_ptr<SetValue>>()->contains(left));
+                }
                 // x in list → check if x is in the list
                 if (right.holds_alternative<std::vector<Value>>()) {
                     const auto& list = right.get<std::vector<Value>>();
@@ -2044,23 +2309,20 @@ Value Interpreter::evalExpr(const Expression* expr) {
                     return Value(false);
                 }
                 // key in map → check if key exists
-                if (right.holds_alternative<std::unordered_map<std::string, Value>>()) {
-                    const auto& map = right.get<std::unordered_map<std::string, Value>>();
-                    std::string key;
-                    if (left.holds_alternative<std::string>()) {
-                        key = left.get<std::string>();
-                    } else {
-                        key = valueToString(left);
-                    }
-                    return Value(map.find(key) != map.end());
+                if (right.holds_alternative<MapValue>()) {
+                    const auto& map = right.get<MapValue>();
+                    return Value(map.find(left) != map.end());
                 }
                 // substr in string → substring check
                 if (right.holds_alternative<std::string>() && left.holds_alternative<std::string>()) {
-                    return Value(right.get<std::string>().find(left.get<std::string>()) != std::string::npos);
+                    return Value(std::get<StringValue>(right.data).view().find(std::get<StringValue>(left.data).view()) != std::string_view::npos);
                 }
-                throw std::runtime_error("'in' operator requires a list, map, or string on the right side.");
+                throw std::runtime_error("'in' operator requires a list, set, map, or string on the right side.");
             }
             case BinaryOp::NotIn: {
+                if (right.holds_alternative<std::shared_ptr<SetValue>>()) {
+                    return Value(!right.get<std::shared_ptr<SetValue>>()->contains(left));
+                }
                 // x not in list → !(x in list)
                 if (right.holds_alternative<std::vector<Value>>()) {
                     const auto& list = right.get<std::vector<Value>>();
@@ -2069,15 +2331,14 @@ Value Interpreter::evalExpr(const Expression* expr) {
                     }
                     return Value(true);
                 }
-                if (right.holds_alternative<std::unordered_map<std::string, Value>>()) {
-                    const auto& map = right.get<std::unordered_map<std::string, Value>>();
-                    std::string key = left.holds_alternative<std::string>() ? left.get<std::string>() : valueToString(left);
-                    return Value(map.find(key) == map.end());
+                if (right.holds_alternative<MapValue>()) {
+                    const auto& map = right.get<MapValue>();
+                    return Value(map.find(left) == map.end());
                 }
                 if (right.holds_alternative<std::string>() && left.holds_alternative<std::string>()) {
-                    return Value(right.get<std::string>().find(left.get<std::string>()) == std::string::npos);
+                    return Value(std::get<StringValue>(right.data).view().find(std::get<StringValue>(left.data).view()) == std::string_view::npos);
                 }
-                throw std::runtime_error("'not in' operator requires a list, map, or string on the right side.");
+                throw std::runtime_error("'not in' operator requires a list, set, map, or string on the right side.");
             }
         }
     }
@@ -2206,20 +2467,22 @@ Value Interpreter::call(const Value& callee, std::vector<Value>& args) {
     // Handle Lambda/closure
     if (callee.holds_alternative<LambdaValue>()) {
         const auto& lambda = callee.get<LambdaValue>();
+        const auto& params = lambda.expr->parameters;
+        const auto& defaults = lambda.expr->parameterDefaults;
 
         // Fill in defaults for missing args
-        if (args.size() < lambda.parameters.size() && lambda.defaultExprs) {
-            for (size_t i = args.size(); i < lambda.parameters.size(); ++i) {
-                if (i < lambda.defaultExprs->size() && (*lambda.defaultExprs)[i]) {
-                    args.push_back(evalExpr((*lambda.defaultExprs)[i]));
+        if (args.size() < params.size()) {
+            for (size_t i = args.size(); i < params.size(); ++i) {
+                if (i < defaults.size() && defaults[i]) {
+                    args.push_back(evalExpr(defaults[i].get()));
                 } else {
                     break;
                 }
             }
         }
 
-        if (args.size() != lambda.parameters.size()) {
-            throw std::runtime_error("Expected " + std::to_string(lambda.parameters.size()) +
+        if (args.size() != params.size()) {
+            throw std::runtime_error("Expected " + std::to_string(params.size()) +
                                    " arguments but got " + std::to_string(args.size()) + ".");
         }
 
@@ -2229,21 +2492,21 @@ Value Interpreter::call(const Value& callee, std::vector<Value>& args) {
             variables = *lambda.captured_env;
         }
 
-        for (size_t i = 0; i < lambda.parameters.size(); ++i) {
-            variables[lambda.parameters[i]] = args[i];
+        for (size_t i = 0; i < params.size(); ++i) {
+            variables[params[i]] = args[i];
         }
 
         Value result;
-        if (lambda.blockBody) {
+        if (lambda.expr->blockBody) {
             // Block body lambda: execute statements, catch return value
             try {
-                execute(lambda.blockBody);
+                execute(lambda.expr->blockBody.get());
                 result = Value();  // No explicit return → null
             } catch (const Value& returnValue) {
                 result = returnValue;
             }
         } else {
-            result = evalExpr(lambda.body);
+            result = evalExpr(lambda.expr->body.get());
         }
 
         variables = savedVars;
@@ -2414,7 +2677,9 @@ void Interpreter::execute(const Statement* stmt) {
     // ---- PrintStmt ----
     if (auto print = dynamic_cast<const PrintStmt*>(stmt)) {
         Value val = evalExpr(print->expression.get());
-        std::cout << valueToString(val) << std::endl;
+        std::string line = valueToString(val);
+        line += '\n';
+        YenNative::Console::write(line);
     }
     // ---- LetStmt ----
     else if (auto let = dynamic_cast<const LetStmt*>(stmt)) {
@@ -2422,7 +2687,7 @@ void Interpreter::execute(const Statement* stmt) {
         if (auto varExpr = dynamic_cast<const VariableExpr*>(let->expression.get())) {
             auto it = structs.find(varExpr->name);
             if (it != structs.end()) {
-                std::unordered_map<std::string, Value> instance;
+                MapValue instance;
                 for (const auto& field : it->second->fields) {
                     instance[field] = Value();
                 }
@@ -2450,16 +2715,54 @@ void Interpreter::execute(const Statement* stmt) {
         if (immutableVars.find(assign->name) != immutableVars.end()) {
             throw std::runtime_error("Cannot assign to immutable variable: " + assign->name);
         }
+        // s = s + a + b ... appends to s in place instead of rebuilding it
+        std::vector<const Expression*> appended;
+        const Expression* base = assign->expression.get();
+        while (auto bin = dynamic_cast<const BinaryExpr*>(base)) {
+            if (bin->op != BinaryOp::Add) break;
+            appended.push_back(bin->right.get());
+            base = bin->left.get();
+        }
+        auto baseVar = dynamic_cast<const VariableExpr*>(base);
+        if (!appended.empty() && baseVar && baseVar->name == assign->name) {
+            Value* slot = findVariableSlot(assign->name);
+            if (slot && (slot->holds_alternative<std::string>() || slot->holds_alternative<std::shared_ptr<StringBuilderValue>>())) {
+                // Operands see the old value and may throw, so evaluate them all first
+                std::vector<Value> operands;
+                operands.reserve(appended.size());
+                for (auto it = appended.rbegin(); it != appended.rend(); ++it) {
+                    operands.push_back(evalExpr(*it));
+                }
+                slot = findVariableSlot(assign->name);   // A call may have rehashed the scope
+                if (!slot) throw std::runtime_error("Undeclared variable: " + assign->name);
+                for (auto& rhsVal : operands) {
+                    if (rhsVal.holds_alternative<std::shared_ptr<StringBuilderValue>>() &&
+                        slot->holds_alternative<std::shared_ptr<StringBuilderValue>>() &&
+                        rhsVal.get<std::shared_ptr<StringBuilderValue>>() == slot->get<std::shared_ptr<StringBuilderValue>>()) {
+                        rhsVal = Value(rhsVal.get<std::shared_ptr<StringBuilderValue>>()->buffer);
+                    }
+                }
+                for (auto& rhsVal : operands) {
+                    if (!appendInPlace(*slot, rhsVal)) {
+                        BinaryExpr tempBin(std::make_unique<LiteralExpr>(*slot), BinaryOp::Add, std::make_unique<LiteralExpr>(rhsVal));
+                        *slot = evalExpr(&tempBin);
+                    }
+                }
+                return;
+            }
+        }
+
         Value val = evalExpr(assign->expression.get());
         // Check environment first
         if (environment && environment->values.count(assign->name)) {
-            environment->values[assign->name] = val;
+            environment->values[assign->name] = std::move(val);
             return;
         }
-        if (variables.find(assign->name) == variables.end()) {
+        auto varIt = variables.find(assign->name);
+        if (varIt == variables.end()) {
             throw std::runtime_error("Undeclared variable: " + assign->name);
         }
-        variables[assign->name] = val;
+        varIt->second = std::move(val);
     }
     // ---- NEW: CompoundAssignStmt (+=, -=, *=, /=, %=) ----
     else if (auto compAssign = dynamic_cast<const CompoundAssignStmt*>(stmt)) {
@@ -2467,6 +2770,18 @@ void Interpreter::execute(const Statement* stmt) {
             throw std::runtime_error("Cannot assign to immutable variable: " + compAssign->name);
         }
 
+        // s += x on a string or builder appends to the stored value in place
+        if (compAssign->op == BinaryOp::Add) {
+            Value rhsVal = evalExpr(compAssign->expression.get());
+            Value* slot = findVariableSlot(compAssign->name);
+            if (!slot) throw std::runtime_error("Undeclared variable: " + compAssign->name);
+            if (!appendInPlace(*slot, rhsVal)) {
+                BinaryExpr tempBin(std::make_unique<LiteralExpr>(*slot), BinaryOp::Add, std::make_unique<LiteralExpr>(rhsVal));
+                *slot = evalExpr(&tempBin);
+            }
+            return;
+        }
+
         // Get current value
         Value currentVal;
         bool inEnv = false;
@@ -2750,16 +3065,9 @@ void Interpreter::execute(const Statement* stmt) {
 
             const_cast<std::vector<Value>&>(vec)[idx] = value;
         }
-        else if (var.holds_alternative<std::unordered_map<std::string, Value>>()) {
-            auto& map = var.get<std::unordered_map<std::string, Value>>();
-            std::string key;
-            if (idxVal.holds_alternative<std::string>()) {
-                key = idxVal.get<std::string>();
-            } else {
-                key = valueToString(idxVal);
-            }
-
-            const_cast<std::unordered_map<std::string, Value>&>(map)[key] = value;
+        else if (var.holds_alternative<MapValue>()) {
+            auto& map = var.get<MapValue>();
+            const_cast<MapValue&>(map)[idxVal] = value;
         }
         else if (var.holds_alternative<std::shared_ptr<ClassInstance>>()) {
             auto instance = var.get<std::shared_ptr<ClassInstance>>();
@@ -2803,10 +3111,42 @@ void Interpreter::execute(const Statement* stmt) {
     else if (auto forStmt = dynamic_cast<const ForStmt*>(stmt)) {
         Value listVal = evalExpr(forStmt->iterable.get());
 
+        // Sets iterate over a snapshot in insertion order
+        if (listVal.holds_alternative<std::shared_ptr<SetValue>>()) {
+            listVal = Value(listVal.get<std::shared_ptr<SetValue>>()->toList());
+        }
+
+        // Maps iterate over a snapshot of their keys in insertion order
+        if (listVal.holds_alternative<MapValue>()) {
+            const auto& map = listVal.get<MapValue>();
+            std::vector<Value> keys;
+            keys.reserve(map.size());
+            for (const auto& [key, _] : map) keys.push_back(key);
+            listVal = Value(std::move(keys));
+        }
+
+        // Iterators are pulled one item at a time, so the sequence is never
+        // materialized
+        if (listVal.holds_alternative<std::shared_ptr<IteratorValue>>()) {
+            auto iter = listVal.get<std::shared_ptr<IteratorValue>>();
+            Value item;
+            while (iter->next(item)) {
+                variables[forStmt->var] = std::move(item);
+                try {
+                    execute(forStmt->body.get());
+                } catch (const BreakSignal&) {
+                    break;
+                } catch (const ContinueSignal&) {
+                    continue;
+                }
+            }
+            return;
+        }
+
         if (!listVal.holds_alternative<std::vector<Value>>()) {
             // Try string iteration
             if (listVal.holds_alternative<std::string>()) {
-                const auto& str = listVal.get<std::string>();
+                std::string_view str = std::get<StringValue>(listVal.data).view();
                 for (size_t i = 0; i < str.size(); ++i) {
                     variables[forStmt->var] = std::string(1, str[i]);
                     try {
@@ -2880,6 +3220,27 @@ void Interpreter::execute(const Statement* stmt) {
             }
         }
     }
+    // ---- ParallelForStmt: iterations split across worker interpreters ----
+    else if (auto parFor = dynamic_cast<const ParallelForStmt*>(stmt)) {
+        executeParallelFor(parFor);
+    }
+    // ---- ReduceStmt: accumulate into the current chunk's partial ----
+    else if (auto reduce = dynamic_cast<const ReduceStmt*>(stmt)) {
+        if (!inParallelBody) {
+            throw std::runtime_error("'reduce " + reduce->name + "' is only valid inside a parallel for body.");
+        }
+        Value rhsVal = evalExpr(reduce->expression.get());
+        auto it = reductionSlots.find(reduce->name);
+        if (it == reductionSlots.end()) {
+            reductionSlots[reduce->name] = rhsVal;
+        } else {
+            // Partials of '-=' are summed and subtracted once when merging
+            BinaryOp op = reduce->op == BinaryOp::Mul ? BinaryOp::Mul : BinaryOp::Add;
+            BinaryExpr tempBin(std::make_unique<LiteralExpr>(it->second), op,
+                               std::make_unique<LiteralExpr>(rhsVal));
+            it->second = evalExpr(&tempBin);
+        }
+    }
     // ---- BreakStmt: throw dedicated signal type ----
     else if (dynamic_cast<const BreakStmt*>(stmt)) {
         throw BreakSignal{};
@@ -3180,6 +3541,7 @@ void Interpreter::execute(const Statement* stmt) {
                 try {
                     goroutineInterp->call(callee, args);
                 } catch (const std::exception& e) {
+                    YenNative::Console::flush();
                     std::cerr << "[goroutine error] " << e.what() << std::endl;
                 } catch (...) {
                     // Silently ignore return value signals (e.g. thrown Value for return)
@@ -3197,6 +3559,7 @@ void Interpreter::execute(const Statement* stmt) {
                         std::vector<Value> emptyArgs;
                         goroutineInterp->call(callable, emptyArgs);
                     } catch (const std::exception& e) {
+                        YenNative::Console::flush();
                         std::cerr << "[goroutine error] " << e.what() << std::endl;
                     } catch (...) {}
                 });
@@ -3299,8 +3662,8 @@ void Interpreter::execute(const Statement* stmt) {
                 auto instance = val.get<std::shared_ptr<ClassInstance>>();
                 auto it = instance->fields.find(fieldName);
                 variables[fieldName] = (it != instance->fields.end()) ? it->second : Value();
-            } else if (val.holds_alternative<std::unordered_map<std::string, Value>>()) {
-                const auto& map = val.get<std::unordered_map<std::string, Value>>();
+            } else if (val.holds_alternative<MapValue>()) {
+                const auto& map = val.get<MapValue>();
                 auto it = map.find(fieldName);
                 variables[fieldName] = (it != map.end()) ? it->second : Value();
             } else {
@@ -3390,6 +3753,7 @@ void Interpreter::executeDeferredStatements() {
         try {
             execute(*it);
         } catch (const std::exception& e) {
+            YenNative::Console::flush();
             std::cerr << "Error in deferred statement: " << e.what() << std::endl;
         } catch (const BreakSignal&) {
             // Ignore break/continue in deferred statements
@@ -3401,6 +3765,264 @@ void Interpreter::executeDeferredStatements() {
     deferStack.pop_back();
 }
 
+// ============================================================================
+// Parallel for
+// ============================================================================
+
+// Variable at the root of a field or index chain (a in a.b[0].c), or
+// "this"; empty for anything else, e.g. a call result
+static std::string rootVariableName(const Expression* expr) {
+    while (true) {
+        if (auto get = dynamic_cast<const GetExpr*>(expr)) expr = get->object.get();
+        else if (auto index = dynamic_cast<const IndexExpr*>(expr)) expr = index->listExpr.get();
+        else break;
+    }
+    if (auto var = dynamic_cast<const VariableExpr*>(expr)) return var->name;
+    if (dynamic_cast<const ThisExpr*>(expr)) return "this";
+    return "";
+}
+
+// Walks a parallel for body collecting names it assigns, variables whose
+// fields it sets, names it declares locally, and its 'reduce' targets.
+// Nested function bodies are not visited.
+static void collectParallelWrites(const Statement* stmt,
+                                  std::vector<std::string>& assigned,
+                                  std::vector<std::string>& fields,
+                                  std::unordered_set<std::string>& declared,
+                                  std::unordered_map<std::string, BinaryOp>& reductions) {
+    if (!stmt) return;
+    if (auto block = dynamic_cast<const BlockStmt*>(stmt)) {
+        for (const auto& s : block->statements) collectParallelWrites(s.get(), assigned, fields, declared, reductions);
+    } else if (auto let = dynamic_cast<const LetStmt*>(stmt)) {
+        declared.insert(let->name);
+    } else if (auto constStmt = dynamic_cast<const ConstStmt*>(stmt)) {
+        declared.insert(constStmt->name);
+    } else if (auto destructure = dynamic_cast<const DestructureLetStmt*>(stmt)) {
+        declared.insert(destructure->names.begin(), destructure->names.end());
+    } else if (auto objDestructure = dynamic_cast<const ObjectDestructureLetStmt*>(stmt)) {
+        declared.insert(objDestructure->fieldNames.begin(), objDestructure->fieldNames.end());
+    } else if (auto assign = dynamic_cast<const AssignStmt*>(stmt)) {
+        assigned.push_back(assign->name);
+    } else if (auto compAssign = dynamic_cast<const CompoundAssignStmt*>(stmt)) {
+        assigned.push_back(compAssign->name);
+    } else if (auto inc = dynamic_cast<const IncrementStmt*>(stmt)) {
+        assigned.push_back(inc->name);
+    } else if (auto indexAssign = dynamic_cast<const IndexAssignStmt*>(stmt)) {
+        if (auto var = dynamic_cast<const VariableExpr*>(indexAssign->listExpr.get())) {
+            assigned.push_back(var->name);
+        }
+    } else if (auto set = dynamic_cast<const SetStmt*>(stmt)) {
+        std::string root = rootVariableName(set->object.get());
+        if (!root.empty()) fields.push_back(root);
+    } else if (auto reduce = dynamic_cast<const ReduceStmt*>(stmt)) {
+        auto it = reductions.find(reduce->name);
+        if (it != reductions.end() && it->second != reduce->op) {
+            throw std::runtime_error("parallel for: conflicting reduce operators for '" + reduce->name + "'.");
+        }
+        reductions[reduce->name] = reduce->op;
+    } else if (auto ifStmt = dynamic_cast<const IfStmt*>(stmt)) {
+        collectParallelWrites(ifStmt->thenBranch.get(), assigned, fields, declared, reductions);
+        collectParallelWrites(ifStmt->elseBranch.get(), assigned, fields, declared, reductions);
+    } else if (auto whileStmt = dynamic_cast<const WhileStmt*>(stmt)) {
+        collectParallelWrites(whileStmt->body.get(), assigned, fields, declared, reductions);
+    } else if (auto doWhile = dynamic_cast<const DoWhileStmt*>(stmt)) {
+        collectParallelWrites(doWhile->body.get(), assigned, fields, declared, reductions);
+    } else if (auto loop = dynamic_cast<const LoopStmt*>(stmt)) {
+        collectParallelWrites(loop->body.get(), assigned, fields, declared, reductions);
+    } else if (auto forStmt = dynamic_cast<const ForStmt*>(stmt)) {
+        declared.insert(forStmt->var);
+        collectParallelWrites(forStmt->body.get(), assigned, fields, declared, reductions);
+    } else if (auto forDestructure = dynamic_cast<const ForDestructureStmt*>(stmt)) {
+        declared.insert(forDestructure->vars.begin(), forDestructure->vars.end());
+        collectParallelWrites(forDestructure->body.get(), assigned, fields, declared, reductions);
+    } else if (auto repeat = dynamic_cast<const RepeatStmt*>(stmt)) {
+        if (!repeat->varName.empty()) declared.insert(repeat->varName);
+        collectParallelWrites(repeat->body.get(), assigned, fields, declared, reductions);
+    } else if (auto tryCatch = dynamic_cast<const TryCatchStmt*>(stmt)) {
+        if (!tryCatch->errorVar.empty()) declared.insert(tryCatch->errorVar);
+        collectParallelWrites(tryCatch->tryBlock.get(), assigned, fields, declared, reductions);
+        collectParallelWrites(tryCatch->catchBlock.get(), assigned, fields, declared, reductions);
+        collectParallelWrites(tryCatch->finallyBlock.get(), assigned, fields, declared, reductions);
+    } else if (auto switchStmt = dynamic_cast<const SwitchStmt*>(stmt)) {
+        for (const auto& c : switchStmt->cases) collectParallelWrites(c.second.get(), assigned, fields, declared, reductions);
+        collectParallelWrites(switchStmt->defaultCase.get(), assigned, fields, declared, reductions);
+    } else if (auto parFor = dynamic_cast<const ParallelForStmt*>(stmt)) {
+        // A nested parallel loop merges its own reductions into this body's locals
+        std::unordered_map<std::string, BinaryOp> innerReductions;
+        declared.insert(parFor->var);
+        collectParallelWrites(parFor->body.get(), assigned, fields, declared, innerReductions);
+        for (const auto& [name, op] : innerReductions) assigned.push_back(name);
+    }
+}
+
+void Interpreter::executeParallelFor(const ParallelForStmt* stmt) {
+    Value listVal = evalExpr(stmt->iterable.get());
+    if (listVal.holds_alternative<std::shared_ptr<SetValue>>()) {
+        listVal = Value(listVal.get<std::shared_ptr<SetValue>>()->toList());
+    }
+    // Workers need random access to split the range: drain iterators first
+    if (listVal.holds_alternative<std::shared_ptr<IteratorValue>>()) {
+        auto iter = listVal.get<std::shared_ptr<IteratorValue>>();
+        std::vector<Value> drained;
+        Value item;
+        while (iter->next(item)) drained.push_back(std::move(item));
+        listVal = Value(std::move(drained));
+    }
+    if (!listVal.holds_alternative<std::vector<Value>>()) {
+        throw std::runtime_error("parallel for: iterable must be a list.");
+    }
+    const auto& items = listVal.get<std::vector<Value>>();
+
+    // Each worker runs on a private copy of the interpreter, so writes to outer
+    // variables would be silently lost: reject them up front.
+    std::vector<std::string> assigned;
+    std::vector<std::string> fields;
+    std::unordered_set<std::string> declared;
+    std::unordered_map<std::string, BinaryOp> reductions;
+    declared.insert(stmt->var);
+    collectParallelWrites(stmt->body.get(), assigned, fields, declared, reductions);
+    auto isOuter = [&](const std::string& name) {
+        return (environment && environment->values.count(name)) || variables.count(name);
+    };
+    for (const auto& name : assigned) {
+        if (declared.count(name) || reductions.count(name) || !isOuter(name)) continue;
+        throw std::runtime_error("parallel for: body assigns to outer variable '" + name +
+                                 "'; use 'reduce " + name + " += ...' or a local 'let'.");
+    }
+    // Instances are shared with every worker, so field writes would race
+    for (const auto& name : fields) {
+        if (declared.count(name) || !isOuter(name)) continue;
+        throw std::runtime_error("parallel for: body sets a field of outer variable '" + name +
+                                 "'; workers share the instance, so collect results with 'reduce'.");
+    }
+    for (const auto& [name, op] : reductions) {
+        if (!isOuter(name)) {
+            throw std::runtime_error("parallel for: reduction variable '" + name + "' is not declared.");
+        }
+        if (immutableVars.count(name)) {
+            throw std::runtime_error("Cannot assign to immutable variable: " + name);
+        }
+    }
+
+    const size_t n = items.size();
+    if (n == 0) return;
+
+    size_t chunk = 0;
+    if (stmt->chunkSize) {
+        Value chunkVal = evalExpr(stmt->chunkSize.get());
+        if (!chunkVal.holds_alternative<int>() || chunkVal.get<int>() <= 0) {
+            throw std::runtime_error("parallel for: chunk size must be a positive integer.");
+        }
+        chunk = static_cast<size_t>(chunkVal.get<int>());
+    }
+    size_t workerCount = std::max(1u, std::thread::hardware_concurrency());
+    if (const char* env = std::getenv("YEN_NUM_THREADS")) {
+        int requested = std::atoi(env);
+        if (requested > 0) workerCount = static_cast<size_t>(requested);
+    }
+    workerCount = std::min(workerCount, n);
+
+    // Chunk claiming. Static chunks are fixed per worker; dynamic and guided
+    // chunks come from a shared cursor.
+    std::atomic<size_t> cursor{0};
+    std::mutex guidedMutex;
+    auto claim = [&](size_t worker, size_t round, size_t& begin, size_t& end) -> bool {
+        switch (stmt->schedule) {
+            case ParallelSchedule::Static:
+                if (chunk == 0) {
+                    if (round > 0) return false;
+                    begin = worker * n / workerCount;
+                    end = (worker + 1) * n / workerCount;
+                } else {
+                    begin = (round * workerCount + worker) * chunk;
+                    end = std::min(begin + chunk, n);
+                }
+                return begin < n && begin < end;
+            case ParallelSchedule::Dynamic: {
+                size_t size = chunk ? chunk : 1;
+                begin = cursor.fetch_add(size);
+                end = std::min(begin + size, n);
+                return begin < n;
+            }
+            case ParallelSchedule::Guided: {
+                std::lock_guard<std::mutex> lock(guidedMutex);
+                begin = cursor.load();
+                if (begin >= n) return false;
+                size_t size = std::max((n - begin + workerCount - 1) / workerCount, chunk ? chunk : 1);
+                end = std::min(begin + size, n);
+                cursor.store(end);
+                return true;
+            }
+        }
+        return false;
+    };
+
+    // Reduction partials are kept per chunk and merged in iteration order,
+    // so results do not depend on which worker ran which chunk.
+    std::map<size_t, std::unordered_map<std::string, Value>> partials;
+    std::mutex partialsMutex;
+    std::atomic<bool> failed{false};
+    std::string firstError;
+
+    std::vector<std::unique_ptr<Interpreter>> workers;
+    for (size_t w = 0; w < workerCount; ++w) {
+        auto worker = std::make_unique<Interpreter>(*this);
+        worker->environment = std::make_shared<Environment>(*environment);
+        worker->inParallelBody = true;
+        worker->reductionSlots.clear();
+        workers.push_back(std::move(worker));
+    }
+
+    auto run = [&](size_t w) {
+        Interpreter& interp = *workers[w];
+        size_t begin = 0, end = 0;
+        try {
+            for (size_t round = 0; !failed.load() && claim(w, round, begin, end); ++round) {
+                interp.reductionSlots.clear();
+                for (size_t i = begin; i < end && !failed.load(); ++i) {
+                    interp.variables[stmt->var] = items[i];
+                    try {
+                        interp.execute(stmt->body.get());
+                    } catch (const ContinueSignal&) {
+                        continue;
+                    }
+                }
+                if (!interp.reductionSlots.empty()) {
+                    std::lock_guard<std::mutex> lock(partialsMutex);
+                    partials[begin] = std::move(interp.reductionSlots);
+                }
+            }
+        } catch (const BreakSignal&) {
+            std::lock_guard<std::mutex> lock(partialsMutex);
+            if (!failed.exchange(true)) firstError = "parallel for: 'break' is not allowed in a parallel loop.";
+        } catch (const Value&) {
+            std::lock_guard<std::mutex> lock(partialsMutex);
+            if (!failed.exchange(true)) firstError = "parallel for: 'return' is not allowed in a parallel loop.";
+        } catch (const std::exception& e) {
+            std::lock_guard<std::mutex> lock(partialsMutex);
+            if (!failed.exchange(true)) firstError = e.what();
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (size_t w = 1; w < workerCount; ++w) threads.emplace_back(run, w);
+    run(0);
+    for (auto& t : threads) t.join();
+
+    if (failed.load()) throw std::runtime_error(firstError);
+
+    for (const auto& [begin, slots] : partials) {
+        for (const auto& [name, partial] : slots) {
+            BinaryOp op = reductions.count(name) ? reductions[name] : BinaryOp::Add;
+            bool inEnv = environment && environment->values.count(name);
+            Value& target = inEnv ? environment->values[name] : variables[name];
+            BinaryExpr tempBin(std::make_unique<LiteralExpr>(target), op,
+                               std::make_unique<LiteralExpr>(partial));
+            target = evalExpr(&tempBin);
+        }
+    }
+}
+
 // ============================================================================
 // Pattern matching
 // ============================================================================
@@ -3523,9 +4145,9 @@ bool Interpreter::matchPattern(const Pattern* pattern, const Value& value,
             return true;
         }
 
-        // Also support matching against unordered_map (struct instances)
-        if (value.holds_alternative<std::unordered_map<std::string, Value>>()) {
-            const auto& map = value.get<std::unordered_map<std::string, Value>>();
+        // Also support matching against maps (struct instances)
+        if (value.holds_alternative<MapValue>()) {
+            const auto& map = value.get<MapValue>();
 
             for (const auto& [fieldName, fieldPattern] : structPat->fields) {
                 auto it = map.find(fieldName);
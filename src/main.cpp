@@ -2,6 +2,7 @@
 #include "yen/parser.h"
 #include "yen/compiler.h"
 #include "yen/stdlib.h"
+#include "yen/native_libs.h"
 #include <iostream>
 #include <fstream>
 #include <sstream>
@@ -15,6 +16,7 @@ static void run(const std::string& source);
 Interpreter interpreter;
 
 int main(int argc, char* argv[]) {
+    YenNative::Console::init();
     initialize_globals(interpreter);
     if (argc > 2) {
         std::cout << "Usage: yen [script]" << std::endl;
@@ -42,6 +44,7 @@ static void runRepl() {
     std::string line;
     for (;;) {
         std::cout << "> ";
+        YenNative::Console::flush();
         if (!std::getline(std::cin, line)) {
             std::cout << std::endl;
             break;
@@ -62,6 +65,7 @@ static void run(const std::string& source) {
     try {
         interpreter.execute(statements);
     } catch (const std::runtime_error& e) {
+        YenNative::Console::flush();
         std::cerr << "Runtime Error: " << e.what() << std::endl;
     }
 }
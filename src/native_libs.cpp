@@ -11,17 +11,45 @@
 #include <fstream>
 #include <filesystem>
 #include <cstdlib>
+#include <cstring>
 #include <functional>
 #include <regex>
+#include <string_view>
+#include <charconv>
+#include <limits>
+#include <csignal>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define YEN_X86_DISPATCH 1
+#include <immintrin.h>
+#include <cpuid.h>
+#endif
 #ifndef _WIN32
 #include <sys/socket.h>
 #include <netinet/in.h>
 #include <arpa/inet.h>
 #include <netdb.h>
+#include <netinet/tcp.h>
+#include <fcntl.h>
+#include <cerrno>
+#include <poll.h>
+#endif
+#ifdef __linux__
+#include <sys/epoll.h>
+#include <sys/sendfile.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
 #endif
 #include <mutex>
 #include <condition_variable>
 #include <queue>
+#include <deque>
+#include <list>
+#include <array>
 #include <atomic>
 
 #ifdef HAVE_LIBCURL
@@ -31,6 +59,8 @@
 #ifdef _WIN32
 #include <windows.h>
 #include <direct.h>
+#include <io.h>
+#include <fcntl.h>
 #define getcwd _getcwd
 #define chdir _chdir
 #else
@@ -47,6 +77,27 @@ static double toDouble(const Value& val) {
     throw std::runtime_error("Expected numeric value.");
 }
 
+// Helper: map key as text (JSON object keys, header names, messages)
+static std::string keyToString(const Value& key) {
+    if (key.holds_alternative<std::string>()) return key.get<std::string>();
+    if (key.holds_alternative<int>()) return std::to_string(key.get<int>());
+    if (key.holds_alternative<bool>()) return key.get<bool>() ? "true" : "false";
+    if (key.holds_alternative<double>() || key.holds_alternative<float>()) {
+        char buf[32];
+        auto res = std::to_chars(buf, buf + sizeof(buf), key.holds_alternative<double>() ? key.get<double>() : key.get<float>());
+        return std::string(buf, res.ptr);
+    }
+    if (key.holds_alternative<std::vector<Value>>()) {
+        std::string out = "[";
+        for (const auto& item : key.get<std::vector<Value>>()) {
+            if (out.size() > 1) out += ", ";
+            out += keyToString(item);
+        }
+        return out + "]";
+    }
+    return "none";
+}
+
 // Helper: extract int from Value
 static int toInt(const Value& val) {
     if (val.holds_alternative<int>()) return val.get<int>();
@@ -55,6 +106,178 @@ static int toInt(const Value& val) {
     throw std::runtime_error("Expected integer value.");
 }
 
+// Helper: CPU features for the SIMD fast paths, probed once at startup
+struct CpuFeatures {
+    bool ssse3 = false;
+    bool sse42 = false;
+    bool avx2 = false;
+    bool sha = false;
+    CpuFeatures() {
+#ifdef YEN_X86_DISPATCH
+        unsigned a, b, c, d;
+        if (!__get_cpuid(1, &a, &b, &c, &d)) return;
+        ssse3 = c & (1u << 9);
+        bool sse41 = c & (1u << 19);
+        sse42 = c & (1u << 20);
+        bool osYmm = false;
+        if (c & (1u << 27)) {   // OSXSAVE: the OS saves YMM state if XCR0 has bits 1 and 2
+            unsigned lo, hi;
+            __asm__("xgetbv" : "=a"(lo), "=d"(hi) : "c"(0));
+            osYmm = (lo & 6) == 6;
+        }
+        if (__get_cpuid_count(7, 0, &a, &b, &c, &d)) {
+            avx2 = osYmm && (b & (1u << 5));
+            sha = (b & (1u << 29)) && ssse3 && sse41;
+        }
+#endif
+    }
+};
+static const CpuFeatures cpu;
+
+// ============ VALUE METHODS ============
+namespace Methods {
+    // Built on first use: the global interpreter registers libraries during
+    // static initialization, possibly before this file's statics exist
+    struct Registry {
+        std::mutex mutex;
+        std::unordered_map<std::string, int> ids;
+        // Rows are sized to kMaxMethods on their first add, so lookups never
+        // see a reallocation
+        std::vector<NativeFunction> tables[std::variant_size_v<ValueVariant>];
+    };
+
+    static Registry& registry() {
+        static Registry r;
+        return r;
+    }
+
+    int intern(const std::string& name) {
+        Registry& r = registry();
+        std::lock_guard<std::mutex> lock(r.mutex);
+        auto it = r.ids.find(name);
+        if (it != r.ids.end()) return it->second;
+        if (r.ids.size() + 1 >= static_cast<size_t>(kMaxMethods)) return 0;
+        int id = static_cast<int>(r.ids.size()) + 1;
+        r.ids.emplace(name, id);
+        return id;
+    }
+
+    void add(size_t typeIndex, const std::string& name, NativeFunction fn) {
+        int id = intern(name);
+        if (id == 0) throw std::runtime_error("Methods::add: too many method names.");
+        Registry& r = registry();
+        std::lock_guard<std::mutex> lock(r.mutex);
+        auto& row = r.tables[typeIndex];
+        if (row.empty()) row.resize(kMaxMethods, NativeFunction{nullptr, 0});
+        row[id] = fn;
+    }
+
+    const NativeFunction* find(size_t typeIndex, int id) {
+        const auto& row = registry().tables[typeIndex];
+        if (id <= 0 || static_cast<size_t>(id) >= row.size() || !row[id].function) return nullptr;
+        return &row[id];
+    }
+}
+
+// ============ CONSOLE OUTPUT ============
+namespace Console {
+#ifndef _WIN32
+    // Ctrl-C and kill end the process without running exit's flush. stdio is
+    // not async-signal-safe (the interrupted thread may be inside fwrite on
+    // stdout), so the handler only records the signal and wakes a flusher
+    // thread. That thread flushes with the stream lock taken normally and
+    // then dies from the signal as before. A second signal ends the process
+    // at once.
+    static int signalPipe[2] = {-1, -1};
+    static volatile sig_atomic_t pendingSignal = 0;
+
+    static void onSignal(int sig) {
+        if (pendingSignal) {
+            std::signal(sig, SIG_DFL);
+            std::raise(sig);
+            return;
+        }
+        pendingSignal = sig;
+        int savedErrno = errno;
+        ssize_t n = ::write(signalPipe[1], "", 1);
+        (void)n;
+        errno = savedErrno;
+    }
+
+    static void flushThenDie() {
+        char c;
+        while (::read(signalPipe[0], &c, 1) < 0 && errno == EINTR) {}
+        std::fflush(stdout);
+        int sig = pendingSignal;
+        std::signal(sig, SIG_DFL);
+        std::raise(sig);
+    }
+#endif
+
+    // print, printf and the std::cout writers in the libraries all land in
+    // stdout's stdio buffer (cout is synced with stdio), so they stay in order.
+    // Writers to stderr flush stdout first; process spawning and blocking
+    // socket waits do too.
+    void init() {
+#ifdef _WIN32
+        bool tty = _isatty(_fileno(stdout));
+#else
+        bool tty = isatty(STDOUT_FILENO);
+#endif
+        static constexpr size_t kBufferSize = 1 << 20;
+        if (tty) std::setvbuf(stdout, nullptr, _IOLBF, 64 * 1024);
+        else std::setvbuf(stdout, new char[kBufferSize], _IOFBF, kBufferSize);  // Lives until exit
+#ifndef _WIN32
+        if (pipe2(signalPipe, O_CLOEXEC) == 0) {
+            std::thread(flushThenDie).detach();
+            for (int sig : {SIGINT, SIGTERM}) {
+                if (std::signal(sig, onSignal) == SIG_IGN) std::signal(sig, SIG_IGN);  // Keep nohup's ignore
+            }
+        }
+#endif
+    }
+
+    void write(std::string_view text) {
+        std::fwrite(text.data(), 1, text.size(), stdout);
+    }
+
+    void flush() {
+        std::fflush(stdout);
+    }
+}
+
+// print's rendering of a value, for %s and %v
+static void appendDisplay(std::string& out, const Value& val) {
+    if (val.holds_alternative<std::string>()) out += std::get<StringValue>(val.data).view();
+    else if (val.holds_alternative<int>()) out += numberToString(val.get<int>());
+    else if (val.holds_alternative<double>()) out += doubleToDisplay(val.get<double>());
+    else if (val.holds_alternative<float>()) out += doubleToDisplay(val.get<float>());
+    else if (val.holds_alternative<bool>()) out += val.get<bool>() ? "true" : "false";
+    else if (val.holds_alternative<std::monostate>()) out += "null";
+    else if (val.holds_alternative<std::vector<Value>>()) {
+        out += '[';
+        const auto& list = val.get<std::vector<Value>>();
+        for (size_t i = 0; i < list.size(); ++i) {
+            if (i > 0) out += ", ";
+            appendDisplay(out, list[i]);
+        }
+        out += ']';
+    } else if (val.holds_alternative<MapValue>()) {
+        out += '{';
+        bool first = true;
+        for (const auto& [key, v] : val.get<MapValue>()) {
+            if (!first) out += ", ";
+            first = false;
+            appendDisplay(out, key);
+            out += ": ";
+            appendDisplay(out, v);
+        }
+        out += '}';
+    } else {
+        out += keyToString(val);
+    }
+}
+
 // ============ CORE LIBRARY ============
 namespace Core {
     Value isInt(std::vector<Value>& args) {
@@ -84,7 +307,7 @@ namespace Core {
 
     Value isMap(std::vector<Value>& args) {
         if (args.empty()) return false;
-        return args[0].holds_alternative<std::unordered_map<std::string, Value>>();
+        return args[0].holds_alternative<MapValue>();
     }
 
     Value isFunc(std::vector<Value>& args) {
@@ -134,9 +357,9 @@ namespace Core {
         if (args.empty()) return std::string("");
         const auto& val = args[0];
         if (val.holds_alternative<std::string>()) return val.get<std::string>();
-        if (val.holds_alternative<int>()) return std::to_string(val.get<int>());
-        if (val.holds_alternative<double>()) return std::to_string(val.get<double>());
-        if (val.holds_alternative<float>()) return std::to_string(val.get<float>());
+        if (val.holds_alternative<int>()) return numberToString(val.get<int>());
+        if (val.holds_alternative<double>()) return numberToString(val.get<double>());
+        if (val.holds_alternative<float>()) return numberToString(val.get<float>());
         if (val.holds_alternative<bool>()) return val.get<bool>() ? std::string("true") : std::string("false");
         if (val.holds_alternative<std::monostate>()) return std::string("null");
         return std::string("<value>");
@@ -152,7 +375,7 @@ namespace Core {
         if (val.holds_alternative<bool>()) return std::string("bool");
         if (val.holds_alternative<std::string>()) return std::string("string");
         if (val.holds_alternative<std::vector<Value>>()) return std::string("list");
-        if (val.holds_alternative<std::unordered_map<std::string, Value>>()) return std::string("map");
+        if (val.holds_alternative<MapValue>()) return std::string("map");
         if (val.holds_alternative<std::shared_ptr<ClassInstance>>()) {
             return std::string("class:" + val.get<std::shared_ptr<ClassInstance>>()->className);
         }
@@ -160,6 +383,9 @@ namespace Core {
         if (val.holds_alternative<const FunctionStmt*>()) return std::string("function");
         if (val.holds_alternative<NativeFunction>()) return std::string("native_function");
         if (val.holds_alternative<LambdaValue>()) return std::string("lambda");
+        if (val.holds_alternative<std::shared_ptr<SetValue>>()) return std::string("set");
+        if (val.holds_alternative<std::shared_ptr<IteratorValue>>()) return std::string("iterator");
+        if (val.holds_alternative<std::shared_ptr<StringBuilderValue>>()) return std::string("string_builder");
         return std::string("unknown");
     }
 
@@ -174,7 +400,183 @@ namespace Core {
             else if (val.holds_alternative<std::monostate>()) std::cout << "null";
             else std::cout << "<value>";
         }
-        std::cout << std::endl;
+        std::cout << '\n';
+        return Value();
+    }
+
+    // ---- format / printf ----
+    //
+    // printf-style specs: %[flags][width][.precision]conv with flags "-+ 0#"
+    // and conversions d i u x X o b (integers), f F e E g G (floats), s v
+    // (any value, as print shows it), c (character) and %%. A format string is
+    // parsed once and cached, so a format in a loop is only compiled on its
+    // first pass; numbers are rendered with std::to_chars.
+
+    struct FormatSpec {
+        std::string literal;    // Text preceding the conversion
+        char conv = 0;          // 0: trailing literal only
+        bool left = false, plus = false, space = false, zero = false, alt = false;
+        int width = 0;
+        int precision = -1;
+    };
+
+    struct CompiledFormat {
+        std::vector<FormatSpec> specs;
+        size_t argCount = 0;
+    };
+
+    static std::shared_ptr<const CompiledFormat> compileFormat(const std::string& fmt, const char* fn) {
+        auto compiled = std::make_shared<CompiledFormat>();
+        FormatSpec spec;
+        for (size_t i = 0; i < fmt.size(); ++i) {
+            char c = fmt[i];
+            if (c != '%') { spec.literal += c; continue; }
+            if (++i == fmt.size()) throw std::runtime_error(std::string(fn) + ": format string ends with '%'.");
+            if (fmt[i] == '%') { spec.literal += '%'; continue; }
+            for (; i < fmt.size(); ++i) {
+                if (fmt[i] == '-') spec.left = true;
+                else if (fmt[i] == '+') spec.plus = true;
+                else if (fmt[i] == ' ') spec.space = true;
+                else if (fmt[i] == '0') spec.zero = true;
+                else if (fmt[i] == '#') spec.alt = true;
+                else break;
+            }
+            for (; i < fmt.size() && std::isdigit(static_cast<unsigned char>(fmt[i])); ++i) spec.width = spec.width * 10 + (fmt[i] - '0');
+            if (i < fmt.size() && fmt[i] == '.') {
+                spec.precision = 0;
+                for (++i; i < fmt.size() && std::isdigit(static_cast<unsigned char>(fmt[i])); ++i) spec.precision = spec.precision * 10 + (fmt[i] - '0');
+            }
+            if (i == fmt.size() || !std::strchr("diuxXobfFeEgGsvc", fmt[i]))
+                throw std::runtime_error(std::string(fn) + ": unknown conversion '%" + (i < fmt.size() ? std::string(1, fmt[i]) : "") + "' in format string.");
+            spec.conv = fmt[i];
+            compiled->specs.push_back(std::move(spec));
+            spec = FormatSpec();
+            ++compiled->argCount;
+        }
+        if (!spec.literal.empty()) compiled->specs.push_back(std::move(spec));
+        return compiled;
+    }
+
+    static std::shared_ptr<const CompiledFormat> getFormat(const std::string& fmt, const char* fn) {
+        thread_local std::unordered_map<std::string, std::shared_ptr<const CompiledFormat>> cache;
+        auto it = cache.find(fmt);
+        if (it != cache.end()) return it->second;
+        if (cache.size() >= 256) cache.clear();
+        auto compiled = compileFormat(fmt, fn);
+        cache.emplace(fmt, compiled);
+        return compiled;
+    }
+
+    static void appendUtf8(std::string& out, uint32_t cp) {
+        if (cp < 0x80) out += static_cast<char>(cp);
+        else if (cp < 0x800) { out += static_cast<char>(0xC0 | (cp >> 6)); out += static_cast<char>(0x80 | (cp & 0x3F)); }
+        else if (cp < 0x10000) {
+            out += static_cast<char>(0xE0 | (cp >> 12));
+            out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+            out += static_cast<char>(0x80 | (cp & 0x3F));
+        } else {
+            out += static_cast<char>(0xF0 | (cp >> 18));
+            out += static_cast<char>(0x80 | ((cp >> 12) & 0x3F));
+            out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+            out += static_cast<char>(0x80 | (cp & 0x3F));
+        }
+    }
+
+    static char upper(char ch) { return static_cast<char>(std::toupper(static_cast<unsigned char>(ch))); }
+
+    static void appendFormatted(std::string& out, const FormatSpec& spec, const Value& arg, const char* fn) {
+        char buf[400];
+        std::string_view body;      // Digits or text, without sign or prefix
+        std::string text;
+        bool negative = false;
+        bool numeric = true;        // Takes sign flags and zero padding
+        const char* prefix = "";
+        switch (spec.conv) {
+            case 'd': case 'i': case 'u': case 'x': case 'X': case 'o': case 'b': {
+                long long v;
+                if (arg.holds_alternative<int>()) v = arg.get<int>();
+                else if (arg.holds_alternative<bool>()) v = arg.get<bool>();
+                else if (arg.holds_alternative<double>() || arg.holds_alternative<float>()) {
+                    double d = toDouble(arg);
+                    if (!std::isfinite(d)) throw std::runtime_error(std::string(fn) + ": %" + spec.conv + " expects a finite number.");
+                    v = static_cast<long long>(d);
+                } else {
+                    throw std::runtime_error(std::string(fn) + ": %" + spec.conv + " expects a number.");
+                }
+                negative = v < 0;
+                unsigned long long mag = negative ? 0ULL - static_cast<unsigned long long>(v) : static_cast<unsigned long long>(v);
+                int base = spec.conv == 'x' || spec.conv == 'X' ? 16 : spec.conv == 'o' ? 8 : spec.conv == 'b' ? 2 : 10;
+                auto res = std::to_chars(buf, buf + sizeof(buf), mag, base);
+                if (spec.conv == 'X') std::transform(buf, res.ptr, buf, upper);
+                body = std::string_view(buf, res.ptr - buf);
+                if (spec.alt && mag != 0) prefix = spec.conv == 'x' ? "0x" : spec.conv == 'X' ? "0X" : spec.conv == 'o' ? "0" : spec.conv == 'b' ? "0b" : "";
+                break;
+            }
+            case 'f': case 'F': case 'e': case 'E': case 'g': case 'G': {
+                if (!(arg.holds_alternative<int>() || arg.holds_alternative<double>() || arg.holds_alternative<float>()))
+                    throw std::runtime_error(std::string(fn) + ": %" + spec.conv + " expects a number.");
+                double d = toDouble(arg);
+                negative = std::signbit(d) && !std::isnan(d);
+                char lower = static_cast<char>(std::tolower(static_cast<unsigned char>(spec.conv)));
+                auto style = lower == 'f' ? std::chars_format::fixed : lower == 'e' ? std::chars_format::scientific : std::chars_format::general;
+                int precision = spec.precision < 0 ? 6 : spec.precision;
+                auto res = std::to_chars(buf, buf + sizeof(buf), std::fabs(d), style, precision);
+                if (res.ec != std::errc()) throw std::runtime_error(std::string(fn) + ": number too long to format.");
+                if (spec.conv != lower) std::transform(buf, res.ptr, buf, upper);
+                body = std::string_view(buf, res.ptr - buf);
+                break;
+            }
+            case 'c':
+                numeric = false;
+                if (arg.holds_alternative<int>()) appendUtf8(text, static_cast<uint32_t>(std::clamp(arg.get<int>(), 0, 0x10FFFF)));
+                else if (arg.holds_alternative<std::string>()) text = arg.get<std::string>().substr(0, 1);
+                else throw std::runtime_error(std::string(fn) + ": %c expects a code point or a string.");
+                body = text;
+                break;
+            default:   // s, v
+                numeric = false;
+                appendDisplay(text, arg);
+                if (spec.precision >= 0 && text.size() > static_cast<size_t>(spec.precision)) text.resize(spec.precision);
+                body = text;
+                break;
+        }
+
+        const char* sign = negative ? "-" : !numeric ? "" : spec.plus ? "+" : spec.space ? " " : "";
+        size_t length = std::strlen(sign) + std::strlen(prefix) + body.size();
+        size_t pad = static_cast<size_t>(spec.width) > length ? spec.width - length : 0;
+        bool zeroPad = spec.zero && numeric && !spec.left && !body.empty() && std::isdigit(static_cast<unsigned char>(body.front()));
+        if (pad && !spec.left && !zeroPad) out.append(pad, ' ');
+        out += sign;
+        out += prefix;
+        if (pad && zeroPad) out.append(pad, '0');
+        out += body;
+        if (pad && spec.left) out.append(pad, ' ');
+    }
+
+    static std::string formatArgs(std::vector<Value>& args, const char* fn) {
+        if (args.empty() || !args[0].holds_alternative<std::string>())
+            throw std::runtime_error(std::string(fn) + ": expected a format string.");
+        auto compiled = getFormat(args[0].get<std::string>(), fn);
+        if (args.size() - 1 != compiled->argCount)
+            throw std::runtime_error(std::string(fn) + ": format expects " + std::to_string(compiled->argCount) +
+                                     " arguments but got " + std::to_string(args.size() - 1) + ".");
+        std::string out;
+        size_t next = 1;
+        for (const auto& spec : compiled->specs) {
+            out += spec.literal;
+            if (spec.conv) appendFormatted(out, spec, args[next++], fn);
+        }
+        return out;
+    }
+
+    // format(fmt, args...): returns the formatted string
+    Value formatFn(std::vector<Value>& args) {
+        return formatArgs(args, "format");
+    }
+
+    // printf(fmt, args...): writes to stdout; no newline is added
+    Value printfFn(std::vector<Value>& args) {
+        Console::write(formatArgs(args, "printf"));
         return Value();
     }
 
@@ -199,6 +601,8 @@ namespace Core {
         globals["core_to_string"] = NativeFunction{toStringFn, 1};
         globals["typeof"] = NativeFunction{typeofFn, 1};
         globals["println"] = NativeFunction{printlnFn, -1};
+        globals["format"] = NativeFunction{formatFn, -1};
+        globals["printf"] = NativeFunction{printfFn, -1};
         globals["panic"] = NativeFunction{panicFn, 1};
     }
 }
@@ -403,9 +807,70 @@ namespace Math {
 
 // ============ STRING LIBRARY ============
 namespace String {
+    // Read-only functions work on the bytes directly, so a slice or split
+    // piece is never copied out of the string it shares.
+    static std::string_view textOf(const Value& val) {
+        return std::get<StringValue>(val.data).view();
+    }
+
+    // ---- Substring search ----
+    //
+    // Candidate positions are those where both the needle's first and last
+    // byte match, found a vector of haystack bytes at a time; only those are
+    // compared in full. The tail shorter than a vector uses string_view::find.
+
+#if defined(__SSE2__)
+    static size_t findSse2(std::string_view hay, std::string_view needle, size_t i) {
+        const size_t m = needle.size();
+        const __m128i first = _mm_set1_epi8(needle[0]);
+        const __m128i last = _mm_set1_epi8(needle[m - 1]);
+        for (; i + m + 15 <= hay.size(); i += 16) {
+            __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(hay.data() + i));
+            __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(hay.data() + i + m - 1));
+            unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(a, first), _mm_cmpeq_epi8(b, last))));
+            for (; mask; mask &= mask - 1) {
+                size_t at = i + __builtin_ctz(mask);
+                if (std::memcmp(hay.data() + at + 1, needle.data() + 1, m - 2) == 0) return at;
+            }
+        }
+        return hay.find(needle, i);
+    }
+#endif
+
+#ifdef YEN_X86_DISPATCH
+    __attribute__((target("avx2")))
+    static size_t findAvx2(std::string_view hay, std::string_view needle, size_t i) {
+        const size_t m = needle.size();
+        const __m256i first = _mm256_set1_epi8(needle[0]);
+        const __m256i last = _mm256_set1_epi8(needle[m - 1]);
+        for (; i + m + 31 <= hay.size(); i += 32) {
+            __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(hay.data() + i));
+            __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(hay.data() + i + m - 1));
+            unsigned mask = static_cast<unsigned>(_mm256_movemask_epi8(_mm256_and_si256(_mm256_cmpeq_epi8(a, first), _mm256_cmpeq_epi8(b, last))));
+            for (; mask; mask &= mask - 1) {
+                size_t at = i + __builtin_ctz(mask);
+                if (std::memcmp(hay.data() + at + 1, needle.data() + 1, m - 2) == 0) return at;
+            }
+        }
+        return hay.find(needle, i);
+    }
+#endif
+
+    size_t findText(std::string_view hay, std::string_view needle, size_t from) {
+        if (needle.size() < 2 || from > hay.size() || needle.size() > hay.size() - from) return hay.find(needle, from);
+#ifdef YEN_X86_DISPATCH
+        if (cpu.avx2) return findAvx2(hay, needle, from);
+#endif
+#if defined(__SSE2__)
+        return findSse2(hay, needle, from);
+#else
+        return hay.find(needle, from);
+#endif
+    }
+
     Value length(std::vector<Value>& args) {
         if (args.empty() || !args[0].holds_alternative<std::string>()) return 0;
-        return static_cast<int>(args[0].get<std::string>().length());
+        return static_cast<int>(textOf(args[0]).size());
     }
 
     Value upper(std::vector<Value>& args) {
@@ -424,28 +889,31 @@ namespace String {
 
     Value trim(std::vector<Value>& args) {
         if (args.empty() || !args[0].holds_alternative<std::string>()) return std::string("");
-        std::string str = args[0].get<std::string>();
-        str.erase(str.begin(), std::find_if(str.begin(), str.end(), [](unsigned char ch) { return !std::isspace(ch); }));
-        str.erase(std::find_if(str.rbegin(), str.rend(), [](unsigned char ch) { return !std::isspace(ch); }).base(), str.end());
-        return str;
+        std::string_view str = textOf(args[0]);
+        size_t begin = 0, end = str.size();
+        while (begin < end && std::isspace(static_cast<unsigned char>(str[begin]))) ++begin;
+        while (end > begin && std::isspace(static_cast<unsigned char>(str[end - 1]))) --end;
+        return std::get<StringValue>(args[0].data).slice(begin, end - begin);
     }
 
     Value split(std::vector<Value>& args) {
         if (args.size() < 2 || !args[0].holds_alternative<std::string>() || !args[1].holds_alternative<std::string>())
             return std::vector<Value>();
-        std::string str = args[0].get<std::string>();
-        std::string delimiter = args[1].get<std::string>();
+        const StringValue& whole = std::get<StringValue>(args[0].data);
+        std::string_view str = whole.view();
+        std::string_view delimiter = textOf(args[1]);
         std::vector<Value> result;
         if (delimiter.empty()) {
+            result.reserve(str.size());
             for (char c : str) result.push_back(Value(std::string(1, c)));
             return result;
         }
-        size_t pos = 0;
-        while ((pos = str.find(delimiter)) != std::string::npos) {
-            result.push_back(Value(str.substr(0, pos)));
-            str.erase(0, pos + delimiter.length());
+        size_t start = 0, pos;
+        while ((pos = str.find(delimiter, start)) != std::string_view::npos) {
+            result.push_back(Value(whole.slice(start, pos - start)));
+            start = pos + delimiter.size();
         }
-        result.push_back(Value(str));
+        result.push_back(Value(whole.slice(start)));
         return result;
     }
 
@@ -453,11 +921,11 @@ namespace String {
         if (args.size() < 2 || !args[0].holds_alternative<std::vector<Value>>() || !args[1].holds_alternative<std::string>())
             return std::string("");
         const auto& vec = args[0].get<std::vector<Value>>();
-        const std::string& separator = args[1].get<std::string>();
+        std::string_view separator = textOf(args[1]);
         std::string result;
         for (size_t i = 0; i < vec.size(); ++i) {
             if (i > 0) result += separator;
-            if (vec[i].holds_alternative<std::string>()) result += vec[i].get<std::string>();
+            if (vec[i].holds_alternative<std::string>()) result += textOf(vec[i]);
             else if (vec[i].holds_alternative<int>()) result += std::to_string(vec[i].get<int>());
             else if (vec[i].holds_alternative<double>()) result += std::to_string(vec[i].get<double>());
             else if (vec[i].holds_alternative<bool>()) result += vec[i].get<bool>() ? "true" : "false";
@@ -467,55 +935,61 @@ namespace String {
 
     Value substring(std::vector<Value>& args) {
         if (args.size() < 3 || !args[0].holds_alternative<std::string>()) return std::string("");
-        std::string str = args[0].get<std::string>();
+        const StringValue& str = std::get<StringValue>(args[0].data);
         int start = toInt(args[1]);
         int len = toInt(args[2]);
-        if (start < 0 || start >= static_cast<int>(str.length())) return std::string("");
-        return str.substr(start, len);
+        if (start < 0 || start >= static_cast<int>(str.size())) return std::string("");
+        return str.slice(start, static_cast<size_t>(len));
     }
 
     Value contains(std::vector<Value>& args) {
         if (args.size() < 2 || !args[0].holds_alternative<std::string>() || !args[1].holds_alternative<std::string>())
             return false;
-        return args[0].get<std::string>().find(args[1].get<std::string>()) != std::string::npos;
+        return findText(textOf(args[0]), textOf(args[1])) != std::string_view::npos;
     }
 
     Value replace(std::vector<Value>& args) {
         if (args.size() < 3 || !args[0].holds_alternative<std::string>() ||
             !args[1].holds_alternative<std::string>() || !args[2].holds_alternative<std::string>())
             return std::string("");
-        std::string str = args[0].get<std::string>();
-        const std::string& from = args[1].get<std::string>();
-        const std::string& to = args[2].get<std::string>();
-        size_t pos = 0;
-        while ((pos = str.find(from, pos)) != std::string::npos) {
-            str.replace(pos, from.length(), to);
-            pos += to.length();
-        }
-        return str;
+        std::string_view str = textOf(args[0]);
+        std::string_view from = textOf(args[1]);
+        std::string_view to = textOf(args[2]);
+        size_t pos = from.empty() ? std::string_view::npos : findText(str, from);
+        if (pos == std::string_view::npos) return args[0];
+        // One pass: copy the text between matches and the replacements
+        std::string out;
+        out.reserve(str.size() + (to.size() > from.size() ? to.size() - from.size() : 0) * 4);
+        size_t start = 0;
+        do {
+            out.append(str, start, pos - start).append(to);
+            start = pos + from.size();
+        } while ((pos = findText(str, from, start)) != std::string_view::npos);
+        out.append(str, start);
+        return out;
     }
 
     Value starts_with(std::vector<Value>& args) {
         if (args.size() < 2 || !args[0].holds_alternative<std::string>() || !args[1].holds_alternative<std::string>())
             return false;
-        const auto& str = args[0].get<std::string>();
-        const auto& prefix = args[1].get<std::string>();
+        std::string_view str = textOf(args[0]);
+        std::string_view prefix = textOf(args[1]);
         return str.size() >= prefix.size() && str.compare(0, prefix.size(), prefix) == 0;
     }
 
     Value ends_with(std::vector<Value>& args) {
         if (args.size() < 2 || !args[0].holds_alternative<std::string>() || !args[1].holds_alternative<std::string>())
             return false;
-        const auto& str = args[0].get<std::string>();
-        const auto& suffix = args[1].get<std::string>();
+        std::string_view str = textOf(args[0]);
+        std::string_view suffix = textOf(args[1]);
         return str.size() >= suffix.size() && str.compare(str.size() - suffix.size(), suffix.size(), suffix) == 0;
     }
 
     Value index_of(std::vector<Value>& args) {
         if (args.size() < 2 || !args[0].holds_alternative<std::string>() || !args[1].holds_alternative<std::string>())
             return -1;
-        size_t pos = args[0].get<std::string>().find(args[1].get<std::string>());
-        return pos == std::string::npos ? -1 : static_cast<int>(pos);
+        size_t pos = findText(textOf(args[0]), textOf(args[1]));
+        return pos == std::string_view::npos ? -1 : static_cast<int>(pos);
     }
 
     Value repeat(std::vector<Value>& args) {
@@ -529,7 +1003,7 @@ namespace String {
 
     Value char_at(std::vector<Value>& args) {
         if (args.size() < 2 || !args[0].holds_alternative<std::string>()) return std::string("");
-        const auto& str = args[0].get<std::string>();
+        std::string_view str = textOf(args[0]);
         int idx = toInt(args[1]);
         if (idx < 0 || idx >= static_cast<int>(str.size())) return std::string("");
         return std::string(1, str[idx]);
@@ -537,8 +1011,9 @@ namespace String {
 
     Value to_chars(std::vector<Value>& args) {
         if (args.empty() || !args[0].holds_alternative<std::string>()) return std::vector<Value>();
-        const auto& str = args[0].get<std::string>();
+        std::string_view str = textOf(args[0]);
         std::vector<Value> result;
+        result.reserve(str.size());
         for (char c : str) result.push_back(Value(std::string(1, c)));
         return result;
     }
@@ -585,12 +1060,12 @@ namespace String {
     Value count(std::vector<Value>& args) {
         if (args.size() < 2 || !args[0].holds_alternative<std::string>() || !args[1].holds_alternative<std::string>())
             return 0;
-        const std::string& str = args[0].get<std::string>();
-        const std::string& substr = args[1].get<std::string>();
+        std::string_view str = textOf(args[0]);
+        std::string_view substr = textOf(args[1]);
         if (substr.empty()) return 0;
         int count = 0;
         size_t pos = 0;
-        while ((pos = str.find(substr, pos)) != std::string::npos) {
+        while ((pos = findText(str, substr, pos)) != std::string_view::npos) {
             ++count;
             pos += substr.length();
         }
@@ -599,7 +1074,7 @@ namespace String {
 
     Value is_empty(std::vector<Value>& args) {
         if (args.empty() || !args[0].holds_alternative<std::string>()) return true;
-        return args[0].get<std::string>().empty();
+        return textOf(args[0]).empty();
     }
 
     Value is_numeric(std::vector<Value>& args) {
@@ -639,7 +1114,7 @@ namespace String {
 
     Value char_code(std::vector<Value>& args) {
         if (args.empty() || !args[0].holds_alternative<std::string>()) return 0;
-        const std::string& str = args[0].get<std::string>();
+        std::string_view str = textOf(args[0]);
         if (str.empty()) return 0;
         return static_cast<int>(static_cast<unsigned char>(str[0]));
     }
@@ -650,6 +1125,259 @@ namespace String {
         return std::string(1, static_cast<char>(code));
     }
 
+    // ---- Multi-pattern matcher ----
+    //
+    // Aho-Corasick automaton compiled into a dense DFA. Bytes are first mapped
+    // to classes (one per distinct pattern byte, plus one for everything
+    // else), so the transition table is states x classes rather than x 256
+    // and scanning costs one table lookup per input byte.
+
+    struct Matcher {
+        std::vector<std::string> patterns;
+        uint16_t classOf[256] = {};
+        size_t numClasses = 1;
+        std::vector<int32_t> next;      // numClasses entries per state
+        std::vector<int32_t> report;    // First state on the suffix chain with outputs, or -1
+        std::vector<int32_t> dictLink;  // Next such state after this one, or -1
+        std::vector<uint32_t> outStart; // outputs[outStart[s], outStart[s + 1]) end at state s
+        std::vector<int32_t> outputs;   // Pattern indices
+
+        // Calls fn(end, pattern) for every occurrence, overlapping ones
+        // included, in order of end offset; stops when fn returns false
+        template<typename Fn>
+        void scan(std::string_view text, Fn fn) const {
+            int32_t state = 0;
+            for (size_t i = 0; i < text.size(); ++i) {
+                state = next[state * numClasses + classOf[static_cast<unsigned char>(text[i])]];
+                for (int32_t s = report[state]; s >= 0; s = dictLink[s])
+                    for (uint32_t o = outStart[s]; o < outStart[s + 1]; ++o)
+                        if (!fn(i + 1, outputs[o])) return;
+            }
+        }
+    };
+
+    static std::shared_ptr<const Matcher> buildMatcher(std::vector<std::string> patterns, bool icase) {
+        auto m = std::make_shared<Matcher>();
+        auto fold = [icase](unsigned char c) { return icase ? static_cast<unsigned char>(std::tolower(c)) : c; };
+        for (const auto& p : patterns)
+            for (unsigned char c : p)
+                if (!m->classOf[fold(c)]) m->classOf[fold(c)] = static_cast<uint16_t>(m->numClasses++);
+        if (icase)
+            for (int c = 'A'; c <= 'Z'; ++c) m->classOf[c] = m->classOf[c - 'A' + 'a'];
+        const size_t nc = m->numClasses;
+
+        // Trie, with -1 for missing edges
+        std::vector<int32_t> go(nc, -1);
+        std::vector<std::vector<int32_t>> out(1);
+        for (size_t i = 0; i < patterns.size(); ++i) {
+            int32_t s = 0;
+            for (unsigned char c : patterns[i]) {
+                size_t edge = s * nc + m->classOf[c];
+                if (go[edge] < 0) {
+                    go[edge] = static_cast<int32_t>(out.size());
+                    go.resize(go.size() + nc, -1);
+                    out.emplace_back();
+                }
+                s = go[edge];
+            }
+            out[s].push_back(static_cast<int32_t>(i));
+        }
+
+        // Breadth-first: failure links, then missing edges follow them
+        const size_t states = out.size();
+        std::vector<int32_t> fail(states, 0);
+        m->report.assign(states, -1);
+        m->dictLink.assign(states, -1);
+        std::vector<int32_t> queue;
+        queue.reserve(states);
+        for (size_t c = 0; c < nc; ++c) {
+            if (go[c] < 0) go[c] = 0;
+            else if (go[c] > 0) queue.push_back(go[c]);
+        }
+        for (size_t head = 0; head < queue.size(); ++head) {
+            int32_t s = queue[head];
+            int32_t f = fail[s];
+            m->dictLink[s] = m->report[f];
+            m->report[s] = out[s].empty() ? m->dictLink[s] : s;
+            for (size_t c = 0; c < nc; ++c) {
+                int32_t& t = go[s * nc + c];
+                if (t < 0) {
+                    t = go[f * nc + c];
+                } else {
+                    fail[t] = go[f * nc + c];
+                    queue.push_back(t);
+                }
+            }
+        }
+
+        m->outStart.reserve(states + 1);
+        for (const auto& o : out) {
+            m->outStart.push_back(static_cast<uint32_t>(m->outputs.size()));
+            m->outputs.insert(m->outputs.end(), o.begin(), o.end());
+        }
+        m->outStart.push_back(static_cast<uint32_t>(m->outputs.size()));
+        m->next = std::move(go);
+        m->patterns = std::move(patterns);
+        return m;
+    }
+
+    // Handles from str_matcher_new
+    static std::mutex matcherRegistryMutex;
+    static std::unordered_map<int, std::shared_ptr<const Matcher>> matchers;
+    static std::atomic<int> nextMatcherId{1};
+
+    static std::shared_ptr<const Matcher> getMatcher(std::vector<Value>& args, const char* fn) {
+        if (args.size() < 2 || !args[0].holds_alternative<int>() || !args[1].holds_alternative<std::string>())
+            throw std::runtime_error(std::string(fn) + ": expected a matcher and a string.");
+        std::lock_guard<std::mutex> lock(matcherRegistryMutex);
+        auto it = matchers.find(args[0].get<int>());
+        if (it == matchers.end()) throw std::runtime_error(std::string(fn) + ": invalid matcher handle.");
+        return it->second;
+    }
+
+    // str_matcher_new(patterns[, flags]) -> handle; flags "i" = ASCII case-insensitive
+    Value matcher_new(std::vector<Value>& args) {
+        if (args.empty() || !args[0].holds_alternative<std::vector<Value>>())
+            throw std::runtime_error("str_matcher_new: expected a list of patterns.");
+        std::vector<std::string> patterns;
+        for (const auto& p : args[0].get<std::vector<Value>>()) {
+            if (!p.holds_alternative<std::string>() || textOf(p).empty())
+                throw std::runtime_error("str_matcher_new: patterns must be non-empty strings.");
+            patterns.emplace_back(textOf(p));
+        }
+        bool icase = args.size() > 1 && args[1].holds_alternative<std::string>() &&
+                     textOf(args[1]).find('i') != std::string_view::npos;
+        auto m = buildMatcher(std::move(patterns), icase);
+        std::lock_guard<std::mutex> lock(matcherRegistryMutex);
+        int id = nextMatcherId++;
+        matchers[id] = std::move(m);
+        return Value(id);
+    }
+
+    Value matcher_free(std::vector<Value>& args) {
+        if (args.empty()) throw std::runtime_error("str_matcher_free: requires matcher handle.");
+        std::lock_guard<std::mutex> lock(matcherRegistryMutex);
+        matchers.erase(toInt(args[0]));
+        return Value();
+    }
+
+    // str_matcher_test(m, text): true if any pattern occurs
+    Value matcher_test(std::vector<Value>& args) {
+        auto m = getMatcher(args, "str_matcher_test");
+        bool found = false;
+        m->scan(textOf(args[1]), [&](size_t, int32_t) { found = true; return false; });
+        return found;
+    }
+
+    // str_matcher_count(m, text): occurrences of all patterns, overlapping included
+    Value matcher_count(std::vector<Value>& args) {
+        auto m = getMatcher(args, "str_matcher_count");
+        int n = 0;
+        m->scan(textOf(args[1]), [&](size_t, int32_t) { ++n; return true; });
+        return n;
+    }
+
+    // str_matcher_find_all(m, text): [[offset, pattern index], ...] by end offset
+    Value matcher_find_all(std::vector<Value>& args) {
+        auto m = getMatcher(args, "str_matcher_find_all");
+        std::vector<Value> result;
+        m->scan(textOf(args[1]), [&](size_t end, int32_t p) {
+            size_t len = m->patterns[p].size();
+            result.push_back(std::vector<Value>{Value(static_cast<int>(end - len)), Value(static_cast<int>(p))});
+            return true;
+        });
+        return result;
+    }
+
+    // str_matcher_tags(m, text): the distinct patterns that occur, in pattern order
+    Value matcher_tags(std::vector<Value>& args) {
+        auto m = getMatcher(args, "str_matcher_tags");
+        std::vector<char> seen(m->patterns.size(), 0);
+        size_t distinct = 0;
+        m->scan(textOf(args[1]), [&](size_t, int32_t p) {
+            if (!seen[p]) { seen[p] = 1; ++distinct; }
+            return distinct < seen.size();
+        });
+        std::vector<Value> result;
+        result.reserve(distinct);
+        for (size_t i = 0; i < seen.size(); ++i)
+            if (seen[i]) result.emplace_back(m->patterns[i]);
+        return result;
+    }
+
+    // ---- String builder ----
+    //
+    // A builder is a shared handle around one growing buffer, so appending
+    // is amortized O(1) however large the text gets. Scalars are appended as
+    // + renders them next to a string; lists and maps as print shows them.
+
+    static StringBuilderValue& getBuilder(std::vector<Value>& args, const char* fn) {
+        if (args.empty() || !args[0].holds_alternative<std::shared_ptr<StringBuilderValue>>())
+            throw std::runtime_error(std::string(fn) + ": expected a string builder.");
+        return *args[0].get<std::shared_ptr<StringBuilderValue>>();
+    }
+
+    static void appendValue(std::string& out, const Value& val) {
+        if (val.holds_alternative<std::string>()) out += textOf(val);
+        else if (val.holds_alternative<std::shared_ptr<StringBuilderValue>>()) out += val.get<std::shared_ptr<StringBuilderValue>>()->buffer;
+        else if (!appendConcatScalar(out, val)) appendDisplay(out, val);
+    }
+
+    // sb_new([capacity | text])
+    Value sb_new(std::vector<Value>& args) {
+        auto builder = std::make_shared<StringBuilderValue>();
+        if (!args.empty()) {
+            if (args[0].holds_alternative<std::string>()) builder->buffer = args[0].get<std::string>();
+            else builder->buffer.reserve(static_cast<size_t>(std::max(0, toInt(args[0]))));
+        }
+        return builder;
+    }
+
+    // sb_append(sb, values...): returns the builder
+    Value sb_append(std::vector<Value>& args) {
+        auto& builder = getBuilder(args, "sb_append");
+        for (size_t i = 1; i < args.size(); ++i) appendValue(builder.buffer, args[i]);
+        return args[0];
+    }
+
+    // sb_append_many(sb, list[, separator])
+    Value sb_append_many(std::vector<Value>& args) {
+        auto& builder = getBuilder(args, "sb_append_many");
+        if (args.size() < 2 || !args[1].holds_alternative<std::vector<Value>>())
+            throw std::runtime_error("sb_append_many: expected a list.");
+        const auto& items = args[1].get<std::vector<Value>>();
+        std::string separator = args.size() > 2 ? keyToString(args[2]) : "";
+        size_t extra = separator.size() * items.size();
+        for (const auto& item : items)
+            if (item.holds_alternative<std::string>()) extra += item.get<std::string>().size();
+        builder.buffer.reserve(builder.buffer.size() + extra);
+        for (size_t i = 0; i < items.size(); ++i) {
+            if (i > 0) builder.buffer += separator;
+            appendValue(builder.buffer, items[i]);
+        }
+        return args[0];
+    }
+
+    Value sb_reserve(std::vector<Value>& args) {
+        auto& builder = getBuilder(args, "sb_reserve");
+        if (args.size() < 2) throw std::runtime_error("sb_reserve: expected a capacity.");
+        builder.buffer.reserve(static_cast<size_t>(std::max(0.0, toDouble(args[1]))));
+        return args[0];
+    }
+
+    Value sb_to_string(std::vector<Value>& args) {
+        return getBuilder(args, "sb_to_string").buffer;
+    }
+
+    Value sb_length(std::vector<Value>& args) {
+        return static_cast<int>(getBuilder(args, "sb_length").buffer.size());
+    }
+
+    Value sb_clear(std::vector<Value>& args) {
+        getBuilder(args, "sb_clear").buffer.clear();   // Keeps the capacity for reuse
+        return args[0];
+    }
+
     void registerFunctions(std::unordered_map<std::string, Value>& globals) {
         globals["str_length"] = NativeFunction{length, 1};
         globals["str_upper"] = NativeFunction{upper, 1};
@@ -676,6 +1404,19 @@ namespace String {
         globals["str_from_bytes"] = NativeFunction{from_bytes, 1};
         globals["str_char_code"] = NativeFunction{char_code, 1};
         globals["str_from_char_code"] = NativeFunction{from_char_code, 1};
+        globals["str_matcher_new"] = NativeFunction{matcher_new, -1};
+        globals["str_matcher_free"] = NativeFunction{matcher_free, 1};
+        globals["str_matcher_test"] = NativeFunction{matcher_test, 2};
+        globals["str_matcher_count"] = NativeFunction{matcher_count, 2};
+        globals["str_matcher_find_all"] = NativeFunction{matcher_find_all, 2};
+        globals["str_matcher_tags"] = NativeFunction{matcher_tags, 2};
+        globals["sb_new"] = NativeFunction{sb_new, -1};
+        globals["sb_append"] = NativeFunction{sb_append, -1};
+        globals["sb_append_many"] = NativeFunction{sb_append_many, -1};
+        globals["sb_reserve"] = NativeFunction{sb_reserve, 2};
+        globals["sb_to_string"] = NativeFunction{sb_to_string, 1};
+        globals["sb_length"] = NativeFunction{sb_length, 1};
+        globals["sb_clear"] = NativeFunction{sb_clear, 1};
     }
 }
 
@@ -699,7 +1440,7 @@ namespace Collections {
         if (args.empty()) return 0;
         if (args[0].holds_alternative<std::vector<Value>>()) return static_cast<int>(args[0].get<std::vector<Value>>().size());
         if (args[0].holds_alternative<std::string>()) return static_cast<int>(args[0].get<std::string>().size());
-        if (args[0].holds_alternative<std::unordered_map<std::string, Value>>()) return static_cast<int>(args[0].get<std::unordered_map<std::string, Value>>().size());
+        if (args[0].holds_alternative<MapValue>()) return static_cast<int>(args[0].get<MapValue>().size());
         return 0;
     }
 
@@ -880,36 +1621,33 @@ namespace Collections {
 // ============ MAP LIBRARY ============
 namespace Map {
     Value keys(std::vector<Value>& args) {
-        if (args.empty() || !args[0].holds_alternative<std::unordered_map<std::string, Value>>())
+        if (args.empty() || !args[0].holds_alternative<MapValue>())
             return std::vector<Value>();
-        const auto& map = args[0].get<std::unordered_map<std::string, Value>>();
+        const auto& map = args[0].get<MapValue>();
         std::vector<Value> result;
         for (const auto& [key, _] : map) result.push_back(Value(key));
         return result;
     }
 
     Value values(std::vector<Value>& args) {
-        if (args.empty() || !args[0].holds_alternative<std::unordered_map<std::string, Value>>())
+        if (args.empty() || !args[0].holds_alternative<MapValue>())
             return std::vector<Value>();
-        const auto& map = args[0].get<std::unordered_map<std::string, Value>>();
+        const auto& map = args[0].get<MapValue>();
         std::vector<Value> result;
         for (const auto& [_, val] : map) result.push_back(val);
         return result;
     }
 
     Value has(std::vector<Value>& args) {
-        if (args.size() < 2 || !args[0].holds_alternative<std::unordered_map<std::string, Value>>() ||
-            !args[1].holds_alternative<std::string>()) return false;
-        const auto& map = args[0].get<std::unordered_map<std::string, Value>>();
-        return map.count(args[1].get<std::string>()) > 0;
+        if (args.size() < 2 || !args[0].holds_alternative<MapValue>()) return false;
+        const auto& map = args[0].get<MapValue>();
+        return map.count(args[1]) > 0;
     }
 
     Value get_fn(std::vector<Value>& args) {
-        if (args.size() < 2 || !args[0].holds_alternative<std::unordered_map<std::string, Value>>() ||
-            !args[1].holds_alternative<std::string>()) return Value();
-        const auto& map = args[0].get<std::unordered_map<std::string, Value>>();
-        const auto& key = args[1].get<std::string>();
-        auto it = map.find(key);
+        if (args.size() < 2 || !args[0].holds_alternative<MapValue>()) return Value();
+        const auto& map = args[0].get<MapValue>();
+        auto it = map.find(args[1]);
         if (it != map.end()) return it->second;
         // Return default value if provided
         if (args.size() >= 3) return args[2];
@@ -917,39 +1655,37 @@ namespace Map {
     }
 
     Value set_fn(std::vector<Value>& args) {
-        if (args.size() < 3 || !args[0].holds_alternative<std::unordered_map<std::string, Value>>() ||
-            !args[1].holds_alternative<std::string>()) return args.empty() ? Value() : args[0];
-        auto& map = const_cast<std::unordered_map<std::string, Value>&>(args[0].get<std::unordered_map<std::string, Value>>());
-        map[args[1].get<std::string>()] = args[2];
+        if (args.size() < 3 || !args[0].holds_alternative<MapValue>()) return args.empty() ? Value() : args[0];
+        auto& map = const_cast<MapValue&>(args[0].get<MapValue>());
+        map[args[1]] = args[2];
         return Value(); // Modified in-place via write-back
     }
 
     Value remove_fn(std::vector<Value>& args) {
-        if (args.size() < 2 || !args[0].holds_alternative<std::unordered_map<std::string, Value>>() ||
-            !args[1].holds_alternative<std::string>()) return args.empty() ? Value() : args[0];
-        auto& map = const_cast<std::unordered_map<std::string, Value>&>(args[0].get<std::unordered_map<std::string, Value>>());
-        map.erase(args[1].get<std::string>());
+        if (args.size() < 2 || !args[0].holds_alternative<MapValue>()) return args.empty() ? Value() : args[0];
+        auto& map = const_cast<MapValue&>(args[0].get<MapValue>());
+        map.erase(args[1]);
         return Value(); // Modified in-place via write-back
     }
 
     Value size(std::vector<Value>& args) {
-        if (args.empty() || !args[0].holds_alternative<std::unordered_map<std::string, Value>>()) return 0;
-        return static_cast<int>(args[0].get<std::unordered_map<std::string, Value>>().size());
+        if (args.empty() || !args[0].holds_alternative<MapValue>()) return 0;
+        return static_cast<int>(args[0].get<MapValue>().size());
     }
 
     Value merge(std::vector<Value>& args) {
-        if (args.size() < 2 || !args[0].holds_alternative<std::unordered_map<std::string, Value>>() ||
-            !args[1].holds_alternative<std::unordered_map<std::string, Value>>()) return args.empty() ? Value() : args[0];
-        auto result = args[0].get<std::unordered_map<std::string, Value>>();
-        const auto& other = args[1].get<std::unordered_map<std::string, Value>>();
+        if (args.size() < 2 || !args[0].holds_alternative<MapValue>() ||
+            !args[1].holds_alternative<MapValue>()) return args.empty() ? Value() : args[0];
+        auto result = args[0].get<MapValue>();
+        const auto& other = args[1].get<MapValue>();
         for (const auto& [key, val] : other) result[key] = val;
         return result;
     }
 
     Value entries(std::vector<Value>& args) {
-        if (args.empty() || !args[0].holds_alternative<std::unordered_map<std::string, Value>>())
+        if (args.empty() || !args[0].holds_alternative<MapValue>())
             return std::vector<Value>();
-        const auto& map = args[0].get<std::unordered_map<std::string, Value>>();
+        const auto& map = args[0].get<MapValue>();
         std::vector<Value> result;
         for (const auto& [key, val] : map) {
             std::vector<Value> pair;
@@ -962,28 +1698,26 @@ namespace Map {
 
     Value from_entries(std::vector<Value>& args) {
         if (args.empty() || !args[0].holds_alternative<std::vector<Value>>())
-            return std::unordered_map<std::string, Value>();
+            return MapValue();
         const auto& list = args[0].get<std::vector<Value>>();
-        std::unordered_map<std::string, Value> result;
+        MapValue result;
+        result.reserve(list.size());
         for (const auto& item : list) {
             if (!item.holds_alternative<std::vector<Value>>()) continue;
             const auto& pair = item.get<std::vector<Value>>();
-            if (pair.size() < 2 || !pair[0].holds_alternative<std::string>()) continue;
-            result[pair[0].get<std::string>()] = pair[1];
+            if (pair.size() < 2) continue;
+            result[pair[0]] = pair[1];
         }
         return result;
     }
 
     Value invert(std::vector<Value>& args) {
-        if (args.empty() || !args[0].holds_alternative<std::unordered_map<std::string, Value>>())
-            return std::unordered_map<std::string, Value>();
-        const auto& map = args[0].get<std::unordered_map<std::string, Value>>();
-        std::unordered_map<std::string, Value> result;
-        for (const auto& [key, val] : map) {
-            if (!val.holds_alternative<std::string>())
-                throw std::runtime_error("map_invert: all values must be strings.");
-            result[val.get<std::string>()] = Value(key);
-        }
+        if (args.empty() || !args[0].holds_alternative<MapValue>())
+            return MapValue();
+        const auto& map = args[0].get<MapValue>();
+        MapValue result;
+        result.reserve(map.size());
+        for (const auto& [key, val] : map) result[val] = key;
         return result;
     }
 
@@ -1004,67 +1738,104 @@ namespace Map {
 
 // ============ JSON LIBRARY ============
 namespace Json {
-    // Forward declaration for recursive use
-    static std::string valueToJson(const Value& val);
+    // ---- Serializer ----
+    //
+    // Everything is appended to one output buffer; strings are copied in runs
+    // between characters that need escaping, and doubles use the shortest
+    // representation that round-trips (std::to_chars).
 
-    static std::string escapeJsonString(const std::string& str) {
-        std::string result;
-        result.reserve(str.size() + 2);
-        result += '"';
-        for (char c : str) {
+    static const char* kHexDigits = "0123456789abcdef";
+
+    static void appendEscaped(std::string& out, std::string_view str) {
+        out += '"';
+        size_t runStart = 0;
+        for (size_t i = 0; i < str.size(); ++i) {
+            unsigned char c = static_cast<unsigned char>(str[i]);
+            if (c >= 0x20 && c != '"' && c != '\\') continue;
+            out.append(str.data() + runStart, i - runStart);
+            runStart = i + 1;
             switch (c) {
-                case '"':  result += "\\\""; break;
-                case '\\': result += "\\\\"; break;
-                case '\b': result += "\\b"; break;
-                case '\f': result += "\\f"; break;
-                case '\n': result += "\\n"; break;
-                case '\r': result += "\\r"; break;
-                case '\t': result += "\\t"; break;
-                default:   result += c; break;
+                case '"':  out += "\\\""; break;
+                case '\\': out += "\\\\"; break;
+                case '\b': out += "\\b"; break;
+                case '\f': out += "\\f"; break;
+                case '\n': out += "\\n"; break;
+                case '\r': out += "\\r"; break;
+                case '\t': out += "\\t"; break;
+                default:
+                    out += "\\u00";
+                    out += kHexDigits[c >> 4];
+                    out += kHexDigits[c & 0xF];
+                    break;
             }
         }
-        result += '"';
-        return result;
-    }
-
-    static std::string valueToJson(const Value& val) {
-        if (val.holds_alternative<std::monostate>()) return "null";
-        if (val.holds_alternative<int>()) return std::to_string(val.get<int>());
-        if (val.holds_alternative<double>()) {
-            std::ostringstream oss;
-            oss << val.get<double>();
-            return oss.str();
-        }
-        if (val.holds_alternative<float>()) {
-            std::ostringstream oss;
-            oss << static_cast<double>(val.get<float>());
-            return oss.str();
-        }
-        if (val.holds_alternative<bool>()) return val.get<bool>() ? "true" : "false";
-        if (val.holds_alternative<std::string>()) return escapeJsonString(val.get<std::string>());
-        if (val.holds_alternative<std::vector<Value>>()) {
+        out.append(str.data() + runStart, str.size() - runStart);
+        out += '"';
+    }
+
+    static void appendDouble(std::string& out, double d) {
+        if (!std::isfinite(d)) { out += "null"; return; }
+        char buf[32];
+        auto res = std::to_chars(buf, buf + sizeof(buf), d);
+        // Keep a fractional part so the value parses back as a float
+        bool integral = std::find_if(buf, res.ptr, [](char c) { return c == '.' || c == 'e' || c == 'n'; }) == res.ptr;
+        out.append(buf, res.ptr - buf);
+        if (integral) out += ".0";
+    }
+
+    static void appendJson(std::string& out, const Value& val) {
+        if (val.holds_alternative<int>()) {
+            char buf[16];
+            auto res = std::to_chars(buf, buf + sizeof(buf), val.get<int>());
+            out.append(buf, res.ptr - buf);
+        } else if (val.holds_alternative<double>()) {
+            appendDouble(out, val.get<double>());
+        } else if (val.holds_alternative<float>()) {
+            appendDouble(out, static_cast<double>(val.get<float>()));
+        } else if (val.holds_alternative<bool>()) {
+            out += val.get<bool>() ? "true" : "false";
+        } else if (val.holds_alternative<std::string>()) {
+            appendEscaped(out, val.get<std::string>());
+        } else if (val.holds_alternative<std::vector<Value>>()) {
             const auto& vec = val.get<std::vector<Value>>();
-            std::string result = "[";
+            out += '[';
             for (size_t i = 0; i < vec.size(); ++i) {
-                if (i > 0) result += ",";
-                result += valueToJson(vec[i]);
+                if (i > 0) out += ',';
+                appendJson(out, vec[i]);
             }
-            result += "]";
-            return result;
-        }
-        if (val.holds_alternative<std::unordered_map<std::string, Value>>()) {
-            const auto& map = val.get<std::unordered_map<std::string, Value>>();
-            std::string result = "{";
+            out += ']';
+        } else if (val.holds_alternative<std::shared_ptr<SetValue>>()) {
+            out += '[';
+            bool first = true;
+            val.get<std::shared_ptr<SetValue>>()->forEach([&](const Value& item) {
+                if (!first) out += ',';
+                first = false;
+                appendJson(out, item);
+            });
+            out += ']';
+        } else if (val.holds_alternative<MapValue>()) {
+            const auto& map = val.get<MapValue>();
+            out += '{';
             bool first = true;
             for (const auto& [key, v] : map) {
-                if (!first) result += ",";
+                if (!first) out += ',';
                 first = false;
-                result += escapeJsonString(key) + ":" + valueToJson(v);
+                if (key.holds_alternative<std::string>()) appendEscaped(out, key.get<std::string>());
+                else appendEscaped(out, keyToString(key));
+                out += ':';
+                appendJson(out, v);
             }
-            result += "}";
-            return result;
+            out += '}';
+        } else {
+            out += "null";
         }
-        return "null";
+    }
+
+    static std::string valueToJson(const Value& val) {
+        std::string out;
+        out.reserve(256);
+        appendJson(out, val);
+        return out;
     }
 
     Value to_json(std::vector<Value>& args) {
@@ -1072,150 +1843,245 @@ namespace Json {
         return valueToJson(args[0]);
     }
 
-    // Simple recursive descent JSON parser
+    // ---- Parser ----
+    //
+    // Single pass over the input with pointer arithmetic. String bodies are
+    // scanned 16 bytes at a time (SSE2, or 8-byte SWAR elsewhere) for the next
+    // quote, backslash or control character, so plain runs are copied in bulk.
+    // Numbers go through std::from_chars; integers that overflow int become
+    // doubles. \uXXXX escapes, including surrogate pairs, are decoded to UTF-8.
+
+    static constexpr size_t kMaxDepth = 512;
+
+    // Offset of the first '"', '\\' or control byte in [p, end), or end - p
+    static size_t scanStringRun(const char* p, const char* end) {
+        const char* start = p;
+#if defined(__SSE2__)
+        const __m128i quote = _mm_set1_epi8('"');
+        const __m128i backslash = _mm_set1_epi8('\\');
+        const __m128i space = _mm_set1_epi8(0x20);
+        while (end - p >= 16) {
+            __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+            // Control bytes: unsigned c < 0x20, i.e. max(c, 0x20) != c
+            __m128i ctrl = _mm_cmpeq_epi8(_mm_max_epu8(chunk, space), space);
+            ctrl = _mm_andnot_si128(_mm_cmpeq_epi8(chunk, space), ctrl);
+            __m128i hit = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(chunk, quote), _mm_cmpeq_epi8(chunk, backslash)), ctrl);
+            int mask = _mm_movemask_epi8(hit);
+            if (mask) return static_cast<size_t>(p - start) + __builtin_ctz(static_cast<unsigned>(mask));
+            p += 16;
+        }
+#else
+        constexpr uint64_t ones = 0x0101010101010101ULL, highs = 0x8080808080808080ULL;
+        while (end - p >= 8) {
+            uint64_t w;
+            std::memcpy(&w, p, 8);
+            uint64_t q = w ^ (ones * '"'), b = w ^ (ones * '\\');
+            uint64_t hit = ((q - ones) & ~q) | ((b - ones) & ~b) | ((w - ones * 0x20) & ~w);
+            if ((hit & highs) != 0) break;  // Exact position found below
+            p += 8;
+        }
+#endif
+        while (p < end && *p != '"' && *p != '\\' && static_cast<unsigned char>(*p) >= 0x20) ++p;
+        return static_cast<size_t>(p - start);
+    }
+
+    static void appendUtf8(std::string& out, uint32_t cp) {
+        if (cp < 0x80) {
+            out += static_cast<char>(cp);
+        } else if (cp < 0x800) {
+            out += static_cast<char>(0xC0 | (cp >> 6));
+            out += static_cast<char>(0x80 | (cp & 0x3F));
+        } else if (cp < 0x10000) {
+            out += static_cast<char>(0xE0 | (cp >> 12));
+            out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+            out += static_cast<char>(0x80 | (cp & 0x3F));
+        } else {
+            out += static_cast<char>(0xF0 | (cp >> 18));
+            out += static_cast<char>(0x80 | ((cp >> 12) & 0x3F));
+            out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+            out += static_cast<char>(0x80 | (cp & 0x3F));
+        }
+    }
+
     struct JsonParser {
-        const std::string& input;
-        size_t pos;
+        const char* p;
+        const char* end;
+        size_t depth = 0;
+
+        JsonParser(std::string_view s) : p(s.data()), end(s.data() + s.size()) {}
 
-        JsonParser(const std::string& s) : input(s), pos(0) {}
+        [[noreturn]] void fail(const std::string& msg) {
+            throw std::runtime_error("from_json: " + msg);
+        }
 
         void skipWhitespace() {
-            while (pos < input.size() && std::isspace(static_cast<unsigned char>(input[pos]))) ++pos;
+            while (p < end && (*p == ' ' || *p == '\n' || *p == '\r' || *p == '\t')) ++p;
         }
 
         char peek() {
             skipWhitespace();
-            if (pos >= input.size()) throw std::runtime_error("from_json: unexpected end of input.");
-            return input[pos];
+            if (p >= end) fail("unexpected end of input.");
+            return *p;
         }
 
-        char advance() {
-            skipWhitespace();
-            if (pos >= input.size()) throw std::runtime_error("from_json: unexpected end of input.");
-            return input[pos++];
+        void expect(char c, const char* msg) {
+            if (peek() != c) fail(msg);
+            ++p;
         }
 
-        bool match(const std::string& expected) {
-            skipWhitespace();
-            if (input.compare(pos, expected.size(), expected) == 0) {
-                pos += expected.size();
+        bool matchLiteral(std::string_view lit) {
+            if (static_cast<size_t>(end - p) >= lit.size() && std::memcmp(p, lit.data(), lit.size()) == 0) {
+                p += lit.size();
                 return true;
             }
             return false;
         }
 
         Value parseValue() {
-            skipWhitespace();
-            if (pos >= input.size()) throw std::runtime_error("from_json: unexpected end of input.");
-            char c = input[pos];
-            if (c == '"') return parseString();
-            if (c == '{') return parseObject();
-            if (c == '[') return parseArray();
-            if (c == 't' || c == 'f') return parseBool();
-            if (c == 'n') return parseNull();
-            if (c == '-' || std::isdigit(static_cast<unsigned char>(c))) return parseNumber();
-            throw std::runtime_error("from_json: unexpected character '" + std::string(1, c) + "'.");
-        }
-
-        Value parseNull() {
-            if (!match("null")) throw std::runtime_error("from_json: expected 'null'.");
-            return Value();
-        }
-
-        Value parseBool() {
-            if (match("true")) return Value(true);
-            if (match("false")) return Value(false);
-            throw std::runtime_error("from_json: expected boolean.");
+            switch (peek()) {
+                case '"': return Value(parseRawString());
+                case '{': return parseObject();
+                case '[': return parseArray();
+                case 't': if (matchLiteral("true")) return Value(true); fail("expected boolean.");
+                case 'f': if (matchLiteral("false")) return Value(false); fail("expected boolean.");
+                case 'n': if (matchLiteral("null")) return Value(); fail("expected 'null'.");
+                default:
+                    if (*p == '-' || (*p >= '0' && *p <= '9')) return parseNumber();
+                    fail("unexpected character '" + std::string(1, *p) + "'.");
+            }
         }
 
         Value parseNumber() {
-            skipWhitespace();
-            size_t start = pos;
-            bool is_float = false;
-            if (pos < input.size() && input[pos] == '-') ++pos;
-            while (pos < input.size() && std::isdigit(static_cast<unsigned char>(input[pos]))) ++pos;
-            if (pos < input.size() && input[pos] == '.') {
-                is_float = true;
-                ++pos;
-                while (pos < input.size() && std::isdigit(static_cast<unsigned char>(input[pos]))) ++pos;
+            const char* start = p;
+            bool isFloat = false;
+            // JSON's grammar: no leading zeros, and each part needs a digit
+            auto digits = [&] {
+                const char* first = p;
+                while (p < end && *p >= '0' && *p <= '9') ++p;
+                if (p == first) fail("invalid number '" + std::string(start, p) + "'.");
+                return first;
+            };
+            if (p < end && *p == '-') ++p;
+            const char* intStart = digits();
+            if (*intStart == '0' && p - intStart > 1) fail("invalid number '" + std::string(start, p) + "' (leading zero).");
+            if (p < end && *p == '.') {
+                isFloat = true;
+                ++p;
+                digits();
             }
-            if (pos < input.size() && (input[pos] == 'e' || input[pos] == 'E')) {
-                is_float = true;
-                ++pos;
-                if (pos < input.size() && (input[pos] == '+' || input[pos] == '-')) ++pos;
-                while (pos < input.size() && std::isdigit(static_cast<unsigned char>(input[pos]))) ++pos;
+            if (p < end && (*p == 'e' || *p == 'E')) {
+                isFloat = true;
+                ++p;
+                if (p < end && (*p == '+' || *p == '-')) ++p;
+                digits();
+            }
+            if (!isFloat) {
+                int i = 0;
+                auto res = std::from_chars(start, p, i);
+                if (res.ec == std::errc() && res.ptr == p) return Value(i);
+            }
+            double d = 0;
+            auto res = std::from_chars(start, p, d);
+            if (res.ec != std::errc() || res.ptr != p) fail("invalid number '" + std::string(start, p) + "'.");
+            return Value(d);
+        }
+
+        uint32_t parseHex4() {
+            if (end - p < 4) fail("truncated \\u escape.");
+            uint32_t cp = 0;
+            for (int i = 0; i < 4; ++i) {
+                char c = *p++;
+                cp <<= 4;
+                if (c >= '0' && c <= '9') cp |= c - '0';
+                else if (c >= 'a' && c <= 'f') cp |= c - 'a' + 10;
+                else if (c >= 'A' && c <= 'F') cp |= c - 'A' + 10;
+                else fail("invalid \\u escape.");
             }
-            std::string numStr = input.substr(start, pos - start);
-            if (is_float) return Value(std::stod(numStr));
-            return Value(std::stoi(numStr));
+            return cp;
         }
 
         std::string parseRawString() {
-            if (advance() != '"') throw std::runtime_error("from_json: expected '\"'.");
+            expect('"', "expected '\"'.");
             std::string result;
-            while (pos < input.size() && input[pos] != '"') {
-                if (input[pos] == '\\') {
-                    ++pos;
-                    if (pos >= input.size()) throw std::runtime_error("from_json: unexpected end in string escape.");
-                    switch (input[pos]) {
-                        case '"':  result += '"'; break;
-                        case '\\': result += '\\'; break;
-                        case '/':  result += '/'; break;
-                        case 'b':  result += '\b'; break;
-                        case 'f':  result += '\f'; break;
-                        case 'n':  result += '\n'; break;
-                        case 'r':  result += '\r'; break;
-                        case 't':  result += '\t'; break;
-                        default:   result += input[pos]; break;
+            while (true) {
+                size_t run = scanStringRun(p, end);
+                result.append(p, run);
+                p += run;
+                if (p >= end) fail("unterminated string.");
+                char c = *p++;
+                if (c == '"') return result;
+                if (c != '\\') fail("control character in string.");
+                if (p >= end) fail("unexpected end in string escape.");
+                switch (*p++) {
+                    case '"':  result += '"'; break;
+                    case '\\': result += '\\'; break;
+                    case '/':  result += '/'; break;
+                    case 'b':  result += '\b'; break;
+                    case 'f':  result += '\f'; break;
+                    case 'n':  result += '\n'; break;
+                    case 'r':  result += '\r'; break;
+                    case 't':  result += '\t'; break;
+                    case 'u': {
+                        uint32_t cp = parseHex4();
+                        if (cp >= 0xD800 && cp <= 0xDBFF && end - p >= 6 && p[0] == '\\' && p[1] == 'u') {
+                            p += 2;
+                            uint32_t low = parseHex4();
+                            if (low >= 0xDC00 && low <= 0xDFFF) cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+                            else { appendUtf8(result, cp); cp = low; }
+                        }
+                        appendUtf8(result, cp);
+                        break;
                     }
-                } else {
-                    result += input[pos];
+                    default: fail("invalid escape '\\" + std::string(1, p[-1]) + "'.");
                 }
-                ++pos;
             }
-            if (pos >= input.size()) throw std::runtime_error("from_json: unterminated string.");
-            ++pos; // skip closing '"'
-            return result;
-        }
-
-        Value parseString() {
-            return Value(parseRawString());
         }
 
         Value parseArray() {
-            advance(); // skip '['
+            ++p; // skip '['
+            if (++depth > kMaxDepth) fail("nesting too deep.");
             std::vector<Value> result;
-            skipWhitespace();
-            if (pos < input.size() && input[pos] == ']') { ++pos; return Value(result); }
-            result.push_back(parseValue());
-            while (pos < input.size()) {
-                skipWhitespace();
-                if (pos < input.size() && input[pos] == ']') { ++pos; return Value(result); }
-                if (advance() != ',') throw std::runtime_error("from_json: expected ',' or ']' in array.");
-                result.push_back(parseValue());
+            if (peek() != ']') {
+                while (true) {
+                    result.push_back(parseValue());
+                    char c = peek();
+                    ++p;
+                    if (c == ']') break;
+                    if (c != ',') fail("expected ',' or ']' in array.");
+                }
+            } else {
+                ++p;
             }
-            throw std::runtime_error("from_json: unterminated array.");
+            --depth;
+            return Value(std::move(result));
         }
 
         Value parseObject() {
-            advance(); // skip '{'
-            std::unordered_map<std::string, Value> result;
-            skipWhitespace();
-            if (pos < input.size() && input[pos] == '}') { ++pos; return Value(result); }
-            std::string key = parseRawString();
+            ++p; // skip '{'
+            if (++depth > kMaxDepth) fail("nesting too deep.");
+            MapValue result;
+            if (peek() != '}') {
+                while (true) {
+                    std::string key = parseRawString();
+                    expect(':', "expected ':' in object.");
+                    result[std::move(key)] = parseValue();
+                    char c = peek();
+                    ++p;
+                    if (c == '}') break;
+                    if (c != ',') fail("expected ',' or '}' in object.");
+                }
+            } else {
+                ++p;
+            }
+            --depth;
+            return Value(std::move(result));
+        }
+
+        Value parseDocument() {
+            Value v = parseValue();
             skipWhitespace();
-            if (advance() != ':') throw std::runtime_error("from_json: expected ':' in object.");
-            result[key] = parseValue();
-            while (pos < input.size()) {
-                skipWhitespace();
-                if (pos < input.size() && input[pos] == '}') { ++pos; return Value(result); }
-                if (advance() != ',') throw std::runtime_error("from_json: expected ',' or '}' in object.");
-                key = parseRawString();
-                skipWhitespace();
-                if (advance() != ':') throw std::runtime_error("from_json: expected ':' in object.");
-                result[key] = parseValue();
-            }
-            throw std::runtime_error("from_json: unterminated object.");
+            if (p != end) fail("unexpected trailing characters.");
+            return v;
         }
     };
 
@@ -1223,23 +2089,365 @@ namespace Json {
         if (args.empty() || !args[0].holds_alternative<std::string>())
             throw std::runtime_error("from_json: expected string argument.");
         JsonParser parser(args[0].get<std::string>());
-        return parser.parseValue();
+        return parser.parseDocument();
     }
 
-    void registerFunctions(std::unordered_map<std::string, Value>& globals) {
-        globals["json_to_string"] = NativeFunction{to_json, 1};
-        globals["json_from_string"] = NativeFunction{from_json, 1};
+    // ---- Lazy access and NDJSON ----
+    //
+    // Field lookups walk the raw text and skip every value they do not need
+    // (strings via scanStringRun, containers by bracket counting), so only the
+    // addressed value is materialised.
+
+    struct PathSegment {
+        std::string key;
+        int index = -1;  // >= 0 when the segment can also index an array
+    };
+
+    // Accepts "a.b.0" or ["a", "b", 0]
+    static std::vector<PathSegment> parsePath(const Value& path, const char* fn) {
+        std::vector<PathSegment> segments;
+        auto addKey = [&](std::string key) {
+            PathSegment seg;
+            if (!key.empty() && std::all_of(key.begin(), key.end(), [](char c) { return c >= '0' && c <= '9'; }))
+                seg.index = std::atoi(key.c_str());
+            seg.key = std::move(key);
+            segments.push_back(std::move(seg));
+        };
+        if (path.holds_alternative<std::string>()) {
+            const std::string& s = path.get<std::string>();
+            size_t start = 0;
+            while (start <= s.size()) {
+                size_t dot = s.find('.', start);
+                if (dot == std::string::npos) dot = s.size();
+                addKey(s.substr(start, dot - start));
+                start = dot + 1;
+            }
+        } else if (path.holds_alternative<std::vector<Value>>()) {
+            for (const auto& seg : path.get<std::vector<Value>>()) {
+                if (seg.holds_alternative<int>()) {
+                    PathSegment ps;
+                    ps.index = seg.get<int>();
+                    ps.key = std::to_string(ps.index);
+                    segments.push_back(std::move(ps));
+                } else if (seg.holds_alternative<std::string>()) {
+                    PathSegment ps;
+                    ps.key = seg.get<std::string>();
+                    segments.push_back(std::move(ps));
+                } else {
+                    throw std::runtime_error(std::string(fn) + ": path segments must be strings or integers.");
+                }
+            }
+        } else {
+            throw std::runtime_error(std::string(fn) + ": path must be a string or a list.");
+        }
+        return segments;
     }
-}
 
-// ============ UTILITY LIBRARY ============
-namespace Utility {
+    struct LazyParser : JsonParser {
+        using JsonParser::JsonParser;
+
+        void skipString() {
+            ++p; // skip opening '"'
+            while (true) {
+                p += scanStringRun(p, end);
+                if (p >= end) fail("unterminated string.");
+                char c = *p++;
+                if (c == '"') return;
+                if (c == '\\' && p < end) ++p;
+            }
+        }
+
+        // Skips one value without building it
+        void skipValue() {
+            char c = peek();
+            if (c == '"') { skipString(); return; }
+            if (c == '{' || c == '[') {
+                size_t nesting = 0;
+                while (p < end) {
+                    char ch = *p;
+                    if (ch == '"') { skipString(); continue; }
+                    ++p;
+                    if (ch == '{' || ch == '[') ++nesting;
+                    else if ((ch == '}' || ch == ']') && --nesting == 0) return;
+                }
+                fail("unterminated container.");
+            }
+            parseValue();  // Scalars are cheap to parse outright
+        }
+
+        // Reads ',' or the closing bracket; false once the container ends
+        bool nextMember(char close, const char* msg) {
+            char c = peek();
+            ++p;
+            if (c == close) return false;
+            if (c != ',') fail(msg);
+            return true;
+        }
+
+        // Moves p to the value addressed by path; false if it does not exist
+        bool seek(const std::vector<PathSegment>& path) {
+            for (const auto& seg : path) {
+                char c = peek();
+                if (c == '{') {
+                    ++p;
+                    if (peek() == '}') return false;
+                    while (true) {
+                        std::string key = parseRawString();
+                        expect(':', "expected ':' in object.");
+                        if (key == seg.key) break;
+                        skipValue();
+                        if (!nextMember('}', "expected ',' or '}' in object.")) return false;
+                    }
+                } else if (c == '[' && seg.index >= 0) {
+                    ++p;
+                    if (peek() == ']') return false;
+                    for (int i = 0; i < seg.index; ++i) {
+                        skipValue();
+                        if (!nextMember(']', "expected ',' or ']' in array.")) return false;
+                    }
+                } else {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        // Value at path, or fallback when absent
+        Value get(const std::vector<PathSegment>& path, const Value& fallback) {
+            const char* start = p;
+            depth = 0;
+            Value result = seek(path) ? parseValue() : fallback;
+            p = start;
+            return result;
+        }
+    };
+
+    // JSON document kept as text (or a file mapping) and parsed per lookup
+    struct JsonDoc {
+        std::string text;
+        const char* data = nullptr;
+        size_t size = 0;
+        void* mapping = nullptr;
+
+        ~JsonDoc() {
+#ifdef __linux__
+            if (mapping) munmap(mapping, size);
+#endif
+        }
+    };
+
+    static std::mutex docRegistryMutex;
+    static std::unordered_map<int, std::shared_ptr<JsonDoc>> docs;
+    static std::atomic<int> nextDocId{1};
+
+    static int registerDoc(std::shared_ptr<JsonDoc> doc) {
+        std::lock_guard<std::mutex> lock(docRegistryMutex);
+        int id = nextDocId++;
+        docs[id] = std::move(doc);
+        return id;
+    }
+
+    // json_doc(text) -> document handle
+    Value doc_fn(std::vector<Value>& args) {
+        if (args.empty() || !args[0].holds_alternative<std::string>())
+            throw std::runtime_error("json_doc: expected string argument.");
+        auto doc = std::make_shared<JsonDoc>();
+        doc->text = args[0].get<std::string>();
+        doc->data = doc->text.data();
+        doc->size = doc->text.size();
+        return Value(registerDoc(std::move(doc)));
+    }
+
+    // json_doc_open(path) -> document handle over the file's bytes
+    Value doc_open_fn(std::vector<Value>& args) {
+        if (args.empty() || !args[0].holds_alternative<std::string>())
+            throw std::runtime_error("json_doc_open: expected file path.");
+        const std::string& path = args[0].get<std::string>();
+        auto doc = std::make_shared<JsonDoc>();
+#ifdef __linux__
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) throw std::runtime_error("json_doc_open: cannot open file '" + path + "'.");
+        struct stat st;
+        if (fstat(fd, &st) == 0 && st.st_size > 0) {
+            void* m = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+            if (m != MAP_FAILED) {
+                doc->mapping = m;
+                doc->data = static_cast<const char*>(m);
+                doc->size = static_cast<size_t>(st.st_size);
+            }
+        }
+        ::close(fd);
+        if (doc->mapping) return Value(registerDoc(std::move(doc)));
+#endif
+        std::ifstream in(path, std::ios::binary);
+        if (!in) throw std::runtime_error("json_doc_open: cannot open file '" + path + "'.");
+        doc->text.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+        doc->data = doc->text.data();
+        doc->size = doc->text.size();
+        return Value(registerDoc(std::move(doc)));
+    }
+
+    // json_get(doc, path[, default]) -> value at path, parsing only what it needs
+    Value get_fn(std::vector<Value>& args) {
+        if (args.size() < 2) throw std::runtime_error("json_get: requires document and path.");
+        std::shared_ptr<JsonDoc> doc;
+        {
+            std::lock_guard<std::mutex> lock(docRegistryMutex);
+            auto it = docs.find(toInt(args[0]));
+            if (it == docs.end()) throw std::runtime_error("json_get: invalid document handle.");
+            doc = it->second;
+        }
+        LazyParser parser(std::string_view(doc->data, doc->size));
+        return parser.get(parsePath(args[1], "json_get"), args.size() > 2 ? args[2] : Value());
+    }
+
+    Value doc_close_fn(std::vector<Value>& args) {
+        if (args.empty()) throw std::runtime_error("json_doc_close: requires document handle.");
+        std::lock_guard<std::mutex> lock(docRegistryMutex);
+        docs.erase(toInt(args[0]));
+        return Value();
+    }
+
+    // Newline-delimited records from a file or a socket, read in 64 KiB blocks
+    struct LineReader {
+        FILE* file = nullptr;
+        int fd = -1;
+        std::string buffer;
+        size_t offset = 0;
+        bool eof = false;
+        long lineNumber = 0;
+        std::mutex mutex;
+
+        ~LineReader() { if (file) fclose(file); }
+
+        bool fill() {
+            if (offset > 0) { buffer.erase(0, offset); offset = 0; }
+            size_t old = buffer.size();
+            buffer.resize(old + 65536);
+            long n = 0;
+            if (file) {
+                n = static_cast<long>(fread(&buffer[old], 1, 65536, file));
+#ifndef _WIN32
+            } else {
+                do { n = static_cast<long>(::recv(fd, &buffer[old], 65536, 0)); } while (n < 0 && errno == EINTR);
+#endif
+            }
+            buffer.resize(old + static_cast<size_t>(std::max(0L, n)));
+            if (n <= 0) eof = true;
+            return n > 0;
+        }
+
+        // Next line without its terminator; valid until the following call
+        bool next(std::string_view& line) {
+            size_t scanned = offset;
+            while (true) {
+                size_t nl = buffer.find('\n', scanned);
+                if (nl != std::string::npos) {
+                    line = std::string_view(buffer.data() + offset, nl - offset);
+                    offset = nl + 1;
+                    break;
+                }
+                size_t pending = buffer.size() - offset;
+                if (eof || !fill()) {
+                    if (offset >= buffer.size()) return false;
+                    line = std::string_view(buffer.data() + offset, buffer.size() - offset);
+                    offset = buffer.size();
+                    break;
+                }
+                scanned = offset + pending;  // fill() compacted the buffer to offset 0
+            }
+            if (!line.empty() && line.back() == '\r') line.remove_suffix(1);
+            ++lineNumber;
+            return true;
+        }
+    };
+
+    static std::mutex readerRegistryMutex;
+    static std::unordered_map<int, std::shared_ptr<LineReader>> readers;
+    static std::atomic<int> nextReaderId{1};
+
+    // json_lines_open(path | socket) -> reader handle
+    Value lines_open_fn(std::vector<Value>& args) {
+        if (args.empty()) throw std::runtime_error("json_lines_open: requires a file path or socket.");
+        auto reader = std::make_shared<LineReader>();
+        if (args[0].holds_alternative<std::string>()) {
+            const std::string& path = args[0].get<std::string>();
+            reader->file = fopen(path.c_str(), "rb");
+            if (!reader->file) throw std::runtime_error("json_lines_open: cannot open file '" + path + "'.");
+        } else {
+            reader->fd = toInt(args[0]);
+        }
+        std::lock_guard<std::mutex> lock(readerRegistryMutex);
+        int id = nextReaderId++;
+        readers[id] = std::move(reader);
+        return Value(id);
+    }
+
+    // json_lines_next(reader[, paths]) -> next record (or {path: value} for the
+    // requested paths), None at the end. Blank lines are skipped.
+    Value lines_next_fn(std::vector<Value>& args) {
+        if (args.empty()) throw std::runtime_error("json_lines_next: requires reader handle.");
+        std::shared_ptr<LineReader> reader;
+        {
+            std::lock_guard<std::mutex> lock(readerRegistryMutex);
+            auto it = readers.find(toInt(args[0]));
+            if (it == readers.end()) throw std::runtime_error("json_lines_next: invalid reader handle.");
+            reader = it->second;
+        }
+        std::vector<std::pair<std::string, std::vector<PathSegment>>> paths;
+        if (args.size() > 1 && args[1].holds_alternative<std::vector<Value>>()) {
+            for (const auto& path : args[1].get<std::vector<Value>>()) {
+                if (!path.holds_alternative<std::string>())
+                    throw std::runtime_error("json_lines_next: paths must be strings.");
+                paths.emplace_back(path.get<std::string>(), parsePath(path, "json_lines_next"));
+            }
+        }
+
+        std::lock_guard<std::mutex> lock(reader->mutex);
+        std::string_view line;
+        while (reader->next(line)) {
+            if (line.find_first_not_of(" \t") == std::string_view::npos) continue;
+            try {
+                if (paths.empty()) return LazyParser(line).parseDocument();
+                LazyParser parser(line);
+                MapValue record;
+                for (const auto& [name, segments] : paths) record[name] = parser.get(segments, Value());
+                return Value(std::move(record));
+            } catch (const std::runtime_error& e) {
+                throw std::runtime_error("json_lines_next: line " + std::to_string(reader->lineNumber) + ": " + e.what());
+            }
+        }
+        return Value();
+    }
+
+    Value lines_close_fn(std::vector<Value>& args) {
+        if (args.empty()) throw std::runtime_error("json_lines_close: requires reader handle.");
+        std::lock_guard<std::mutex> lock(readerRegistryMutex);
+        readers.erase(toInt(args[0]));
+        return Value();
+    }
+
+    void registerFunctions(std::unordered_map<std::string, Value>& globals) {
+        globals["json_to_string"] = NativeFunction{to_json, 1};
+        globals["json_from_string"] = NativeFunction{from_json, 1};
+        globals["json_doc"] = NativeFunction{doc_fn, 1};
+        globals["json_doc_open"] = NativeFunction{doc_open_fn, 1};
+        globals["json_get"] = NativeFunction{get_fn, -1};
+        globals["json_doc_close"] = NativeFunction{doc_close_fn, 1};
+        globals["json_lines_open"] = NativeFunction{lines_open_fn, 1};
+        globals["json_lines_next"] = NativeFunction{lines_next_fn, -1};
+        globals["json_lines_close"] = NativeFunction{lines_close_fn, 1};
+    }
+}
+
+// ============ UTILITY LIBRARY ============
+namespace Utility {
     // Helper to produce a debug string representation of a value
     static std::string debugRepr(const Value& val) {
         if (val.holds_alternative<std::monostate>()) return "null";
-        if (val.holds_alternative<int>()) return std::to_string(val.get<int>());
-        if (val.holds_alternative<double>()) return std::to_string(val.get<double>());
-        if (val.holds_alternative<float>()) return std::to_string(val.get<float>());
+        if (val.holds_alternative<int>()) return numberToString(val.get<int>());
+        if (val.holds_alternative<double>()) return numberToString(val.get<double>());
+        if (val.holds_alternative<float>()) return numberToString(val.get<float>());
         if (val.holds_alternative<bool>()) return val.get<bool>() ? "true" : "false";
         if (val.holds_alternative<std::string>()) return "\"" + val.get<std::string>() + "\"";
         if (val.holds_alternative<std::vector<Value>>()) {
@@ -1252,14 +2460,14 @@ namespace Utility {
             result += "]";
             return result;
         }
-        if (val.holds_alternative<std::unordered_map<std::string, Value>>()) {
-            const auto& map = val.get<std::unordered_map<std::string, Value>>();
+        if (val.holds_alternative<MapValue>()) {
+            const auto& map = val.get<MapValue>();
             std::string result = "{";
             bool first = true;
             for (const auto& [key, v] : map) {
                 if (!first) result += ", ";
                 first = false;
-                result += "\"" + key + "\": " + debugRepr(v);
+                result += "\"" + keyToString(key) + "\": " + debugRepr(v);
             }
             result += "}";
             return result;
@@ -1308,13 +2516,52 @@ namespace Utility {
 
 // ============ IO LIBRARY ============
 namespace IO {
+    // Reads a whole file with one allocation sized from the file length
+    static bool readWhole(const std::string& path, std::string& out) {
+        std::FILE* f = std::fopen(path.c_str(), "rb");
+        if (!f) return false;
+        out.clear();
+        if (std::fseek(f, 0, SEEK_END) == 0) {
+            long size = std::ftell(f);
+            if (size > 0) out.reserve(static_cast<size_t>(size));
+            std::rewind(f);
+        }
+        char buf[65536];
+        size_t n;
+        while ((n = std::fread(buf, 1, sizeof(buf), f)) > 0) out.append(buf, n);
+        std::fclose(f);
+        return true;
+    }
+
+    // Sizes and offsets past INT_MAX (multi-GB files) are returned as floats
+    static Value sizeValue(size_t n) {
+        if (n <= static_cast<size_t>(std::numeric_limits<int>::max())) return static_cast<int>(n);
+        return static_cast<double>(n);
+    }
+
+    static size_t offsetArg(const Value& v, const char* fn) {
+        double d = toDouble(v);
+        if (d < 0) throw std::runtime_error(std::string(fn) + ": offset must not be negative.");
+        return static_cast<size_t>(d);
+    }
+
+    // Splits text on '\n' like std::getline: no empty entry after a final newline
+    template<typename F>
+    static void forEachLine(const char* data, size_t size, F&& emit) {
+        size_t pos = 0;
+        while (pos < size) {
+            const char* nl = static_cast<const char*>(std::memchr(data + pos, '\n', size - pos));
+            size_t end = nl ? static_cast<size_t>(nl - data) : size;
+            emit(data + pos, end - pos);
+            pos = end + 1;
+        }
+    }
+
     Value readFile(std::vector<Value>& args) {
         if (args.empty() || !args[0].holds_alternative<std::string>()) return std::string("");
-        std::ifstream file(args[0].get<std::string>());
-        if (!file.is_open()) return std::string("");
-        std::stringstream buffer;
-        buffer << file.rdbuf();
-        return buffer.str();
+        std::string content;
+        if (!readWhole(args[0].get<std::string>(), content)) return std::string("");
+        return content;
     }
 
     Value writeFile(std::vector<Value>& args) {
@@ -1337,19 +2584,448 @@ namespace IO {
 
     Value readLines(std::vector<Value>& args) {
         if (args.empty() || !args[0].holds_alternative<std::string>()) return std::vector<Value>();
-        std::ifstream file(args[0].get<std::string>());
-        if (!file.is_open()) return std::vector<Value>();
+        std::string content;
+        if (!readWhole(args[0].get<std::string>(), content)) return std::vector<Value>();
+        // Every line is a slice of one shared buffer holding the whole file
+        StringValue whole(std::move(content));
+        const char* base = whole.view().data();
         std::vector<Value> lines;
-        std::string line;
-        while (std::getline(file, line)) lines.push_back(Value(line));
+        forEachLine(base, whole.size(), [&](const char* p, size_t n) { lines.emplace_back(whole.slice(p - base, n)); });
         return lines;
     }
 
+    // ---- Memory-mapped files ----
+    struct Mapping {
+        const char* data = nullptr;
+        size_t size = 0;
+        void* addr = nullptr;
+        std::string fallback;   // Contents when mmap is unavailable
+
+        ~Mapping() {
+#ifdef __linux__
+            if (addr) munmap(addr, size);
+#endif
+        }
+    };
+
+    // Handles from io_mmap; a registry of their own, separate from the CSV readers'
+    static std::mutex mappingRegistryMutex;
+    static std::unordered_map<int, std::shared_ptr<Mapping>> mappings;
+    static std::atomic<int> nextMappingId{1};
+
+    static std::shared_ptr<Mapping> openMapping(const std::string& path, const char* fn) {
+        auto m = std::make_shared<Mapping>();
+#ifdef __linux__
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) throw std::runtime_error(std::string(fn) + ": cannot open file '" + path + "'.");
+        struct stat st;
+        if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode)) {
+            if (st.st_size > 0) {
+                void* addr = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+                if (addr != MAP_FAILED) {
+                    m->addr = addr;
+                    m->data = static_cast<const char*>(addr);
+                    m->size = static_cast<size_t>(st.st_size);
+                }
+            }
+            if (m->addr || st.st_size == 0) {
+                ::close(fd);
+                return m;
+            }
+        }
+        ::close(fd);
+#endif
+        if (!readWhole(path, m->fallback)) throw std::runtime_error(std::string(fn) + ": cannot open file '" + path + "'.");
+        m->data = m->fallback.data();
+        m->size = m->fallback.size();
+        return m;
+    }
+
+    static std::shared_ptr<Mapping> getMapping(const std::vector<Value>& args, const char* fn) {
+        if (args.empty() || !args[0].holds_alternative<int>())
+            throw std::runtime_error(std::string(fn) + ": expected a mapping handle.");
+        std::lock_guard<std::mutex> lock(mappingRegistryMutex);
+        auto it = mappings.find(args[0].get<int>());
+        if (it == mappings.end()) throw std::runtime_error(std::string(fn) + ": invalid mapping handle.");
+        return it->second;
+    }
+
+    Value mmap_open(std::vector<Value>& args) {
+        if (args.empty() || !args[0].holds_alternative<std::string>())
+            throw std::runtime_error("io_mmap: path must be a string.");
+        auto m = openMapping(args[0].get<std::string>(), "io_mmap");
+        int id = nextMappingId++;
+        std::lock_guard<std::mutex> lock(mappingRegistryMutex);
+        mappings[id] = std::move(m);
+        return id;
+    }
+
+    Value mmap_size(std::vector<Value>& args) {
+        return sizeValue(getMapping(args, "io_mmap_size")->size);
+    }
+
+    // io_mmap_read(m, offset, length): copies out a slice, clamped to the file
+    Value mmap_read(std::vector<Value>& args) {
+        auto m = getMapping(args, "io_mmap_read");
+        if (args.size() < 3) throw std::runtime_error("io_mmap_read: expected mapping, offset and length.");
+        size_t offset = std::min(offsetArg(args[1], "io_mmap_read"), m->size);
+        size_t length = std::min(offsetArg(args[2], "io_mmap_read"), m->size - offset);
+        return std::string(m->data + offset, length);
+    }
+
+    // io_mmap_find(m, needle[, from]): byte offset of the next match, or -1
+    Value mmap_find(std::vector<Value>& args) {
+        auto m = getMapping(args, "io_mmap_find");
+        if (args.size() < 2 || !args[1].holds_alternative<std::string>())
+            throw std::runtime_error("io_mmap_find: needle must be a string.");
+        const auto& needle = args[1].get<std::string>();
+        size_t from = args.size() > 2 ? std::min(offsetArg(args[2], "io_mmap_find"), m->size) : 0;
+        std::string_view hay(m->data, m->size);
+        size_t pos = hay.find(needle, from);
+        return pos == std::string_view::npos ? Value(-1) : sizeValue(pos);
+    }
+
+    Value mmap_close(std::vector<Value>& args) {
+        getMapping(args, "io_mmap_close");
+        std::lock_guard<std::mutex> lock(mappingRegistryMutex);
+        return mappings.erase(args[0].get<int>()) > 0;
+    }
+
+    // ---- Lazy line iteration ----
+    // Reads fixed-size chunks, so memory stays constant however large the file
+    // is; the buffer only grows to fit a single line longer than it.
+    struct LineReader {
+        std::FILE* file = nullptr;
+        std::vector<char> buf = std::vector<char>(1 << 20);
+        size_t start = 0, end = 0;
+        bool eof = false;
+
+        ~LineReader() { if (file) std::fclose(file); }
+
+        bool next(Value& out) {
+            while (true) {
+                if (start < end) {
+                    const char* base = buf.data();
+                    const char* nl = static_cast<const char*>(std::memchr(base + start, '\n', end - start));
+                    if (nl) {
+                        out = std::string(base + start, nl);
+                        start = static_cast<size_t>(nl - base) + 1;
+                        return true;
+                    }
+                }
+                if (eof) {
+                    if (start >= end) return false;
+                    out = std::string(buf.data() + start, end - start);
+                    start = end;
+                    return true;
+                }
+                // Keep the partial line and refill behind it
+                std::memmove(buf.data(), buf.data() + start, end - start);
+                end -= start;
+                start = 0;
+                if (end == buf.size()) buf.resize(buf.size() * 2);
+                size_t n = std::fread(buf.data() + end, 1, buf.size() - end, file);
+                end += n;
+                if (n == 0) {
+                    if (std::ferror(file)) throw std::runtime_error("io_lines: read error.");
+                    eof = true;
+                    std::fclose(file);
+                    file = nullptr;
+                }
+            }
+        }
+    };
+
+    // Walks a mapping, dropping already-scanned pages so resident memory stays
+    // bounded on multi-GB files
+    struct MappedLineReader {
+        std::shared_ptr<Mapping> mapping;
+        size_t pos = 0;
+        size_t released = 0;
+
+        bool next(Value& out) {
+            const char* data = mapping->data;
+            size_t size = mapping->size;
+            if (pos >= size) return false;
+            const char* nl = static_cast<const char*>(std::memchr(data + pos, '\n', size - pos));
+            size_t end = nl ? static_cast<size_t>(nl - data) : size;
+            out = std::string(data + pos, end - pos);
+            pos = end + 1;
+#ifdef __linux__
+            constexpr size_t kRelease = 64u << 20;
+            if (mapping->addr && pos - released >= kRelease) {
+                size_t upto = pos & ~static_cast<size_t>(4095);
+                madvise(const_cast<char*>(data) + released, upto - released, MADV_DONTNEED);
+                released = upto;
+            }
+#endif
+            return true;
+        }
+    };
+
+    // io_lines(path | mapping): iterator over the lines, for use in for loops
+    Value lines(std::vector<Value>& args) {
+        auto iter = std::make_shared<IteratorValue>();
+        iter->kind = "lines";
+        if (!args.empty() && args[0].holds_alternative<int>()) {
+            auto reader = std::make_shared<MappedLineReader>();
+            reader->mapping = getMapping(args, "io_lines");
+            iter->next = [reader](Value& out) { return reader->next(out); };
+            return iter;
+        }
+        if (args.empty() || !args[0].holds_alternative<std::string>())
+            throw std::runtime_error("io_lines: expected a path or a mapping handle.");
+        const auto& path = args[0].get<std::string>();
+        auto reader = std::make_shared<LineReader>();
+        reader->file = std::fopen(path.c_str(), "rb");
+        if (!reader->file) throw std::runtime_error("io_lines: cannot open file '" + path + "'.");
+#ifdef __linux__
+        posix_fadvise(fileno(reader->file), 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+        iter->next = [reader](Value& out) { return reader->next(out); };
+        return iter;
+    }
+
+    // ---- Buffered file handles ----
+    // io_open keeps the descriptor open across writes and batches them in a
+    // userspace buffer, so appending many small records costs one write(2)
+    // per buffer rather than an open/write/close per call.
+    enum class SyncPolicy { None, Flush, Close };
+
+    struct FileHandle {
+        int fd = -1;
+        std::string path;
+        char* buf = nullptr;
+        size_t cap = 0, len = 0;
+        bool direct = false;            // O_DIRECT active: buffer and writes are block aligned
+        SyncPolicy sync = SyncPolicy::None;
+        std::mutex mutex;               // Handles may be shared with goroutines
+
+        static constexpr size_t kDirectAlign = 4096;
+
+        ~FileHandle() {
+            try { close(); } catch (...) {}
+            std::free(buf);
+        }
+
+        [[noreturn]] void fail(const char* fn) const {
+            throw std::runtime_error(std::string(fn) + ": '" + path + "': " + std::strerror(errno) + ".");
+        }
+
+        void dropDirect() {
+#ifdef __linux__
+            int flags = fcntl(fd, F_GETFL);
+            if (flags >= 0) fcntl(fd, F_SETFL, flags & ~O_DIRECT);
+#endif
+            direct = false;
+        }
+
+        void writeAll(const char* p, size_t n, const char* fn) {
+            while (n > 0) {
+                ssize_t w = ::write(fd, p, n);
+                if (w < 0) {
+                    if (errno == EINTR) continue;
+                    // Filesystems without O_DIRECT support, or an unaligned
+                    // append offset: continue through the page cache
+                    if (errno == EINVAL && direct) { dropDirect(); continue; }
+                    fail(fn);
+                }
+                p += w;
+                n -= static_cast<size_t>(w);
+            }
+        }
+
+        void syncData(const char* fn) {
+#if defined(__linux__)
+            if (fdatasync(fd) != 0) fail(fn);
+#elif !defined(_WIN32)
+            if (fsync(fd) != 0) fail(fn);
+#endif
+        }
+
+        void flush(const char* fn) {
+            if (fd < 0) throw std::runtime_error(std::string(fn) + ": file is closed.");
+            if (len > 0) {
+                // A partial block cannot go through O_DIRECT
+                if (direct && len % kDirectAlign != 0) dropDirect();
+                writeAll(buf, len, fn);
+                len = 0;
+            }
+            if (sync == SyncPolicy::Flush) syncData(fn);
+        }
+
+        void write(const char* p, size_t n, const char* fn) {
+            if (fd < 0) throw std::runtime_error(std::string(fn) + ": file is closed.");
+            // Large writes bypass the buffer unless O_DIRECT needs aligned chunks
+            if (!direct && n >= cap) {
+                if (len > 0) { writeAll(buf, len, fn); len = 0; }
+                writeAll(p, n, fn);
+                return;
+            }
+            while (n > 0) {
+                size_t take = std::min(n, cap - len);
+                std::memcpy(buf + len, p, take);
+                len += take; p += take; n -= take;
+                if (len == cap) { writeAll(buf, len, fn); len = 0; }
+            }
+        }
+
+        void close() {
+            if (fd < 0) return;
+            try {
+                flush("io_close");
+                if (sync == SyncPolicy::Close) syncData("io_close");
+            } catch (...) {
+                ::close(fd);
+                fd = -1;
+                throw;
+            }
+            ::close(fd);
+            fd = -1;
+        }
+    };
+
+    static std::mutex fileRegistryMutex;
+    static std::unordered_map<int, std::shared_ptr<FileHandle>> files;
+    static std::atomic<int> nextFileId{1};
+
+    static std::shared_ptr<FileHandle> getFile(const std::vector<Value>& args, const char* fn) {
+        if (args.empty() || !args[0].holds_alternative<int>())
+            throw std::runtime_error(std::string(fn) + ": expected a file handle.");
+        std::lock_guard<std::mutex> lock(fileRegistryMutex);
+        auto it = files.find(args[0].get<int>());
+        if (it == files.end()) throw std::runtime_error(std::string(fn) + ": invalid file handle.");
+        return it->second;
+    }
+
+    // io_open(path, mode = "w", options = {}): mode is "w" (truncate) or "a"
+    // (append). Options: "buffer" (bytes, default 65536; 0 writes through),
+    // "sync" ("none", "flush" or "close": when to fdatasync) and "direct"
+    // (bool: O_DIRECT where the filesystem supports it).
+    Value open_fn(std::vector<Value>& args) {
+        if (args.empty() || !args[0].holds_alternative<std::string>())
+            throw std::runtime_error("io_open: path must be a string.");
+        std::string mode = "w";
+        if (args.size() > 1) {
+            if (!args[1].holds_alternative<std::string>()) throw std::runtime_error("io_open: mode must be a string.");
+            mode = args[1].get<std::string>();
+        }
+        if (mode != "w" && mode != "a") throw std::runtime_error("io_open: mode must be \"w\" or \"a\".");
+
+        auto file = std::make_shared<FileHandle>();
+        file->path = args[0].get<std::string>();
+        size_t bufferSize = 65536;
+        bool direct = false;
+        if (args.size() > 2 && args[2].holds_alternative<MapValue>()) {
+            const auto& opts = args[2].get<MapValue>();
+            auto it = opts.find("buffer");
+            if (it != opts.end()) {
+                int n = toInt(it->second);
+                if (n < 0) throw std::runtime_error("io_open: buffer must not be negative.");
+                bufferSize = static_cast<size_t>(n);
+            }
+            it = opts.find("sync");
+            if (it != opts.end()) {
+                std::string s = it->second.holds_alternative<std::string>() ? it->second.get<std::string>() : "";
+                if (s == "none") file->sync = SyncPolicy::None;
+                else if (s == "flush") file->sync = SyncPolicy::Flush;
+                else if (s == "close") file->sync = SyncPolicy::Close;
+                else throw std::runtime_error("io_open: sync must be \"none\", \"flush\" or \"close\".");
+            }
+            it = opts.find("direct");
+            if (it != opts.end()) direct = it->second.holds_alternative<bool>() && it->second.get<bool>();
+        }
+
+        int flags = O_WRONLY | O_CREAT | (mode == "a" ? O_APPEND : O_TRUNC);
+#ifdef _WIN32
+        flags |= O_BINARY;
+#endif
+#ifdef __linux__
+        flags |= O_CLOEXEC;
+        if (direct) {
+            file->fd = ::open(file->path.c_str(), flags | O_DIRECT, 0644);
+            if (file->fd >= 0) file->direct = true;
+        }
+#endif
+        if (file->fd < 0) file->fd = ::open(file->path.c_str(), flags, 0644);
+        if (file->fd < 0) file->fail("io_open");
+
+#ifdef __linux__
+        if (file->direct) {
+            // Aligned buffer of whole blocks
+            bufferSize = std::max(bufferSize, FileHandle::kDirectAlign);
+            bufferSize = (bufferSize + FileHandle::kDirectAlign - 1) / FileHandle::kDirectAlign * FileHandle::kDirectAlign;
+            void* mem = nullptr;
+            if (posix_memalign(&mem, FileHandle::kDirectAlign, bufferSize) != 0) throw std::bad_alloc();
+            file->buf = static_cast<char*>(mem);
+        } else
+#endif
+        if (bufferSize > 0) {
+            file->buf = static_cast<char*>(std::malloc(bufferSize));
+            if (!file->buf) throw std::bad_alloc();
+        }
+        file->cap = bufferSize;
+
+        int id = nextFileId++;
+        std::lock_guard<std::mutex> lock(fileRegistryMutex);
+        files[id] = std::move(file);
+        return id;
+    }
+
+    // io_write(file, data): strings are written as-is, other values as text
+    Value write_fn(std::vector<Value>& args) {
+        auto file = getFile(args, "io_write");
+        if (args.size() < 2) throw std::runtime_error("io_write: expected file and data.");
+        std::lock_guard<std::mutex> lock(file->mutex);
+        if (args[1].holds_alternative<std::string>()) {
+            const auto& s = args[1].get<std::string>();
+            file->write(s.data(), s.size(), "io_write");
+            return sizeValue(s.size());
+        }
+        std::string s = keyToString(args[1]);
+        file->write(s.data(), s.size(), "io_write");
+        return sizeValue(s.size());
+    }
+
+    // io_flush() with no handle flushes standard output
+    Value flush_fn(std::vector<Value>& args) {
+        if (args.empty()) {
+            Console::flush();
+            return Value();
+        }
+        auto file = getFile(args, "io_flush");
+        std::lock_guard<std::mutex> lock(file->mutex);
+        file->flush("io_flush");
+        return true;
+    }
+
+    // Flushes and releases the handle; closing twice is an error
+    Value close_fn(std::vector<Value>& args) {
+        auto file = getFile(args, "io_close");
+        {
+            std::lock_guard<std::mutex> lock(fileRegistryMutex);
+            files.erase(args[0].get<int>());
+        }
+        std::lock_guard<std::mutex> lock(file->mutex);
+        file->close();
+        return true;
+    }
+
     void registerFunctions(std::unordered_map<std::string, Value>& globals) {
         globals["io_read_file"] = NativeFunction{readFile, 1};
         globals["io_write_file"] = NativeFunction{writeFile, 2};
         globals["io_append_file"] = NativeFunction{appendFile, 2};
         globals["io_read_lines"] = NativeFunction{readLines, 1};
+        globals["io_lines"] = NativeFunction{lines, 1};
+        globals["io_mmap"] = NativeFunction{mmap_open, 1};
+        globals["io_mmap_size"] = NativeFunction{mmap_size, 1};
+        globals["io_mmap_read"] = NativeFunction{mmap_read, 3};
+        globals["io_mmap_find"] = NativeFunction{mmap_find, -1};
+        globals["io_mmap_close"] = NativeFunction{mmap_close, 1};
+        globals["io_open"] = NativeFunction{open_fn, -1};
+        globals["io_write"] = NativeFunction{write_fn, 2};
+        globals["io_flush"] = NativeFunction{flush_fn, -1};
+        globals["io_close"] = NativeFunction{close_fn, 1};
     }
 }
 
@@ -1428,53 +3104,544 @@ namespace FS {
     }
 }
 
-// ============ TIME LIBRARY ============
-namespace Time {
-    Value now(std::vector<Value>& args) {
-        auto now_tp = std::chrono::system_clock::now();
-        auto duration = now_tp.time_since_epoch();
-        auto millis = std::chrono::duration_cast<std::chrono::milliseconds>(duration).count();
-        return static_cast<double>(millis);
-    }
-
-    Value sleep_fn(std::vector<Value>& args) {
-        if (args.empty()) return Value();
-        int ms = toInt(args[0]);
-        std::this_thread::sleep_for(std::chrono::milliseconds(ms));
-        return Value();
-    }
+// ============ ASYNC IO LIBRARY ============
+namespace AsyncIO {
+    // Batches of whole-file reads and writes run on a background I/O thread.
+    // On Linux that thread drives an io_uring (raw syscalls, no liburing): every
+    // file in a batch advances through open -> read/write... -> close as its
+    // completions arrive, so thousands of small files cost a handful of
+    // io_uring_enter calls instead of four syscalls each. Elsewhere, or when
+    // io_uring or one of those opcodes is unavailable, the same steps run as
+    // plain blocking syscalls.
+
+    struct Op {
+        enum Kind { Read, Write } kind = Read;
+        enum Stage { Open, Stat, Transfer, Close, Done } stage = Open;
+        std::string path;
+        std::string data;       // Read: contents so far; Write: bytes to write
+        bool append = false;
+        int fd = -1;
+        size_t done = 0;        // Bytes transferred
+        bool regular = false;   // A short read from a regular file means EOF
+        int err = 0;            // errno of the first failure
+#ifdef __linux__
+        struct statx stx{};
+#endif
+    };
 
-    Value timestamp(std::vector<Value>& args) {
-        auto now_tp = std::chrono::system_clock::now();
-        auto duration = now_tp.time_since_epoch();
-        auto secs = std::chrono::duration_cast<std::chrono::seconds>(duration).count();
-        return static_cast<int>(secs);
-    }
+    struct Batch {
+        std::vector<Op> ops;
+        std::mutex mutex;
+        std::condition_variable cv;
+        bool finished = false;
+    };
 
-    void registerFunctions(std::unordered_map<std::string, Value>& globals) {
-        globals["time_now"] = NativeFunction{now, 0};
-        globals["time_sleep"] = NativeFunction{sleep_fn, 1};
-        globals["time_timestamp"] = NativeFunction{timestamp, 0};
+    // Reads are sized from the file's length (plus one byte, so the first
+    // short read is the last); the buffer only grows if the file did
+    static void growForRead(Op& op) {
+        if (op.data.size() > op.done) return;
+        op.data.resize(op.data.empty() ? 4096 : op.data.size() * 2);
     }
-}
 
-// ============ CRYPTO LIBRARY ============
-namespace Crypto {
-    Value xor_cipher(std::vector<Value>& args) {
-        if (args.size() < 2 || !args[0].holds_alternative<std::string>() || !args[1].holds_alternative<std::string>())
-            return std::string("");
-        std::string data = args[0].get<std::string>();
-        std::string key = args[1].get<std::string>();
-        if (key.empty()) return data;
-        std::string result = data;
-        for (size_t i = 0; i < data.size(); ++i) result[i] = data[i] ^ key[i % key.size()];
-        return result;
+    static bool readFinished(const Op& op, size_t requested, size_t got) {
+        return got == 0 || (op.regular && got < requested);
     }
 
-    Value simple_hash(std::vector<Value>& args) {
-        if (args.empty() || !args[0].holds_alternative<std::string>()) return 0;
-        std::string str = args[0].get<std::string>();
-        size_t hash = 0;
+    static void runSync(Op& op) {
+#ifdef _WIN32
+        int flags = op.kind == Op::Read ? (O_RDONLY | O_BINARY) : (O_WRONLY | O_CREAT | O_BINARY | (op.append ? O_APPEND : O_TRUNC));
+#else
+        int flags = op.kind == Op::Read ? (O_RDONLY | O_CLOEXEC) : (O_WRONLY | O_CREAT | O_CLOEXEC | (op.append ? O_APPEND : O_TRUNC));
+#endif
+        op.fd = ::open(op.path.c_str(), flags, 0644);
+        if (op.fd < 0) { op.err = errno; op.stage = Op::Done; return; }
+        if (op.kind == Op::Read) {
+            struct stat st;
+            if (::fstat(op.fd, &st) == 0 && S_ISREG(st.st_mode)) {
+                op.regular = true;
+                op.data.resize(static_cast<size_t>(st.st_size) + 1);
+            }
+            while (true) {
+                growForRead(op);
+                size_t requested = op.data.size() - op.done;
+                auto n = ::read(op.fd, &op.data[op.done], static_cast<unsigned>(std::min<size_t>(requested, 1u << 30)));
+                if (n < 0 && errno == EINTR) continue;
+                if (n < 0) { op.err = errno; break; }
+                op.done += static_cast<size_t>(n);
+                if (readFinished(op, requested, static_cast<size_t>(n))) break;
+            }
+            op.data.resize(op.done);
+        } else {
+            while (op.done < op.data.size()) {
+                auto n = ::write(op.fd, op.data.data() + op.done, op.data.size() - op.done);
+                if (n < 0 && errno == EINTR) continue;
+                if (n < 0) { op.err = errno; break; }
+                op.done += static_cast<size_t>(n);
+            }
+        }
+        if (::close(op.fd) != 0 && !op.err) op.err = errno;
+        op.fd = -1;
+        op.stage = Op::Done;
+    }
+
+#ifdef __linux__
+    class Ring {
+    public:
+        ~Ring() {
+            if (sqesPtr) munmap(sqesPtr, sqesSize);
+            if (cqPtr && cqPtr != sqPtr) munmap(cqPtr, cqSize);
+            if (sqPtr) munmap(sqPtr, sqSize);
+            if (fd >= 0) ::close(fd);
+        }
+
+        bool init(unsigned entries) {
+            io_uring_params p{};
+            fd = static_cast<int>(syscall(__NR_io_uring_setup, entries, &p));
+            if (fd < 0) return false;
+            sqSize = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+            cqSize = p.cq_off.cqes + p.cq_entries * sizeof(io_uring_cqe);
+            bool single = p.features & IORING_FEAT_SINGLE_MMAP;
+            if (single) sqSize = cqSize = std::max(sqSize, cqSize);
+            sqPtr = mmap(nullptr, sqSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+            if (sqPtr == MAP_FAILED) { sqPtr = nullptr; return false; }
+            cqPtr = single ? sqPtr : mmap(nullptr, cqSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+            if (cqPtr == MAP_FAILED) { cqPtr = nullptr; return false; }
+            sqesSize = p.sq_entries * sizeof(io_uring_sqe);
+            sqesPtr = mmap(nullptr, sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+            if (sqesPtr == MAP_FAILED) { sqesPtr = nullptr; return false; }
+
+            auto* sq = static_cast<char*>(sqPtr);
+            sqHead = reinterpret_cast<unsigned*>(sq + p.sq_off.head);
+            sqTail = reinterpret_cast<unsigned*>(sq + p.sq_off.tail);
+            sqMask = *reinterpret_cast<unsigned*>(sq + p.sq_off.ring_mask);
+            sqArray = reinterpret_cast<unsigned*>(sq + p.sq_off.array);
+            auto* cq = static_cast<char*>(cqPtr);
+            cqHead = reinterpret_cast<unsigned*>(cq + p.cq_off.head);
+            cqTail = reinterpret_cast<unsigned*>(cq + p.cq_off.tail);
+            cqMask = *reinterpret_cast<unsigned*>(cq + p.cq_off.ring_mask);
+            cqes = reinterpret_cast<io_uring_cqe*>(cq + p.cq_off.cqes);
+            sqes = static_cast<io_uring_sqe*>(sqesPtr);
+            capacity = p.sq_entries;
+            localTail = *sqTail;
+            return supportsOps();
+        }
+
+        unsigned size() const { return capacity; }
+
+        // Kernels before 5.6 set up a ring but fail these opcodes with -EINVAL;
+        // they also lack IORING_REGISTER_PROBE, so a failed probe means no
+        bool supportsOps() {
+            constexpr unsigned kProbeOps = 256;
+            std::vector<char> buf(sizeof(io_uring_probe) + kProbeOps * sizeof(io_uring_probe_op), 0);
+            auto* probe = reinterpret_cast<io_uring_probe*>(buf.data());
+            if (syscall(__NR_io_uring_register, fd, IORING_REGISTER_PROBE, probe, kProbeOps) < 0) return false;
+            for (int op : {IORING_OP_OPENAT, IORING_OP_STATX, IORING_OP_READ, IORING_OP_WRITE, IORING_OP_CLOSE}) {
+                if (op > probe->last_op || !(probe->ops[op].flags & IO_URING_OP_SUPPORTED)) return false;
+            }
+            return true;
+        }
+
+        // Queues one SQE for op `index` at its current stage
+        void prepare(Op& op, uint64_t index) {
+            unsigned slot = localTail & sqMask;
+            io_uring_sqe* sqe = &sqes[slot];
+            std::memset(sqe, 0, sizeof(*sqe));
+            sqe->user_data = index;
+            switch (op.stage) {
+                case Op::Open:
+                    sqe->opcode = IORING_OP_OPENAT;
+                    sqe->fd = AT_FDCWD;
+                    sqe->addr = reinterpret_cast<uint64_t>(op.path.c_str());
+                    sqe->open_flags = op.kind == Op::Read ? (O_RDONLY | O_CLOEXEC)
+                                                          : (O_WRONLY | O_CREAT | O_CLOEXEC | (op.append ? O_APPEND : O_TRUNC));
+                    sqe->len = 0644;
+                    break;
+                case Op::Stat:
+                    sqe->opcode = IORING_OP_STATX;
+                    sqe->fd = op.fd;
+                    sqe->addr = reinterpret_cast<uint64_t>("");
+                    sqe->statx_flags = AT_EMPTY_PATH;
+                    sqe->len = STATX_TYPE | STATX_SIZE;
+                    sqe->off = reinterpret_cast<uint64_t>(&op.stx);
+                    break;
+                case Op::Transfer:
+                    sqe->fd = op.fd;
+                    if (op.kind == Op::Read) {
+                        growForRead(op);
+                        sqe->opcode = IORING_OP_READ;
+                        sqe->addr = reinterpret_cast<uint64_t>(&op.data[op.done]);
+                        sqe->len = static_cast<unsigned>(std::min<size_t>(op.data.size() - op.done, 1u << 30));
+                        sqe->off = op.done;
+                    } else {
+                        sqe->opcode = IORING_OP_WRITE;
+                        sqe->addr = reinterpret_cast<uint64_t>(op.data.data() + op.done);
+                        sqe->len = static_cast<unsigned>(std::min<size_t>(op.data.size() - op.done, 1u << 30));
+                        sqe->off = op.append ? static_cast<uint64_t>(-1) : op.done;
+                    }
+                    break;
+                default:
+                    sqe->opcode = IORING_OP_CLOSE;
+                    sqe->fd = op.fd;
+                    break;
+            }
+            sqArray[slot] = slot;
+            ++localTail;
+        }
+
+        // Submits queued SQEs and waits for at least one completion
+        int submitAndWait() {
+            __atomic_store_n(sqTail, localTail, __ATOMIC_RELEASE);
+            while (true) {
+                // Whatever the kernel has not consumed yet, including after EINTR
+                unsigned toSubmit = localTail - __atomic_load_n(sqHead, __ATOMIC_ACQUIRE);
+                long r = syscall(__NR_io_uring_enter, fd, toSubmit, 1, IORING_ENTER_GETEVENTS, nullptr, 0);
+                if (r >= 0 && static_cast<unsigned>(r) >= toSubmit) return 0;
+                if (r >= 0) continue;
+                if (errno == EAGAIN || errno == EBUSY) { std::this_thread::yield(); continue; }
+                if (errno != EINTR) return errno;
+            }
+        }
+
+        template<typename F>
+        void reap(F&& onComplete) {
+            unsigned head = *cqHead;
+            unsigned tail = __atomic_load_n(cqTail, __ATOMIC_ACQUIRE);
+            for (; head != tail; ++head) {
+                const io_uring_cqe& cqe = cqes[head & cqMask];
+                onComplete(cqe.user_data, cqe.res);
+            }
+            __atomic_store_n(cqHead, head, __ATOMIC_RELEASE);
+        }
+
+    private:
+        int fd = -1;
+        void* sqPtr = nullptr;
+        void* cqPtr = nullptr;
+        void* sqesPtr = nullptr;
+        size_t sqSize = 0, cqSize = 0, sqesSize = 0;
+        unsigned *sqHead = nullptr, *sqTail = nullptr, *sqArray = nullptr;
+        unsigned *cqHead = nullptr, *cqTail = nullptr;
+        unsigned sqMask = 0, cqMask = 0, capacity = 0;
+        unsigned localTail = 0;
+        io_uring_sqe* sqes = nullptr;
+        io_uring_cqe* cqes = nullptr;
+    };
+
+    // Advances op after a completion; returns false once it is done
+    static bool advance(Op& op, int res) {
+        switch (op.stage) {
+            case Op::Open:
+                if (res < 0) { op.err = -res; op.stage = Op::Done; return false; }
+                op.fd = res;
+                op.stage = op.kind == Op::Read ? Op::Stat : Op::Transfer;
+                if (op.kind == Op::Write && op.data.empty()) op.stage = Op::Close;
+                return true;
+            case Op::Stat:
+                if (res == 0 && S_ISREG(op.stx.stx_mode)) {
+                    op.regular = true;
+                    op.data.resize(static_cast<size_t>(op.stx.stx_size) + 1);
+                }
+                op.stage = Op::Transfer;
+                return true;
+            case Op::Transfer: {
+                if (res == -EINTR || res == -EAGAIN) return true;
+                if (res < 0) { op.err = -res; op.stage = Op::Close; return true; }
+                size_t requested = std::min<size_t>(op.data.size() - op.done, 1u << 30);
+                op.done += static_cast<size_t>(res);
+                if (op.kind == Op::Read ? readFinished(op, requested, static_cast<size_t>(res)) : op.done >= op.data.size())
+                    op.stage = Op::Close;
+                return true;
+            }
+            default:
+                if (res < 0 && !op.err) op.err = -res;
+                if (op.kind == Op::Read) op.data.resize(op.done);
+                op.fd = -1;
+                op.stage = Op::Done;
+                return false;
+        }
+    }
+
+    // Returns false if the ring itself failed; unstarted ops then run
+    // synchronously and ops caught in flight report the error
+    static bool runRing(Ring& ring, std::vector<Op>& ops) {
+        size_t next = 0, inFlight = 0;
+        while (next < ops.size() || inFlight > 0) {
+            while (next < ops.size() && inFlight < ring.size()) {
+                ring.prepare(ops[next], next);
+                ++next;
+                ++inFlight;
+            }
+            if (int err = ring.submitAndWait()) {
+                for (size_t i = 0; i < ops.size(); ++i) {
+                    Op& op = ops[i];
+                    if (i >= next) { runSync(op); continue; }
+                    if (op.stage == Op::Done) continue;
+                    if (op.fd >= 0) ::close(op.fd);
+                    op.fd = -1;
+                    op.err = err;
+                    op.stage = Op::Done;
+                }
+                return false;
+            }
+            ring.reap([&](uint64_t index, int res) {
+                Op& op = ops[index];
+                if (advance(op, res)) ring.prepare(op, index);
+                else --inFlight;
+            });
+        }
+        return true;
+    }
+#endif
+
+    // One I/O thread serves batches in submission order
+    class Engine {
+    public:
+        static Engine& instance() {
+            static Engine* engine = new Engine();   // Never destroyed: the worker is detached
+            return *engine;
+        }
+
+        const char* backend() const { return useRing ? "io_uring" : "sync"; }
+
+        void submit(std::shared_ptr<Batch> batch) {
+            std::lock_guard<std::mutex> lock(mutex);
+            queue.push_back(std::move(batch));
+            cv.notify_one();
+        }
+
+    private:
+        Engine() {
+#ifdef __linux__
+            const char* env = std::getenv("YEN_AIO_BACKEND");
+            if (!(env && std::string(env) == "sync")) useRing = ring.init(256);
+#endif
+            std::thread([this] { run(); }).detach();
+        }
+
+        void run() {
+            while (true) {
+                std::shared_ptr<Batch> batch;
+                {
+                    std::unique_lock<std::mutex> lock(mutex);
+                    cv.wait(lock, [this] { return !queue.empty(); });
+                    batch = std::move(queue.front());
+                    queue.pop_front();
+                }
+#ifdef __linux__
+                if (useRing) useRing = runRing(ring, batch->ops);
+                else
+#endif
+                for (auto& op : batch->ops) runSync(op);
+                std::lock_guard<std::mutex> lock(batch->mutex);
+                batch->finished = true;
+                batch->cv.notify_all();
+            }
+        }
+
+        std::mutex mutex;
+        std::condition_variable cv;
+        std::deque<std::shared_ptr<Batch>> queue;
+        std::atomic<bool> useRing{false};
+#ifdef __linux__
+        Ring ring;
+#endif
+    };
+
+    static std::mutex registryMutex;
+    static std::unordered_map<int, std::shared_ptr<Batch>> batches;
+    static std::atomic<int> nextBatchId{1};
+
+    // A path string is a read; maps are {"op": "read"|"write", "path", "data", "append"}
+    static Op parseOp(const Value& spec, const char* fn) {
+        Op op;
+        if (spec.holds_alternative<std::string>()) {
+            op.path = spec.get<std::string>();
+            return op;
+        }
+        if (!spec.holds_alternative<MapValue>()) throw std::runtime_error(std::string(fn) + ": each operation must be a path or a map.");
+        const auto& m = spec.get<MapValue>();
+        auto it = m.find("path");
+        if (it == m.end() || !it->second.holds_alternative<std::string>())
+            throw std::runtime_error(std::string(fn) + ": operation needs a \"path\" string.");
+        op.path = it->second.get<std::string>();
+        it = m.find("op");
+        std::string kind = (it != m.end() && it->second.holds_alternative<std::string>()) ? it->second.get<std::string>() : "read";
+        if (kind == "write") {
+            op.kind = Op::Write;
+            it = m.find("data");
+            if (it != m.end()) op.data = it->second.holds_alternative<std::string>() ? it->second.get<std::string>() : keyToString(it->second);
+            it = m.find("append");
+            op.append = it != m.end() && it->second.holds_alternative<bool>() && it->second.get<bool>();
+        } else if (kind != "read") {
+            throw std::runtime_error(std::string(fn) + ": unknown operation '" + kind + "' (use read or write).");
+        }
+        return op;
+    }
+
+    static std::shared_ptr<Batch> runBatch(std::vector<Op> ops) {
+        auto batch = std::make_shared<Batch>();
+        batch->ops = std::move(ops);
+        Engine::instance().submit(batch);
+        return batch;
+    }
+
+    static void awaitBatch(Batch& batch) {
+        std::unique_lock<std::mutex> lock(batch.mutex);
+        batch.cv.wait(lock, [&] { return batch.finished; });
+    }
+
+    static Value opResult(Op& op) {
+        MapValue result;
+        result["path"] = op.path;
+        result["ok"] = op.err == 0;
+        if (op.err) result["error"] = std::string(std::strerror(op.err));
+        else if (op.kind == Op::Read) result["data"] = std::move(op.data);
+        else result["bytes"] = IO::sizeValue(op.done);
+        return result;
+    }
+
+    // aio_submit(ops): starts a batch and returns its handle immediately
+    Value submit_fn(std::vector<Value>& args) {
+        if (args.empty() || !args[0].holds_alternative<std::vector<Value>>())
+            throw std::runtime_error("aio_submit: expected a list of operations.");
+        std::vector<Op> ops;
+        for (const auto& spec : args[0].get<std::vector<Value>>()) ops.push_back(parseOp(spec, "aio_submit"));
+        auto batch = runBatch(std::move(ops));
+        int id = nextBatchId++;
+        std::lock_guard<std::mutex> lock(registryMutex);
+        batches[id] = std::move(batch);
+        return id;
+    }
+
+    static std::shared_ptr<Batch> getBatch(const std::vector<Value>& args, const char* fn) {
+        if (args.empty() || !args[0].holds_alternative<int>()) throw std::runtime_error(std::string(fn) + ": expected a batch handle.");
+        std::lock_guard<std::mutex> lock(registryMutex);
+        auto it = batches.find(args[0].get<int>());
+        if (it == batches.end()) throw std::runtime_error(std::string(fn) + ": invalid batch handle.");
+        return it->second;
+    }
+
+    Value poll_fn(std::vector<Value>& args) {
+        auto batch = getBatch(args, "aio_poll");
+        std::lock_guard<std::mutex> lock(batch->mutex);
+        return batch->finished;
+    }
+
+    // aio_wait(batch): blocks until every operation completes; returns one
+    // {"path", "ok", "data" | "bytes" | "error"} map per operation, in order
+    Value wait_fn(std::vector<Value>& args) {
+        auto batch = getBatch(args, "aio_wait");
+        awaitBatch(*batch);
+        {
+            std::lock_guard<std::mutex> lock(registryMutex);
+            batches.erase(args[0].get<int>());
+        }
+        std::vector<Value> results;
+        results.reserve(batch->ops.size());
+        for (auto& op : batch->ops) results.push_back(opResult(op));
+        return results;
+    }
+
+    // aio_read_files(paths): contents in order, None where a read failed
+    Value read_files_fn(std::vector<Value>& args) {
+        if (args.empty() || !args[0].holds_alternative<std::vector<Value>>())
+            throw std::runtime_error("aio_read_files: expected a list of paths.");
+        std::vector<Op> ops;
+        for (const auto& p : args[0].get<std::vector<Value>>()) {
+            if (!p.holds_alternative<std::string>()) throw std::runtime_error("aio_read_files: paths must be strings.");
+            Op op;
+            op.path = p.get<std::string>();
+            ops.push_back(std::move(op));
+        }
+        auto batch = runBatch(std::move(ops));
+        awaitBatch(*batch);
+        std::vector<Value> results;
+        results.reserve(batch->ops.size());
+        for (auto& op : batch->ops) results.push_back(op.err ? Value() : Value(std::move(op.data)));
+        return results;
+    }
+
+    // aio_write_files({path: data, ...}): number of files written successfully
+    Value write_files_fn(std::vector<Value>& args) {
+        if (args.empty() || !args[0].holds_alternative<MapValue>())
+            throw std::runtime_error("aio_write_files: expected a map of path to contents.");
+        std::vector<Op> ops;
+        for (const auto& [path, data] : args[0].get<MapValue>()) {
+            Op op;
+            op.kind = Op::Write;
+            op.path = keyToString(path);
+            op.data = data.holds_alternative<std::string>() ? data.get<std::string>() : keyToString(data);
+            ops.push_back(std::move(op));
+        }
+        auto batch = runBatch(std::move(ops));
+        awaitBatch(*batch);
+        int written = 0;
+        for (const auto& op : batch->ops) written += op.err == 0;
+        return written;
+    }
+
+    Value backend_fn(std::vector<Value>&) {
+        return std::string(Engine::instance().backend());
+    }
+
+    void registerFunctions(std::unordered_map<std::string, Value>& globals) {
+        globals["aio_submit"] = NativeFunction{submit_fn, 1};
+        globals["aio_poll"] = NativeFunction{poll_fn, 1};
+        globals["aio_wait"] = NativeFunction{wait_fn, 1};
+        globals["aio_read_files"] = NativeFunction{read_files_fn, 1};
+        globals["aio_write_files"] = NativeFunction{write_files_fn, 1};
+        globals["aio_backend"] = NativeFunction{backend_fn, 0};
+    }
+}
+
+// ============ TIME LIBRARY ============
+namespace Time {
+    Value now(std::vector<Value>& args) {
+        auto now_tp = std::chrono::system_clock::now();
+        auto duration = now_tp.time_since_epoch();
+        auto millis = std::chrono::duration_cast<std::chrono::milliseconds>(duration).count();
+        return static_cast<double>(millis);
+    }
+
+    Value sleep_fn(std::vector<Value>& args) {
+        if (args.empty()) return Value();
+        int ms = toInt(args[0]);
+        Console::flush();   // Don't hold output back while idle
+        std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+        return Value();
+    }
+
+    Value timestamp(std::vector<Value>& args) {
+        auto now_tp = std::chrono::system_clock::now();
+        auto duration = now_tp.time_since_epoch();
+        auto secs = std::chrono::duration_cast<std::chrono::seconds>(duration).count();
+        return static_cast<int>(secs);
+    }
+
+    void registerFunctions(std::unordered_map<std::string, Value>& globals) {
+        globals["time_now"] = NativeFunction{now, 0};
+        globals["time_sleep"] = NativeFunction{sleep_fn, 1};
+        globals["time_timestamp"] = NativeFunction{timestamp, 0};
+    }
+}
+
+// ============ CRYPTO LIBRARY ============
+namespace Crypto {
+    Value xor_cipher(std::vector<Value>& args) {
+        if (args.size() < 2 || !args[0].holds_alternative<std::string>() || !args[1].holds_alternative<std::string>())
+            return std::string("");
+        std::string data = args[0].get<std::string>();
+        std::string key = args[1].get<std::string>();
+        if (key.empty()) return data;
+        std::string result = data;
+        for (size_t i = 0; i < data.size(); ++i) result[i] = data[i] ^ key[i % key.size()];
+        return result;
+    }
+
+    Value simple_hash(std::vector<Value>& args) {
+        if (args.empty() || !args[0].holds_alternative<std::string>()) return 0;
+        std::string str = args[0].get<std::string>();
+        size_t hash = 0;
         for (char c : str) hash = hash * 31 + static_cast<size_t>(c);
         return static_cast<int>(hash % 1000000007);
     }
@@ -1497,150 +3664,1520 @@ namespace Crypto {
     }
 }
 
+// ============ HASH LIBRARY ============
+namespace Hash {
+    // SHA-256 and SHA-1 use the x86 SHA extensions when the CPU has them,
+    // CRC32C uses the SSE4.2 crc32 instruction, and XXH3 (64-bit) uses SSE2.
+    // Each has a portable fallback, picked via `cpu` at runtime.
+
+    static inline uint32_t rotr32(uint32_t x, int n) { return (x >> n) | (x << (32 - n)); }
+    static inline uint32_t rotl32(uint32_t x, int n) { return (x << n) | (x >> (32 - n)); }
+    static inline uint64_t rotl64(uint64_t x, int n) { return (x << n) | (x >> (64 - n)); }
+    static inline uint32_t readBE32(const uint8_t* p) {
+        return (uint32_t(p[0]) << 24) | (uint32_t(p[1]) << 16) | (uint32_t(p[2]) << 8) | p[3];
+    }
+    static inline uint32_t readLE32(const uint8_t* p) { uint32_t v; std::memcpy(&v, p, 4); return v; }
+    static inline uint64_t readLE64(const uint8_t* p) { uint64_t v; std::memcpy(&v, p, 8); return v; }
+
+    static std::string toHex(const uint8_t* bytes, size_t n) {
+        static const char digits[] = "0123456789abcdef";
+        std::string out(n * 2, '0');
+        for (size_t i = 0; i < n; ++i) {
+            out[2 * i] = digits[bytes[i] >> 4];
+            out[2 * i + 1] = digits[bytes[i] & 15];
+        }
+        return out;
+    }
+
+    static std::string toHex64(uint64_t v, int bytes) {
+        uint8_t be[8];
+        for (int i = 0; i < bytes; ++i) be[i] = static_cast<uint8_t>(v >> (8 * (bytes - 1 - i)));
+        return toHex(be, bytes);
+    }
+
+    // ---- SHA-256 ----
+    static const uint32_t kSha256K[64] = {
+        0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+        0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+        0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+        0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+        0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+        0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+        0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+        0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+    };
+
+    static void sha256BlocksPortable(uint32_t st[8], const uint8_t* p, size_t blocks) {
+        for (; blocks--; p += 64) {
+            uint32_t w[64];
+            for (int i = 0; i < 16; ++i) w[i] = readBE32(p + 4 * i);
+            for (int i = 16; i < 64; ++i) {
+                uint32_t s0 = rotr32(w[i - 15], 7) ^ rotr32(w[i - 15], 18) ^ (w[i - 15] >> 3);
+                uint32_t s1 = rotr32(w[i - 2], 17) ^ rotr32(w[i - 2], 19) ^ (w[i - 2] >> 10);
+                w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+            }
+            uint32_t a = st[0], b = st[1], c = st[2], d = st[3], e = st[4], f = st[5], g = st[6], h = st[7];
+            for (int i = 0; i < 64; ++i) {
+                uint32_t t1 = h + (rotr32(e, 6) ^ rotr32(e, 11) ^ rotr32(e, 25)) + ((e & f) ^ (~e & g)) + kSha256K[i] + w[i];
+                uint32_t t2 = (rotr32(a, 2) ^ rotr32(a, 13) ^ rotr32(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+                h = g; g = f; f = e; e = d + t1; d = c; c = b; b = a; a = t1 + t2;
+            }
+            st[0] += a; st[1] += b; st[2] += c; st[3] += d; st[4] += e; st[5] += f; st[6] += g; st[7] += h;
+        }
+    }
+
+#ifdef YEN_X86_DISPATCH
+    __attribute__((target("sha,sse4.1,ssse3")))
+    static void sha256BlocksShaNi(uint32_t st[8], const uint8_t* p, size_t blocks) {
+        const __m128i mask = _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+        __m128i tmp = _mm_shuffle_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(st)), 0xB1);
+        __m128i state1 = _mm_shuffle_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(st + 4)), 0x1B);
+        __m128i state0 = _mm_alignr_epi8(tmp, state1, 8);    // ABEF
+        state1 = _mm_blend_epi16(state1, tmp, 0xF0);         // CDGH
+
+        for (; blocks--; p += 64) {
+            __m128i abefSave = state0, cdghSave = state1;
+            __m128i w[4];
+            // 16 groups of four rounds; w[] holds the message schedule four words at a time
+            for (int g = 0; g < 16; ++g) {
+                if (g < 4) w[g] = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 16 * g)), mask);
+                __m128i msg = _mm_add_epi32(w[g & 3], _mm_loadu_si128(reinterpret_cast<const __m128i*>(kSha256K + 4 * g)));
+                state1 = _mm_sha256rnds2_epu32(state1, state0, msg);
+                if (g >= 3 && g < 15) {
+                    __m128i t = _mm_alignr_epi8(w[g & 3], w[(g - 1) & 3], 4);
+                    w[(g + 1) & 3] = _mm_sha256msg2_epu32(_mm_add_epi32(w[(g + 1) & 3], t), w[g & 3]);
+                }
+                state0 = _mm_sha256rnds2_epu32(state0, state1, _mm_shuffle_epi32(msg, 0x0E));
+                if (g >= 1 && g < 13) w[(g - 1) & 3] = _mm_sha256msg1_epu32(w[(g - 1) & 3], w[g & 3]);
+            }
+            state0 = _mm_add_epi32(state0, abefSave);
+            state1 = _mm_add_epi32(state1, cdghSave);
+        }
+
+        tmp = _mm_shuffle_epi32(state0, 0x1B);               // FEBA
+        state1 = _mm_shuffle_epi32(state1, 0xB1);            // DCHG
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(st), _mm_blend_epi16(tmp, state1, 0xF0));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(st + 4), _mm_alignr_epi8(state1, tmp, 8));
+    }
+#endif
+
+    // ---- SHA-1 ----
+    static void sha1BlocksPortable(uint32_t st[5], const uint8_t* p, size_t blocks) {
+        for (; blocks--; p += 64) {
+            uint32_t w[80];
+            for (int i = 0; i < 16; ++i) w[i] = readBE32(p + 4 * i);
+            for (int i = 16; i < 80; ++i) w[i] = rotl32(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+            uint32_t a = st[0], b = st[1], c = st[2], d = st[3], e = st[4];
+            for (int i = 0; i < 80; ++i) {
+                uint32_t f, k;
+                if (i < 20) { f = (b & c) | (~b & d); k = 0x5A827999; }
+                else if (i < 40) { f = b ^ c ^ d; k = 0x6ED9EBA1; }
+                else if (i < 60) { f = (b & c) | (b & d) | (c & d); k = 0x8F1BBCDC; }
+                else { f = b ^ c ^ d; k = 0xCA62C1D6; }
+                uint32_t t = rotl32(a, 5) + f + e + k + w[i];
+                e = d; d = c; c = rotl32(b, 30); b = a; a = t;
+            }
+            st[0] += a; st[1] += b; st[2] += c; st[3] += d; st[4] += e;
+        }
+    }
+
+#ifdef YEN_X86_DISPATCH
+    __attribute__((target("sha,sse4.1,ssse3")))
+    static void sha1BlocksShaNi(uint32_t st[5], const uint8_t* p, size_t blocks) {
+        const __m128i mask = _mm_set_epi64x(0x0001020304050607ULL, 0x08090a0b0c0d0e0fULL);
+        __m128i abcd = _mm_shuffle_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(st)), 0x1B);
+        __m128i e0 = _mm_set_epi32(static_cast<int>(st[4]), 0, 0, 0);
+
+        for (; blocks--; p += 64) {
+            __m128i abcdSave = abcd, e0Save = e0, e1 = _mm_setzero_si128();
+            __m128i w[4];
+            // 20 groups of four rounds, alternating between the e0 and e1 registers
+            for (int g = 0; g < 20; ++g) {
+                if (g < 4) w[g] = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 16 * g)), mask);
+                __m128i e;
+                if (g == 0) { e0 = _mm_add_epi32(e0, w[0]); e1 = abcd; e = e0; }
+                else if (g & 1) { e1 = _mm_sha1nexte_epu32(e1, w[g & 3]); e0 = abcd; e = e1; }
+                else { e0 = _mm_sha1nexte_epu32(e0, w[g & 3]); e1 = abcd; e = e0; }
+                if (g >= 3 && g <= 18) w[(g + 1) & 3] = _mm_sha1msg2_epu32(w[(g + 1) & 3], w[g & 3]);
+                switch (g / 5) {
+                    case 0: abcd = _mm_sha1rnds4_epu32(abcd, e, 0); break;
+                    case 1: abcd = _mm_sha1rnds4_epu32(abcd, e, 1); break;
+                    case 2: abcd = _mm_sha1rnds4_epu32(abcd, e, 2); break;
+                    default: abcd = _mm_sha1rnds4_epu32(abcd, e, 3); break;
+                }
+                if (g >= 1 && g <= 16) w[(g - 1) & 3] = _mm_sha1msg1_epu32(w[(g - 1) & 3], w[g & 3]);
+                if (g >= 2 && g <= 17) w[(g - 2) & 3] = _mm_xor_si128(w[(g - 2) & 3], w[g & 3]);
+            }
+            e0 = _mm_sha1nexte_epu32(e0, e0Save);
+            abcd = _mm_add_epi32(abcd, abcdSave);
+        }
+
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(st), _mm_shuffle_epi32(abcd, 0x1B));
+        st[4] = static_cast<uint32_t>(_mm_extract_epi32(e0, 3));
+    }
+#endif
+
+    // Merkle-Damgard framing shared by SHA-1 and SHA-256
+    template<size_t Words>
+    struct ShaState {
+        using BlockFn = void(*)(uint32_t*, const uint8_t*, size_t);
+        uint32_t h[Words];
+        uint8_t buf[64];
+        size_t buffered = 0;
+        uint64_t total = 0;
+        BlockFn blocks;
+
+        void update(const uint8_t* p, size_t n) {
+            total += n;
+            if (buffered) {
+                size_t take = std::min(n, 64 - buffered);
+                std::memcpy(buf + buffered, p, take);
+                buffered += take; p += take; n -= take;
+                if (buffered < 64) return;
+                blocks(h, buf, 1);
+                buffered = 0;
+            }
+            if (n >= 64) {
+                blocks(h, p, n / 64);
+                p += n & ~size_t(63);
+                n &= 63;
+            }
+            std::memcpy(buf, p, n);
+            buffered = n;
+        }
+
+        std::string finish() {
+            uint64_t bits = total * 8;
+            uint8_t pad[72] = {0x80};
+            size_t padLen = (buffered < 56 ? 56 : 120) - buffered;
+            for (int i = 0; i < 8; ++i) pad[padLen + i] = static_cast<uint8_t>(bits >> (56 - 8 * i));
+            update(pad, padLen + 8);
+            uint8_t out[Words * 4];
+            for (size_t i = 0; i < Words; ++i) {
+                out[4 * i] = h[i] >> 24; out[4 * i + 1] = h[i] >> 16;
+                out[4 * i + 2] = h[i] >> 8; out[4 * i + 3] = h[i];
+            }
+            return toHex(out, sizeof(out));
+        }
+    };
+
+    static ShaState<8> newSha256() {
+        static const uint32_t init[8] = {0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19};
+        ShaState<8> s{};
+        std::copy(init, init + 8, s.h);
+        s.blocks = sha256BlocksPortable;
+#ifdef YEN_X86_DISPATCH
+        if (cpu.sha) s.blocks = sha256BlocksShaNi;
+#endif
+        return s;
+    }
+
+    static ShaState<5> newSha1() {
+        static const uint32_t init[5] = {0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0};
+        ShaState<5> s{};
+        std::copy(init, init + 5, s.h);
+        s.blocks = sha1BlocksPortable;
+#ifdef YEN_X86_DISPATCH
+        if (cpu.sha) s.blocks = sha1BlocksShaNi;
+#endif
+        return s;
+    }
+
+    // ---- CRC32C (Castagnoli) ----
+    static uint32_t crc32cPortable(uint32_t crc, const uint8_t* p, size_t n) {
+        static const auto table = []() {
+            std::array<std::array<uint32_t, 256>, 8> t{};
+            for (uint32_t i = 0; i < 256; ++i) {
+                uint32_t c = i;
+                for (int k = 0; k < 8; ++k) c = (c >> 1) ^ (0x82F63B78u & (0u - (c & 1)));
+                t[0][i] = c;
+            }
+            for (uint32_t i = 0; i < 256; ++i)
+                for (int s = 1; s < 8; ++s) t[s][i] = (t[s - 1][i] >> 8) ^ t[0][t[s - 1][i] & 0xFF];
+            return t;
+        }();
+        // Slicing-by-8
+        for (; n >= 8; n -= 8, p += 8) {
+            uint64_t v = readLE64(p) ^ crc;
+            crc = table[7][v & 0xFF] ^ table[6][(v >> 8) & 0xFF] ^ table[5][(v >> 16) & 0xFF] ^
+                  table[4][(v >> 24) & 0xFF] ^ table[3][(v >> 32) & 0xFF] ^ table[2][(v >> 40) & 0xFF] ^
+                  table[1][(v >> 48) & 0xFF] ^ table[0][v >> 56];
+        }
+        while (n--) crc = (crc >> 8) ^ table[0][(crc ^ *p++) & 0xFF];
+        return crc;
+    }
+
+#ifdef YEN_X86_DISPATCH
+    __attribute__((target("sse4.2")))
+    static uint32_t crc32cSse42(uint32_t crc, const uint8_t* p, size_t n) {
+        uint64_t c = crc;
+        for (; n >= 8; n -= 8, p += 8) c = _mm_crc32_u64(c, readLE64(p));
+        uint32_t c32 = static_cast<uint32_t>(c);
+        while (n--) c32 = _mm_crc32_u8(c32, *p++);
+        return c32;
+    }
+#endif
+
+    static uint32_t crc32cUpdate(uint32_t crc, const uint8_t* p, size_t n) {
+#ifdef YEN_X86_DISPATCH
+        if (cpu.sse42) return ~crc32cSse42(~crc, p, n);
+#endif
+        return ~crc32cPortable(~crc, p, n);
+    }
+
+    // ---- XXH3 (64-bit, seed 0, default secret) ----
+    static const uint8_t kXxhSecret[192] = {
+        0xb8, 0xfe, 0x6c, 0x39, 0x23, 0xa4, 0x4b, 0xbe, 0x7c, 0x01, 0x81, 0x2c, 0xf7, 0x21, 0xad, 0x1c,
+        0xde, 0xd4, 0x6d, 0xe9, 0x83, 0x90, 0x97, 0xdb, 0x72, 0x40, 0xa4, 0xa4, 0xb7, 0xb3, 0x67, 0x1f,
+        0xcb, 0x79, 0xe6, 0x4e, 0xcc, 0xc0, 0xe5, 0x78, 0x82, 0x5a, 0xd0, 0x7d, 0xcc, 0xff, 0x72, 0x21,
+        0xb8, 0x08, 0x46, 0x74, 0xf7, 0x43, 0x24, 0x8e, 0xe0, 0x35, 0x90, 0xe6, 0x81, 0x3a, 0x26, 0x4c,
+        0x3c, 0x28, 0x52, 0xbb, 0x91, 0xc3, 0x00, 0xcb, 0x88, 0xd0, 0x65, 0x8b, 0x1b, 0x53, 0x2e, 0xa3,
+        0x71, 0x64, 0x48, 0x97, 0xa2, 0x0d, 0xf9, 0x4e, 0x38, 0x19, 0xef, 0x46, 0xa9, 0xde, 0xac, 0xd8,
+        0xa8, 0xfa, 0x76, 0x3f, 0xe3, 0x9c, 0x34, 0x3f, 0xf9, 0xdc, 0xbb, 0xc7, 0xc7, 0x0b, 0x4f, 0x1d,
+        0x8a, 0x51, 0xe0, 0x4b, 0xcd, 0xb4, 0x59, 0x31, 0xc8, 0x9f, 0x7e, 0xc9, 0xd9, 0x78, 0x73, 0x64,
+        0xea, 0xc5, 0xac, 0x83, 0x34, 0xd3, 0xeb, 0xc3, 0xc5, 0x81, 0xa0, 0xff, 0xfa, 0x13, 0x63, 0xeb,
+        0x17, 0x0d, 0xdd, 0x51, 0xb7, 0xf0, 0xda, 0x49, 0xd3, 0x16, 0x55, 0x26, 0x29, 0xd4, 0x68, 0x9e,
+        0x2b, 0x16, 0xbe, 0x58, 0x7d, 0x47, 0xa1, 0xfc, 0x8f, 0xf8, 0xb8, 0xd1, 0x7a, 0xd0, 0x31, 0xce,
+        0x45, 0xcb, 0x3a, 0x8f, 0x95, 0x16, 0x04, 0x28, 0xaf, 0xd7, 0xfb, 0xca, 0xbb, 0x4b, 0x40, 0x7e,
+    };
+    static constexpr uint64_t kP32_1 = 0x9E3779B1U, kP32_2 = 0x85EBCA77U, kP32_3 = 0xC2B2AE3DU;
+    static constexpr uint64_t kP64_1 = 0x9E3779B185EBCA87ULL, kP64_2 = 0xC2B2AE3D27D4EB4FULL;
+    static constexpr uint64_t kP64_3 = 0x165667B19E3779F9ULL, kP64_4 = 0x85EBCA77C2B2AE63ULL;
+    static constexpr uint64_t kP64_5 = 0x27D4EB2F165667C5ULL;
+
+    static inline uint64_t mulFold64(uint64_t a, uint64_t b) {
+        __uint128_t p = static_cast<__uint128_t>(a) * b;
+        return static_cast<uint64_t>(p) ^ static_cast<uint64_t>(p >> 64);
+    }
+    static inline uint64_t xxh64Avalanche(uint64_t h) {
+        h ^= h >> 33; h *= kP64_2; h ^= h >> 29; h *= kP64_3; return h ^ (h >> 32);
+    }
+    static inline uint64_t xxh3Avalanche(uint64_t h) {
+        h ^= h >> 37; h *= 0x165667919E3779F9ULL; return h ^ (h >> 32);
+    }
+    static inline uint64_t mix16(const uint8_t* in, const uint8_t* sec) {
+        return mulFold64(readLE64(in) ^ readLE64(sec), readLE64(in + 8) ^ readLE64(sec + 8));
+    }
+
+    static uint64_t xxh3Short(const uint8_t* p, size_t len) {
+        const uint8_t* s = kXxhSecret;
+        if (len == 0) return xxh64Avalanche(readLE64(s + 56) ^ readLE64(s + 64));
+        if (len <= 3) {
+            uint32_t combined = (uint32_t(p[0]) << 16) | (uint32_t(p[len >> 1]) << 24) | p[len - 1] | (uint32_t(len) << 8);
+            return xxh64Avalanche(combined ^ uint64_t(readLE32(s) ^ readLE32(s + 4)));
+        }
+        if (len <= 8) {
+            uint64_t in64 = readLE32(p + len - 4) + (uint64_t(readLE32(p)) << 32);
+            uint64_t h = in64 ^ (readLE64(s + 8) ^ readLE64(s + 16));
+            h ^= rotl64(h, 49) ^ rotl64(h, 24);
+            h *= 0x9FB21C651E98DF25ULL;
+            h ^= (h >> 35) + len;
+            h *= 0x9FB21C651E98DF25ULL;
+            return h ^ (h >> 28);
+        }
+        if (len <= 16) {
+            uint64_t lo = readLE64(p) ^ (readLE64(s + 24) ^ readLE64(s + 32));
+            uint64_t hi = readLE64(p + len - 8) ^ (readLE64(s + 40) ^ readLE64(s + 48));
+            return xxh3Avalanche(len + __builtin_bswap64(lo) + hi + mulFold64(lo, hi));
+        }
+        uint64_t acc = len * kP64_1;
+        if (len <= 128) {
+            if (len > 32) {
+                if (len > 64) {
+                    if (len > 96) { acc += mix16(p + 48, s + 96); acc += mix16(p + len - 64, s + 112); }
+                    acc += mix16(p + 32, s + 64); acc += mix16(p + len - 48, s + 80);
+                }
+                acc += mix16(p + 16, s + 32); acc += mix16(p + len - 32, s + 48);
+            }
+            acc += mix16(p, s); acc += mix16(p + len - 16, s + 16);
+            return xxh3Avalanche(acc);
+        }
+        // 129..240 bytes
+        for (int i = 0; i < 8; ++i) acc += mix16(p + 16 * i, s + 16 * i);
+        acc = xxh3Avalanche(acc);
+        for (size_t i = 8; i < len / 16; ++i) acc += mix16(p + 16 * i, s + 16 * (i - 8) + 3);
+        acc += mix16(p + len - 16, s + 136 - 17);
+        return xxh3Avalanche(acc);
+    }
+
+    // Long-input state: 8 accumulators fed 64-byte stripes, scrambled every 16 stripes
+    struct Xxh3State {
+        uint64_t acc[8] = {kP32_3, kP64_1, kP64_2, kP64_3, kP64_4, kP32_2, kP64_5, kP32_1};
+        size_t stripe = 0;           // Stripe index within the current block
+        std::string pending;         // Unconsumed input (all of it while total <= 240)
+        size_t pendingOff = 0;
+        uint8_t tail[64];            // Last 64 bytes seen, for the final stripe
+        uint64_t total = 0;
+
+        static void accumulate(uint64_t* acc, const uint8_t* in, const uint8_t* sec) {
+#if defined(__SSE2__)
+            for (int i = 0; i < 4; ++i) {
+                __m128i a = _mm_loadu_si128(reinterpret_cast<__m128i*>(acc + 2 * i));
+                __m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + 16 * i));
+                __m128i dk = _mm_xor_si128(d, _mm_loadu_si128(reinterpret_cast<const __m128i*>(sec + 16 * i)));
+                __m128i prod = _mm_mul_epu32(dk, _mm_shuffle_epi32(dk, _MM_SHUFFLE(0, 3, 0, 1)));
+                a = _mm_add_epi64(a, _mm_shuffle_epi32(d, _MM_SHUFFLE(1, 0, 3, 2)));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(acc + 2 * i), _mm_add_epi64(a, prod));
+            }
+#else
+            for (int i = 0; i < 8; ++i) {
+                uint64_t d = readLE64(in + 8 * i), dk = d ^ readLE64(sec + 8 * i);
+                acc[i ^ 1] += d;
+                acc[i] += (dk & 0xFFFFFFFFu) * (dk >> 32);
+            }
+#endif
+        }
+
+        void consume(const uint8_t* in, size_t stripes) {
+            for (size_t n = 0; n < stripes; ++n, in += 64) {
+                accumulate(acc, in, kXxhSecret + 8 * stripe);
+                if (++stripe == 16) {
+                    for (int i = 0; i < 8; ++i) {
+                        uint64_t a = acc[i];
+                        a ^= a >> 47;
+                        a ^= readLE64(kXxhSecret + 128 + 8 * i);
+                        acc[i] = a * kP32_1;
+                    }
+                    stripe = 0;
+                }
+            }
+        }
+
+        // Consumes every stripe that ends before the last byte seen so far
+        void update(const uint8_t* p, size_t n) {
+            total += n;
+            if (n >= 64) std::memcpy(tail, p + n - 64, 64);
+            else {
+                std::memmove(tail, tail + n, 64 - n);
+                std::memcpy(tail + 64 - n, p, n);
+            }
+            if (total <= 240) { pending.append(reinterpret_cast<const char*>(p), n); return; }
+            size_t avail = pending.size() - pendingOff;
+            if (avail) {
+                // Top up pending to a whole stripe, then feed the caller's buffer directly
+                size_t take = std::min(n, (64 - avail % 64) % 64);
+                pending.append(reinterpret_cast<const char*>(p), take);
+                p += take; n -= take;
+                avail += take;
+                size_t stripes = (n ? avail : avail - 1) / 64;
+                consume(reinterpret_cast<const uint8_t*>(pending.data()) + pendingOff, stripes);
+                pendingOff += stripes * 64;
+                if (pendingOff < pending.size()) return;
+                pending.clear();
+                pendingOff = 0;
+            }
+            if (n) {
+                size_t stripes = (n - 1) / 64;
+                consume(p, stripes);
+                pending.assign(reinterpret_cast<const char*>(p) + stripes * 64, n - stripes * 64);
+            }
+        }
+
+        uint64_t digest() const {
+            if (total <= 240) return xxh3Short(reinterpret_cast<const uint8_t*>(pending.data()), total);
+            uint64_t a[8];
+            std::memcpy(a, acc, sizeof(a));
+            accumulate(a, tail, kXxhSecret + 192 - 64 - 7);
+            uint64_t h = total * kP64_1;
+            for (int i = 0; i < 4; ++i)
+                h += mulFold64(a[2 * i] ^ readLE64(kXxhSecret + 11 + 16 * i), a[2 * i + 1] ^ readLE64(kXxhSecret + 11 + 16 * i + 8));
+            return xxh3Avalanche(h);
+        }
+    };
+
+    static uint64_t xxh3(const uint8_t* p, size_t n) {
+        if (n <= 240) return xxh3Short(p, n);
+        Xxh3State st;
+        st.update(p, n);
+        return st.digest();
+    }
+
+    // ---- Streaming handles ----
+    enum class Algo { Sha256, Sha1, Crc32c, Xxh3 };
+
+    struct Hasher {
+        Algo algo;
+        ShaState<8> sha256;
+        ShaState<5> sha1;
+        uint32_t crc = 0;
+        Xxh3State xxh;
+
+        explicit Hasher(Algo a) : algo(a), sha256(newSha256()), sha1(newSha1()) {}
+
+        void update(const uint8_t* p, size_t n) {
+            switch (algo) {
+                case Algo::Sha256: sha256.update(p, n); break;
+                case Algo::Sha1: sha1.update(p, n); break;
+                case Algo::Crc32c: crc = crc32cUpdate(crc, p, n); break;
+                case Algo::Xxh3: xxh.update(p, n); break;
+            }
+        }
+
+        std::string finish() {
+            switch (algo) {
+                case Algo::Sha256: return sha256.finish();
+                case Algo::Sha1: return sha1.finish();
+                case Algo::Crc32c: return toHex64(crc, 4);
+                case Algo::Xxh3: return toHex64(xxh.digest(), 8);
+            }
+            return "";
+        }
+    };
+
+    static std::mutex registryMutex;
+    static std::unordered_map<int, std::shared_ptr<Hasher>> hashers;
+    static std::atomic<int> nextHasherId{1};
+
+    static Algo parseAlgo(const std::vector<Value>& args, size_t i, const char* fn) {
+        if (args.size() <= i) return Algo::Sha256;
+        if (!args[i].holds_alternative<std::string>())
+            throw std::runtime_error(std::string(fn) + ": algorithm must be a string.");
+        const auto& name = args[i].get<std::string>();
+        if (name == "sha256") return Algo::Sha256;
+        if (name == "sha1") return Algo::Sha1;
+        if (name == "crc32c") return Algo::Crc32c;
+        if (name == "xxh3") return Algo::Xxh3;
+        throw std::runtime_error(std::string(fn) + ": unknown algorithm '" + name + "' (use sha256, sha1, crc32c or xxh3).");
+    }
+
+    static const std::string& dataArg(const std::vector<Value>& args, size_t i, const char* fn) {
+        if (args.size() <= i || !args[i].holds_alternative<std::string>())
+            throw std::runtime_error(std::string(fn) + ": data must be a string.");
+        return args[i].get<std::string>();
+    }
+
+    static const uint8_t* bytes(const std::string& s) { return reinterpret_cast<const uint8_t*>(s.data()); }
+
+    static std::shared_ptr<Hasher> getHasher(const std::vector<Value>& args, const char* fn) {
+        if (args.empty() || !args[0].holds_alternative<int>())
+            throw std::runtime_error(std::string(fn) + ": expected a hash handle.");
+        std::lock_guard<std::mutex> lock(registryMutex);
+        auto it = hashers.find(args[0].get<int>());
+        if (it == hashers.end()) throw std::runtime_error(std::string(fn) + ": invalid hash handle.");
+        return it->second;
+    }
+
+    Value sha256_fn(std::vector<Value>& args) {
+        const auto& data = dataArg(args, 0, "hash_sha256");
+        auto st = newSha256();
+        st.update(bytes(data), data.size());
+        return st.finish();
+    }
+
+    Value sha1_fn(std::vector<Value>& args) {
+        const auto& data = dataArg(args, 0, "hash_sha1");
+        auto st = newSha1();
+        st.update(bytes(data), data.size());
+        return st.finish();
+    }
+
+    Value crc32c_fn(std::vector<Value>& args) {
+        const auto& data = dataArg(args, 0, "hash_crc32c");
+        return toHex64(crc32cUpdate(0, bytes(data), data.size()), 4);
+    }
+
+    Value xxh3_fn(std::vector<Value>& args) {
+        const auto& data = dataArg(args, 0, "hash_xxh3");
+        return toHex64(xxh3(bytes(data), data.size()), 8);
+    }
+
+    Value new_fn(std::vector<Value>& args) {
+        auto hasher = std::make_shared<Hasher>(parseAlgo(args, 0, "hash_new"));
+        int id = nextHasherId++;
+        std::lock_guard<std::mutex> lock(registryMutex);
+        hashers[id] = std::move(hasher);
+        return id;
+    }
+
+    Value update_fn(std::vector<Value>& args) {
+        auto hasher = getHasher(args, "hash_update");
+        const auto& data = dataArg(args, 1, "hash_update");
+        hasher->update(bytes(data), data.size());
+        return args[0];
+    }
+
+    // Returns the hex digest and releases the handle
+    Value final_fn(std::vector<Value>& args) {
+        auto hasher = getHasher(args, "hash_final");
+        {
+            std::lock_guard<std::mutex> lock(registryMutex);
+            hashers.erase(args[0].get<int>());
+        }
+        return hasher->finish();
+    }
+
+    // hash_file(path[, algo]): streams the file in 1 MiB reads
+    Value file_fn(std::vector<Value>& args) {
+        if (args.empty() || !args[0].holds_alternative<std::string>())
+            throw std::runtime_error("hash_file: path must be a string.");
+        Hasher hasher(parseAlgo(args, 1, "hash_file"));
+        const auto& path = args[0].get<std::string>();
+        std::FILE* f = std::fopen(path.c_str(), "rb");
+        if (!f) throw std::runtime_error("hash_file: cannot open '" + path + "'.");
+#ifdef __linux__
+        posix_fadvise(fileno(f), 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+        std::vector<uint8_t> buf(1 << 20);
+        size_t n;
+        while ((n = std::fread(buf.data(), 1, buf.size(), f)) > 0) hasher.update(buf.data(), n);
+        bool failed = std::ferror(f);
+        std::fclose(f);
+        if (failed) throw std::runtime_error("hash_file: read error on '" + path + "'.");
+        return hasher.finish();
+    }
+
+    void registerFunctions(std::unordered_map<std::string, Value>& globals) {
+        globals["hash_sha256"] = NativeFunction{sha256_fn, 1};
+        globals["hash_sha1"] = NativeFunction{sha1_fn, 1};
+        globals["hash_crc32c"] = NativeFunction{crc32c_fn, 1};
+        globals["hash_xxh3"] = NativeFunction{xxh3_fn, 1};
+        globals["hash_new"] = NativeFunction{new_fn, -1};
+        globals["hash_update"] = NativeFunction{update_fn, 2};
+        globals["hash_final"] = NativeFunction{final_fn, 1};
+        globals["hash_file"] = NativeFunction{file_fn, -1};
+    }
+}
+
 // ============ ENCODING LIBRARY ============
 namespace Encoding {
-    static const std::string base64_chars =
+    // Base64, hex and UTF-8 validation have SSSE3/AVX2 kernels picked via `cpu`
+    // at runtime; percent-encoding scans 16 bytes at a time with SSE2. The
+    // scalar loops handle tails and CPUs without the extensions.
+    static const char base64_chars[] =
         "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    static const char hex_lower[] = "0123456789abcdef";
+    static const char hex_upper[] = "0123456789ABCDEF";
+
+    // 0-63 for alphabet characters, 0xFF otherwise
+    static const std::array<uint8_t, 256> base64_values = []() {
+        std::array<uint8_t, 256> t{};
+        t.fill(0xFF);
+        for (int i = 0; i < 64; ++i) t[static_cast<uint8_t>(base64_chars[i])] = static_cast<uint8_t>(i);
+        return t;
+    }();
+
+    // 0-15 for hex digits, 0xFF otherwise
+    static const std::array<uint8_t, 256> hex_values = []() {
+        std::array<uint8_t, 256> t{};
+        t.fill(0xFF);
+        for (int i = 0; i < 16; ++i) {
+            t[static_cast<uint8_t>(hex_lower[i])] = static_cast<uint8_t>(i);
+            t[static_cast<uint8_t>(hex_upper[i])] = static_cast<uint8_t>(i);
+        }
+        return t;
+    }();
+
+    // ---- Base64 ----
+    static void base64EncodeScalar(const uint8_t* in, size_t n, char* out) {
+        size_t i = 0;
+        for (; i + 3 <= n; i += 3, out += 4) {
+            uint32_t v = (uint32_t(in[i]) << 16) | (uint32_t(in[i + 1]) << 8) | in[i + 2];
+            out[0] = base64_chars[v >> 18];
+            out[1] = base64_chars[(v >> 12) & 63];
+            out[2] = base64_chars[(v >> 6) & 63];
+            out[3] = base64_chars[v & 63];
+        }
+        if (i < n) {
+            uint32_t v = uint32_t(in[i]) << 16;
+            if (i + 1 < n) v |= uint32_t(in[i + 1]) << 8;
+            out[0] = base64_chars[v >> 18];
+            out[1] = base64_chars[(v >> 12) & 63];
+            out[2] = i + 1 < n ? base64_chars[(v >> 6) & 63] : '=';
+            out[3] = '=';
+        }
+    }
 
-    Value base64_encode(std::vector<Value>& args) {
-        if (args.empty() || !args[0].holds_alternative<std::string>()) return std::string("");
-        const std::string& input = args[0].get<std::string>();
-        std::string ret;
-        int i = 0;
-        unsigned char char_array_3[3], char_array_4[4];
-        for (char c : input) {
-            char_array_3[i++] = c;
-            if (i == 3) {
-                char_array_4[0] = (char_array_3[0] & 0xfc) >> 2;
-                char_array_4[1] = ((char_array_3[0] & 0x03) << 4) + ((char_array_3[1] & 0xf0) >> 4);
-                char_array_4[2] = ((char_array_3[1] & 0x0f) << 2) + ((char_array_3[2] & 0xc0) >> 6);
-                char_array_4[3] = char_array_3[2] & 0x3f;
-                for (i = 0; i < 4; i++) ret += base64_chars[char_array_4[i]];
-                i = 0;
-            }
-        }
-        if (i) {
-            for (int j = i; j < 3; j++) char_array_3[j] = '\0';
-            char_array_4[0] = (char_array_3[0] & 0xfc) >> 2;
-            char_array_4[1] = ((char_array_3[0] & 0x03) << 4) + ((char_array_3[1] & 0xf0) >> 4);
-            char_array_4[2] = ((char_array_3[1] & 0x0f) << 2) + ((char_array_3[2] & 0xc0) >> 6);
-            for (int j = 0; j < i + 1; j++) ret += base64_chars[char_array_4[j]];
-            while (i++ < 3) ret += '=';
-        }
-        return ret;
+#ifdef YEN_X86_DISPATCH
+    // Muła's method: spread each 3-byte group over 4 lanes, cut out the 6-bit
+    // indices with two multiplies, then add a per-range ASCII offset via pshufb.
+    __attribute__((target("ssse3")))
+    static size_t base64EncodeSsse3(const uint8_t* in, size_t n, char* out) {
+        const __m128i spread = _mm_setr_epi8(1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10);
+        const __m128i offsets = _mm_setr_epi8('a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+                                              '0' - 52, '0' - 52, '0' - 52, '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0);
+        size_t i = 0;
+        for (; i + 16 <= n; i += 12, out += 16) {
+            __m128i v = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i)), spread);
+            __m128i t0 = _mm_mulhi_epu16(_mm_and_si128(v, _mm_set1_epi32(0x0fc0fc00)), _mm_set1_epi32(0x04000040));
+            __m128i t1 = _mm_mullo_epi16(_mm_and_si128(v, _mm_set1_epi32(0x003f03f0)), _mm_set1_epi32(0x01000010));
+            __m128i idx = _mm_or_si128(t0, t1);
+            __m128i range = _mm_subs_epu8(idx, _mm_set1_epi8(51));
+            range = _mm_or_si128(range, _mm_and_si128(_mm_cmpgt_epi8(_mm_set1_epi8(26), idx), _mm_set1_epi8(13)));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out), _mm_add_epi8(idx, _mm_shuffle_epi8(offsets, range)));
+        }
+        return i;
+    }
+
+    __attribute__((target("avx2")))
+    static size_t base64EncodeAvx2(const uint8_t* in, size_t n, char* out) {
+        const __m256i spread = _mm256_setr_epi8(1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10,
+                                                1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10);
+        const __m256i offsets = _mm256_setr_epi8('a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+                                                 '0' - 52, '0' - 52, '0' - 52, '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0,
+                                                 'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+                                                 '0' - 52, '0' - 52, '0' - 52, '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0);
+        size_t i = 0;
+        for (; i + 28 <= n; i += 24, out += 32) {
+            __m256i v = _mm256_inserti128_si256(
+                _mm256_castsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i))),
+                _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i + 12)), 1);
+            v = _mm256_shuffle_epi8(v, spread);
+            __m256i t0 = _mm256_mulhi_epu16(_mm256_and_si256(v, _mm256_set1_epi32(0x0fc0fc00)), _mm256_set1_epi32(0x04000040));
+            __m256i t1 = _mm256_mullo_epi16(_mm256_and_si256(v, _mm256_set1_epi32(0x003f03f0)), _mm256_set1_epi32(0x01000010));
+            __m256i idx = _mm256_or_si256(t0, t1);
+            __m256i range = _mm256_subs_epu8(idx, _mm256_set1_epi8(51));
+            range = _mm256_or_si256(range, _mm256_and_si256(_mm256_cmpgt_epi8(_mm256_set1_epi8(26), idx), _mm256_set1_epi8(13)));
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(out), _mm256_add_epi8(idx, _mm256_shuffle_epi8(offsets, range)));
+        }
+        return i;
+    }
+
+    // Nibble lookups that flag non-alphabet characters, and the per-range
+    // offsets that turn ASCII into 6-bit values ('/' gets its own slot).
+    alignas(32) static const int8_t base64_lut_lo[32] = {
+        0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A,
+        0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A};
+    alignas(32) static const int8_t base64_lut_hi[32] = {
+        0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10,
+        0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10};
+    alignas(32) static const int8_t base64_lut_roll[32] = {
+        0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0};
+
+    // 16 characters -> 12 bytes (writes 16); false if any character is outside the alphabet
+    __attribute__((target("ssse3")))
+    static bool base64DecodeSsse3(const char* in, uint8_t* out) {
+        const __m128i lutLo = _mm_load_si128(reinterpret_cast<const __m128i*>(base64_lut_lo));
+        const __m128i lutHi = _mm_load_si128(reinterpret_cast<const __m128i*>(base64_lut_hi));
+        const __m128i lutRoll = _mm_load_si128(reinterpret_cast<const __m128i*>(base64_lut_roll));
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in));
+        __m128i hiNibbles = _mm_and_si128(_mm_srli_epi32(v, 4), _mm_set1_epi8(0x0F));
+        __m128i loNibbles = _mm_and_si128(v, _mm_set1_epi8(0x0F));
+        __m128i bad = _mm_and_si128(_mm_shuffle_epi8(lutLo, loNibbles), _mm_shuffle_epi8(lutHi, hiNibbles));
+        if (_mm_movemask_epi8(_mm_cmpgt_epi8(bad, _mm_setzero_si128()))) return false;
+        __m128i roll = _mm_shuffle_epi8(lutRoll, _mm_add_epi8(_mm_cmpeq_epi8(v, _mm_set1_epi8('/')), hiNibbles));
+        v = _mm_add_epi8(v, roll);
+        v = _mm_maddubs_epi16(v, _mm_set1_epi32(0x01400140));
+        v = _mm_madd_epi16(v, _mm_set1_epi32(0x00011000));
+        v = _mm_shuffle_epi8(v, _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out), v);
+        return true;
     }
 
-    Value base64_decode(std::vector<Value>& args) {
-        if (args.empty() || !args[0].holds_alternative<std::string>()) return std::string("");
-        const std::string& input = args[0].get<std::string>();
-        std::string ret;
-        int i = 0;
-        unsigned char char_array_4[4], char_array_3[3];
-        for (char c : input) {
+    // 32 characters -> 24 bytes (writes 32)
+    __attribute__((target("avx2")))
+    static bool base64DecodeAvx2(const char* in, uint8_t* out) {
+        const __m256i lutLo = _mm256_load_si256(reinterpret_cast<const __m256i*>(base64_lut_lo));
+        const __m256i lutHi = _mm256_load_si256(reinterpret_cast<const __m256i*>(base64_lut_hi));
+        const __m256i lutRoll = _mm256_load_si256(reinterpret_cast<const __m256i*>(base64_lut_roll));
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in));
+        __m256i hiNibbles = _mm256_and_si256(_mm256_srli_epi32(v, 4), _mm256_set1_epi8(0x0F));
+        __m256i loNibbles = _mm256_and_si256(v, _mm256_set1_epi8(0x0F));
+        __m256i bad = _mm256_and_si256(_mm256_shuffle_epi8(lutLo, loNibbles), _mm256_shuffle_epi8(lutHi, hiNibbles));
+        if (_mm256_movemask_epi8(_mm256_cmpgt_epi8(bad, _mm256_setzero_si256()))) return false;
+        __m256i roll = _mm256_shuffle_epi8(lutRoll, _mm256_add_epi8(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('/')), hiNibbles));
+        v = _mm256_add_epi8(v, roll);
+        v = _mm256_maddubs_epi16(v, _mm256_set1_epi32(0x01400140));
+        v = _mm256_madd_epi16(v, _mm256_set1_epi32(0x00011000));
+        v = _mm256_shuffle_epi8(v, _mm256_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1,
+                                                    2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1));
+        v = _mm256_permutevar8x32_epi32(v, _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 3, 7));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out), v);
+        return true;
+    }
+#endif
+
+    std::string base64Encode(std::string_view input) {
+        const uint8_t* in = reinterpret_cast<const uint8_t*>(input.data());
+        size_t n = input.size();
+        std::string out((n + 2) / 3 * 4, '\0');
+        size_t done = 0;
+#ifdef YEN_X86_DISPATCH
+        if (cpu.avx2) done = base64EncodeAvx2(in, n, out.data());
+        else if (cpu.ssse3) done = base64EncodeSsse3(in, n, out.data());
+#endif
+        base64EncodeScalar(in + done, n - done, out.data() + done / 3 * 4);
+        return out;
+    }
+
+    // Lenient like the original decoder: characters outside the alphabet are
+    // skipped and decoding stops at the first '='. Whole blocks of clean input
+    // go through the SIMD kernel whenever no partial quad is pending.
+    std::string base64Decode(std::string_view input) {
+        size_t n = input.size();
+        std::string out(n / 4 * 3 + 32, '\0');
+        uint8_t* o = reinterpret_cast<uint8_t*>(out.data());
+        size_t w = 0, pos = 0;
+        uint32_t acc = 0;
+        int quad = 0;
+#ifdef YEN_X86_DISPATCH
+        bool (*block)(const char*, uint8_t*) = cpu.avx2 ? base64DecodeAvx2 : cpu.ssse3 ? base64DecodeSsse3 : nullptr;
+        size_t width = cpu.avx2 ? 32 : 16;
+#endif
+        while (pos < n) {
+#ifdef YEN_X86_DISPATCH
+            if (block && quad == 0 && pos + width <= n && block(input.data() + pos, o + w)) {
+                pos += width;
+                w += width / 4 * 3;
+                continue;
+            }
+#endif
+            char c = input[pos++];
             if (c == '=') break;
-            size_t pos = base64_chars.find(c);
-            if (pos == std::string::npos) continue;
-            char_array_4[i++] = static_cast<unsigned char>(pos);
-            if (i == 4) {
-                char_array_3[0] = (char_array_4[0] << 2) + ((char_array_4[1] & 0x30) >> 4);
-                char_array_3[1] = ((char_array_4[1] & 0xf) << 4) + ((char_array_4[2] & 0x3c) >> 2);
-                char_array_3[2] = ((char_array_4[2] & 0x3) << 6) + char_array_4[3];
-                for (i = 0; i < 3; i++) ret += static_cast<char>(char_array_3[i]);
-                i = 0;
+            uint8_t v = base64_values[static_cast<uint8_t>(c)];
+            if (v == 0xFF) continue;
+            acc = (acc << 6) | v;
+            if (++quad == 4) {
+                o[w++] = static_cast<uint8_t>(acc >> 16);
+                o[w++] = static_cast<uint8_t>(acc >> 8);
+                o[w++] = static_cast<uint8_t>(acc);
+                acc = 0;
+                quad = 0;
+            }
+        }
+        if (quad == 2) {
+            o[w++] = static_cast<uint8_t>(acc >> 4);
+        } else if (quad == 3) {
+            o[w++] = static_cast<uint8_t>(acc >> 10);
+            o[w++] = static_cast<uint8_t>(acc >> 2);
+        }
+        out.resize(w);
+        return out;
+    }
+
+    // ---- Hex ----
+#ifdef YEN_X86_DISPATCH
+    __attribute__((target("ssse3")))
+    static size_t hexEncodeSsse3(const uint8_t* in, size_t n, char* out) {
+        const __m128i digits = _mm_loadu_si128(reinterpret_cast<const __m128i*>(hex_lower));
+        const __m128i low4 = _mm_set1_epi8(0x0F);
+        size_t i = 0;
+        for (; i + 16 <= n; i += 16, out += 32) {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+            __m128i hi = _mm_shuffle_epi8(digits, _mm_and_si128(_mm_srli_epi16(v, 4), low4));
+            __m128i lo = _mm_shuffle_epi8(digits, _mm_and_si128(v, low4));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out), _mm_unpacklo_epi8(hi, lo));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out + 16), _mm_unpackhi_epi8(hi, lo));
+        }
+        return i;
+    }
+
+    __attribute__((target("avx2")))
+    static size_t hexEncodeAvx2(const uint8_t* in, size_t n, char* out) {
+        const __m256i digits = _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(hex_lower)));
+        const __m256i low4 = _mm256_set1_epi8(0x0F);
+        size_t i = 0;
+        for (; i + 32 <= n; i += 32, out += 64) {
+            __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + i));
+            __m256i hi = _mm256_shuffle_epi8(digits, _mm256_and_si256(_mm256_srli_epi16(v, 4), low4));
+            __m256i lo = _mm256_shuffle_epi8(digits, _mm256_and_si256(v, low4));
+            __m256i a = _mm256_unpacklo_epi8(hi, lo), b = _mm256_unpackhi_epi8(hi, lo);
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(out), _mm256_permute2x128_si256(a, b, 0x20));
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + 32), _mm256_permute2x128_si256(a, b, 0x31));
+        }
+        return i;
+    }
+#endif
+
+#if defined(__SSE2__)
+    // 16 hex characters -> 8 bytes; false on a non-hex character
+    static bool hexDecodeSse2(const char* in, uint8_t* out) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in));
+        __m128i isDigit = _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8('0' - 1)), _mm_cmplt_epi8(v, _mm_set1_epi8('9' + 1)));
+        __m128i lower = _mm_or_si128(v, _mm_set1_epi8(0x20));
+        __m128i isAlpha = _mm_and_si128(_mm_cmpgt_epi8(lower, _mm_set1_epi8('a' - 1)), _mm_cmplt_epi8(lower, _mm_set1_epi8('f' + 1)));
+        if (_mm_movemask_epi8(_mm_or_si128(isDigit, isAlpha)) != 0xFFFF) return false;
+        __m128i val = _mm_or_si128(_mm_and_si128(isDigit, _mm_sub_epi8(v, _mm_set1_epi8('0'))),
+                                   _mm_and_si128(isAlpha, _mm_sub_epi8(lower, _mm_set1_epi8('a' - 10))));
+        __m128i hi = _mm_slli_epi16(_mm_and_si128(val, _mm_set1_epi16(0x00FF)), 4);
+        __m128i lo = _mm_srli_epi16(val, 8);
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(out), _mm_packus_epi16(_mm_or_si128(hi, lo), _mm_setzero_si128()));
+        return true;
+    }
+#endif
+
+    std::string hexEncode(std::string_view input) {
+        const uint8_t* in = reinterpret_cast<const uint8_t*>(input.data());
+        size_t n = input.size();
+        std::string out(n * 2, '\0');
+        size_t i = 0;
+#ifdef YEN_X86_DISPATCH
+        if (cpu.avx2) i = hexEncodeAvx2(in, n, out.data());
+        else if (cpu.ssse3) i = hexEncodeSsse3(in, n, out.data());
+#endif
+        for (; i < n; ++i) {
+            out[2 * i] = hex_lower[in[i] >> 4];
+            out[2 * i + 1] = hex_lower[in[i] & 15];
+        }
+        return out;
+    }
+
+    // A trailing odd character is ignored
+    std::string hexDecode(std::string_view input) {
+        size_t n = input.size() / 2 * 2;
+        std::string out(n / 2 + 8, '\0');
+        uint8_t* o = reinterpret_cast<uint8_t*>(out.data());
+        size_t i = 0;
+#if defined(__SSE2__)
+        for (; i + 16 <= n; i += 16, o += 8) {
+            if (!hexDecodeSse2(input.data() + i, o)) break;
+        }
+#endif
+        for (; i < n; i += 2) {
+            uint8_t hi = hex_values[static_cast<uint8_t>(input[i])], lo = hex_values[static_cast<uint8_t>(input[i + 1])];
+            if ((hi | lo) == 0xFF) throw std::runtime_error("encoding_hex_decode: invalid hex digit.");
+            *o++ = static_cast<uint8_t>(hi << 4 | lo);
+        }
+        out.resize(n / 2);
+        return out;
+    }
+
+    // ---- Percent-encoding ----
+    static bool isUnreserved(unsigned char c) {
+        return std::isalnum(c) || c == '-' || c == '_' || c == '.' || c == '~';
+    }
+
+#if defined(__SSE2__)
+    // Lanes set for RFC 3986 unreserved characters
+    static inline __m128i unreservedMask(__m128i v) {
+        __m128i digit = _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8('0' - 1)), _mm_cmplt_epi8(v, _mm_set1_epi8('9' + 1)));
+        __m128i lower = _mm_or_si128(v, _mm_set1_epi8(0x20));
+        __m128i alpha = _mm_and_si128(_mm_cmpgt_epi8(lower, _mm_set1_epi8('a' - 1)), _mm_cmplt_epi8(lower, _mm_set1_epi8('z' + 1)));
+        __m128i mark = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('-')), _mm_cmpeq_epi8(v, _mm_set1_epi8('_'))),
+                                    _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('.')), _mm_cmpeq_epi8(v, _mm_set1_epi8('~'))));
+        return _mm_or_si128(_mm_or_si128(digit, alpha), mark);
+    }
+#endif
+
+    std::string percentEncode(std::string_view input) {
+        size_t n = input.size();
+        std::string out(n * 3, '\0');
+        char* o = out.data();
+        size_t i = 0;
+        while (i < n) {
+#if defined(__SSE2__)
+            if (i + 16 <= n) {
+                __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(input.data() + i));
+                unsigned plain = ~static_cast<unsigned>(_mm_movemask_epi8(unreservedMask(v))) & 0xFFFF;
+                size_t run = plain ? static_cast<size_t>(__builtin_ctz(plain)) : 16;
+                std::memcpy(o, input.data() + i, run);
+                o += run;
+                i += run;
+                if (run == 16) continue;
+            }
+#endif
+            unsigned char c = static_cast<unsigned char>(input[i++]);
+            if (isUnreserved(c)) {
+                *o++ = static_cast<char>(c);
+            } else {
+                o[0] = '%';
+                o[1] = hex_upper[c >> 4];
+                o[2] = hex_upper[c & 15];
+                o += 3;
             }
         }
-        if (i) {
-            for (int j = i; j < 4; j++) char_array_4[j] = 0;
-            char_array_3[0] = (char_array_4[0] << 2) + ((char_array_4[1] & 0x30) >> 4);
-            char_array_3[1] = ((char_array_4[1] & 0xf) << 4) + ((char_array_4[2] & 0x3c) >> 2);
-            for (int j = 0; j < i - 1; j++) ret += static_cast<char>(char_array_3[j]);
+        out.resize(o - out.data());
+        return out;
+    }
+
+    // Decodes %XX escapes (malformed ones are kept literally) and, for form
+    // data, '+' as a space.
+    std::string percentDecode(std::string_view input, bool plusAsSpace) {
+        size_t n = input.size();
+        std::string out(n, '\0');
+        char* o = out.data();
+        size_t i = 0;
+        while (i < n) {
+#if defined(__SSE2__)
+            if (i + 16 <= n) {
+                __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(input.data() + i));
+                __m128i special = _mm_cmpeq_epi8(v, _mm_set1_epi8('%'));
+                if (plusAsSpace) special = _mm_or_si128(special, _mm_cmpeq_epi8(v, _mm_set1_epi8('+')));
+                unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(special));
+                size_t run = mask ? static_cast<size_t>(__builtin_ctz(mask)) : 16;
+                std::memcpy(o, input.data() + i, run);
+                o += run;
+                i += run;
+                if (run == 16) continue;
+            }
+#endif
+            char c = input[i];
+            if (c == '%' && i + 2 < n) {
+                uint8_t hi = hex_values[static_cast<uint8_t>(input[i + 1])];
+                uint8_t lo = hex_values[static_cast<uint8_t>(input[i + 2])];
+                if ((hi | lo) != 0xFF) {
+                    *o++ = static_cast<char>(hi << 4 | lo);
+                    i += 3;
+                    continue;
+                }
+            }
+            *o++ = (c == '+' && plusAsSpace) ? ' ' : c;
+            ++i;
         }
-        return ret;
+        out.resize(o - out.data());
+        return out;
+    }
+
+    // ---- UTF-8 validation ----
+    static bool utf8ValidScalar(const uint8_t* p, size_t n) {
+        size_t i = 0;
+        while (i < n) {
+            uint8_t c = p[i];
+            if (c < 0x80) { ++i; continue; }
+            size_t len;
+            uint32_t cp;
+            if ((c & 0xE0) == 0xC0) { len = 2; cp = c & 0x1F; }
+            else if ((c & 0xF0) == 0xE0) { len = 3; cp = c & 0x0F; }
+            else if ((c & 0xF8) == 0xF0) { len = 4; cp = c & 0x07; }
+            else return false;
+            if (i + len > n) return false;
+            for (size_t k = 1; k < len; ++k) {
+                if ((p[i + k] & 0xC0) != 0x80) return false;
+                cp = (cp << 6) | (p[i + k] & 0x3F);
+            }
+            if ((len == 2 && cp < 0x80) || (len == 3 && cp < 0x800) || (len == 4 && cp < 0x10000)) return false;
+            if (cp > 0x10FFFF || (cp >= 0xD800 && cp <= 0xDFFF)) return false;
+            i += len;
+        }
+        return true;
+    }
+
+#ifdef YEN_X86_DISPATCH
+    // Keiser & Lemire lookup validator: three nibble tables classify each
+    // (previous byte, current byte) pair, and a saturating subtract checks
+    // that 3- and 4-byte sequences get their second and third continuations.
+    enum : uint8_t {
+        U8_TOO_SHORT = 1 << 0, U8_TOO_LONG = 1 << 1, U8_OVERLONG_3 = 1 << 2, U8_TOO_LARGE = 1 << 3,
+        U8_SURROGATE = 1 << 4, U8_OVERLONG_2 = 1 << 5, U8_TOO_LARGE_1000 = 1 << 6, U8_OVERLONG_4 = 1 << 6,
+        U8_TWO_CONTS = 1 << 7, U8_CARRY = U8_TOO_SHORT | U8_TOO_LONG | U8_TWO_CONTS
+    };
+    alignas(16) static const uint8_t utf8_byte1_high[16] = {
+        U8_TOO_LONG, U8_TOO_LONG, U8_TOO_LONG, U8_TOO_LONG, U8_TOO_LONG, U8_TOO_LONG, U8_TOO_LONG, U8_TOO_LONG,
+        U8_TWO_CONTS, U8_TWO_CONTS, U8_TWO_CONTS, U8_TWO_CONTS,
+        U8_TOO_SHORT | U8_OVERLONG_2,
+        U8_TOO_SHORT,
+        U8_TOO_SHORT | U8_OVERLONG_3 | U8_SURROGATE,
+        U8_TOO_SHORT | U8_TOO_LARGE | U8_TOO_LARGE_1000 | U8_OVERLONG_4};
+    alignas(16) static const uint8_t utf8_byte1_low[16] = {
+        U8_CARRY | U8_OVERLONG_3 | U8_OVERLONG_2 | U8_OVERLONG_4,
+        U8_CARRY | U8_OVERLONG_2,
+        U8_CARRY,
+        U8_CARRY,
+        U8_CARRY | U8_TOO_LARGE,
+        U8_CARRY | U8_TOO_LARGE | U8_TOO_LARGE_1000, U8_CARRY | U8_TOO_LARGE | U8_TOO_LARGE_1000,
+        U8_CARRY | U8_TOO_LARGE | U8_TOO_LARGE_1000, U8_CARRY | U8_TOO_LARGE | U8_TOO_LARGE_1000,
+        U8_CARRY | U8_TOO_LARGE | U8_TOO_LARGE_1000, U8_CARRY | U8_TOO_LARGE | U8_TOO_LARGE_1000,
+        U8_CARRY | U8_TOO_LARGE | U8_TOO_LARGE_1000, U8_CARRY | U8_TOO_LARGE | U8_TOO_LARGE_1000,
+        U8_CARRY | U8_TOO_LARGE | U8_TOO_LARGE_1000 | U8_SURROGATE,
+        U8_CARRY | U8_TOO_LARGE | U8_TOO_LARGE_1000, U8_CARRY | U8_TOO_LARGE | U8_TOO_LARGE_1000};
+    alignas(16) static const uint8_t utf8_byte2_high[16] = {
+        U8_TOO_SHORT, U8_TOO_SHORT, U8_TOO_SHORT, U8_TOO_SHORT, U8_TOO_SHORT, U8_TOO_SHORT, U8_TOO_SHORT, U8_TOO_SHORT,
+        U8_TOO_LONG | U8_OVERLONG_2 | U8_TWO_CONTS | U8_OVERLONG_3 | U8_TOO_LARGE_1000 | U8_OVERLONG_4,
+        U8_TOO_LONG | U8_OVERLONG_2 | U8_TWO_CONTS | U8_OVERLONG_3 | U8_TOO_LARGE,
+        U8_TOO_LONG | U8_OVERLONG_2 | U8_TWO_CONTS | U8_SURROGATE | U8_TOO_LARGE,
+        U8_TOO_LONG | U8_OVERLONG_2 | U8_TWO_CONTS | U8_SURROGATE | U8_TOO_LARGE,
+        U8_TOO_SHORT, U8_TOO_SHORT, U8_TOO_SHORT, U8_TOO_SHORT};
+    // Subtracting these leaves a nonzero lane if the block ends mid-sequence
+    alignas(16) static const uint8_t utf8_incomplete[16] = {
+        0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xF0 - 1, 0xE0 - 1, 0xC0 - 1};
+
+    __attribute__((target("ssse3")))
+    static bool utf8ValidSsse3(const uint8_t* p, size_t n) {
+        const __m128i byte1High = _mm_load_si128(reinterpret_cast<const __m128i*>(utf8_byte1_high));
+        const __m128i byte1Low = _mm_load_si128(reinterpret_cast<const __m128i*>(utf8_byte1_low));
+        const __m128i byte2High = _mm_load_si128(reinterpret_cast<const __m128i*>(utf8_byte2_high));
+        const __m128i maxValue = _mm_load_si128(reinterpret_cast<const __m128i*>(utf8_incomplete));
+        const __m128i low4 = _mm_set1_epi8(0x0F);
+        __m128i prev = _mm_setzero_si128(), prevIncomplete = _mm_setzero_si128(), error = _mm_setzero_si128();
+        uint8_t tail[16];
+        for (size_t i = 0; i < n; i += 16) {
+            __m128i in;
+            if (i + 16 <= n) {
+                in = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i));
+            } else {
+                std::memset(tail, 0, sizeof(tail));   // zero padding is ASCII, so a cut-off sequence reads as too short
+                std::memcpy(tail, p + i, n - i);
+                in = _mm_loadu_si128(reinterpret_cast<const __m128i*>(tail));
+            }
+            if (_mm_movemask_epi8(in) == 0) {
+                error = _mm_or_si128(error, prevIncomplete);
+                prevIncomplete = _mm_setzero_si128();
+            } else {
+                __m128i prev1 = _mm_alignr_epi8(in, prev, 15);
+                __m128i special = _mm_and_si128(
+                    _mm_and_si128(_mm_shuffle_epi8(byte1High, _mm_and_si128(_mm_srli_epi16(prev1, 4), low4)),
+                                  _mm_shuffle_epi8(byte1Low, _mm_and_si128(prev1, low4))),
+                    _mm_shuffle_epi8(byte2High, _mm_and_si128(_mm_srli_epi16(in, 4), low4)));
+                __m128i third = _mm_subs_epu8(_mm_alignr_epi8(in, prev, 14), _mm_set1_epi8(static_cast<char>(0xE0 - 0x80)));
+                __m128i fourth = _mm_subs_epu8(_mm_alignr_epi8(in, prev, 13), _mm_set1_epi8(static_cast<char>(0xF0 - 0x80)));
+                __m128i must23 = _mm_and_si128(_mm_or_si128(third, fourth), _mm_set1_epi8(static_cast<char>(0x80)));
+                error = _mm_or_si128(error, _mm_xor_si128(must23, special));
+                prevIncomplete = _mm_subs_epu8(in, maxValue);
+            }
+            prev = in;
+        }
+        error = _mm_or_si128(error, prevIncomplete);
+        return _mm_movemask_epi8(_mm_cmpeq_epi8(error, _mm_setzero_si128())) == 0xFFFF;
+    }
+#endif
+
+    bool utf8Valid(std::string_view input) {
+        const uint8_t* p = reinterpret_cast<const uint8_t*>(input.data());
+#ifdef YEN_X86_DISPATCH
+        if (cpu.ssse3) return utf8ValidSsse3(p, input.size());
+#endif
+        return utf8ValidScalar(p, input.size());
+    }
+
+    Value base64_encode(std::vector<Value>& args) {
+        if (args.empty() || !args[0].holds_alternative<std::string>()) return std::string("");
+        return base64Encode(args[0].get<std::string>());
+    }
+
+    Value base64_decode(std::vector<Value>& args) {
+        if (args.empty() || !args[0].holds_alternative<std::string>()) return std::string("");
+        return base64Decode(args[0].get<std::string>());
     }
 
     Value hex_encode(std::vector<Value>& args) {
         if (args.empty() || !args[0].holds_alternative<std::string>()) return std::string("");
-        const std::string& input = args[0].get<std::string>();
-        std::stringstream ss;
-        ss << std::hex << std::setfill('0');
-        for (unsigned char c : input) ss << std::setw(2) << static_cast<int>(c);
-        return ss.str();
+        return hexEncode(args[0].get<std::string>());
     }
 
     Value hex_decode(std::vector<Value>& args) {
         if (args.empty() || !args[0].holds_alternative<std::string>()) return std::string("");
-        const std::string& input = args[0].get<std::string>();
-        std::string result;
-        for (size_t i = 0; i + 1 < input.size(); i += 2) {
-            std::string byte = input.substr(i, 2);
-            result += static_cast<char>(std::stoi(byte, nullptr, 16));
+        return hexDecode(args[0].get<std::string>());
+    }
+
+    Value utf8_valid(std::vector<Value>& args) {
+        if (args.empty() || !args[0].holds_alternative<std::string>()) return false;
+        return utf8Valid(args[0].get<std::string>());
+    }
+
+    void registerFunctions(std::unordered_map<std::string, Value>& globals) {
+        globals["encoding_base64_encode"] = NativeFunction{base64_encode, 1};
+        globals["encoding_base64_decode"] = NativeFunction{base64_decode, 1};
+        globals["encoding_hex_encode"] = NativeFunction{hex_encode, 1};
+        globals["encoding_hex_decode"] = NativeFunction{hex_decode, 1};
+        globals["encoding_utf8_valid"] = NativeFunction{utf8_valid, 1};
+    }
+}
+
+// ============ LOG LIBRARY ============
+namespace Log {
+    // The level check comes first, so filtered calls cost one atomic load.
+    // Arguments are rendered to text on the calling thread (values may change
+    // once the call returns); everything else — timestamps, JSON/logfmt
+    // layout, the write itself — happens in the sink. Console output is
+    // written synchronously so it stays ordered with print. File output is
+    // asynchronous by default: each thread pushes records into its own
+    // single-producer ring, and one background thread drains every ring,
+    // writes the batch with a single flush, and rotates the file by size.
+
+    enum Level { Debug = 0, Info, Warn, Error, Off };
+    enum Format { FormatText = 0, FormatJson, FormatLogfmt };
+
+    static const char* kLevelNames[] = {"debug", "info", "warn", "error"};
+    static const char* kTextTags[] = {"[DEBUG] ", "[INFO] ", "[WARN] ", "[ERROR] "};
+
+    struct Field {
+        std::string key;
+        std::string text;       // Raw for strings, JSON for everything else
+        bool isString;
+    };
+
+    struct Record {
+        int level = Info;
+        std::chrono::system_clock::time_point time;
+        std::string message;
+        std::vector<Field> fields;
+    };
+
+    // Written only by its owning thread (tail) and the drainer (head)
+    struct ThreadRing {
+        static constexpr size_t kSlots = 1024;
+        std::array<Record, kSlots> slots;
+        std::atomic<size_t> head{0};
+        std::atomic<size_t> tail{0};
+        std::atomic<bool> orphaned{false};
+    };
+
+    struct RingHolder {
+        std::shared_ptr<ThreadRing> ring;
+        ~RingHolder() { if (ring) ring->orphaned = true; }
+    };
+
+    static std::atomic<int> minLevel{Debug};
+    static std::atomic<int> format{FormatText};
+    static std::atomic<bool> async{false};
+
+    // Sink state; guarded by sinkMutex
+    static std::mutex sinkMutex;
+    static std::FILE* logFile = nullptr;
+    static std::string logPath;
+    static size_t maxBytes = 0;
+    static int maxFiles = 5;
+    static size_t fileBytes = 0;
+
+    static std::mutex ringsMutex;
+    static std::vector<std::shared_ptr<ThreadRing>> rings;
+
+    static std::mutex drainMutex;
+    static std::condition_variable drainCv;
+    static std::condition_variable flushedCv;
+    static uint64_t flushRequested = 0;
+    static uint64_t flushCompleted = 0;
+    static bool stopDrainer = false;
+    static std::atomic<bool> wakeRequested{false};
+    static std::thread drainer;
+
+    static void appendText(std::string& out, const Value& val) {
+        if (val.holds_alternative<std::string>()) out += val.get<std::string>();
+        else if (val.holds_alternative<int>() || val.holds_alternative<double>() || val.holds_alternative<float>() ||
+                 val.holds_alternative<bool>() || val.holds_alternative<std::vector<Value>>()) out += keyToString(val);
+        else Json::appendJson(out, val);
+    }
+
+    static void appendTimestamp(std::string& out, std::chrono::system_clock::time_point time) {
+        auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(time.time_since_epoch()).count();
+        time_t secs = static_cast<time_t>(ms / 1000);
+        struct tm tm;
+#ifdef _WIN32
+        gmtime_s(&tm, &secs);
+#else
+        gmtime_r(&secs, &tm);
+#endif
+        char buf[32];
+        size_t n = strftime(buf, sizeof(buf), "%Y-%m-%dT%H:%M:%S", &tm);
+        snprintf(buf + n, sizeof(buf) - n, ".%03dZ", static_cast<int>(ms % 1000));
+        out += buf;
+    }
+
+    // logfmt values are quoted only when they contain spaces, quotes or '='
+    static void appendLogfmtValue(std::string& out, const std::string& text) {
+        bool plain = !text.empty() && std::none_of(text.begin(), text.end(), [](char c) {
+            return c == ' ' || c == '"' || c == '=' || c == '\\' || static_cast<unsigned char>(c) < 0x20;
+        });
+        if (plain) out += text;
+        else Json::appendEscaped(out, text);
+    }
+
+    static void formatRecord(std::string& out, const Record& rec, int fmt) {
+        if (fmt == FormatJson) {
+            out += "{\"ts\":\"";
+            appendTimestamp(out, rec.time);
+            out += "\",\"level\":\"";
+            out += kLevelNames[rec.level];
+            out += "\",\"msg\":";
+            Json::appendEscaped(out, rec.message);
+            for (const auto& f : rec.fields) {
+                out += ',';
+                Json::appendEscaped(out, f.key);
+                out += ':';
+                if (f.isString) Json::appendEscaped(out, f.text);
+                else out += f.text;
+            }
+            out += '}';
+        } else if (fmt == FormatLogfmt) {
+            out += "ts=";
+            appendTimestamp(out, rec.time);
+            out += " level=";
+            out += kLevelNames[rec.level];
+            out += " msg=";
+            appendLogfmtValue(out, rec.message);
+            for (const auto& f : rec.fields) {
+                out += ' ';
+                out += f.key;
+                out += '=';
+                appendLogfmtValue(out, f.text);
+            }
+        } else {
+            out += kTextTags[rec.level];
+            out += rec.message;
+            for (const auto& f : rec.fields) {
+                out += ' ';
+                out += f.key;
+                out += '=';
+                out += f.text;
+            }
+        }
+        out += '\n';
+    }
+
+    // Shifts path -> path.1 -> ... -> path.<maxFiles> and starts a new file
+    static void rotate() {
+        std::fclose(logFile);
+        logFile = nullptr;
+        if (maxFiles > 0) {
+            std::remove((logPath + "." + std::to_string(maxFiles)).c_str());
+            for (int i = maxFiles - 1; i >= 1; --i)
+                std::rename((logPath + "." + std::to_string(i)).c_str(), (logPath + "." + std::to_string(i + 1)).c_str());
+            std::rename(logPath.c_str(), (logPath + ".1").c_str());
+        }
+        logFile = std::fopen(logPath.c_str(), "w");
+        fileBytes = 0;
+    }
+
+    // Caller holds sinkMutex. Console errors go to stderr, after flushing
+    // stdout so the two streams stay in order.
+    static void writeLine(const std::string& text, int level) {
+        if (logFile) {
+            std::fwrite(text.data(), 1, text.size(), logFile);
+            fileBytes += text.size();
+            if (maxBytes > 0 && fileBytes >= maxBytes) rotate();
+            return;
+        }
+        if (level == Error) {
+            std::fflush(stdout);
+            std::fwrite(text.data(), 1, text.size(), stderr);
+        } else {
+            std::fwrite(text.data(), 1, text.size(), stdout);
+        }
+    }
+
+    // Moves everything queued so far into out; drops rings whose thread exited
+    static void collect(std::vector<Record>& out) {
+        std::lock_guard<std::mutex> lock(ringsMutex);
+        for (size_t i = 0; i < rings.size();) {
+            ThreadRing& ring = *rings[i];
+            bool orphaned = ring.orphaned.load(std::memory_order_acquire);
+            size_t head = ring.head.load(std::memory_order_relaxed);
+            size_t tail = ring.tail.load(std::memory_order_acquire);
+            for (; head != tail; ++head) out.push_back(std::move(ring.slots[head % ThreadRing::kSlots]));
+            ring.head.store(head, std::memory_order_release);
+            if (orphaned) {
+                rings[i] = std::move(rings.back());
+                rings.pop_back();
+            } else {
+                ++i;
+            }
+        }
+    }
+
+    static void drainOnce(std::vector<Record>& batch, std::string& text) {
+        batch.clear();
+        collect(batch);
+        if (batch.empty()) return;
+        // Rings are drained one after another; restore cross-thread order
+        std::stable_sort(batch.begin(), batch.end(), [](const Record& a, const Record& b) { return a.time < b.time; });
+        int fmt = format.load();
+        std::lock_guard<std::mutex> lock(sinkMutex);
+        for (const auto& rec : batch) {
+            text.clear();
+            formatRecord(text, rec, fmt);
+            writeLine(text, rec.level);
+        }
+        std::fflush(logFile ? logFile : stdout);
+    }
+
+    static void drainLoop() {
+        std::vector<Record> batch;
+        std::string text;
+        while (true) {
+            uint64_t target;
+            bool stopping;
+            {
+                std::unique_lock<std::mutex> lock(drainMutex);
+                drainCv.wait_for(lock, std::chrono::milliseconds(50), [] {
+                    return stopDrainer || flushRequested != flushCompleted || wakeRequested.load();
+                });
+                target = flushRequested;
+                stopping = stopDrainer;
+                wakeRequested = false;
+            }
+            drainOnce(batch, text);
+            {
+                std::lock_guard<std::mutex> lock(drainMutex);
+                flushCompleted = target;
+            }
+            flushedCv.notify_all();
+            if (stopping) return;
+        }
+    }
+
+    // Drains and stops the background thread at exit
+    struct DrainerGuard {
+        ~DrainerGuard() {
+            if (!drainer.joinable()) return;
+            {
+                std::lock_guard<std::mutex> lock(drainMutex);
+                stopDrainer = true;
+            }
+            drainCv.notify_all();
+            drainer.join();
+            std::lock_guard<std::mutex> lock(sinkMutex);
+            if (logFile) std::fclose(logFile);
+            logFile = nullptr;
+        }
+    };
+    static DrainerGuard drainerGuard;
+
+    static void startDrainer() {
+        std::lock_guard<std::mutex> lock(drainMutex);
+        if (!drainer.joinable()) drainer = std::thread(drainLoop);
+    }
+
+    static void flushAll() {
+        if (drainer.joinable()) {
+            std::unique_lock<std::mutex> lock(drainMutex);
+            uint64_t target = ++flushRequested;
+            drainCv.notify_all();
+            flushedCv.wait(lock, [&] { return flushCompleted >= target; });
         }
-        return result;
+        std::lock_guard<std::mutex> lock(sinkMutex);
+        std::fflush(logFile ? logFile : stdout);
     }
 
-    void registerFunctions(std::unordered_map<std::string, Value>& globals) {
-        globals["encoding_base64_encode"] = NativeFunction{base64_encode, 1};
-        globals["encoding_base64_decode"] = NativeFunction{base64_decode, 1};
-        globals["encoding_hex_encode"] = NativeFunction{hex_encode, 1};
-        globals["encoding_hex_decode"] = NativeFunction{hex_decode, 1};
+    // Taking drainMutex means the drainer is either waiting (and sees the
+    // flag on wakeup) or busy (and sees it before waiting again)
+    static void wakeDrainer() {
+        if (wakeRequested.exchange(true)) return;
+        std::lock_guard<std::mutex> lock(drainMutex);
+        drainCv.notify_one();
     }
-}
 
-// ============ LOG LIBRARY ============
-namespace Log {
-    Value info(std::vector<Value>& args) {
-        std::cout << "[INFO] ";
-        for (const auto& arg : args) {
-            if (arg.holds_alternative<std::string>()) std::cout << arg.get<std::string>();
-            else if (arg.holds_alternative<int>()) std::cout << arg.get<int>();
-            else if (arg.holds_alternative<double>()) std::cout << arg.get<double>();
-            else if (arg.holds_alternative<bool>()) std::cout << (arg.get<bool>() ? "true" : "false");
+    static void enqueue(Record&& rec) {
+        thread_local RingHolder holder;
+        if (!holder.ring) {
+            holder.ring = std::make_shared<ThreadRing>();
+            std::lock_guard<std::mutex> lock(ringsMutex);
+            rings.push_back(holder.ring);
+        }
+        ThreadRing& ring = *holder.ring;
+        size_t tail = ring.tail.load(std::memory_order_relaxed);
+        // Full: wake the drainer and wait for room rather than drop records
+        while (tail - ring.head.load(std::memory_order_acquire) >= ThreadRing::kSlots) {
+            wakeDrainer();
+            std::this_thread::yield();
+        }
+        ring.slots[tail % ThreadRing::kSlots] = std::move(rec);
+        ring.tail.store(tail + 1, std::memory_order_release);
+        if (tail - ring.head.load(std::memory_order_relaxed) >= ThreadRing::kSlots / 4) wakeDrainer();
+    }
+
+    // log_<level>(parts...[, fields]): parts are concatenated into the
+    // message; a trailing map supplies structured fields
+    static Value logAt(int level, std::vector<Value>& args) {
+        if (level < minLevel.load(std::memory_order_relaxed)) return Value();
+        Record rec;
+        rec.level = level;
+        rec.time = std::chrono::system_clock::now();
+        size_t parts = args.size();
+        if (parts > 1 && args.back().holds_alternative<MapValue>()) {
+            --parts;
+            for (const auto& [key, val] : args.back().get<MapValue>()) {
+                Field f{keyToString(key), std::string(), val.holds_alternative<std::string>()};
+                if (f.isString) f.text = val.get<std::string>();
+                else Json::appendJson(f.text, val);
+                rec.fields.push_back(std::move(f));
+            }
+        }
+        for (size_t i = 0; i < parts; ++i) appendText(rec.message, args[i]);
+
+        if (async.load(std::memory_order_relaxed)) {
+            enqueue(std::move(rec));
+            return Value();
         }
-        std::cout << std::endl;
+        thread_local std::string text;
+        text.clear();
+        formatRecord(text, rec, format.load(std::memory_order_relaxed));
+        std::lock_guard<std::mutex> lock(sinkMutex);
+        writeLine(text, level);
         return Value();
     }
 
-    Value warn(std::vector<Value>& args) {
-        std::cout << "[WARN] ";
-        for (const auto& arg : args) {
-            if (arg.holds_alternative<std::string>()) std::cout << arg.get<std::string>();
-            else if (arg.holds_alternative<int>()) std::cout << arg.get<int>();
-            else if (arg.holds_alternative<double>()) std::cout << arg.get<double>();
-            else if (arg.holds_alternative<bool>()) std::cout << (arg.get<bool>() ? "true" : "false");
-        }
-        std::cout << std::endl;
+    Value debug(std::vector<Value>& args) { return logAt(Debug, args); }
+    Value info(std::vector<Value>& args) { return logAt(Info, args); }
+    Value warn(std::vector<Value>& args) { return logAt(Warn, args); }
+    Value error(std::vector<Value>& args) { return logAt(Error, args); }
+
+    static int parseLevel(const Value& v, const char* fn) {
+        std::string name = v.holds_alternative<std::string>() ? v.get<std::string>() : "";
+        for (int i = Debug; i <= Error; ++i) if (name == kLevelNames[i]) return i;
+        if (name == "off") return Off;
+        throw std::runtime_error(std::string(fn) + ": level must be debug, info, warn, error or off.");
+    }
+
+    Value set_level(std::vector<Value>& args) {
+        minLevel = parseLevel(args[0], "log_set_level");
         return Value();
     }
 
-    Value error(std::vector<Value>& args) {
-        std::cerr << "[ERROR] ";
-        for (const auto& arg : args) {
-            if (arg.holds_alternative<std::string>()) std::cerr << arg.get<std::string>();
-            else if (arg.holds_alternative<int>()) std::cerr << arg.get<int>();
-            else if (arg.holds_alternative<double>()) std::cerr << arg.get<double>();
-            else if (arg.holds_alternative<bool>()) std::cerr << (arg.get<bool>() ? "true" : "false");
+    Value get_level(std::vector<Value>&) {
+        int level = minLevel.load();
+        return std::string(level == Off ? "off" : kLevelNames[level]);
+    }
+
+    // log_configure({"level", "format": "text"|"json"|"logfmt", "output":
+    // "console"|path, "max_bytes", "max_files", "async"})
+    Value configure(std::vector<Value>& args) {
+        if (args.empty() || !args[0].holds_alternative<MapValue>())
+            throw std::runtime_error("log_configure: expected an options map.");
+        const auto& opts = args[0].get<MapValue>();
+        auto opt = [&](const char* key) -> const Value* {
+            auto it = opts.find(std::string(key));
+            return it == opts.end() ? nullptr : &it->second;
+        };
+
+        int newFormat = format.load();
+        if (const Value* v = opt("format")) {
+            std::string name = v->holds_alternative<std::string>() ? v->get<std::string>() : "";
+            if (name == "text") newFormat = FormatText;
+            else if (name == "json") newFormat = FormatJson;
+            else if (name == "logfmt") newFormat = FormatLogfmt;
+            else throw std::runtime_error("log_configure: format must be text, json or logfmt.");
         }
-        std::cerr << std::endl;
+        int newLevel = opt("level") ? parseLevel(*opt("level"), "log_configure") : minLevel.load();
+
+        // Queued records belong to the old sink
+        flushAll();
+        {
+            std::lock_guard<std::mutex> lock(sinkMutex);
+            if (const Value* v = opt("output")) {
+                if (!v->holds_alternative<std::string>()) throw std::runtime_error("log_configure: output must be \"console\" or a file path.");
+                std::string output = v->get<std::string>();
+                std::FILE* file = nullptr;
+                if (output != "console") {
+                    file = std::fopen(output.c_str(), "a");
+                    if (!file) throw std::runtime_error("log_configure: cannot open '" + output + "'.");
+                }
+                if (logFile) std::fclose(logFile);
+                logFile = file;
+                logPath = file ? output : "";
+                fileBytes = 0;
+                if (file) {
+                    std::fseek(file, 0, SEEK_END);
+                    long size = std::ftell(file);
+                    if (size > 0) fileBytes = static_cast<size_t>(size);
+                }
+                // Files default to asynchronous writes, the console to synchronous
+                async = file != nullptr;
+            }
+            if (const Value* v = opt("max_bytes")) maxBytes = static_cast<size_t>(std::max(0.0, toDouble(*v)));
+            if (const Value* v = opt("max_files")) maxFiles = std::max(0, toInt(*v));
+            if (const Value* v = opt("async")) async = v->holds_alternative<bool>() && v->get<bool>();
+        }
+        format = newFormat;
+        minLevel = newLevel;
+        if (async) startDrainer();
         return Value();
     }
 
-    Value debug(std::vector<Value>& args) {
-        std::cout << "[DEBUG] ";
-        for (const auto& arg : args) {
-            if (arg.holds_alternative<std::string>()) std::cout << arg.get<std::string>();
-            else if (arg.holds_alternative<int>()) std::cout << arg.get<int>();
-            else if (arg.holds_alternative<double>()) std::cout << arg.get<double>();
-            else if (arg.holds_alternative<bool>()) std::cout << (arg.get<bool>() ? "true" : "false");
-        }
-        std::cout << std::endl;
+    // log_flush(): blocks until every record logged so far has been written
+    Value flush(std::vector<Value>&) {
+        flushAll();
         return Value();
     }
 
     void registerFunctions(std::unordered_map<std::string, Value>& globals) {
-        globals["log_info"] = NativeFunction{info, 1};
-        globals["log_warn"] = NativeFunction{warn, 1};
-        globals["log_error"] = NativeFunction{error, 1};
-        globals["log_debug"] = NativeFunction{debug, 1};
+        globals["log_info"] = NativeFunction{info, -1};
+        globals["log_warn"] = NativeFunction{warn, -1};
+        globals["log_error"] = NativeFunction{error, -1};
+        globals["log_debug"] = NativeFunction{debug, -1};
+        globals["log_set_level"] = NativeFunction{set_level, 1};
+        globals["log_level"] = NativeFunction{get_level, 0};
+        globals["log_configure"] = NativeFunction{configure, 1};
+        globals["log_flush"] = NativeFunction{flush, 0};
     }
 }
 
@@ -1672,6 +5209,7 @@ namespace Env {
 namespace Process {
     Value exec(std::vector<Value>& args) {
         if (args.empty() || !args[0].holds_alternative<std::string>()) return -1;
+        Console::flush();
         return system(args[0].get<std::string>().c_str());
     }
 
@@ -1679,6 +5217,7 @@ namespace Process {
         if (args.empty() || !args[0].holds_alternative<std::string>()) return std::string("");
         std::string command = args[0].get<std::string>();
         std::string result;
+        Console::flush();
         FILE* pipe = popen(command.c_str(), "r");
         if (!pipe) return std::string("");
         char buffer[256];
@@ -1693,6 +5232,7 @@ namespace Process {
         for (size_t i = 1; i < args.size(); ++i) {
             if (args[i].holds_alternative<std::string>()) command += " " + args[i].get<std::string>();
         }
+        Console::flush();
         return system(command.c_str());
     }
 
@@ -1795,85 +5335,708 @@ namespace Platform {
 
 // ============ REGEX LIBRARY ============
 namespace Regex {
+    // ---- Linear-time engine ----
+    //
+    // Patterns in the common ECMAScript subset (literals, classes, escapes,
+    // anchors, word boundaries, groups, alternation, greedy and lazy
+    // quantifiers) compile to a small program run by a Pike VM: all threads
+    // advance in lock-step over the input, so matching is O(pattern * input)
+    // with no backtracking. Thread order encodes priority, which reproduces
+    // the leftmost-first submatches std::regex would report. Patterns outside
+    // the subset (backreferences, lookaround, POSIX classes, \u escapes) fall
+    // back to std::regex.
+
+    struct Unsupported {};
+
+    enum class Op : uint8_t { Char, Any, Class, Split, Jmp, Save, Match, Bol, Eol, WordB, NotWordB };
+
+    struct Inst {
+        Op op;
+        unsigned char c = 0;
+        int x = 0;  // Split: preferred branch, Jmp: target, Save: slot, Class: class index
+        int y = 0;  // Split: other branch
+    };
+
+    struct Program {
+        std::vector<Inst> code;
+        std::vector<std::array<bool, 256>> classes;
+        size_t groups = 1;
+        bool icase = false;
+        std::string prefix;      // Literal every match starts with (search skips ahead to it)
+        bool anchored = false;   // Starts with ^
+    };
+
+    static constexpr size_t kMaxProgram = 10000;
+
+    static bool isWordChar(unsigned char c) { return std::isalnum(c) || c == '_'; }
+
+    // Pattern AST, compiled to Program by emit()
+    struct Node {
+        enum Kind { Char, Any, Class, Cat, Alt, Repeat, Group, Bol, Eol, WordB, NotWordB } kind;
+        unsigned char c = 0;
+        int cls = 0;
+        int min = 0, max = 0;  // Repeat; max -1 = unbounded
+        bool greedy = true;
+        int cap = -1;          // Group; -1 = non-capturing
+        std::vector<std::unique_ptr<Node>> kids;
+    };
+
+    struct PatternParser {
+        const std::string& s;
+        size_t pos = 0;
+        Program& prog;
+
+        PatternParser(const std::string& pattern, Program& p) : s(pattern), prog(p) {}
+
+        bool more() const { return pos < s.size(); }
+
+        std::unique_ptr<Node> make(Node::Kind kind) {
+            auto n = std::make_unique<Node>();
+            n->kind = kind;
+            return n;
+        }
+
+        int addClass(const std::array<bool, 256>& set) {
+            prog.classes.push_back(set);
+            return static_cast<int>(prog.classes.size() - 1);
+        }
+
+        static void addNamed(std::array<bool, 256>& set, char name) {
+            for (int ch = 0; ch < 256; ++ch) {
+                bool in = false;
+                switch (std::tolower(name)) {
+                    case 'd': in = ch >= '0' && ch <= '9'; break;
+                    case 'w': in = isWordChar(static_cast<unsigned char>(ch)); break;
+                    case 's': in = ch == ' ' || (ch >= '\t' && ch <= '\r'); break;
+                }
+                if (std::isupper(name)) in = !in;
+                if (in) set[ch] = true;
+            }
+        }
+
+        int hexDigit(char h) {
+            if (h >= '0' && h <= '9') return h - '0';
+            if (h >= 'a' && h <= 'f') return h - 'a' + 10;
+            if (h >= 'A' && h <= 'F') return h - 'A' + 10;
+            throw Unsupported{};
+        }
+
+        // Single-character escapes shared by atoms and classes; -1 if not one
+        int charEscape(char e) {
+            switch (e) {
+                case 'n': return '\n';
+                case 'r': return '\r';
+                case 't': return '\t';
+                case 'f': return '\f';
+                case 'v': return '\v';
+                case '0': return '\0';
+                case 'x': {
+                    if (pos + 2 > s.size()) throw Unsupported{};
+                    int v = hexDigit(s[pos]) * 16 + hexDigit(s[pos + 1]);
+                    pos += 2;
+                    return v;
+                }
+                default:
+                    if (std::isalnum(static_cast<unsigned char>(e))) throw Unsupported{};  // \u, \c, \k, backrefs...
+                    return static_cast<unsigned char>(e);
+            }
+        }
+
+        std::unique_ptr<Node> parseClass() {
+            std::array<bool, 256> set{};
+            bool negate = false;
+            if (more() && s[pos] == '^') { negate = true; ++pos; }
+            if (more() && s[pos] == ']') throw Unsupported{};
+            while (true) {
+                if (!more()) throw Unsupported{};
+                char ch = s[pos++];
+                if (ch == ']') break;
+                if (ch == '[' && more() && (s[pos] == ':' || s[pos] == '=' || s[pos] == '.')) throw Unsupported{};
+                int lo;
+                if (ch == '\\') {
+                    if (!more()) throw Unsupported{};
+                    char e = s[pos++];
+                    if (std::strchr("dDwWsS", e)) { addNamed(set, e); continue; }
+                    lo = e == 'b' ? '\b' : charEscape(e);
+                } else {
+                    lo = static_cast<unsigned char>(ch);
+                }
+                int hi = lo;
+                if (pos + 1 < s.size() && s[pos] == '-' && s[pos + 1] != ']') {
+                    ++pos;
+                    char h = s[pos++];
+                    if (h == '\\') {
+                        if (!more()) throw Unsupported{};
+                        char e = s[pos++];
+                        if (std::strchr("dDwWsS", e)) throw Unsupported{};
+                        hi = e == 'b' ? '\b' : charEscape(e);
+                    } else {
+                        hi = static_cast<unsigned char>(h);
+                    }
+                    if (hi < lo) throw Unsupported{};
+                }
+                for (int v = lo; v <= hi; ++v) set[v] = true;
+            }
+            if (prog.icase) {
+                for (int v = 0; v < 256; ++v) {
+                    if (set[v]) { set[std::tolower(v)] = true; set[std::toupper(v)] = true; }
+                }
+            }
+            if (negate) for (auto& b : set) b = !b;
+            auto n = make(Node::Class);
+            n->cls = addClass(set);
+            return n;
+        }
+
+        std::unique_ptr<Node> parseAtom() {
+            char ch = s[pos++];
+            switch (ch) {
+                case '.': return make(Node::Any);
+                case '^': return make(Node::Bol);
+                case '$': return make(Node::Eol);
+                case '[': return parseClass();
+                case '(': {
+                    auto g = make(Node::Group);
+                    if (more() && s[pos] == '?') {
+                        if (pos + 1 < s.size() && s[pos + 1] == ':') pos += 2;
+                        else throw Unsupported{};  // Lookaround and named groups
+                    } else {
+                        g->cap = static_cast<int>(prog.groups++);
+                    }
+                    g->kids.push_back(parseAlt());
+                    if (!more() || s[pos] != ')') throw Unsupported{};
+                    ++pos;
+                    return g;
+                }
+                case '\\': {
+                    if (!more()) throw Unsupported{};
+                    char e = s[pos++];
+                    if (e == 'b') return make(Node::WordB);
+                    if (e == 'B') return make(Node::NotWordB);
+                    if (std::strchr("dDwWsS", e)) {
+                        std::array<bool, 256> set{};
+                        addNamed(set, e);
+                        auto n = make(Node::Class);
+                        n->cls = addClass(set);
+                        return n;
+                    }
+                    auto n = make(Node::Char);
+                    n->c = static_cast<unsigned char>(charEscape(e));
+                    return n;
+                }
+                case ')': case '*': case '+': case '?': case '{': case '}': case ']': case '|':
+                    throw Unsupported{};
+                default: {
+                    auto n = make(Node::Char);
+                    n->c = static_cast<unsigned char>(ch);
+                    return n;
+                }
+            }
+        }
+
+        int parseInt() {
+            size_t start = pos;
+            int v = 0;
+            while (more() && std::isdigit(static_cast<unsigned char>(s[pos]))) {
+                v = v * 10 + (s[pos++] - '0');
+                if (v > 1000) throw Unsupported{};
+            }
+            if (pos == start) throw Unsupported{};
+            return v;
+        }
+
+        std::unique_ptr<Node> parseRepeat() {
+            auto atom = parseAtom();
+            while (more() && std::strchr("*+?{", s[pos])) {
+                if (atom->kind == Node::Bol || atom->kind == Node::Eol ||
+                    atom->kind == Node::WordB || atom->kind == Node::NotWordB) throw Unsupported{};
+                int min = 0, max = -1;
+                char q = s[pos++];
+                if (q == '+') min = 1;
+                else if (q == '?') max = 1;
+                else if (q == '{') {
+                    min = max = parseInt();
+                    if (more() && s[pos] == ',') {
+                        ++pos;
+                        max = more() && s[pos] == '}' ? -1 : parseInt();
+                    }
+                    if (!more() || s[pos] != '}' || (max >= 0 && max < min)) throw Unsupported{};
+                    ++pos;
+                }
+                auto rep = make(Node::Repeat);
+                rep->min = min;
+                rep->max = max;
+                if (more() && s[pos] == '?') { rep->greedy = false; ++pos; }
+                rep->kids.push_back(std::move(atom));
+                atom = std::move(rep);
+            }
+            return atom;
+        }
+
+        std::unique_ptr<Node> parseCat() {
+            auto cat = make(Node::Cat);
+            while (more() && s[pos] != '|' && s[pos] != ')') cat->kids.push_back(parseRepeat());
+            return cat;
+        }
+
+        std::unique_ptr<Node> parseAlt() {
+            auto first = parseCat();
+            if (!more() || s[pos] != '|') return first;
+            auto alt = make(Node::Alt);
+            alt->kids.push_back(std::move(first));
+            while (more() && s[pos] == '|') {
+                ++pos;
+                alt->kids.push_back(parseCat());
+            }
+            return alt;
+        }
+    };
+
+    static void emit(Program& prog, const Node& n);
+
+    static int emitInst(Program& prog, Inst inst) {
+        if (prog.code.size() >= kMaxProgram) throw Unsupported{};
+        prog.code.push_back(inst);
+        return static_cast<int>(prog.code.size() - 1);
+    }
+
+    // Optional copy of n: Split(body, skip), preferring body when greedy
+    static int emitOptional(Program& prog, const Node& n, bool greedy) {
+        int split = emitInst(prog, {Op::Split});
+        emit(prog, n);
+        int next = static_cast<int>(prog.code.size());
+        prog.code[split].x = greedy ? split + 1 : next;
+        prog.code[split].y = greedy ? next : split + 1;
+        return split;
+    }
+
+    static void emit(Program& prog, const Node& n) {
+        switch (n.kind) {
+            case Node::Char: {
+                unsigned char c = prog.icase ? static_cast<unsigned char>(std::tolower(n.c)) : n.c;
+                emitInst(prog, {Op::Char, c});
+                break;
+            }
+            case Node::Any: emitInst(prog, {Op::Any}); break;
+            case Node::Class: emitInst(prog, {Op::Class, 0, n.cls}); break;
+            case Node::Bol: emitInst(prog, {Op::Bol}); break;
+            case Node::Eol: emitInst(prog, {Op::Eol}); break;
+            case Node::WordB: emitInst(prog, {Op::WordB}); break;
+            case Node::NotWordB: emitInst(prog, {Op::NotWordB}); break;
+            case Node::Cat:
+                for (const auto& k : n.kids) emit(prog, *k);
+                break;
+            case Node::Group:
+                if (n.cap >= 0) emitInst(prog, {Op::Save, 0, n.cap * 2});
+                emit(prog, *n.kids[0]);
+                if (n.cap >= 0) emitInst(prog, {Op::Save, 0, n.cap * 2 + 1});
+                break;
+            case Node::Alt: {
+                std::vector<int> jumps;
+                for (size_t i = 0; i < n.kids.size(); ++i) {
+                    if (i + 1 < n.kids.size()) {
+                        int split = emitInst(prog, {Op::Split});
+                        prog.code[split].x = split + 1;
+                        emit(prog, *n.kids[i]);
+                        jumps.push_back(emitInst(prog, {Op::Jmp}));
+                        prog.code[split].y = static_cast<int>(prog.code.size());
+                    } else {
+                        emit(prog, *n.kids[i]);
+                    }
+                }
+                for (int j : jumps) prog.code[j].x = static_cast<int>(prog.code.size());
+                break;
+            }
+            case Node::Repeat: {
+                const Node& body = *n.kids[0];
+                for (int i = 0; i < n.min; ++i) emit(prog, body);
+                if (n.max < 0) {
+                    // L: Split(body, out); body; Jmp L
+                    int split = emitOptional(prog, body, n.greedy);
+                    int jmp = emitInst(prog, {Op::Jmp, 0, split});
+                    int out = jmp + 1;
+                    if (n.greedy) prog.code[split].y = out; else prog.code[split].x = out;
+                } else {
+                    // Nested optionals: any skipped copy skips the rest too
+                    std::vector<int> splits;
+                    for (int i = n.min; i < n.max; ++i) splits.push_back(emitOptional(prog, body, n.greedy));
+                    int out = static_cast<int>(prog.code.size());
+                    for (int sp : splits) {
+                        if (n.greedy) prog.code[sp].y = out; else prog.code[sp].x = out;
+                    }
+                }
+                break;
+            }
+        }
+    }
+
+    static std::unique_ptr<Program> compileProgram(const std::string& pattern, bool icase) {
+        auto prog = std::make_unique<Program>();
+        prog->icase = icase;
+        PatternParser parser(pattern, *prog);
+        auto root = parser.parseAlt();
+        if (parser.more()) throw Unsupported{};  // Unbalanced ')'
+        emitInst(*prog, {Op::Save, 0, 0});
+        emit(*prog, *root);
+        emitInst(*prog, {Op::Save, 0, 1});
+        emitInst(*prog, {Op::Match});
+
+        // Literal prefix: straight-line Char instructions after the opening Save
+        size_t pc = 1;
+        if (prog->code[pc].op == Op::Bol) prog->anchored = true;
+        while (!icase && pc < prog->code.size() && prog->code[pc].op == Op::Char) prog->prefix += static_cast<char>(prog->code[pc++].c);
+        return prog;
+    }
+
+    // Per-thread VM scratch space, reused across calls
+    struct ThreadList {
+        std::vector<int> pcs;
+        std::vector<int> caps;        // ncap slots per entry
+        std::vector<uint32_t> mark;   // Generation each pc was last added in
+        uint32_t gen = 0;
+    };
+
+    struct VM {
+        const Program& prog;
+        std::string_view in;
+        size_t ncap;
+        bool full;
+
+        bool charMatches(const Inst& inst, unsigned char ch) const {
+            switch (inst.op) {
+                case Op::Char: return (prog.icase ? static_cast<unsigned char>(std::tolower(ch)) : ch) == inst.c;
+                case Op::Any: return ch != '\n' && ch != '\r';
+                case Op::Class: return prog.classes[inst.x][ch];
+                default: return false;
+            }
+        }
+
+        bool wordAt(size_t i) const { return i < in.size() && isWordChar(static_cast<unsigned char>(in[i])); }
+
+        // Follows empty transitions from pc at position sp, appending consuming
+        // instructions (and Match) to list in priority order
+        void addThread(ThreadList& list, int pc, int* caps, size_t sp) {
+            if (list.mark[pc] == list.gen) return;
+            list.mark[pc] = list.gen;
+            const Inst& inst = prog.code[pc];
+            switch (inst.op) {
+                case Op::Jmp: addThread(list, inst.x, caps, sp); return;
+                case Op::Split:
+                    addThread(list, inst.x, caps, sp);
+                    addThread(list, inst.y, caps, sp);
+                    return;
+                case Op::Save: {
+                    int old = caps[inst.x];
+                    caps[inst.x] = static_cast<int>(sp);
+                    addThread(list, pc + 1, caps, sp);
+                    caps[inst.x] = old;
+                    return;
+                }
+                case Op::Bol: if (sp == 0) addThread(list, pc + 1, caps, sp); return;
+                case Op::Eol: if (sp == in.size()) addThread(list, pc + 1, caps, sp); return;
+                case Op::WordB:
+                case Op::NotWordB: {
+                    bool boundary = (sp > 0 && wordAt(sp - 1)) != wordAt(sp);
+                    if (boundary == (inst.op == Op::WordB)) addThread(list, pc + 1, caps, sp);
+                    return;
+                }
+                default:
+                    list.pcs.push_back(pc);
+                    list.caps.insert(list.caps.end(), caps, caps + ncap);
+                    return;
+            }
+        }
+
+        bool run(size_t start, std::vector<int>& out) {
+            thread_local ThreadList lists[2];
+            thread_local std::vector<int> scratch;
+            ThreadList* clist = &lists[0];
+            ThreadList* nlist = &lists[1];
+            for (ThreadList* l : {clist, nlist}) {
+                l->pcs.clear();
+                l->caps.clear();
+                if (l->mark.size() < prog.code.size()) l->mark.assign(prog.code.size(), 0);
+                if (++l->gen == 0) { std::fill(l->mark.begin(), l->mark.end(), 0); l->gen = 1; }
+            }
+            scratch.assign(ncap, -1);
+            bool matched = false;
+            bool canStart = true;
+
+            for (size_t sp = start;; ++sp) {
+                if (!matched && canStart) {
+                    if (clist->pcs.empty() && !full && !prog.prefix.empty()) {
+                        size_t next = in.find(prog.prefix, sp);
+                        if (next == std::string_view::npos) break;
+                        sp = next;
+                    }
+                    std::fill(scratch.begin(), scratch.end(), -1);
+                    addThread(*clist, 0, scratch.data(), sp);
+                    if (full || prog.anchored) canStart = false;
+                }
+                if (clist->pcs.empty() && (matched || !canStart)) break;
+
+                unsigned char ch = sp < in.size() ? static_cast<unsigned char>(in[sp]) : 0;
+                for (size_t i = 0; i < clist->pcs.size(); ++i) {
+                    const Inst& inst = prog.code[clist->pcs[i]];
+                    int* caps = &clist->caps[i * ncap];
+                    if (inst.op == Op::Match) {
+                        if (full && sp != in.size()) continue;
+                        out.assign(caps, caps + ncap);
+                        matched = true;
+                        break;  // Lower-priority threads lose
+                    }
+                    if (sp < in.size() && charMatches(inst, ch)) addThread(*nlist, clist->pcs[i] + 1, caps, sp + 1);
+                }
+                if (sp >= in.size()) break;
+                std::swap(clist, nlist);
+                nlist->pcs.clear();
+                nlist->caps.clear();
+                if (++nlist->gen == 0) { std::fill(nlist->mark.begin(), nlist->mark.end(), 0); nlist->gen = 1; }
+            }
+            return matched;
+        }
+    };
+
+    // A compiled pattern: a VM program, or std::regex for unsupported syntax
+    struct Compiled {
+        std::unique_ptr<Program> program;
+        std::unique_ptr<std::regex> fallback;
+        size_t groups = 1;
+
+        // Finds a match at or after start (anywhere if !full; the whole input if full).
+        // caps receives 2 * groups offsets, -1 for groups that did not take part.
+        bool exec(std::string_view in, size_t start, bool full, std::vector<int>& caps) const {
+            if (program) {
+                VM vm{*program, in, groups * 2, full};
+                return vm.run(start, caps);
+            }
+            std::cmatch m;
+            const char* b = in.data() + start;
+            const char* e = in.data() + in.size();
+            bool ok = full ? std::regex_match(b, e, m, *fallback)
+                           : std::regex_search(b, e, m, *fallback, start > 0 ? std::regex_constants::match_prev_avail
+                                                                              : std::regex_constants::match_default);
+            if (!ok) return false;
+            caps.assign(groups * 2, -1);
+            for (size_t g = 0; g < m.size() && g < groups; ++g) {
+                if (!m[g].matched) continue;
+                caps[g * 2] = static_cast<int>(m[g].first - in.data());
+                caps[g * 2 + 1] = static_cast<int>(m[g].second - in.data());
+            }
+            return true;
+        }
+    };
+
+    static std::shared_ptr<const Compiled> compile(const std::string& pattern, bool icase) {
+        auto c = std::make_shared<Compiled>();
+        try {
+            c->program = compileProgram(pattern, icase);
+            c->groups = c->program->groups;
+        } catch (const Unsupported&) {
+            auto flags = std::regex_constants::ECMAScript;
+            if (icase) flags |= std::regex_constants::icase;
+            c->fallback = std::make_unique<std::regex>(pattern, flags);  // Throws std::regex_error if invalid
+            c->groups = c->fallback->mark_count() + 1;
+        }
+        return c;
+    }
+
+    // LRU cache for the string-pattern API
+    static constexpr size_t kCacheSize = 128;
+    static std::mutex cacheMutex;
+    static std::list<std::pair<std::string, std::shared_ptr<const Compiled>>> cacheOrder;
+    static std::unordered_map<std::string, decltype(cacheOrder)::iterator> cacheIndex;
+
+    static std::shared_ptr<const Compiled> cached(const std::string& pattern) {
+        {
+            std::lock_guard<std::mutex> lock(cacheMutex);
+            auto it = cacheIndex.find(pattern);
+            if (it != cacheIndex.end()) {
+                cacheOrder.splice(cacheOrder.begin(), cacheOrder, it->second);
+                return it->second->second;
+            }
+        }
+        auto c = compile(pattern, false);
+        std::lock_guard<std::mutex> lock(cacheMutex);
+        if (cacheIndex.count(pattern)) return c;
+        cacheOrder.emplace_front(pattern, c);
+        cacheIndex[pattern] = cacheOrder.begin();
+        if (cacheOrder.size() > kCacheSize) {
+            cacheIndex.erase(cacheOrder.back().first);
+            cacheOrder.pop_back();
+        }
+        return c;
+    }
+
+    // Handles from regex_compile
+    static std::mutex registryMutex;
+    static std::unordered_map<int, std::shared_ptr<const Compiled>> handles;
+    static std::atomic<int> nextHandleId{1};
+
+    // Pattern argument: a string (cached) or a regex_compile handle
+    static std::shared_ptr<const Compiled> patternArg(const Value& v) {
+        if (v.holds_alternative<std::string>()) return cached(v.get<std::string>());
+        if (v.holds_alternative<int>()) {
+            std::lock_guard<std::mutex> lock(registryMutex);
+            auto it = handles.find(v.get<int>());
+            if (it != handles.end()) return it->second;
+            throw std::runtime_error("regex: invalid regex handle.");
+        }
+        throw std::runtime_error("regex: pattern must be a string or a regex_compile handle.");
+    }
+
+    static bool validArgs(const std::vector<Value>& args, size_t n) {
+        return args.size() >= n && args[0].holds_alternative<std::string>() &&
+               (args[1].holds_alternative<std::string>() || args[1].holds_alternative<int>());
+    }
+
+    static std::string group(std::string_view in, const std::vector<int>& caps, size_t g) {
+        if (g * 2 + 1 >= caps.size() || caps[g * 2] < 0) return "";
+        return std::string(in.substr(caps[g * 2], caps[g * 2 + 1] - caps[g * 2]));
+    }
+
+    // Calls fn(caps) for each successive non-overlapping match
+    template <typename Fn>
+    static void forEachMatch(const Compiled& re, std::string_view in, Fn fn) {
+        std::vector<int> caps;
+        size_t pos = 0;
+        while (pos <= in.size() && re.exec(in, pos, false, caps)) {
+            fn(caps);
+            size_t end = static_cast<size_t>(caps[1]);
+            pos = end == static_cast<size_t>(caps[0]) ? end + 1 : end;
+        }
+    }
+
+    // regex_compile(pattern[, flags]) -> handle; flags "i" = case-insensitive
+    Value compile_fn(std::vector<Value>& args) {
+        if (args.empty() || !args[0].holds_alternative<std::string>())
+            throw std::runtime_error("regex_compile: requires pattern string.");
+        bool icase = args.size() > 1 && args[1].holds_alternative<std::string>() &&
+                     args[1].get<std::string>().find('i') != std::string::npos;
+        std::shared_ptr<const Compiled> c;
+        try {
+            c = compile(args[0].get<std::string>(), icase);
+        } catch (const std::regex_error& e) {
+            throw std::runtime_error("regex_compile: invalid pattern '" + args[0].get<std::string>() + "': " + e.what());
+        }
+        std::lock_guard<std::mutex> lock(registryMutex);
+        int id = nextHandleId++;
+        handles[id] = std::move(c);
+        return Value(id);
+    }
+
+    Value free_fn(std::vector<Value>& args) {
+        if (args.empty()) throw std::runtime_error("regex_free: requires regex handle.");
+        std::lock_guard<std::mutex> lock(registryMutex);
+        handles.erase(toInt(args[0]));
+        return Value();
+    }
+
     Value match_fn(std::vector<Value>& args) {
-        if (args.size() < 2 || !args[0].holds_alternative<std::string>() || !args[1].holds_alternative<std::string>())
-            return false;
+        if (!validArgs(args, 2)) return false;
         try {
-            std::regex re(args[1].get<std::string>());
-            return std::regex_match(args[0].get<std::string>(), re);
-        } catch (...) { return false; }
+            std::vector<int> caps;
+            return patternArg(args[1])->exec(args[0].get<std::string>(), 0, true, caps);
+        } catch (const std::regex_error&) { return false; }
     }
 
     Value search_fn(std::vector<Value>& args) {
-        if (args.size() < 2 || !args[0].holds_alternative<std::string>() || !args[1].holds_alternative<std::string>())
-            return Value();
+        if (!validArgs(args, 2)) return Value();
         try {
-            std::regex re(args[1].get<std::string>());
-            std::smatch match;
-            std::string str = args[0].get<std::string>();
-            if (std::regex_search(str, match, re))
-                return match[0].str();
+            const std::string& str = args[0].get<std::string>();
+            std::vector<int> caps;
+            if (patternArg(args[1])->exec(str, 0, false, caps)) return group(str, caps, 0);
             return Value();
-        } catch (...) { return Value(); }
+        } catch (const std::regex_error&) { return Value(); }
     }
 
     Value find_all_fn(std::vector<Value>& args) {
-        if (args.size() < 2 || !args[0].holds_alternative<std::string>() || !args[1].holds_alternative<std::string>())
-            return std::vector<Value>();
+        if (!validArgs(args, 2)) return std::vector<Value>();
         try {
-            std::regex re(args[1].get<std::string>());
-            std::string str = args[0].get<std::string>();
+            const std::string& str = args[0].get<std::string>();
             std::vector<Value> results;
-            std::sregex_iterator it(str.begin(), str.end(), re);
-            std::sregex_iterator end;
-            for (; it != end; ++it)
-                results.push_back(Value((*it)[0].str()));
+            forEachMatch(*patternArg(args[1]), str, [&](const std::vector<int>& caps) {
+                results.push_back(Value(group(str, caps, 0)));
+            });
             return results;
-        } catch (...) { return std::vector<Value>(); }
+        } catch (const std::regex_error&) { return std::vector<Value>(); }
+    }
+
+    // ECMAScript replacement format: $&, $1..$99, $`, $', $$
+    static void appendReplacement(std::string& out, const std::string& fmt, std::string_view in,
+                                  const std::vector<int>& caps) {
+        for (size_t i = 0; i < fmt.size(); ++i) {
+            if (fmt[i] != '$' || i + 1 >= fmt.size()) { out += fmt[i]; continue; }
+            char n = fmt[i + 1];
+            if (n == '$') { out += '$'; ++i; }
+            else if (n == '&') { out += group(in, caps, 0); ++i; }
+            else if (n == '`') { out.append(in.substr(0, caps[0])); ++i; }
+            else if (n == '\'') { out.append(in.substr(caps[1])); ++i; }
+            else if (std::isdigit(static_cast<unsigned char>(n))) {
+                size_t g = n - '0';
+                ++i;
+                if (i + 1 < fmt.size() && std::isdigit(static_cast<unsigned char>(fmt[i + 1])) &&
+                    (g * 10 + (fmt[i + 1] - '0')) * 2 < caps.size()) {
+                    g = g * 10 + (fmt[++i] - '0');
+                }
+                out += group(in, caps, g);
+            } else {
+                out += '$';
+            }
+        }
     }
 
     Value replace_fn(std::vector<Value>& args) {
-        if (args.size() < 3 || !args[0].holds_alternative<std::string>() ||
-            !args[1].holds_alternative<std::string>() || !args[2].holds_alternative<std::string>())
+        if (!validArgs(args, 3) || !args[2].holds_alternative<std::string>())
             return std::string("");
         try {
-            std::regex re(args[1].get<std::string>());
-            return std::regex_replace(args[0].get<std::string>(), re, args[2].get<std::string>());
-        } catch (...) { return args[0]; }
+            const std::string& str = args[0].get<std::string>();
+            const std::string& fmt = args[2].get<std::string>();
+            std::string out;
+            out.reserve(str.size());
+            size_t copied = 0;
+            forEachMatch(*patternArg(args[1]), str, [&](const std::vector<int>& caps) {
+                out.append(str, copied, caps[0] - copied);
+                appendReplacement(out, fmt, str, caps);
+                copied = static_cast<size_t>(caps[1]);
+            });
+            out.append(str, copied, std::string::npos);
+            return out;
+        } catch (const std::regex_error&) { return args[0]; }
     }
 
     Value split_fn(std::vector<Value>& args) {
-        if (args.size() < 2 || !args[0].holds_alternative<std::string>() || !args[1].holds_alternative<std::string>())
-            return std::vector<Value>();
+        if (!validArgs(args, 2)) return std::vector<Value>();
         try {
-            std::regex re(args[1].get<std::string>());
-            std::string str = args[0].get<std::string>();
+            const std::string& str = args[0].get<std::string>();
             std::vector<Value> results;
-            std::sregex_token_iterator it(str.begin(), str.end(), re, -1);
-            std::sregex_token_iterator end;
-            for (; it != end; ++it)
-                results.push_back(Value(it->str()));
+            size_t copied = 0;
+            forEachMatch(*patternArg(args[1]), str, [&](const std::vector<int>& caps) {
+                results.push_back(Value(str.substr(copied, caps[0] - copied)));
+                copied = static_cast<size_t>(caps[1]);
+            });
+            if (copied < str.size()) results.push_back(Value(str.substr(copied)));
             return results;
-        } catch (...) { return std::vector<Value>(); }
+        } catch (const std::regex_error&) { return std::vector<Value>(); }
     }
 
     Value captures_fn(std::vector<Value>& args) {
-        if (args.size() < 2 || !args[0].holds_alternative<std::string>() || !args[1].holds_alternative<std::string>())
-            return std::vector<Value>();
+        if (!validArgs(args, 2)) return std::vector<Value>();
         try {
-            std::regex re(args[1].get<std::string>());
-            std::smatch match;
+            const std::string& str = args[0].get<std::string>();
+            auto re = patternArg(args[1]);
+            std::vector<int> caps;
             std::vector<Value> results;
-            std::string str = args[0].get<std::string>();
-            if (std::regex_search(str, match, re)) {
-                for (size_t i = 0; i < match.size(); ++i)
-                    results.push_back(Value(match[i].str()));
+            if (re->exec(str, 0, false, caps)) {
+                for (size_t g = 0; g < re->groups; ++g) results.push_back(Value(group(str, caps, g)));
             }
             return results;
-        } catch (...) { return std::vector<Value>(); }
+        } catch (const std::regex_error&) { return std::vector<Value>(); }
     }
 
     void registerFunctions(std::unordered_map<std::string, Value>& globals) {
+        globals["regex_compile"] = NativeFunction{compile_fn, -1};
+        globals["regex_free"] = NativeFunction{free_fn, 1};
         globals["regex_match"] = NativeFunction{match_fn, 2};
         globals["regex_search"] = NativeFunction{search_fn, 2};
         globals["regex_find_all"] = NativeFunction{find_all_fn, 2};
@@ -1948,7 +6111,10 @@ namespace NetSocket {
         int fd = toInt(args[0]);
         struct sockaddr_in client_addr;
         socklen_t client_len = sizeof(client_addr);
+        Console::flush();   // Don't hold output back while waiting for a client
         int client_fd = ::accept(fd, (struct sockaddr*)&client_addr, &client_len);
+        if (client_fd < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+            return Value();  // non-blocking socket with no pending connection
         if (client_fd < 0)
             throw std::runtime_error("socket_accept: accept failed.");
         std::string addr_str = std::string(inet_ntoa(client_addr.sin_addr)) + ":" + std::to_string(ntohs(client_addr.sin_port));
@@ -1979,8 +6145,11 @@ namespace NetSocket {
             addr.sin_addr.s_addr = inet_addr(host.c_str());
         }
 
-        if (::connect(fd, (struct sockaddr*)&addr, sizeof(addr)) < 0)
+        if (::connect(fd, (struct sockaddr*)&addr, sizeof(addr)) < 0) {
+            // Non-blocking connect: completion is signalled by writability
+            if (errno == EINPROGRESS) return false;
             throw std::runtime_error("socket_connect: connect failed.");
+        }
         return true;
         #else
         throw std::runtime_error("socket_connect: not supported on Windows.");
@@ -1992,7 +6161,8 @@ namespace NetSocket {
         if (args.size() < 2) throw std::runtime_error("socket_send: requires handle and data.");
         int fd = toInt(args[0]);
         std::string data = args[1].get<std::string>();
-        ssize_t sent = ::send(fd, data.c_str(), data.size(), 0);
+        ssize_t sent = ::send(fd, data.c_str(), data.size(), MSG_NOSIGNAL);
+        if (sent < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return 0;
         if (sent < 0) throw std::runtime_error("socket_send: send failed.");
         return static_cast<int>(sent);
         #else
@@ -2006,7 +6176,10 @@ namespace NetSocket {
         int fd = toInt(args[0]);
         int maxlen = args.size() >= 2 ? toInt(args[1]) : 4096;
         std::vector<char> buffer(maxlen);
+        Console::flush();
         ssize_t received = ::recv(fd, buffer.data(), maxlen, 0);
+        if (received < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+            return Value();  // non-blocking socket with no data yet
         if (received < 0) throw std::runtime_error("socket_recv: recv failed.");
         if (received == 0) return std::string("");
         return std::string(buffer.data(), received);
@@ -2035,6 +6208,9 @@ namespace NetSocket {
             setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &val, sizeof(val));
         } else if (option == "keep_alive") {
             setsockopt(fd, SOL_SOCKET, SO_KEEPALIVE, &val, sizeof(val));
+        } else if (option == "non_blocking") {
+            int flags = fcntl(fd, F_GETFL, 0);
+            fcntl(fd, F_SETFL, val ? (flags | O_NONBLOCK) : (flags & ~O_NONBLOCK));
         }
         return true;
         #else
@@ -2072,7 +6248,7 @@ namespace NetHTTP {
     // Callback: collect response headers
     static size_t curlHeaderCallback(char* ptr, size_t size, size_t nmemb, void* userdata) {
         size_t total = size * nmemb;
-        auto* headers = static_cast<std::unordered_map<std::string, Value>*>(userdata);
+        auto* headers = static_cast<MapValue*>(userdata);
         std::string line(ptr, total);
 
         // Trim \r\n
@@ -2100,73 +6276,507 @@ namespace NetHTTP {
         return fwrite(ptr, size, nmemb, static_cast<FILE*>(userdata));
     }
 
-    static std::unordered_map<std::string, Value> doHttpRequest(
-        const std::string& method, const std::string& url,
-        const std::unordered_map<std::string, Value>& extra_headers,
-        const std::string& body)
-    {
-        std::unordered_map<std::string, Value> result;
-        result["status"] = Value(0);
-        result["body"] = Value(std::string(""));
-        result["headers"] = Value(std::unordered_map<std::string, Value>());
+    // ---- Connection pooling ----
+    //
+    // All handles share one DNS cache and TLS session cache (curl share
+    // interface). Connections are not shared: libcurl doesn't support a shared
+    // connection cache across threads. Instead each thread keeps its easy
+    // handle, and with it that handle's open connections, between requests,
+    // and a batch reuses connections within its multi handle. Repeated calls
+    // to the same host therefore skip DNS, TCP and TLS setup.
+
+    static std::mutex curlShareLocks[CURL_LOCK_DATA_LAST];
+
+    static void curlShareLock(CURL*, curl_lock_data data, curl_lock_access, void*) {
+        curlShareLocks[data].lock();
+    }
+
+    static void curlShareUnlock(CURL*, curl_lock_data data, void*) {
+        curlShareLocks[data].unlock();
+    }
+
+    static CURLSH* curlShare() {
+        static CURLSH* share = [] {
+            curl_global_init(CURL_GLOBAL_DEFAULT);
+            CURLSH* sh = curl_share_init();
+            curl_share_setopt(sh, CURLSHOPT_LOCKFUNC, curlShareLock);
+            curl_share_setopt(sh, CURLSHOPT_UNLOCKFUNC, curlShareUnlock);
+            curl_share_setopt(sh, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+            curl_share_setopt(sh, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+            return sh;
+        }();
+        return share;
+    }
+
+    struct PooledEasy {
+        CURL* handle = nullptr;
+        ~PooledEasy() { if (handle) curl_easy_cleanup(handle); }
+    };
+
+    // Per-thread easy handle, reset (but not closed) between requests
+    static CURL* pooledEasyHandle() {
+        thread_local PooledEasy pooled;
+        if (!pooled.handle) pooled.handle = curl_easy_init();
+        else curl_easy_reset(pooled.handle);
+        return pooled.handle;
+    }
+
+    // Response buffers and request header list for one transfer
+    struct CurlTransfer {
+        std::string body;
+        MapValue headers;
+        struct curl_slist* headerList = nullptr;
+        std::string requestBody;
+        char error[CURL_ERROR_SIZE] = {0};
+        ~CurlTransfer() { if (headerList) curl_slist_free_all(headerList); }
+    };
+
+    // Applies the options shared by single and batched requests
+    static void setupTransfer(CURL* curl, CurlTransfer& t, const std::string& method, const std::string& url,
+                              const MapValue& extra_headers, long timeoutSec) {
+        curl_easy_setopt(curl, CURLOPT_SHARE, curlShare());
+        curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
+        curl_easy_setopt(curl, CURLOPT_CUSTOMREQUEST, method.c_str());
+        curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, curlWriteCallback);
+        curl_easy_setopt(curl, CURLOPT_WRITEDATA, &t.body);
+        curl_easy_setopt(curl, CURLOPT_HEADERFUNCTION, curlHeaderCallback);
+        curl_easy_setopt(curl, CURLOPT_HEADERDATA, &t.headers);
+        curl_easy_setopt(curl, CURLOPT_ERRORBUFFER, t.error);
+        curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1L);
+        curl_easy_setopt(curl, CURLOPT_MAXREDIRS, 10L);
+        curl_easy_setopt(curl, CURLOPT_TIMEOUT, timeoutSec);
+        curl_easy_setopt(curl, CURLOPT_CONNECTTIMEOUT, 10L);
+        curl_easy_setopt(curl, CURLOPT_NOSIGNAL, 1L);
+        curl_easy_setopt(curl, CURLOPT_TCP_KEEPALIVE, 1L);
+        curl_easy_setopt(curl, CURLOPT_USERAGENT, "Yen/1.0");
+        curl_easy_setopt(curl, CURLOPT_ACCEPT_ENCODING, "");  // Accept all encodings (gzip, deflate, etc.)
+
+        // Set request body (owned by the transfer so batched handles can outlive the caller's Value)
+        if (!t.requestBody.empty()) {
+            curl_easy_setopt(curl, CURLOPT_POSTFIELDS, t.requestBody.c_str());
+            curl_easy_setopt(curl, CURLOPT_POSTFIELDSIZE, static_cast<long>(t.requestBody.size()));
+        }
+
+        // Set custom headers
+        for (const auto& [key, val] : extra_headers) {
+            if (val.holds_alternative<std::string>()) {
+                std::string header_line = keyToString(key) + ": " + val.get<std::string>();
+                t.headerList = curl_slist_append(t.headerList, header_line.c_str());
+            }
+        }
+        if (t.headerList) {
+            curl_easy_setopt(curl, CURLOPT_HTTPHEADER, t.headerList);
+        }
+    }
+
+    static MapValue transferResult(CURL* curl, CurlTransfer& t) {
+        long status_code = 0;
+        curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &status_code);
+        MapValue result;
+        result["status"] = Value(static_cast<int>(status_code));
+        result["body"] = Value(std::move(t.body));
+        result["headers"] = Value(std::move(t.headers));
+        return result;
+    }
+
+    static MapValue doHttpRequest(
+        const std::string& method, const std::string& url,
+        const MapValue& extra_headers,
+        const std::string& body)
+    {
+        CURL* curl = pooledEasyHandle();
+        if (!curl) throw std::runtime_error("http: failed to initialize libcurl.");
+
+        CurlTransfer transfer;
+        transfer.requestBody = body;
+        setupTransfer(curl, transfer, method, url, extra_headers, 30L);
+
+        CURLcode res = curl_easy_perform(curl);
+        if (res != CURLE_OK) {
+            std::string err = transfer.error[0] ? transfer.error : curl_easy_strerror(res);
+            throw std::runtime_error("http: request failed - " + err);
+        }
+        return transferResult(curl, transfer);
+    }
+
+    struct BatchRequest {
+        std::string method;
+        std::string url;
+        MapValue headers;
+        std::string body;
+    };
+
+    // Runs all requests concurrently on one multi handle. Results keep input
+    // order; a failed transfer yields {status: 0, error: message}.
+    // The slot for a transfer that never got a response
+    static Value failedTransfer(const std::string& error) {
+        MapValue failed;
+        failed["status"] = Value(0);
+        failed["body"] = Value(std::string(""));
+        failed["headers"] = Value(MapValue());
+        failed["error"] = Value(error);
+        return Value(failed);
+    }
+
+    static std::vector<Value> doHttpBatch(const std::vector<BatchRequest>& requests, long maxPerHost, long timeoutSec) {
+        CURLM* multi = curl_multi_init();
+        if (!multi) throw std::runtime_error("http_request_batch: failed to initialize libcurl.");
+        curl_multi_setopt(multi, CURLMOPT_MAX_HOST_CONNECTIONS, maxPerHost);
+        curl_multi_setopt(multi, CURLMOPT_PIPELINING, CURLPIPE_MULTIPLEX);
+
+        std::vector<std::unique_ptr<CurlTransfer>> transfers(requests.size());
+        std::vector<CURL*> handles(requests.size(), nullptr);
+        std::vector<Value> results(requests.size());
+        for (size_t i = 0; i < requests.size(); ++i) {
+            transfers[i] = std::make_unique<CurlTransfer>();
+            transfers[i]->requestBody = requests[i].body;
+            handles[i] = curl_easy_init();
+            if (!handles[i]) {
+                results[i] = failedTransfer("failed to initialize libcurl handle");
+                continue;
+            }
+            setupTransfer(handles[i], *transfers[i], requests[i].method, requests[i].url, requests[i].headers, timeoutSec);
+            curl_easy_setopt(handles[i], CURLOPT_PRIVATE, reinterpret_cast<void*>(i));
+            curl_multi_add_handle(multi, handles[i]);
+        }
+
+        int running = 0;
+        do {
+            curl_multi_perform(multi, &running);
+            int queued = 0;
+            while (CURLMsg* msg = curl_multi_info_read(multi, &queued)) {
+                if (msg->msg != CURLMSG_DONE) continue;
+                void* priv = nullptr;
+                curl_easy_getinfo(msg->easy_handle, CURLINFO_PRIVATE, &priv);
+                size_t i = reinterpret_cast<size_t>(priv);
+                if (msg->data.result == CURLE_OK) {
+                    results[i] = Value(transferResult(msg->easy_handle, *transfers[i]));
+                } else {
+                    results[i] = failedTransfer(transfers[i]->error[0] ? transfers[i]->error
+                                                                       : curl_easy_strerror(msg->data.result));
+                }
+            }
+            if (running) curl_multi_poll(multi, nullptr, 0, 1000, nullptr);
+        } while (running);
+
+        for (CURL* h : handles) {
+            if (!h) continue;
+            curl_multi_remove_handle(multi, h);
+            curl_easy_cleanup(h);
+        }
+        curl_multi_cleanup(multi);
+        return results;
+    }
+
+    // ---- Streaming responses and uploads ----
+    //
+    // A stream owns one easy handle on its own multi handle. The transfer is
+    // only driven while the caller is reading, so at most one socket read is
+    // buffered ahead of the consumer and TCP flow control holds back the
+    // rest of the body. Uploads come from a file, a list of chunks, or chunks
+    // written one at a time with http_stream_write (sent chunked).
+
+    struct HttpStream {
+        CURLM* multi = nullptr;
+        CURL* easy = nullptr;
+        CurlTransfer transfer;
+        std::string buffer;
+        size_t offset = 0;
+        int status = 0;
+        bool headersDone = false;
+        bool done = false;
+        CURLcode result = CURLE_OK;
+
+        FILE* uploadFile = nullptr;
+        std::deque<std::string> uploadChunks;
+        size_t uploadOffset = 0;
+        bool uploadWriter = false;   // body fed by http_stream_write
+        bool uploadFinished = false;
+        bool uploadPaused = false;
+
+        size_t pending() const { return buffer.size() - offset; }
+
+        // Takes up to n buffered bytes
+        std::string take(size_t n) {
+            n = std::min(n, pending());
+            std::string out = buffer.substr(offset, n);
+            offset += n;
+            if (offset == buffer.size()) { buffer.clear(); offset = 0; }
+            else if (offset >= 65536) { buffer.erase(0, offset); offset = 0; }
+            return out;
+        }
+
+        ~HttpStream() {
+            if (easy) { curl_multi_remove_handle(multi, easy); curl_easy_cleanup(easy); }
+            if (multi) curl_multi_cleanup(multi);
+            if (uploadFile) fclose(uploadFile);
+        }
+    };
 
-        CURL* curl = curl_easy_init();
-        if (!curl) throw std::runtime_error("http: failed to initialize libcurl.");
+    static std::mutex streamRegistryMutex;
+    static std::unordered_map<int, std::shared_ptr<HttpStream>> streams;
+    static std::atomic<int> nextStreamId{1};
 
-        std::string response_body;
-        std::unordered_map<std::string, Value> response_headers;
+    static std::shared_ptr<HttpStream> getStream(const std::vector<Value>& args, const char* fn) {
+        if (args.empty()) throw std::runtime_error(std::string(fn) + ": requires stream handle.");
+        std::lock_guard<std::mutex> lock(streamRegistryMutex);
+        auto it = streams.find(toInt(args[0]));
+        if (it == streams.end()) throw std::runtime_error(std::string(fn) + ": invalid stream handle.");
+        return it->second;
+    }
 
-        curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
-        curl_easy_setopt(curl, CURLOPT_CUSTOMREQUEST, method.c_str());
-        curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, curlWriteCallback);
-        curl_easy_setopt(curl, CURLOPT_WRITEDATA, &response_body);
-        curl_easy_setopt(curl, CURLOPT_HEADERFUNCTION, curlHeaderCallback);
-        curl_easy_setopt(curl, CURLOPT_HEADERDATA, &response_headers);
-        curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1L);
-        curl_easy_setopt(curl, CURLOPT_MAXREDIRS, 10L);
-        curl_easy_setopt(curl, CURLOPT_TIMEOUT, 30L);
-        curl_easy_setopt(curl, CURLOPT_CONNECTTIMEOUT, 10L);
-        curl_easy_setopt(curl, CURLOPT_USERAGENT, "Yen/1.0");
-        curl_easy_setopt(curl, CURLOPT_ACCEPT_ENCODING, "");  // Accept all encodings (gzip, deflate, etc.)
+    static size_t streamWriteCallback(char* ptr, size_t size, size_t nmemb, void* userdata) {
+        size_t total = size * nmemb;
+        static_cast<HttpStream*>(userdata)->buffer.append(ptr, total);
+        return total;
+    }
 
-        // Set request body
-        if (!body.empty()) {
-            curl_easy_setopt(curl, CURLOPT_POSTFIELDS, body.c_str());
-            curl_easy_setopt(curl, CURLOPT_POSTFIELDSIZE, static_cast<long>(body.size()));
+    // Tracks the status line so only the final response's headers are kept,
+    // and marks the headers complete at the blank line ending them
+    static size_t streamHeaderCallback(char* ptr, size_t size, size_t nmemb, void* userdata) {
+        size_t total = size * nmemb;
+        auto* s = static_cast<HttpStream*>(userdata);
+        if (total >= 5 && std::memcmp(ptr, "HTTP/", 5) == 0) {
+            const char* sp = static_cast<const char*>(std::memchr(ptr, ' ', total));
+            s->status = sp ? std::atoi(sp + 1) : 0;
+            s->transfer.headers.clear();
+            return total;
         }
-
-        // Set custom headers
-        struct curl_slist* header_list = nullptr;
-        for (const auto& [key, val] : extra_headers) {
-            if (val.holds_alternative<std::string>()) {
-                std::string header_line = key + ": " + val.get<std::string>();
-                header_list = curl_slist_append(header_list, header_line.c_str());
+        if (total <= 2 && (ptr[0] == '\r' || ptr[0] == '\n')) {
+            bool redirect = s->status >= 300 && s->status < 400 && s->transfer.headers.count("location");
+            if (s->status >= 200 && !redirect) s->headersDone = true;
+            return total;
+        }
+        return curlHeaderCallback(ptr, size, nmemb, &s->transfer.headers);
+    }
+
+    static size_t streamReadCallback(char* dest, size_t size, size_t nmemb, void* userdata) {
+        auto* s = static_cast<HttpStream*>(userdata);
+        size_t room = size * nmemb;
+        if (s->uploadFile) return fread(dest, 1, room, s->uploadFile);
+        while (!s->uploadChunks.empty()) {
+            const std::string& chunk = s->uploadChunks.front();
+            if (s->uploadOffset < chunk.size()) {
+                size_t n = std::min(room, chunk.size() - s->uploadOffset);
+                std::memcpy(dest, chunk.data() + s->uploadOffset, n);
+                s->uploadOffset += n;
+                return n;
             }
+            s->uploadChunks.pop_front();
+            s->uploadOffset = 0;
         }
-        if (header_list) {
-            curl_easy_setopt(curl, CURLOPT_HTTPHEADER, header_list);
+        if (s->uploadWriter && !s->uploadFinished) {
+            s->uploadPaused = true;
+            return CURL_READFUNC_PAUSE;
         }
+        return 0;
+    }
 
-        CURLcode res = curl_easy_perform(curl);
+    // Moves the transfer along as far as it can go without waiting
+    static void stepStream(HttpStream& s) {
+        int running = 0;
+        curl_multi_perform(s.multi, &running);
+        int queued = 0;
+        while (CURLMsg* msg = curl_multi_info_read(s.multi, &queued)) {
+            if (msg->msg == CURLMSG_DONE) { s.done = true; s.result = msg->data.result; }
+        }
+    }
 
-        if (res != CURLE_OK) {
-            std::string err = curl_easy_strerror(res);
-            if (header_list) curl_slist_free_all(header_list);
-            curl_easy_cleanup(curl);
-            throw std::runtime_error("http: request failed - " + err);
+    // Drives the transfer until ready() holds or it completes
+    template <typename Ready>
+    static void pumpStream(HttpStream& s, Ready ready) {
+        while (!s.done && !ready()) {
+            stepStream(s);
+            if (!s.done && !ready()) curl_multi_poll(s.multi, nullptr, 0, 1000, nullptr);
         }
+    }
 
-        long status_code = 0;
-        curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &status_code);
+    static void checkStream(const HttpStream& s, const char* fn) {
+        if (s.done && s.result != CURLE_OK) {
+            std::string err = s.transfer.error[0] ? s.transfer.error : curl_easy_strerror(s.result);
+            throw std::runtime_error(std::string(fn) + ": transfer failed - " + err);
+        }
+    }
 
-        result["status"] = Value(static_cast<int>(status_code));
-        result["body"] = Value(response_body);
-        result["headers"] = Value(response_headers);
+    // http_open(method, url[, {headers, body, body_file, body_chunks, body_stream, timeout}])
+    static Value open_fn(std::vector<Value>& args) {
+        if (args.size() < 2 || !args[0].holds_alternative<std::string>() || !args[1].holds_alternative<std::string>())
+            throw std::runtime_error("http_open: requires method and URL.");
+        MapValue opts;
+        if (args.size() > 2 && args[2].holds_alternative<MapValue>())
+            opts = args[2].get<MapValue>();
+
+        auto s = std::make_shared<HttpStream>();
+        MapValue headers;
+        auto it = opts.find("headers");
+        if (it != opts.end() && it->second.holds_alternative<MapValue>())
+            headers = it->second.get<MapValue>();
+        it = opts.find("body");
+        if (it != opts.end() && it->second.holds_alternative<std::string>())
+            s->transfer.requestBody = it->second.get<std::string>();
+
+        bool upload = false;
+        curl_off_t uploadSize = -1;
+        it = opts.find("body_file");
+        if (it != opts.end() && it->second.holds_alternative<std::string>()) {
+            const std::string& path = it->second.get<std::string>();
+            s->uploadFile = fopen(path.c_str(), "rb");
+            if (!s->uploadFile) throw std::runtime_error("http_open: cannot open file '" + path + "'.");
+            struct stat st;
+            if (fstat(fileno(s->uploadFile), &st) == 0) uploadSize = st.st_size;
+            upload = true;
+        }
+        it = opts.find("body_chunks");
+        if (it != opts.end() && it->second.holds_alternative<std::vector<Value>>()) {
+            for (const auto& chunk : it->second.get<std::vector<Value>>()) {
+                if (!chunk.holds_alternative<std::string>())
+                    throw std::runtime_error("http_open: body_chunks must be strings.");
+                s->uploadChunks.push_back(chunk.get<std::string>());
+            }
+            upload = true;
+        }
+        it = opts.find("body_stream");
+        if (it != opts.end() && it->second.holds_alternative<bool>() && it->second.get<bool>()) {
+            s->uploadWriter = true;
+            upload = true;
+        }
+        long timeoutSec = 0;  // No overall limit: streams may run for a long time
+        it = opts.find("timeout");
+        if (it != opts.end()) timeoutSec = std::max(0, toInt(it->second));
+
+        s->multi = curl_multi_init();
+        s->easy = curl_easy_init();
+        if (!s->multi || !s->easy) throw std::runtime_error("http_open: failed to initialize libcurl.");
+        setupTransfer(s->easy, s->transfer, args[0].get<std::string>(), args[1].get<std::string>(), headers, timeoutSec);
+        curl_easy_setopt(s->easy, CURLOPT_WRITEFUNCTION, streamWriteCallback);
+        curl_easy_setopt(s->easy, CURLOPT_WRITEDATA, s.get());
+        curl_easy_setopt(s->easy, CURLOPT_HEADERFUNCTION, streamHeaderCallback);
+        curl_easy_setopt(s->easy, CURLOPT_HEADERDATA, s.get());
+        if (upload) {
+            // UPLOAD streams through the read callback; unknown sizes go out chunked
+            curl_easy_setopt(s->easy, CURLOPT_UPLOAD, 1L);
+            curl_easy_setopt(s->easy, CURLOPT_READFUNCTION, streamReadCallback);
+            curl_easy_setopt(s->easy, CURLOPT_READDATA, s.get());
+            if (uploadSize >= 0) curl_easy_setopt(s->easy, CURLOPT_INFILESIZE_LARGE, uploadSize);
+            // Send the body straight away rather than waiting on "Expect: 100-continue"
+            s->transfer.headerList = curl_slist_append(s->transfer.headerList, "Expect:");
+            curl_easy_setopt(s->easy, CURLOPT_HTTPHEADER, s->transfer.headerList);
+        }
+        curl_multi_add_handle(s->multi, s->easy);
 
-        if (header_list) curl_slist_free_all(header_list);
-        curl_easy_cleanup(curl);
+        // A writer-fed upload returns at once; the response arrives after http_stream_finish
+        if (!s->uploadWriter) {
+            pumpStream(*s, [&] { return s->headersDone; });
+            checkStream(*s, "http_open");
+        }
 
-        return result;
+        std::lock_guard<std::mutex> lock(streamRegistryMutex);
+        int id = nextStreamId++;
+        streams[id] = s;
+        return Value(id);
+    }
+
+    // http_stream_info(stream) -> {status, headers}. While a body_stream upload
+    // is still open the response can't have started, so this reports what has
+    // arrived so far (status 0) instead of waiting for headers.
+    static Value stream_info_fn(std::vector<Value>& args) {
+        auto s = getStream(args, "http_stream_info");
+        if (s->uploadWriter && !s->uploadFinished) {
+            if (!s->done) stepStream(*s);
+        } else {
+            pumpStream(*s, [&] { return s->headersDone; });
+        }
+        checkStream(*s, "http_stream_info");
+        MapValue info;
+        info["status"] = Value(s->status);
+        info["headers"] = Value(s->transfer.headers);
+        return Value(std::move(info));
+    }
+
+    // http_stream_read(stream[, max_bytes]) -> next chunk, or None at the end
+    static Value stream_read_fn(std::vector<Value>& args) {
+        auto s = getStream(args, "http_stream_read");
+        size_t maxBytes = args.size() > 1 ? static_cast<size_t>(std::max(1, toInt(args[1]))) : 65536;
+        pumpStream(*s, [&] { return s->pending() > 0; });
+        checkStream(*s, "http_stream_read");
+        if (s->pending() == 0) return Value();
+        return Value(s->take(maxBytes));
+    }
+
+    // http_stream_line(stream) -> next line without its terminator, or None at the end
+    static Value stream_line_fn(std::vector<Value>& args) {
+        auto s = getStream(args, "http_stream_line");
+        size_t scanned = 0;
+        size_t nl = std::string::npos;
+        pumpStream(*s, [&] {
+            nl = s->buffer.find('\n', s->offset + scanned);
+            scanned = s->pending();
+            return nl != std::string::npos;
+        });
+        checkStream(*s, "http_stream_line");
+        if (nl == std::string::npos) nl = s->buffer.find('\n', s->offset);
+        if (nl == std::string::npos) {
+            if (s->pending() == 0) return Value();
+            return Value(s->take(s->pending()));
+        }
+        std::string line = s->take(nl - s->offset + 1);
+        line.pop_back();
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        return Value(line);
+    }
+
+    // http_stream_to_file(stream, path) -> bytes written
+    static Value stream_to_file_fn(std::vector<Value>& args) {
+        auto s = getStream(args, "http_stream_to_file");
+        if (args.size() < 2 || !args[1].holds_alternative<std::string>())
+            throw std::runtime_error("http_stream_to_file: requires stream and file path.");
+        const std::string& path = args[1].get<std::string>();
+        FILE* fp = fopen(path.c_str(), "wb");
+        if (!fp) throw std::runtime_error("http_stream_to_file: cannot open file '" + path + "' for writing.");
+        long long written = 0;
+        while (true) {
+            pumpStream(*s, [&] { return s->pending() > 0; });
+            if (s->pending() == 0) break;
+            written += static_cast<long long>(fwrite(s->buffer.data() + s->offset, 1, s->pending(), fp));
+            s->take(s->pending());
+        }
+        fclose(fp);
+        checkStream(*s, "http_stream_to_file");
+        return IO::sizeValue(static_cast<size_t>(written));
+    }
+
+    // http_stream_write(stream, chunk) -> sends one chunk of a body_stream upload
+    static Value stream_write_fn(std::vector<Value>& args) {
+        auto s = getStream(args, "http_stream_write");
+        if (!s->uploadWriter || s->uploadFinished)
+            throw std::runtime_error("http_stream_write: stream is not accepting body chunks.");
+        if (args.size() < 2 || !args[1].holds_alternative<std::string>())
+            throw std::runtime_error("http_stream_write: requires stream and string chunk.");
+        std::string chunk = args[1].get<std::string>();
+        if (chunk.empty()) return Value(0);  // An empty chunk would end the chunked body
+        size_t size = chunk.size();
+        s->uploadChunks.push_back(std::move(chunk));
+        if (s->uploadPaused) { s->uploadPaused = false; curl_easy_pause(s->easy, CURLPAUSE_CONT); }
+        pumpStream(*s, [&] { return s->uploadChunks.empty() || s->uploadPaused; });
+        checkStream(*s, "http_stream_write");
+        return Value(static_cast<int>(size));
+    }
+
+    // http_stream_finish(stream) -> ends a body_stream upload and waits for the response headers
+    static Value stream_finish_fn(std::vector<Value>& args) {
+        auto s = getStream(args, "http_stream_finish");
+        s->uploadFinished = true;
+        if (s->uploadPaused) { s->uploadPaused = false; curl_easy_pause(s->easy, CURLPAUSE_CONT); }
+        pumpStream(*s, [&] { return s->headersDone; });
+        checkStream(*s, "http_stream_finish");
+        return Value(s->status);
+    }
+
+    static Value stream_close_fn(std::vector<Value>& args) {
+        if (args.empty()) throw std::runtime_error("http_stream_close: requires stream handle.");
+        std::lock_guard<std::mutex> lock(streamRegistryMutex);
+        streams.erase(toInt(args[0]));
+        return Value();
     }
 
     // Download URL to file (streaming, memory-efficient)
@@ -2183,6 +6793,7 @@ namespace NetHTTP {
         CURL* curl = curl_easy_init();
         if (!curl) { fclose(fp); throw std::runtime_error("http_download: failed to initialize libcurl."); }
 
+        curl_easy_setopt(curl, CURLOPT_SHARE, curlShare());
         curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
         curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, curlFileWriteCallback);
         curl_easy_setopt(curl, CURLOPT_WRITEDATA, fp);
@@ -2218,8 +6829,9 @@ namespace NetHTTP {
         if (!curl) throw std::runtime_error("http_headers: failed to initialize libcurl.");
 
         std::string discard_body;
-        std::unordered_map<std::string, Value> response_headers;
+        MapValue response_headers;
 
+        curl_easy_setopt(curl, CURLOPT_SHARE, curlShare());
         curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
         curl_easy_setopt(curl, CURLOPT_NOBODY, 1L);  // HEAD request
         curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, curlWriteCallback);
@@ -2282,9 +6894,9 @@ namespace NetHTTP {
         #endif
     }
 
-    static std::unordered_map<std::string, Value> parseHttpResponse(const std::string& response) {
-        std::unordered_map<std::string, Value> result;
-        result["status"] = Value(0); result["body"] = Value(std::string("")); result["headers"] = Value(std::unordered_map<std::string, Value>());
+    static MapValue parseHttpResponse(const std::string& response) {
+        MapValue result;
+        result["status"] = Value(0); result["body"] = Value(std::string("")); result["headers"] = Value(MapValue());
         size_t status_end = response.find("\r\n");
         if (status_end == std::string::npos) { result["body"] = Value(response); return result; }
         std::string status_line = response.substr(0, status_end);
@@ -2296,7 +6908,7 @@ namespace NetHTTP {
         }
         size_t headers_end = response.find("\r\n\r\n");
         if (headers_end == std::string::npos) return result;
-        std::unordered_map<std::string, Value> headers;
+        MapValue headers;
         size_t pos = status_end + 2;
         while (pos < headers_end) {
             size_t line_end = response.find("\r\n", pos);
@@ -2316,9 +6928,9 @@ namespace NetHTTP {
         return result;
     }
 
-    static std::unordered_map<std::string, Value> doHttpRequest(
+    static MapValue doHttpRequest(
         const std::string& method, const std::string& url,
-        const std::unordered_map<std::string, Value>& extra_headers,
+        const MapValue& extra_headers,
         const std::string& body)
     {
         #ifndef _WIN32
@@ -2344,16 +6956,49 @@ namespace NetHTTP {
         #endif
     }
 
+    struct BatchRequest {
+        std::string method;
+        std::string url;
+        MapValue headers;
+        std::string body;
+    };
+
+    // Without libcurl, batches run sequentially with the same result shape
+    static std::vector<Value> doHttpBatch(const std::vector<BatchRequest>& requests, long, long) {
+        std::vector<Value> results;
+        for (const auto& req : requests) {
+            try {
+                results.push_back(Value(doHttpRequest(req.method, req.url, req.headers, req.body)));
+            } catch (const std::exception& e) {
+                MapValue failed;
+                failed["status"] = Value(0);
+                failed["body"] = Value(std::string(""));
+                failed["headers"] = Value(MapValue());
+                failed["error"] = Value(std::string(e.what()));
+                results.push_back(Value(failed));
+            }
+        }
+        return results;
+    }
+
     // Stubs for libcurl-only functions
     static Value download_fn(std::vector<Value>& args) { throw std::runtime_error("http_download: requires libcurl (not available)."); }
     static Value headers_fn(std::vector<Value>& args) { throw std::runtime_error("http_headers: requires libcurl (not available)."); }
+    static Value open_fn(std::vector<Value>& args) { throw std::runtime_error("http_open: requires libcurl (not available)."); }
+    static Value stream_info_fn(std::vector<Value>& args) { throw std::runtime_error("http_stream_info: requires libcurl (not available)."); }
+    static Value stream_read_fn(std::vector<Value>& args) { throw std::runtime_error("http_stream_read: requires libcurl (not available)."); }
+    static Value stream_line_fn(std::vector<Value>& args) { throw std::runtime_error("http_stream_line: requires libcurl (not available)."); }
+    static Value stream_to_file_fn(std::vector<Value>& args) { throw std::runtime_error("http_stream_to_file: requires libcurl (not available)."); }
+    static Value stream_write_fn(std::vector<Value>& args) { throw std::runtime_error("http_stream_write: requires libcurl (not available)."); }
+    static Value stream_finish_fn(std::vector<Value>& args) { throw std::runtime_error("http_stream_finish: requires libcurl (not available)."); }
+    static Value stream_close_fn(std::vector<Value>& args) { throw std::runtime_error("http_stream_close: requires libcurl (not available)."); }
 
 #endif // HAVE_LIBCURL
 
     Value get_fn(std::vector<Value>& args) {
         if (args.empty() || !args[0].holds_alternative<std::string>())
             throw std::runtime_error("http_get: requires URL string.");
-        std::unordered_map<std::string, Value> empty_headers;
+        MapValue empty_headers;
         auto result = doHttpRequest("GET", args[0].get<std::string>(), empty_headers, "");
         return result;
     }
@@ -2366,7 +7011,7 @@ namespace NetHTTP {
         std::string content_type = "application/x-www-form-urlencoded";
         if (args.size() >= 3 && args[2].holds_alternative<std::string>())
             content_type = args[2].get<std::string>();
-        std::unordered_map<std::string, Value> headers;
+        MapValue headers;
         headers["Content-Type"] = Value(content_type);
         auto result = doHttpRequest("POST", url, headers, body);
         return result;
@@ -2380,7 +7025,7 @@ namespace NetHTTP {
         std::string content_type = "application/json";
         if (args.size() >= 3 && args[2].holds_alternative<std::string>())
             content_type = args[2].get<std::string>();
-        std::unordered_map<std::string, Value> headers;
+        MapValue headers;
         headers["Content-Type"] = Value(content_type);
         return doHttpRequest("PUT", url, headers, body);
     }
@@ -2393,7 +7038,7 @@ namespace NetHTTP {
         std::string content_type = "application/json";
         if (args.size() >= 3 && args[2].holds_alternative<std::string>())
             content_type = args[2].get<std::string>();
-        std::unordered_map<std::string, Value> headers;
+        MapValue headers;
         headers["Content-Type"] = Value(content_type);
         return doHttpRequest("PATCH", url, headers, body);
     }
@@ -2401,7 +7046,7 @@ namespace NetHTTP {
     Value delete_fn(std::vector<Value>& args) {
         if (args.empty() || !args[0].holds_alternative<std::string>())
             throw std::runtime_error("http_delete: requires URL string.");
-        std::unordered_map<std::string, Value> empty_headers;
+        MapValue empty_headers;
         return doHttpRequest("DELETE", args[0].get<std::string>(), empty_headers, "");
     }
 
@@ -2410,9 +7055,9 @@ namespace NetHTTP {
             throw std::runtime_error("http_request: requires method and URL.");
         std::string method = args[0].get<std::string>();
         std::string url = args[1].get<std::string>();
-        std::unordered_map<std::string, Value> headers;
-        if (args.size() >= 3 && args[2].holds_alternative<std::unordered_map<std::string, Value>>())
-            headers = args[2].get<std::unordered_map<std::string, Value>>();
+        MapValue headers;
+        if (args.size() >= 3 && args[2].holds_alternative<MapValue>())
+            headers = args[2].get<MapValue>();
         std::string body = "";
         if (args.size() >= 4 && args[3].holds_alternative<std::string>())
             body = args[3].get<std::string>();
@@ -2422,39 +7067,352 @@ namespace NetHTTP {
 
     Value url_encode_fn(std::vector<Value>& args) {
         if (args.empty() || !args[0].holds_alternative<std::string>()) return std::string("");
-        const std::string& input = args[0].get<std::string>();
-        std::ostringstream encoded;
-        encoded << std::hex << std::uppercase;
-        for (unsigned char c : input) {
-            if (std::isalnum(c) || c == '-' || c == '_' || c == '.' || c == '~') {
-                encoded << c;
-            } else {
-                encoded << '%' << std::setw(2) << std::setfill('0') << static_cast<int>(c);
-            }
-        }
-        return encoded.str();
+        return Encoding::percentEncode(args[0].get<std::string>());
     }
 
     Value url_decode_fn(std::vector<Value>& args) {
         if (args.empty() || !args[0].holds_alternative<std::string>()) return std::string("");
-        const std::string& input = args[0].get<std::string>();
-        std::string decoded;
-        for (size_t i = 0; i < input.size(); ++i) {
-            if (input[i] == '%' && i + 2 < input.size()) {
-                std::string hex = input.substr(i + 1, 2);
-                try {
-                    decoded += static_cast<char>(std::stoi(hex, nullptr, 16));
-                    i += 2;
-                } catch (...) {
-                    decoded += input[i];
+        return Encoding::percentDecode(args[0].get<std::string>(), true);
+    }
+
+    // ---- Incremental HTTP/1.1 request parser ----
+    //
+    // Works in place over a connection buffer that grows as data arrives:
+    // parse() resumes where the previous call stopped, so every byte is
+    // scanned once no matter how the request is split across reads. Request
+    // line and headers are kept as offsets into the buffer and only turned
+    // into Values by toValue().
+
+    static constexpr size_t kMaxRequestLineBytes = 8 * 1024;
+    static constexpr size_t kMaxHeaderBytes = 64 * 1024;
+    static constexpr size_t kMaxHeaderCount = 100;
+    static constexpr size_t kMaxChunkLineBytes = 4 * 1024;
+    static constexpr size_t kMaxBodyBytes = 64 * 1024 * 1024;
+
+    struct RequestParser {
+        enum class State { RequestLine, Headers, Body, ChunkSize, ChunkData, ChunkDataEnd, Trailers, Complete, Error };
+        struct Slice { size_t off = 0, len = 0; };
+
+        State state = State::RequestLine;
+        size_t start = 0;      // first byte of the current request
+        size_t lineStart = 0;  // first byte of the line (or body data) being parsed
+        size_t scan = 0;       // bytes before this were already searched for '\n'
+        size_t end = 0;        // one past the last byte of a Complete request
+        size_t trailerStart = 0;  // first byte after the last chunk's size line
+        Slice method, target, version;
+        std::vector<std::pair<Slice, Slice>> headers;
+        size_t contentLength = 0;
+        bool hasContentLength = false;
+        bool chunked = false;
+        size_t chunkRemaining = 0;
+        std::string chunkedBody;
+        bool keepAlive = false;
+        int errorStatus = 0;
+
+        static std::string_view view(const std::string& buf, Slice s) {
+            return std::string_view(buf.data() + s.off, s.len);
+        }
+
+        static bool equalsIgnoreCase(std::string_view a, std::string_view b) {
+            if (a.size() != b.size()) return false;
+            for (size_t i = 0; i < a.size(); ++i) {
+                if (std::tolower(static_cast<unsigned char>(a[i])) != b[i]) return false;
+            }
+            return true;
+        }
+
+        static bool containsIgnoreCase(std::string_view haystack, std::string_view needle) {
+            for (size_t i = 0; i + needle.size() <= haystack.size(); ++i) {
+                if (equalsIgnoreCase(haystack.substr(i, needle.size()), needle)) return true;
+            }
+            return false;
+        }
+
+        bool fail(int status) {
+            errorStatus = status;
+            state = State::Error;
+            return false;
+        }
+
+        // Starts the next request at offset next (after a Complete one)
+        void reset(size_t next) {
+            size_t keep = next;
+            *this = RequestParser();
+            start = lineStart = scan = keep;
+        }
+
+        // Drops consumed bytes from the front of buf; only valid between requests
+        void compact(std::string& buf) {
+            if (state != State::RequestLine || start == 0) return;
+            buf.erase(0, start);
+            lineStart -= start;
+            scan -= start;
+            start = 0;
+        }
+
+        bool onRequestLine(std::string_view line, size_t off) {
+            size_t sp1 = line.find(' ');
+            size_t sp2 = sp1 == std::string_view::npos ? sp1 : line.find(' ', sp1 + 1);
+            if (sp1 == 0 || sp2 == std::string_view::npos || sp2 == sp1 + 1) return fail(400);
+            method = {off, sp1};
+            target = {off + sp1 + 1, sp2 - sp1 - 1};
+            version = {off + sp2 + 1, line.size() - sp2 - 1};
+            std::string_view ver = line.substr(sp2 + 1);
+            if (ver != "HTTP/1.1" && ver != "HTTP/1.0") return fail(400);
+            keepAlive = ver == "HTTP/1.1";
+            state = State::Headers;
+            return true;
+        }
+
+        bool onHeaderLine(std::string_view line, size_t off) {
+            size_t colon = line.find(':');
+            if (colon == std::string_view::npos || colon == 0 ||
+                line[colon - 1] == ' ' || line[colon - 1] == '\t') return fail(400);
+            if (headers.size() >= kMaxHeaderCount) return fail(431);
+            size_t vs = colon + 1;
+            while (vs < line.size() && (line[vs] == ' ' || line[vs] == '\t')) ++vs;
+            size_t ve = line.size();
+            while (ve > vs && (line[ve - 1] == ' ' || line[ve - 1] == '\t')) --ve;
+            std::string_view name = line.substr(0, colon);
+            std::string_view value = line.substr(vs, ve - vs);
+            headers.push_back({{off, colon}, {off + vs, ve - vs}});
+
+            if (equalsIgnoreCase(name, "content-length")) {
+                size_t n = 0;
+                if (value.empty()) return fail(400);
+                for (char c : value) {
+                    if (c < '0' || c > '9') return fail(400);
+                    n = n * 10 + static_cast<size_t>(c - '0');
+                    if (n > kMaxBodyBytes) return fail(413);
+                }
+                if (hasContentLength && n != contentLength) return fail(400);
+                hasContentLength = true;
+                contentLength = n;
+            } else if (equalsIgnoreCase(name, "transfer-encoding")) {
+                chunked = containsIgnoreCase(value, "chunked");
+            } else if (equalsIgnoreCase(name, "connection")) {
+                if (equalsIgnoreCase(value, "close")) keepAlive = false;
+                else if (equalsIgnoreCase(value, "keep-alive")) keepAlive = true;
+            }
+            return true;
+        }
+
+        bool onChunkSizeLine(std::string_view line) {
+            size_t size = 0;
+            size_t i = 0;
+            for (; i < line.size() && line[i] != ';'; ++i) {
+                char c = line[i];
+                int digit;
+                if (c >= '0' && c <= '9') digit = c - '0';
+                else if (c >= 'a' && c <= 'f') digit = c - 'a' + 10;
+                else if (c >= 'A' && c <= 'F') digit = c - 'A' + 10;
+                else if (c == ' ' || c == '\t') continue;
+                else return fail(400);
+                size = size * 16 + static_cast<size_t>(digit);
+                if (size > kMaxBodyBytes) return fail(413);
+            }
+            if (i == 0) return fail(400);
+            if (chunkedBody.size() + size > kMaxBodyBytes) return fail(413);
+            chunkRemaining = size;
+            if (size == 0) trailerStart = lineStart;
+            state = size == 0 ? State::Trailers : State::ChunkData;
+            return true;
+        }
+
+        // Advances over newly appended bytes of buf. Returns true once a full
+        // request is available; false if more data is needed or on error.
+        bool parse(const std::string& buf) {
+            while (true) {
+                switch (state) {
+                    case State::Complete:
+                        return true;
+                    case State::Error:
+                        return false;
+                    case State::Body:
+                        if (buf.size() - lineStart < contentLength) return false;
+                        end = lineStart + contentLength;
+                        state = State::Complete;
+                        return true;
+                    case State::ChunkData: {
+                        size_t avail = std::min(chunkRemaining, buf.size() - lineStart);
+                        chunkedBody.append(buf, lineStart, avail);
+                        lineStart += avail;
+                        scan = lineStart;
+                        chunkRemaining -= avail;
+                        if (chunkRemaining > 0) return false;
+                        state = State::ChunkDataEnd;
+                        break;
+                    }
+                    default: {
+                        // Line-oriented states: find the next '\n' past what was already scanned
+                        const char* base = buf.data();
+                        const void* nl = scan < buf.size() ? memchr(base + scan, '\n', buf.size() - scan) : nullptr;
+                        if (!nl) {
+                            scan = buf.size();
+                            if (state == State::RequestLine && buf.size() - lineStart > kMaxRequestLineBytes) return fail(414);
+                            if (state == State::Headers && buf.size() - start > kMaxHeaderBytes) return fail(431);
+                            if (state == State::Trailers && buf.size() - trailerStart > kMaxHeaderBytes) return fail(431);
+                            if ((state == State::ChunkSize || state == State::ChunkDataEnd) &&
+                                buf.size() - lineStart > kMaxChunkLineBytes) return fail(400);
+                            return false;
+                        }
+                        size_t nlPos = static_cast<size_t>(static_cast<const char*>(nl) - base);
+                        size_t len = nlPos - lineStart;
+                        if (len > 0 && base[nlPos - 1] == '\r') --len;
+                        std::string_view line(base + lineStart, len);
+                        size_t off = lineStart;
+                        lineStart = scan = nlPos + 1;
+                        if (state == State::Headers && lineStart - start > kMaxHeaderBytes) return fail(431);
+                        if (state == State::Trailers && lineStart - trailerStart > kMaxHeaderBytes) return fail(431);
+                        if ((state == State::ChunkSize || state == State::ChunkDataEnd) && len > kMaxChunkLineBytes) return fail(400);
+
+                        if (state == State::RequestLine) {
+                            if (line.empty()) { start = lineStart; continue; }  // tolerate leading CRLFs
+                            if (!onRequestLine(line, off)) return false;
+                        } else if (state == State::Headers) {
+                            if (!line.empty()) {
+                                if (!onHeaderLine(line, off)) return false;
+                            } else if (chunked) {
+                                state = State::ChunkSize;
+                            } else if (contentLength > 0) {
+                                state = State::Body;
+                            } else {
+                                end = lineStart;
+                                state = State::Complete;
+                            }
+                        } else if (state == State::ChunkSize) {
+                            if (!onChunkSizeLine(line)) return false;
+                        } else if (state == State::ChunkDataEnd) {
+                            if (!line.empty()) return fail(400);
+                            state = State::ChunkSize;
+                        } else if (state == State::Trailers) {
+                            if (line.empty()) {
+                                end = lineStart;
+                                state = State::Complete;
+                            }
+                        }
+                        break;
+                    }
                 }
-            } else if (input[i] == '+') {
-                decoded += ' ';
+            }
+        }
+
+        // Value of the first header named lowerName (case-insensitive), or empty
+        std::string_view header(const std::string& buf, std::string_view lowerName) const {
+            for (const auto& [name, value] : headers) {
+                if (equalsIgnoreCase(view(buf, name), lowerName)) return view(buf, value);
+            }
+            return std::string_view();
+        }
+
+        // Builds the request map for a Complete request. With splitQuery the
+        // target is split into "path" and "query"; otherwise "path" is the raw target.
+        Value toValue(const std::string& buf, bool splitQuery) const {
+            MapValue headerMap;
+            headerMap.reserve(headers.size());
+            for (const auto& [name, value] : headers) {
+                std::string key(buf, name.off, name.len);
+                for (auto& c : key) c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+                headerMap[std::move(key)] = Value(std::string(buf, value.off, value.len));
+            }
+            MapValue request;
+            request["method"] = Value(std::string(view(buf, method)));
+            std::string_view tgt = view(buf, target);
+            if (splitQuery) {
+                size_t q = tgt.find('?');
+                request["path"] = Value(std::string(tgt.substr(0, q)));
+                request["query"] = Value(q == std::string_view::npos ? std::string("") : std::string(tgt.substr(q + 1)));
             } else {
-                decoded += input[i];
+                request["path"] = Value(std::string(tgt));
+            }
+            request["version"] = Value(std::string(view(buf, version)));
+            request["headers"] = Value(std::move(headerMap));
+            if (chunked) request["body"] = Value(chunkedBody);
+            else request["body"] = Value(std::string(buf, end - contentLength, contentLength));
+            return Value(std::move(request));
+        }
+    };
+
+    // Reads batch options: {"max_per_host": n, "timeout": seconds}
+    static void batchOptions(const std::vector<Value>& args, size_t index, long& maxPerHost, long& timeoutSec) {
+        if (args.size() <= index || !args[index].holds_alternative<MapValue>()) return;
+        const auto& opts = args[index].get<MapValue>();
+        auto it = opts.find("max_per_host");
+        if (it != opts.end()) maxPerHost = std::max(1, toInt(it->second));
+        it = opts.find("timeout");
+        if (it != opts.end()) timeoutSec = std::max(1, toInt(it->second));
+    }
+
+    Value get_many_fn(std::vector<Value>& args) {
+        if (args.empty() || !args[0].holds_alternative<std::vector<Value>>())
+            throw std::runtime_error("http_get_many: requires a list of URLs.");
+        std::vector<BatchRequest> requests;
+        for (const auto& url : args[0].get<std::vector<Value>>()) {
+            if (!url.holds_alternative<std::string>())
+                throw std::runtime_error("http_get_many: every URL must be a string.");
+            requests.push_back(BatchRequest{"GET", url.get<std::string>(), {}, ""});
+        }
+        long maxPerHost = 6, timeoutSec = 30;
+        batchOptions(args, 1, maxPerHost, timeoutSec);
+        return doHttpBatch(requests, maxPerHost, timeoutSec);
+    }
+
+    Value request_batch_fn(std::vector<Value>& args) {
+        if (args.empty() || !args[0].holds_alternative<std::vector<Value>>())
+            throw std::runtime_error("http_request_batch: requires a list of requests.");
+        std::vector<BatchRequest> requests;
+        for (const auto& item : args[0].get<std::vector<Value>>()) {
+            if (item.holds_alternative<std::string>()) {
+                requests.push_back(BatchRequest{"GET", item.get<std::string>(), {}, ""});
+                continue;
             }
+            if (!item.holds_alternative<MapValue>())
+                throw std::runtime_error("http_request_batch: each request must be a URL or {method, url, headers, body}.");
+            const auto& map = item.get<MapValue>();
+            BatchRequest req{"GET", "", {}, ""};
+            auto it = map.find("url");
+            if (it == map.end() || !it->second.holds_alternative<std::string>())
+                throw std::runtime_error("http_request_batch: request is missing 'url'.");
+            req.url = it->second.get<std::string>();
+            it = map.find("method");
+            if (it != map.end() && it->second.holds_alternative<std::string>()) req.method = it->second.get<std::string>();
+            it = map.find("headers");
+            if (it != map.end() && it->second.holds_alternative<MapValue>())
+                req.headers = it->second.get<MapValue>();
+            it = map.find("body");
+            if (it != map.end() && it->second.holds_alternative<std::string>()) req.body = it->second.get<std::string>();
+            requests.push_back(std::move(req));
+        }
+        long maxPerHost = 6, timeoutSec = 30;
+        batchOptions(args, 1, maxPerHost, timeoutSec);
+        return doHttpBatch(requests, maxPerHost, timeoutSec);
+    }
+
+    static const char* statusText(int status) {
+        switch (status) {
+            case 200: return "OK";
+            case 201: return "Created";
+            case 204: return "No Content";
+            case 206: return "Partial Content";
+            case 301: return "Moved Permanently";
+            case 302: return "Found";
+            case 304: return "Not Modified";
+            case 400: return "Bad Request";
+            case 401: return "Unauthorized";
+            case 403: return "Forbidden";
+            case 404: return "Not Found";
+            case 405: return "Method Not Allowed";
+            case 409: return "Conflict";
+            case 411: return "Length Required";
+            case 413: return "Payload Too Large";
+            case 414: return "URI Too Long";
+            case 416: return "Range Not Satisfiable";
+            case 431: return "Request Header Fields Too Large";
+            case 500: return "Internal Server Error";
+            case 501: return "Not Implemented";
+            case 503: return "Service Unavailable";
+            default:  return "OK";
         }
-        return decoded;
     }
 
     Value server_fn(std::vector<Value>& args) {
@@ -2474,187 +7432,707 @@ namespace NetHTTP {
         addr.sin_addr.s_addr = INADDR_ANY;
         memset(addr.sin_zero, 0, sizeof(addr.sin_zero));
 
-        if (::bind(fd, (struct sockaddr*)&addr, sizeof(addr)) < 0) {
-            ::close(fd);
-            throw std::runtime_error("http_server: bind failed on port " + std::to_string(port));
+        if (::bind(fd, (struct sockaddr*)&addr, sizeof(addr)) < 0) {
+            ::close(fd);
+            throw std::runtime_error("http_server: bind failed on port " + std::to_string(port));
+        }
+
+        if (::listen(fd, 128) < 0) {
+            ::close(fd);
+            throw std::runtime_error("http_server: listen failed.");
+        }
+
+        return fd;
+        #else
+        throw std::runtime_error("http_server: not supported on Windows.");
+        #endif
+    }
+
+    Value server_next_fn(std::vector<Value>& args) {
+        #ifndef _WIN32
+        if (args.empty()) throw std::runtime_error("http_server_next: requires server handle.");
+        int server_fd = toInt(args[0]);
+
+        struct sockaddr_in client_addr;
+        socklen_t client_len = sizeof(client_addr);
+        Console::flush();   // Don't hold output back while waiting for a request
+        int client_fd = ::accept(server_fd, (struct sockaddr*)&client_addr, &client_len);
+        if (client_fd < 0) throw std::runtime_error("http_server_next: accept failed.");
+
+        // Read until the parser has a complete request (or the peer stops sending)
+        std::string request;
+        RequestParser parser;
+        char buffer[8192];
+        while (!parser.parse(request) && parser.state != RequestParser::State::Error) {
+            ssize_t n = ::recv(client_fd, buffer, sizeof(buffer), 0);
+            if (n <= 0) break;
+            request.append(buffer, n);
+        }
+
+        MapValue result;
+        if (parser.state == RequestParser::State::Complete) {
+            result = parser.toValue(request, false).get<MapValue>();
+        } else {
+            result["method"] = Value(std::string(""));
+            result["path"] = Value(std::string(""));
+            result["headers"] = Value(MapValue());
+            result["body"] = Value(std::string(""));
+        }
+        result["client"] = Value(client_fd);
+        return result;
+        #else
+        throw std::runtime_error("http_server_next: not supported on Windows.");
+        #endif
+    }
+
+    Value server_respond_fn(std::vector<Value>& args) {
+        #ifndef _WIN32
+        if (args.size() < 4) throw std::runtime_error("http_server_respond: requires client, status, headers, body.");
+        int client_fd = toInt(args[0]);
+        int status = toInt(args[1]);
+
+        MapValue headers;
+        if (args[2].holds_alternative<MapValue>())
+            headers = args[2].get<MapValue>();
+
+        std::string body = "";
+        if (args[3].holds_alternative<std::string>())
+            body = args[3].get<std::string>();
+
+        std::string response = "HTTP/1.1 " + std::to_string(status) + " " + statusText(status) + "\r\n";
+
+        // Add headers
+        bool has_content_length = false;
+        bool has_connection = false;
+        for (const auto& [k, val] : headers) {
+            if (val.holds_alternative<std::string>()) {
+                std::string key = keyToString(k);
+                response += key + ": " + val.get<std::string>() + "\r\n";
+                std::string lower_key = key;
+                std::transform(lower_key.begin(), lower_key.end(), lower_key.begin(), ::tolower);
+                if (lower_key == "content-length") has_content_length = true;
+                if (lower_key == "connection") has_connection = true;
+            }
+        }
+        if (!has_content_length)
+            response += "Content-Length: " + std::to_string(body.size()) + "\r\n";
+        if (!has_connection)
+            response += "Connection: close\r\n";
+        response += "\r\n";
+        response += body;
+
+        ::send(client_fd, response.c_str(), response.size(), 0);
+        ::close(client_fd);
+        return true;
+        #else
+        throw std::runtime_error("http_server_respond: not supported on Windows.");
+        #endif
+    }
+
+    Value server_close_fn(std::vector<Value>& args) {
+        #ifndef _WIN32
+        if (args.empty()) throw std::runtime_error("http_server_close: requires handle.");
+        ::close(toInt(args[0]));
+        return true;
+        #else
+        throw std::runtime_error("http_server_close: not supported on Windows.");
+        #endif
+    }
+
+    // ---- http_serve: multi-worker server with keep-alive and pipelining ----
+    //
+    // The calling thread runs an epoll loop that accepts connections and waits
+    // for readable clients; client fds are armed EPOLLONESHOT, so a connection
+    // is owned by at most one worker at a time. A worker drains the socket,
+    // answers every complete request in its buffer (pipelining) in order, and
+    // re-arms the fd unless the connection is closing.
+
+    struct ServeConnection {
+        int fd;
+        std::string buffer;
+        RequestParser parser;
+    };
+
+    static std::mutex serveRegistryMutex;
+    static std::unordered_map<int, std::shared_ptr<std::atomic<bool>>> serveStopFlags;
+
+    // Serializes a handler result: a string body, or {status, headers, body}.
+    static void appendServeResponse(std::string& out, const Value& result, bool keepAlive) {
+        int status = 200;
+        std::string body;
+        std::string contentType = "text/plain; charset=utf-8";
+        std::string extraHeaders;
+        const Value* bodyVal = &result;
+        if (result.holds_alternative<MapValue>()) {
+            const auto& map = result.get<MapValue>();
+            auto statusIt = map.find("status");
+            if (statusIt != map.end() && statusIt->second.holds_alternative<int>()) status = statusIt->second.get<int>();
+            auto headersIt = map.find("headers");
+            if (headersIt != map.end() && headersIt->second.holds_alternative<MapValue>()) {
+                for (const auto& [k, val] : headersIt->second.get<MapValue>()) {
+                    if (!val.holds_alternative<std::string>()) continue;
+                    std::string key = keyToString(k);
+                    std::string lower = key;
+                    std::transform(lower.begin(), lower.end(), lower.begin(), ::tolower);
+                    if (lower == "content-type") contentType = val.get<std::string>();
+                    else if (lower != "content-length" && lower != "connection")
+                        extraHeaders += key + ": " + val.get<std::string>() + "\r\n";
+                }
+            }
+            auto bodyIt = map.find("body");
+            static const Value empty = Value(std::string(""));
+            bodyVal = bodyIt != map.end() ? &bodyIt->second : &empty;
+        }
+        if (bodyVal->holds_alternative<std::string>()) {
+            body = bodyVal->get<std::string>();
+        } else if (!bodyVal->holds_alternative<std::monostate>()) {
+            body = Json::valueToJson(*bodyVal);
+            contentType = "application/json";
+        }
+
+        out += "HTTP/1.1 " + std::to_string(status) + " " + statusText(status) + "\r\n";
+        out += "Content-Type: " + contentType + "\r\n";
+        out += extraHeaders;
+        out += "Content-Length: " + std::to_string(body.size()) + "\r\n";
+        out += keepAlive ? "Connection: keep-alive\r\n\r\n" : "Connection: close\r\n\r\n";
+        out += body;
+    }
+
+#ifdef __linux__
+    // Writes all of data to a non-blocking socket, waiting for writability as needed.
+    static bool sendAll(int fd, const std::string& data) {
+        size_t sent = 0;
+        while (sent < data.size()) {
+            ssize_t n = ::send(fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+            if (n > 0) {
+                sent += static_cast<size_t>(n);
+            } else if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+                struct pollfd pfd = {fd, POLLOUT, 0};
+                if (::poll(&pfd, 1, 5000) <= 0) return false;
+            } else if (n < 0 && errno == EINTR) {
+                continue;
+            } else {
+                return false;
+            }
+        }
+        return true;
+    }
+#endif
+
+    // ---- Static files: sendfile for large files, mmap cache for small ones ----
+
+    struct StaticRequest {
+        bool head = false;
+        bool keepAlive = false;
+        std::string ifNoneMatch;
+        std::string ifModifiedSince;
+        std::string range;
+    };
+
+    struct StaticMount {
+        std::string prefix;  // URL prefix, e.g. "/static"
+        std::string root;    // canonical directory
+    };
+
+    static std::mutex staticMountsMutex;
+    static std::unordered_map<int, std::vector<StaticMount>> staticMounts;
+
+    static std::string mimeType(const std::string& path) {
+        static const std::unordered_map<std::string, std::string> types = {
+            {".html", "text/html; charset=utf-8"}, {".htm", "text/html; charset=utf-8"},
+            {".css", "text/css; charset=utf-8"}, {".js", "text/javascript; charset=utf-8"},
+            {".json", "application/json"}, {".txt", "text/plain; charset=utf-8"},
+            {".csv", "text/csv; charset=utf-8"}, {".xml", "application/xml"},
+            {".svg", "image/svg+xml"}, {".png", "image/png"}, {".jpg", "image/jpeg"},
+            {".jpeg", "image/jpeg"}, {".gif", "image/gif"}, {".webp", "image/webp"},
+            {".ico", "image/x-icon"}, {".wasm", "application/wasm"}, {".pdf", "application/pdf"},
+            {".woff", "font/woff"}, {".woff2", "font/woff2"}, {".mp4", "video/mp4"},
+        };
+        size_t dot = path.rfind('.');
+        if (dot != std::string::npos && path.find('/', dot) == std::string::npos) {
+            std::string ext = path.substr(dot);
+            std::transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
+            auto it = types.find(ext);
+            if (it != types.end()) return it->second;
+        }
+        return "application/octet-stream";
+    }
+
+#ifdef __linux__
+    static constexpr size_t kStaticCacheFileBytes = 256 * 1024;
+    static constexpr size_t kStaticCacheTotalBytes = 64 * 1024 * 1024;
+
+    // A small file mapped read-only; kept alive by shared_ptr while being sent
+    struct MappedFile {
+        void* addr = MAP_FAILED;
+        size_t size = 0;
+        time_t mtime = 0;
+        ~MappedFile() { if (addr != MAP_FAILED) munmap(addr, size); }
+    };
+
+    // LRU cache of mapped files, most recently served first
+    static std::mutex staticCacheMutex;
+    static std::list<std::pair<std::string, std::shared_ptr<MappedFile>>> staticCacheOrder;
+    static std::unordered_map<std::string, decltype(staticCacheOrder)::iterator> staticCacheIndex;
+    static size_t staticCacheBytes = 0;
+
+    // Caller holds staticCacheMutex
+    static void evictMapping(decltype(staticCacheOrder)::iterator it) {
+        staticCacheBytes -= it->second->size;
+        staticCacheIndex.erase(it->first);
+        staticCacheOrder.erase(it);
+    }
+
+    static void evictMapping(const std::string& path) {
+        std::lock_guard<std::mutex> lock(staticCacheMutex);
+        auto it = staticCacheIndex.find(path);
+        if (it != staticCacheIndex.end()) evictMapping(it->second);
+    }
+
+    static std::shared_ptr<MappedFile> cachedMapping(const std::string& path, const struct stat& st) {
+        {
+            std::lock_guard<std::mutex> lock(staticCacheMutex);
+            auto it = staticCacheIndex.find(path);
+            if (it != staticCacheIndex.end()) {
+                auto& file = it->second->second;
+                if (file->mtime == st.st_mtime && file->size == static_cast<size_t>(st.st_size)) {
+                    staticCacheOrder.splice(staticCacheOrder.begin(), staticCacheOrder, it->second);
+                    return file;
+                }
+                evictMapping(it->second);
+            }
+        }
+        int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) return nullptr;
+        auto file = std::make_shared<MappedFile>();
+        file->size = static_cast<size_t>(st.st_size);
+        file->mtime = st.st_mtime;
+        file->addr = mmap(nullptr, file->size, PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if (file->addr == MAP_FAILED) return nullptr;
+        std::lock_guard<std::mutex> lock(staticCacheMutex);
+        auto it = staticCacheIndex.find(path);
+        if (it != staticCacheIndex.end()) evictMapping(it->second);
+        while (staticCacheBytes + file->size > kStaticCacheTotalBytes && !staticCacheOrder.empty()) {
+            evictMapping(std::prev(staticCacheOrder.end()));
+        }
+        staticCacheOrder.emplace_front(path, file);
+        staticCacheIndex[path] = staticCacheOrder.begin();
+        staticCacheBytes += file->size;
+        return file;
+    }
+
+    static std::string httpDate(time_t t) {
+        struct tm tm;
+        gmtime_r(&t, &tm);
+        char buf[64];
+        strftime(buf, sizeof(buf), "%a, %d %b %Y %H:%M:%S GMT", &tm);
+        return buf;
+    }
+
+    // Parses a single "bytes=a-b" range against size; false if unsatisfiable
+    static bool parseRange(const std::string& header, size_t size, size_t& first, size_t& last) {
+        if (header.compare(0, 6, "bytes=") != 0 || header.find(',') != std::string::npos) return false;
+        std::string spec = header.substr(6);
+        size_t dash = spec.find('-');
+        if (dash == std::string::npos || size == 0) return false;
+        try {
+            if (dash == 0) {
+                size_t suffix = std::stoull(spec.substr(1));
+                if (suffix == 0) return false;
+                first = suffix >= size ? 0 : size - suffix;
+                last = size - 1;
+            } else {
+                first = std::stoull(spec.substr(0, dash));
+                last = dash + 1 < spec.size() ? std::stoull(spec.substr(dash + 1)) : size - 1;
+                if (last >= size) last = size - 1;
+            }
+        } catch (...) {
+            return false;
+        }
+        return first <= last && first < size;
+    }
+
+    // Writes a full response for filePath. Bytes already queued in out are sent
+    // first so pipelined responses stay in order. Returns false if the socket failed.
+    static bool sendStaticFile(int fd, std::string& out, const std::string& filePath, const StaticRequest& req) {
+        struct stat st;
+        if (::stat(filePath.c_str(), &st) < 0 || !S_ISREG(st.st_mode)) {
+            appendServeResponse(out, Value(MapValue{
+                {"status", Value(404)}, {"body", Value(std::string("Not Found"))}}), req.keepAlive);
+            return true;
+        }
+        size_t size = static_cast<size_t>(st.st_size);
+        char etagBuf[64];
+        snprintf(etagBuf, sizeof(etagBuf), "\"%zx-%lx\"", size, static_cast<long>(st.st_mtime));
+        std::string etag = etagBuf;
+        std::string lastModified = httpDate(st.st_mtime);
+        std::string common = "ETag: " + etag + "\r\nLast-Modified: " + lastModified +
+                             "\r\nAccept-Ranges: bytes\r\n" +
+                             (req.keepAlive ? "Connection: keep-alive\r\n" : "Connection: close\r\n");
+
+        bool notModified = false;
+        if (!req.ifNoneMatch.empty()) {
+            notModified = req.ifNoneMatch == "*" || req.ifNoneMatch.find(etag) != std::string::npos;
+        } else if (!req.ifModifiedSince.empty()) {
+            struct tm tm;
+            memset(&tm, 0, sizeof(tm));
+            if (strptime(req.ifModifiedSince.c_str(), "%a, %d %b %Y %H:%M:%S GMT", &tm))
+                notModified = st.st_mtime <= timegm(&tm);
+        }
+        if (notModified) {
+            out += "HTTP/1.1 304 Not Modified\r\n" + common + "\r\n";
+            return true;
         }
 
-        if (::listen(fd, 128) < 0) {
-            ::close(fd);
-            throw std::runtime_error("http_server: listen failed.");
+        int status = 200;
+        size_t first = 0, last = size ? size - 1 : 0;
+        std::string rangeHeader;
+        if (!req.range.empty()) {
+            if (!parseRange(req.range, size, first, last)) {
+                out += "HTTP/1.1 416 Range Not Satisfiable\r\nContent-Range: bytes */" +
+                       std::to_string(size) + "\r\nContent-Length: 0\r\n" + common + "\r\n";
+                return true;
+            }
+            status = 206;
+            rangeHeader = "Content-Range: bytes " + std::to_string(first) + "-" + std::to_string(last) +
+                          "/" + std::to_string(size) + "\r\n";
+        }
+        size_t length = size ? last - first + 1 : 0;
+        out += "HTTP/1.1 " + std::to_string(status) + " " + statusText(status) + "\r\n";
+        out += "Content-Type: " + mimeType(filePath) + "\r\n";
+        out += "Content-Length: " + std::to_string(length) + "\r\n" + rangeHeader + common + "\r\n";
+        if (req.head || length == 0) return true;
+
+        if (size <= kStaticCacheFileBytes) {
+            auto mapped = cachedMapping(filePath, st);
+            if (mapped) {
+                // Touching mapped pages past a truncated file's end raises SIGBUS,
+                // so re-check the file right before copying; sendfile copes with it
+                struct stat now;
+                if (::stat(filePath.c_str(), &now) == 0 && static_cast<size_t>(now.st_size) == mapped->size &&
+                    now.st_mtime == mapped->mtime) {
+                    out.append(static_cast<const char*>(mapped->addr) + first, length);
+                    return true;
+                }
+                evictMapping(filePath);
+            }
         }
 
-        return fd;
-        #else
-        throw std::runtime_error("http_server: not supported on Windows.");
-        #endif
+        // Large file: flush queued bytes, then let the kernel copy the body
+        if (!sendAll(fd, out)) return false;
+        out.clear();
+        int fileFd = ::open(filePath.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fileFd < 0) return false;
+        off_t offset = static_cast<off_t>(first);
+        size_t remaining = length;
+        bool ok = true;
+        while (remaining > 0) {
+            ssize_t n = ::sendfile(fd, fileFd, &offset, remaining);
+            if (n > 0) {
+                remaining -= static_cast<size_t>(n);
+            } else if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+                struct pollfd pfd = {fd, POLLOUT, 0};
+                if (::poll(&pfd, 1, 5000) <= 0) { ok = false; break; }
+            } else if (n < 0 && errno == EINTR) {
+                continue;
+            } else {
+                ok = false;
+                break;
+            }
+        }
+        ::close(fileFd);
+        return ok;
     }
 
-    Value server_next_fn(std::vector<Value>& args) {
-        #ifndef _WIN32
-        if (args.empty()) throw std::runtime_error("http_server_next: requires server handle.");
-        int server_fd = toInt(args[0]);
-
-        struct sockaddr_in client_addr;
-        socklen_t client_len = sizeof(client_addr);
-        int client_fd = ::accept(server_fd, (struct sockaddr*)&client_addr, &client_len);
-        if (client_fd < 0) throw std::runtime_error("http_server_next: accept failed.");
+    // Maps a request target onto a mount's directory; empty if it escapes the root
+    static std::string resolveStaticPath(const StaticMount& mount, std::string_view target) {
+        size_t q = target.find('?');
+        std::string_view path = target.substr(0, q).substr(mount.prefix.size());
+        std::string decoded = Encoding::percentDecode(path, false);
+        if (decoded.find('\0') != std::string::npos) return "";
+        // Reject any ".." segment
+        size_t pos = 0;
+        while (pos <= decoded.size()) {
+            size_t slash = decoded.find('/', pos);
+            if (slash == std::string::npos) slash = decoded.size();
+            if (decoded.compare(pos, slash - pos, "..") == 0 && slash - pos == 2) return "";
+            pos = slash + 1;
+        }
+        std::string full = mount.root;
+        if (decoded.empty() || decoded[0] != '/') full += '/';
+        full += decoded;
+        struct stat st;
+        if (::stat(full.c_str(), &st) == 0 && S_ISDIR(st.st_mode)) {
+            if (full.back() != '/') full += '/';
+            full += "index.html";
+        }
+        return full;
+    }
 
-        // Read HTTP request headers (loop until we find \r\n\r\n or hit limit)
-        std::string request;
-        char buffer[8192];
-        size_t headers_end_pos = std::string::npos;
+    static const StaticMount* findStaticMount(const std::vector<StaticMount>& mounts, std::string_view target) {
+        for (const auto& mount : mounts) {
+            if (target.compare(0, mount.prefix.size(), mount.prefix) != 0) continue;
+            // Prefix must end on a path boundary: "/static" matches "/static/x" but not "/staticx"
+            if (mount.prefix.back() == '/' || target.size() == mount.prefix.size() ||
+                target[mount.prefix.size()] == '/' || target[mount.prefix.size()] == '?')
+                return &mount;
+        }
+        return nullptr;
+    }
+#endif
 
-        while (headers_end_pos == std::string::npos && request.size() < 1048576) {  // 1MB header limit
-            ssize_t n = ::recv(client_fd, buffer, sizeof(buffer), 0);
-            if (n <= 0) break;
-            request.append(buffer, n);
-            headers_end_pos = request.find("\r\n\r\n");
+    void serve(int serverFd, size_t workerCount, const RequestHandler& handler) {
+        Console::flush();   // Startup output shouldn't wait behind a server that runs until stopped
+        #ifdef __linux__
+        auto stopFlag = std::make_shared<std::atomic<bool>>(false);
+        {
+            std::lock_guard<std::mutex> lock(serveRegistryMutex);
+            serveStopFlags[serverFd] = stopFlag;
+        }
+        int epfd = epoll_create1(EPOLL_CLOEXEC);
+        if (epfd < 0) throw std::runtime_error("http_serve: epoll_create1 failed.");
+        int listenFlags = fcntl(serverFd, F_GETFL, 0);
+        fcntl(serverFd, F_SETFL, listenFlags | O_NONBLOCK);
+        struct epoll_event lev;
+        memset(&lev, 0, sizeof(lev));
+        lev.events = EPOLLIN;
+        lev.data.fd = serverFd;
+        epoll_ctl(epfd, EPOLL_CTL_ADD, serverFd, &lev);
+
+        std::vector<StaticMount> mounts;
+        {
+            std::lock_guard<std::mutex> lock(staticMountsMutex);
+            auto it = staticMounts.find(serverFd);
+            if (it != staticMounts.end()) mounts = it->second;
         }
 
-        // Parse request line
-        std::unordered_map<std::string, Value> result;
-        result["client"] = Value(client_fd);
-        result["method"] = Value(std::string(""));
-        result["path"] = Value(std::string(""));
-        result["headers"] = Value(std::unordered_map<std::string, Value>());
-        result["body"] = Value(std::string(""));
-
-        size_t first_line_end = request.find("\r\n");
-        if (first_line_end != std::string::npos) {
-            std::string request_line = request.substr(0, first_line_end);
-            size_t sp1 = request_line.find(' ');
-            if (sp1 != std::string::npos) {
-                result["method"] = Value(request_line.substr(0, sp1));
-                size_t sp2 = request_line.find(' ', sp1 + 1);
-                if (sp2 != std::string::npos) {
-                    result["path"] = Value(request_line.substr(sp1 + 1, sp2 - sp1 - 1));
-                } else {
-                    result["path"] = Value(request_line.substr(sp1 + 1));
-                }
+        std::mutex connsMutex;
+        std::unordered_map<int, std::shared_ptr<ServeConnection>> conns;
+        std::mutex queueMutex;
+        std::condition_variable queueCv;
+        std::deque<int> readyFds;
+
+        auto closeConn = [&](int fd) {
+            {
+                std::lock_guard<std::mutex> lock(connsMutex);
+                conns.erase(fd);
             }
+            epoll_ctl(epfd, EPOLL_CTL_DEL, fd, nullptr);
+            ::close(fd);
+        };
+
+        auto rearm = [&](int fd) {
+            struct epoll_event ev;
+            memset(&ev, 0, sizeof(ev));
+            ev.events = EPOLLIN | EPOLLRDHUP | EPOLLONESHOT;
+            ev.data.fd = fd;
+            epoll_ctl(epfd, EPOLL_CTL_MOD, fd, &ev);
+        };
+
+        auto worker = [&](size_t id) {
+            char chunk[16384];
+            while (true) {
+                int fd;
+                {
+                    std::unique_lock<std::mutex> lock(queueMutex);
+                    queueCv.wait(lock, [&] { return !readyFds.empty() || stopFlag->load(); });
+                    if (readyFds.empty()) return;
+                    fd = readyFds.front();
+                    readyFds.pop_front();
+                }
+                std::shared_ptr<ServeConnection> conn;
+                {
+                    std::lock_guard<std::mutex> lock(connsMutex);
+                    auto it = conns.find(fd);
+                    if (it == conns.end()) continue;
+                    conn = it->second;
+                }
 
-            // Parse headers
-            std::unordered_map<std::string, Value> headers;
-            size_t pos = first_line_end + 2;
-            size_t hdr_end = headers_end_pos != std::string::npos ? headers_end_pos : request.size();
-
-            long content_length = -1;
-
-            while (pos < hdr_end) {
-                size_t line_end = request.find("\r\n", pos);
-                if (line_end == std::string::npos || line_end > hdr_end) break;
-                std::string line = request.substr(pos, line_end - pos);
-                size_t colon = line.find(':');
-                if (colon != std::string::npos) {
-                    std::string key = line.substr(0, colon);
-                    std::string val = line.substr(colon + 1);
-                    size_t val_start = val.find_first_not_of(' ');
-                    if (val_start != std::string::npos) val = val.substr(val_start);
-                    std::transform(key.begin(), key.end(), key.begin(), ::tolower);
-                    headers[key] = Value(val);
-                    if (key == "content-length") {
-                        try { content_length = std::stol(val); } catch (...) {}
-                    }
+                bool peerClosed = false;
+                while (true) {
+                    ssize_t n = ::recv(fd, chunk, sizeof(chunk), 0);
+                    if (n > 0) { conn->buffer.append(chunk, n); continue; }
+                    if (n == 0) peerClosed = true;
+                    else if (errno == EINTR) continue;
+                    else if (errno != EAGAIN && errno != EWOULDBLOCK) peerClosed = true;
+                    break;
                 }
-                pos = line_end + 2;
-            }
-            result["headers"] = Value(headers);
 
-            // Read body based on Content-Length
-            if (headers_end_pos != std::string::npos) {
-                size_t body_start = headers_end_pos + 4;
-                std::string body_data;
-                if (body_start < request.size()) {
-                    body_data = request.substr(body_start);
+                // Answer every complete request in the buffer, in order
+                std::string out;
+                bool closing = false;
+                RequestParser& parser = conn->parser;
+                while (!closing && parser.parse(conn->buffer)) {
+                    bool keepAlive = parser.keepAlive;
+                    // Static mounts are answered here without entering the interpreter
+                    std::string_view method = RequestParser::view(conn->buffer, parser.method);
+                    const StaticMount* mount = mounts.empty() || (method != "GET" && method != "HEAD") ? nullptr :
+                        findStaticMount(mounts, RequestParser::view(conn->buffer, parser.target));
+                    if (mount) {
+                        StaticRequest sreq;
+                        sreq.head = method == "HEAD";
+                        sreq.keepAlive = keepAlive;
+                        sreq.ifNoneMatch = std::string(parser.header(conn->buffer, "if-none-match"));
+                        sreq.ifModifiedSince = std::string(parser.header(conn->buffer, "if-modified-since"));
+                        sreq.range = std::string(parser.header(conn->buffer, "range"));
+                        std::string filePath = resolveStaticPath(*mount, RequestParser::view(conn->buffer, parser.target));
+                        parser.reset(parser.end);
+                        if (filePath.empty()) {
+                            appendServeResponse(out, Value(MapValue{
+                                {"status", Value(403)}, {"body", Value(std::string("Forbidden"))}}), keepAlive);
+                        } else if (!sendStaticFile(fd, out, filePath, sreq)) {
+                            closing = true;
+                        }
+                        if (!keepAlive) closing = true;
+                        continue;
+                    }
+                    Value request = parser.toValue(conn->buffer, true);
+                    parser.reset(parser.end);
+                    Value result;
+                    try {
+                        result = handler(id, request);
+                    } catch (const std::exception& e) {
+                        std::cerr << "[http_serve error] " << e.what() << std::endl;
+                        result = Value(MapValue{
+                            {"status", Value(500)}, {"body", Value(std::string("Internal Server Error"))}});
+                    } catch (...) {
+                        // Anything else escaping the handler would terminate the worker thread
+                        std::cerr << "[http_serve error] handler threw an uncaught exception" << std::endl;
+                        result = Value(MapValue{
+                            {"status", Value(500)}, {"body", Value(std::string("Internal Server Error"))}});
+                    }
+                    appendServeResponse(out, result, keepAlive);
+                    if (!keepAlive) closing = true;
                 }
+                if (parser.state == RequestParser::State::Error) {
+                    appendServeResponse(out, Value(MapValue{
+                        {"status", Value(parser.errorStatus)},
+                        {"body", Value(std::string(statusText(parser.errorStatus)))}}), false);
+                    closing = true;
+                }
+                parser.compact(conn->buffer);
 
-                // If Content-Length specified, read remaining body bytes
-                if (content_length > 0 && static_cast<long>(body_data.size()) < content_length) {
-                    long remaining = content_length - static_cast<long>(body_data.size());
-                    while (remaining > 0) {
-                        ssize_t n = ::recv(client_fd, buffer, std::min(static_cast<long>(sizeof(buffer)), remaining), 0);
-                        if (n <= 0) break;
-                        body_data.append(buffer, n);
-                        remaining -= n;
+                if (!out.empty() && !sendAll(fd, out)) closing = true;
+                if (closing || peerClosed || stopFlag->load()) closeConn(fd);
+                else rearm(fd);
+            }
+        };
+
+        std::vector<std::thread> workers;
+        for (size_t i = 0; i < std::max<size_t>(1, workerCount); ++i) workers.emplace_back(worker, i);
+
+        struct epoll_event events[256];
+        while (!stopFlag->load()) {
+            int n = epoll_wait(epfd, events, 256, 100);
+            for (int i = 0; i < n; ++i) {
+                int fd = events[i].data.fd;
+                if (fd == serverFd) {
+                    while (true) {
+                        int client = ::accept4(serverFd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+                        if (client < 0) break;
+                        int one = 1;
+                        setsockopt(client, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+                        {
+                            std::lock_guard<std::mutex> lock(connsMutex);
+                            auto conn = std::make_shared<ServeConnection>();
+                            conn->fd = client;
+                            conns[client] = conn;
+                        }
+                        struct epoll_event cev;
+                        memset(&cev, 0, sizeof(cev));
+                        cev.events = EPOLLIN | EPOLLRDHUP | EPOLLONESHOT;
+                        cev.data.fd = client;
+                        epoll_ctl(epfd, EPOLL_CTL_ADD, client, &cev);
                     }
+                } else {
+                    std::lock_guard<std::mutex> lock(queueMutex);
+                    readyFds.push_back(fd);
+                    queueCv.notify_one();
                 }
-                result["body"] = Value(body_data);
             }
         }
 
-        return result;
+        queueCv.notify_all();
+        for (auto& t : workers) t.join();
+        {
+            std::lock_guard<std::mutex> lock(connsMutex);
+            for (auto& [fd, conn] : conns) ::close(fd);
+            conns.clear();
+        }
+        ::close(epfd);
+        fcntl(serverFd, F_SETFL, listenFlags);
+        std::lock_guard<std::mutex> lock(serveRegistryMutex);
+        serveStopFlags.erase(serverFd);
         #else
-        throw std::runtime_error("http_server_next: not supported on Windows.");
+        throw std::runtime_error("http_serve: requires epoll (Linux).");
         #endif
     }
 
-    Value server_respond_fn(std::vector<Value>& args) {
-        #ifndef _WIN32
-        if (args.size() < 4) throw std::runtime_error("http_server_respond: requires client, status, headers, body.");
-        int client_fd = toInt(args[0]);
-        int status = toInt(args[1]);
-
-        std::unordered_map<std::string, Value> headers;
-        if (args[2].holds_alternative<std::unordered_map<std::string, Value>>())
-            headers = args[2].get<std::unordered_map<std::string, Value>>();
-
-        std::string body = "";
-        if (args[3].holds_alternative<std::string>())
-            body = args[3].get<std::string>();
+    Value serve_fn(std::vector<Value>& args) {
+        // Reached only when http_serve is called indirectly; the interpreter
+        // handles direct calls so worker threads can invoke the Yen handler.
+        throw std::runtime_error("http_serve: must be called directly as http_serve(server, handler[, workers]).");
+    }
 
-        // Build status text
-        std::string status_text = "OK";
-        if (status == 200) status_text = "OK";
-        else if (status == 201) status_text = "Created";
-        else if (status == 204) status_text = "No Content";
-        else if (status == 301) status_text = "Moved Permanently";
-        else if (status == 302) status_text = "Found";
-        else if (status == 400) status_text = "Bad Request";
-        else if (status == 401) status_text = "Unauthorized";
-        else if (status == 403) status_text = "Forbidden";
-        else if (status == 404) status_text = "Not Found";
-        else if (status == 405) status_text = "Method Not Allowed";
-        else if (status == 409) status_text = "Conflict";
-        else if (status == 500) status_text = "Internal Server Error";
-
-        std::string response = "HTTP/1.1 " + std::to_string(status) + " " + status_text + "\r\n";
+    Value static_fn(std::vector<Value>& args) {
+        #ifdef __linux__
+        if (args.size() < 3 || !args[1].holds_alternative<std::string>() || !args[2].holds_alternative<std::string>())
+            throw std::runtime_error("http_static: requires server, url prefix and directory.");
+        std::error_code ec;
+        auto root = std::filesystem::canonical(args[2].get<std::string>(), ec);
+        if (ec || !std::filesystem::is_directory(root))
+            throw std::runtime_error("http_static: not a directory: " + args[2].get<std::string>());
+        std::string prefix = args[1].get<std::string>();
+        if (prefix.empty() || prefix[0] != '/') prefix = "/" + prefix;
+        std::lock_guard<std::mutex> lock(staticMountsMutex);
+        staticMounts[toInt(args[0])].push_back(StaticMount{prefix, root.string()});
+        return true;
+        #else
+        throw std::runtime_error("http_static: requires Linux.");
+        #endif
+    }
 
-        // Add headers
-        bool has_content_length = false;
-        bool has_connection = false;
-        for (const auto& [key, val] : headers) {
-            if (val.holds_alternative<std::string>()) {
-                response += key + ": " + val.get<std::string>() + "\r\n";
-                std::string lower_key = key;
-                std::transform(lower_key.begin(), lower_key.end(), lower_key.begin(), ::tolower);
-                if (lower_key == "content-length") has_content_length = true;
-                if (lower_key == "connection") has_connection = true;
+    Value send_file_fn(std::vector<Value>& args) {
+        #ifdef __linux__
+        if (args.size() < 2 || !args[1].holds_alternative<std::string>())
+            throw std::runtime_error("http_send_file: requires client and file path.");
+        int client_fd = toInt(args[0]);
+        StaticRequest req;
+        if (args.size() >= 3 && args[2].holds_alternative<MapValue>()) {
+            // Conditional and range headers come from the http_server_next request
+            const auto& request = args[2].get<MapValue>();
+            auto methodIt = request.find("method");
+            req.head = methodIt != request.end() && methodIt->second.holds_alternative<std::string>() &&
+                       methodIt->second.get<std::string>() == "HEAD";
+            auto headersIt = request.find("headers");
+            if (headersIt != request.end() && headersIt->second.holds_alternative<MapValue>()) {
+                const auto& headers = headersIt->second.get<MapValue>();
+                auto get = [&](const char* key) {
+                    auto it = headers.find(key);
+                    return it != headers.end() && it->second.holds_alternative<std::string>() ? it->second.get<std::string>() : std::string();
+                };
+                req.ifNoneMatch = get("if-none-match");
+                req.ifModifiedSince = get("if-modified-since");
+                req.range = get("range");
             }
         }
-        if (!has_content_length)
-            response += "Content-Length: " + std::to_string(body.size()) + "\r\n";
-        if (!has_connection)
-            response += "Connection: close\r\n";
-        response += "\r\n";
-        response += body;
-
-        ::send(client_fd, response.c_str(), response.size(), 0);
+        std::string out;
+        bool ok = sendStaticFile(client_fd, out, args[1].get<std::string>(), req) && sendAll(client_fd, out);
         ::close(client_fd);
-        return true;
+        return ok;
         #else
-        throw std::runtime_error("http_server_respond: not supported on Windows.");
+        throw std::runtime_error("http_send_file: requires Linux.");
         #endif
     }
 
-    Value server_close_fn(std::vector<Value>& args) {
-        #ifndef _WIN32
-        if (args.empty()) throw std::runtime_error("http_server_close: requires handle.");
-        ::close(toInt(args[0]));
+    Value serve_stop_fn(std::vector<Value>& args) {
+        if (args.empty()) throw std::runtime_error("http_serve_stop: requires server handle.");
+        std::lock_guard<std::mutex> lock(serveRegistryMutex);
+        auto it = serveStopFlags.find(toInt(args[0]));
+        if (it == serveStopFlags.end()) return false;
+        it->second->store(true);
         return true;
-        #else
-        throw std::runtime_error("http_server_close: not supported on Windows.");
-        #endif
     }
 
     void registerFunctions(std::unordered_map<std::string, Value>& globals) {
@@ -2668,10 +8146,24 @@ namespace NetHTTP {
         globals["http_url_decode"] = NativeFunction{url_decode_fn, 1};
         globals["http_download"] = NativeFunction{download_fn, 2};
         globals["http_headers"] = NativeFunction{headers_fn, 1};
+        globals["http_get_many"] = NativeFunction{get_many_fn, -1};
+        globals["http_request_batch"] = NativeFunction{request_batch_fn, -1};
+        globals["http_open"] = NativeFunction{open_fn, -1};
+        globals["http_stream_info"] = NativeFunction{stream_info_fn, 1};
+        globals["http_stream_read"] = NativeFunction{stream_read_fn, -1};
+        globals["http_stream_line"] = NativeFunction{stream_line_fn, 1};
+        globals["http_stream_to_file"] = NativeFunction{stream_to_file_fn, 2};
+        globals["http_stream_write"] = NativeFunction{stream_write_fn, 2};
+        globals["http_stream_finish"] = NativeFunction{stream_finish_fn, 1};
+        globals["http_stream_close"] = NativeFunction{stream_close_fn, 1};
         globals["http_server"] = NativeFunction{server_fn, 1};
         globals["http_server_next"] = NativeFunction{server_next_fn, 1};
         globals["http_server_respond"] = NativeFunction{server_respond_fn, 4};
         globals["http_server_close"] = NativeFunction{server_close_fn, 1};
+        globals["http_serve"] = NativeFunction{serve_fn, -1};
+        globals["http_serve_stop"] = NativeFunction{serve_stop_fn, 1};
+        globals["http_static"] = NativeFunction{static_fn, 3};
+        globals["http_send_file"] = NativeFunction{send_file_fn, -1};
     }
 }
 
@@ -2681,6 +8173,7 @@ namespace OS {
         if (args.empty() || !args[0].holds_alternative<std::string>()) return std::string("");
         std::string command = args[0].get<std::string>();
         std::string result;
+        Console::flush();
         FILE* pipe = popen(command.c_str(), "r");
         if (!pipe) return std::string("");
         char buffer[256];
@@ -2691,6 +8184,7 @@ namespace OS {
 
     Value exec_status_fn(std::vector<Value>& args) {
         if (args.empty() || !args[0].holds_alternative<std::string>()) return -1;
+        Console::flush();
         return system(args[0].get<std::string>().c_str());
     }
 
@@ -2831,8 +8325,8 @@ namespace OS {
 
     Value stat_fn(std::vector<Value>& args) {
         if (args.empty() || !args[0].holds_alternative<std::string>())
-            return std::unordered_map<std::string, Value>();
-        std::unordered_map<std::string, Value> result;
+            return MapValue();
+        MapValue result;
         std::string path = args[0].get<std::string>();
         try {
             result["is_dir"] = Value(std::filesystem::is_directory(path));
@@ -2920,74 +8414,406 @@ namespace Async {
         return Value();
     }
 
-    Value recv_fn(std::vector<Value>& args) {
-        if (args.empty()) throw std::runtime_error("recv: requires channel.");
-        int id = toInt(args[0]);
-        std::shared_ptr<Channel> ch;
-        {
-            std::lock_guard<std::mutex> lock(registryMutex);
-            auto it = channels.find(id);
-            if (it == channels.end()) throw std::runtime_error("recv: invalid channel.");
-            ch = it->second;
-        }
-        std::unique_lock<std::mutex> lock(ch->mtx);
-        ch->cv_recv.wait(lock, [&] { return !ch->buffer.empty() || ch->closed; });
-        if (ch->buffer.empty()) return Value();
-        Value val = ch->buffer.front();
-        ch->buffer.pop();
-        ch->cv_send.notify_one();
-        return val;
+    Value recv_fn(std::vector<Value>& args) {
+        if (args.empty()) throw std::runtime_error("recv: requires channel.");
+        int id = toInt(args[0]);
+        std::shared_ptr<Channel> ch;
+        {
+            std::lock_guard<std::mutex> lock(registryMutex);
+            auto it = channels.find(id);
+            if (it == channels.end()) throw std::runtime_error("recv: invalid channel.");
+            ch = it->second;
+        }
+        std::unique_lock<std::mutex> lock(ch->mtx);
+        ch->cv_recv.wait(lock, [&] { return !ch->buffer.empty() || ch->closed; });
+        if (ch->buffer.empty()) return Value();
+        Value val = ch->buffer.front();
+        ch->buffer.pop();
+        ch->cv_send.notify_one();
+        return val;
+    }
+
+    Value try_recv_fn(std::vector<Value>& args) {
+        if (args.empty()) throw std::runtime_error("try_recv: requires channel.");
+        int id = toInt(args[0]);
+        std::shared_ptr<Channel> ch;
+        {
+            std::lock_guard<std::mutex> lock(registryMutex);
+            auto it = channels.find(id);
+            if (it == channels.end()) throw std::runtime_error("try_recv: invalid channel.");
+            ch = it->second;
+        }
+        std::lock_guard<std::mutex> lock(ch->mtx);
+        if (ch->buffer.empty()) return Value();
+        Value val = ch->buffer.front();
+        ch->buffer.pop();
+        ch->cv_send.notify_one();
+        return val;
+    }
+
+    Value close_fn(std::vector<Value>& args) {
+        if (args.empty()) throw std::runtime_error("close_chan: requires channel.");
+        int id = toInt(args[0]);
+        std::shared_ptr<Channel> ch;
+        {
+            std::lock_guard<std::mutex> lock(registryMutex);
+            auto it = channels.find(id);
+            if (it == channels.end()) throw std::runtime_error("close_chan: invalid channel.");
+            ch = it->second;
+        }
+        std::lock_guard<std::mutex> lock(ch->mtx);
+        ch->closed = true;
+        ch->cv_recv.notify_all();
+        ch->cv_send.notify_all();
+        return Value();
+    }
+
+    Value sleep_fn(std::vector<Value>& args) {
+        if (args.empty()) return Value();
+        int ms = toInt(args[0]);
+        Console::flush();   // Don't hold output back while idle
+        std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+        return Value();
+    }
+
+    void registerFunctions(std::unordered_map<std::string, Value>& globals) {
+        globals["chan"] = NativeFunction{chan_fn, -1};
+        globals["send"] = NativeFunction{send_fn, 2};
+        globals["recv"] = NativeFunction{recv_fn, 1};
+        globals["try_recv"] = NativeFunction{try_recv_fn, 1};
+        globals["close_chan"] = NativeFunction{close_fn, 1};
+        globals["sleep"] = NativeFunction{sleep_fn, 1};
+    }
+}
+
+// ============ EVENT LOOP LIBRARY ============
+namespace EventLoop {
+    // A loop owns an epoll instance, per-fd read/write callbacks and a timer
+    // heap. Native functions get only their arguments, not the interpreter
+    // that would run a callback (event_emit has the same split), so readiness
+    // is reported as [callback, event] pairs: loop_poll hands them to the
+    // script, and the interpreter's loop_run builtin calls them directly.
+    struct Watch {
+        Value onRead;
+        Value onWrite;
+    };
+
+    struct Timer {
+        std::chrono::steady_clock::time_point deadline;
+        int intervalMs;  // 0 = one-shot
+        Value callback;
+        bool fired = false;  // one-shot already handed out; erased on the next poll
+    };
+
+    struct Loop {
+        int epfd = -1;
+        std::unordered_map<int, Watch> watches;
+        std::unordered_map<int, Timer> timers;
+        // (deadline, timer id); entries for cleared or rescheduled timers are skipped lazily
+        std::priority_queue<std::pair<std::chrono::steady_clock::time_point, int>,
+                            std::vector<std::pair<std::chrono::steady_clock::time_point, int>>,
+                            std::greater<>> timerQueue;
+        int nextTimerId = 1;
+        bool stopped = false;
+        // Handed out by the last poll and dropped by the next one, so callbacks
+        // earlier in the same batch can still cancel them
+        std::vector<int> firedTimers;
+        std::vector<int> hungUpFds;
+    };
+
+    static std::mutex registryMutex;
+    static std::unordered_map<int, std::shared_ptr<Loop>> loops;
+    static std::atomic<int> nextLoopId{1};
+
+    static std::shared_ptr<Loop> getLoop(int id, const char* fn) {
+        std::lock_guard<std::mutex> lock(registryMutex);
+        auto it = loops.find(id);
+        if (it == loops.end()) throw std::runtime_error(std::string(fn) + ": invalid loop.");
+        return it->second;
+    }
+
+#ifdef __linux__
+    static void updateInterest(Loop& loop, int fd, bool added) {
+        auto it = loop.watches.find(fd);
+        struct epoll_event ev;
+        memset(&ev, 0, sizeof(ev));
+        ev.data.fd = fd;
+        if (it != loop.watches.end()) {
+            if (!it->second.onRead.holds_alternative<std::monostate>()) ev.events |= EPOLLIN;
+            if (!it->second.onWrite.holds_alternative<std::monostate>()) ev.events |= EPOLLOUT;
+        }
+        if (ev.events == 0) {
+            epoll_ctl(loop.epfd, EPOLL_CTL_DEL, fd, nullptr);
+            loop.watches.erase(fd);
+            return;
+        }
+        if (epoll_ctl(loop.epfd, added ? EPOLL_CTL_ADD : EPOLL_CTL_MOD, fd, &ev) < 0)
+            throw std::runtime_error("loop: cannot watch fd " + std::to_string(fd) + ".");
+    }
+
+    // Closing an fd silently removes it from epoll, so its watch would never
+    // fire again yet keep the loop alive
+    static void dropClosedWatches(Loop& loop) {
+        for (auto it = loop.watches.begin(); it != loop.watches.end();) {
+            if (fcntl(it->first, F_GETFD) < 0 && errno == EBADF) it = loop.watches.erase(it);
+            else ++it;
+        }
+    }
+#endif
+
+    static Value watchFd(std::vector<Value>& args, bool readable, const char* fn) {
+        #ifdef __linux__
+        if (args.size() < 3) throw std::runtime_error(std::string(fn) + ": requires loop, fd and callback.");
+        auto loop = getLoop(toInt(args[0]), fn);
+        int fd = toInt(args[1]);
+        // Watched fds are switched to non-blocking so callbacks never stall the loop
+        int flags = fcntl(fd, F_GETFL, 0);
+        if (flags >= 0) fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+        bool added = loop->watches.find(fd) == loop->watches.end();
+        Watch& w = loop->watches[fd];
+        (readable ? w.onRead : w.onWrite) = args[2];
+        updateInterest(*loop, fd, added);
+        return Value();
+        #else
+        throw std::runtime_error(std::string(fn) + ": requires epoll (Linux).");
+        #endif
+    }
+
+    static int addTimer(std::vector<Value>& args, bool repeat, const char* fn) {
+        if (args.size() < 3) throw std::runtime_error(std::string(fn) + ": requires loop, ms and callback.");
+        auto loop = getLoop(toInt(args[0]), fn);
+        int ms = std::max(0, toInt(args[1]));
+        int id = loop->nextTimerId++;
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(ms);
+        loop->timers[id] = Timer{deadline, repeat ? std::max(1, ms) : 0, args[2]};
+        loop->timerQueue.push({deadline, id});
+        return id;
+    }
+
+    std::vector<std::pair<Value, Value>> poll(int loopId, int timeoutMs) {
+        std::vector<std::pair<Value, Value>> ready;
+        #ifdef __linux__
+        auto loop = getLoop(loopId, "loop_poll");
+        if (loop->stopped) return ready;
+
+        for (int id : loop->firedTimers) {
+            auto it = loop->timers.find(id);
+            if (it != loop->timers.end() && it->second.fired) loop->timers.erase(it);
+        }
+        loop->firedTimers.clear();
+        for (int fd : loop->hungUpFds) {
+            if (loop->watches.erase(fd)) epoll_ctl(loop->epfd, EPOLL_CTL_DEL, fd, nullptr);
+        }
+        loop->hungUpFds.clear();
+
+        // Drop stale heap entries so the wait is bounded by a live timer
+        while (!loop->timerQueue.empty()) {
+            auto [deadline, id] = loop->timerQueue.top();
+            auto it = loop->timers.find(id);
+            if (it != loop->timers.end() && it->second.deadline == deadline) break;
+            loop->timerQueue.pop();
+        }
+        int wait = timeoutMs;
+        if (!loop->timerQueue.empty()) {
+            // Round up: a truncated wait of 0 would spin until a sub-millisecond timer is due
+            auto untilNext = std::chrono::ceil<std::chrono::milliseconds>(
+                loop->timerQueue.top().first - std::chrono::steady_clock::now()).count();
+            int timerWait = static_cast<int>(std::max<long long>(0, untilNext));
+            wait = wait < 0 ? timerWait : std::min(wait, timerWait);
+        }
+        if (wait < 0) dropClosedWatches(*loop);
+        if (loop->watches.empty() && wait < 0) return ready;
+
+        struct epoll_event events[64];
+        int n = epoll_wait(loop->epfd, events, 64, wait);
+        if (n < 0 && errno != EINTR) throw std::runtime_error("loop_poll: epoll_wait failed.");
+        if (n == 0) dropClosedWatches(*loop);
+        for (int i = 0; i < n; ++i) {
+            int fd = events[i].data.fd;
+            auto it = loop->watches.find(fd);
+            if (it == loop->watches.end()) continue;
+            uint32_t flags = events[i].events;
+            bool hup = flags & (EPOLLHUP | EPOLLERR);
+            auto makeEvent = [&](const char* type) {
+                MapValue ev;
+                ev["type"] = std::string(type);
+                ev["fd"] = fd;
+                ev["hup"] = hup;
+                return Value(ev);
+            };
+            if ((flags & EPOLLIN || hup) && !it->second.onRead.holds_alternative<std::monostate>())
+                ready.push_back({it->second.onRead, makeEvent("read")});
+            if ((flags & EPOLLOUT || hup) && !it->second.onWrite.holds_alternative<std::monostate>())
+                ready.push_back({it->second.onWrite, makeEvent("write")});
+            // Once buffered input is drained a hung-up fd can only report hup again
+            if (hup && !(flags & EPOLLIN)) loop->hungUpFds.push_back(fd);
+        }
+
+        auto now = std::chrono::steady_clock::now();
+        while (!loop->timerQueue.empty() && loop->timerQueue.top().first <= now) {
+            auto [deadline, id] = loop->timerQueue.top();
+            loop->timerQueue.pop();
+            auto it = loop->timers.find(id);
+            if (it == loop->timers.end() || it->second.deadline != deadline) continue;
+            MapValue ev;
+            ev["type"] = std::string("timer");
+            ev["timer"] = id;
+            ready.push_back({it->second.callback, Value(ev)});
+            if (it->second.intervalMs > 0) {
+                it->second.deadline = deadline + std::chrono::milliseconds(it->second.intervalMs);
+                if (it->second.deadline < now) it->second.deadline = now;
+                loop->timerQueue.push({it->second.deadline, id});
+            } else {
+                it->second.fired = true;
+                loop->firedTimers.push_back(id);
+            }
+        }
+        #else
+        throw std::runtime_error("loop_poll: requires epoll (Linux).");
+        #endif
+        return ready;
+    }
+
+    bool hasWork(int loopId) {
+        std::shared_ptr<Loop> loop;
+        {
+            std::lock_guard<std::mutex> lock(registryMutex);
+            auto it = loops.find(loopId);
+            if (it == loops.end()) return false;  // closed by a callback
+            loop = it->second;
+        }
+        return !loop->stopped && (!loop->watches.empty() || !loop->timers.empty());
+    }
+
+    bool isLive(int loopId, const Value& event) {
+        std::shared_ptr<Loop> loop;
+        {
+            std::lock_guard<std::mutex> lock(registryMutex);
+            auto it = loops.find(loopId);
+            if (it == loops.end()) return false;
+            loop = it->second;
+        }
+        const auto& ev = event.get<MapValue>();
+        const auto& type = ev.at("type").get<std::string>();
+        if (type == "timer") return loop->timers.count(ev.at("timer").get<int>()) > 0;
+        auto it = loop->watches.find(ev.at("fd").get<int>());
+        if (it == loop->watches.end()) return false;
+        const Value& callback = type == "read" ? it->second.onRead : it->second.onWrite;
+        return !callback.holds_alternative<std::monostate>();
+    }
+
+    Value loop_new_fn(std::vector<Value>& args) {
+        #ifdef __linux__
+        auto loop = std::make_shared<Loop>();
+        loop->epfd = epoll_create1(EPOLL_CLOEXEC);
+        if (loop->epfd < 0) throw std::runtime_error("loop_new: epoll_create1 failed.");
+        int id = nextLoopId++;
+        std::lock_guard<std::mutex> lock(registryMutex);
+        loops[id] = loop;
+        return id;
+        #else
+        throw std::runtime_error("loop_new: requires epoll (Linux).");
+        #endif
+    }
+
+    Value on_readable_fn(std::vector<Value>& args) {
+        return watchFd(args, true, "loop_on_readable");
+    }
+
+    Value on_writable_fn(std::vector<Value>& args) {
+        return watchFd(args, false, "loop_on_writable");
+    }
+
+    Value remove_fn(std::vector<Value>& args) {
+        #ifdef __linux__
+        if (args.size() < 2) throw std::runtime_error("loop_remove: requires loop and fd.");
+        auto loop = getLoop(toInt(args[0]), "loop_remove");
+        int fd = toInt(args[1]);
+        if (args.size() >= 3 && args[2].holds_alternative<std::string>()) {
+            // Remove only one direction: "read" or "write"
+            auto it = loop->watches.find(fd);
+            if (it == loop->watches.end()) return Value();
+            if (args[2].get<std::string>() == "read") it->second.onRead = Value();
+            else it->second.onWrite = Value();
+            updateInterest(*loop, fd, false);
+            return Value();
+        }
+        if (loop->watches.erase(fd)) epoll_ctl(loop->epfd, EPOLL_CTL_DEL, fd, nullptr);
+        return Value();
+        #else
+        throw std::runtime_error("loop_remove: requires epoll (Linux).");
+        #endif
+    }
+
+    Value set_timeout_fn(std::vector<Value>& args) {
+        return addTimer(args, false, "loop_set_timeout");
+    }
+
+    Value set_interval_fn(std::vector<Value>& args) {
+        return addTimer(args, true, "loop_set_interval");
+    }
+
+    Value clear_timer_fn(std::vector<Value>& args) {
+        if (args.size() < 2) throw std::runtime_error("loop_clear_timer: requires loop and timer.");
+        auto loop = getLoop(toInt(args[0]), "loop_clear_timer");
+        auto it = loop->timers.find(toInt(args[1]));
+        if (it == loop->timers.end()) return false;
+        bool pending = !it->second.fired;
+        loop->timers.erase(it);
+        return pending;
     }
 
-    Value try_recv_fn(std::vector<Value>& args) {
-        if (args.empty()) throw std::runtime_error("try_recv: requires channel.");
-        int id = toInt(args[0]);
-        std::shared_ptr<Channel> ch;
-        {
-            std::lock_guard<std::mutex> lock(registryMutex);
-            auto it = channels.find(id);
-            if (it == channels.end()) throw std::runtime_error("try_recv: invalid channel.");
-            ch = it->second;
+    Value poll_fn(std::vector<Value>& args) {
+        if (args.empty()) throw std::runtime_error("loop_poll: requires loop.");
+        int timeout = args.size() >= 2 ? toInt(args[1]) : -1;
+        std::vector<Value> result;
+        for (auto& [callback, event] : poll(toInt(args[0]), timeout)) {
+            result.push_back(Value(std::vector<Value>{callback, event}));
         }
-        std::lock_guard<std::mutex> lock(ch->mtx);
-        if (ch->buffer.empty()) return Value();
-        Value val = ch->buffer.front();
-        ch->buffer.pop();
-        ch->cv_send.notify_one();
-        return val;
+        return result;
+    }
+
+    Value run_fn(std::vector<Value>& args) {
+        // Reached only when loop_run is called indirectly (e.g. through a variable);
+        // the interpreter handles direct calls so it can invoke the callbacks.
+        throw std::runtime_error("loop_run: must be called directly as loop_run(loop).");
+    }
+
+    Value stop_fn(std::vector<Value>& args) {
+        if (args.empty()) throw std::runtime_error("loop_stop: requires loop.");
+        getLoop(toInt(args[0]), "loop_stop")->stopped = true;
+        return Value();
     }
 
     Value close_fn(std::vector<Value>& args) {
-        if (args.empty()) throw std::runtime_error("close_chan: requires channel.");
+        if (args.empty()) throw std::runtime_error("loop_close: requires loop.");
         int id = toInt(args[0]);
-        std::shared_ptr<Channel> ch;
+        std::shared_ptr<Loop> loop;
         {
             std::lock_guard<std::mutex> lock(registryMutex);
-            auto it = channels.find(id);
-            if (it == channels.end()) throw std::runtime_error("close_chan: invalid channel.");
-            ch = it->second;
+            auto it = loops.find(id);
+            if (it == loops.end()) throw std::runtime_error("loop_close: invalid loop.");
+            loop = it->second;
+            loops.erase(it);
         }
-        std::lock_guard<std::mutex> lock(ch->mtx);
-        ch->closed = true;
-        ch->cv_recv.notify_all();
-        ch->cv_send.notify_all();
-        return Value();
-    }
-
-    Value sleep_fn(std::vector<Value>& args) {
-        if (args.empty()) return Value();
-        int ms = toInt(args[0]);
-        std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+        #ifndef _WIN32
+        if (loop->epfd >= 0) ::close(loop->epfd);
+        #endif
         return Value();
     }
 
     void registerFunctions(std::unordered_map<std::string, Value>& globals) {
-        globals["chan"] = NativeFunction{chan_fn, -1};
-        globals["send"] = NativeFunction{send_fn, 2};
-        globals["recv"] = NativeFunction{recv_fn, 1};
-        globals["try_recv"] = NativeFunction{try_recv_fn, 1};
-        globals["close_chan"] = NativeFunction{close_fn, 1};
-        globals["sleep"] = NativeFunction{sleep_fn, 1};
+        globals["loop_new"] = NativeFunction{loop_new_fn, 0};
+        globals["loop_on_readable"] = NativeFunction{on_readable_fn, 3};
+        globals["loop_on_writable"] = NativeFunction{on_writable_fn, 3};
+        globals["loop_remove"] = NativeFunction{remove_fn, -1};
+        globals["loop_set_timeout"] = NativeFunction{set_timeout_fn, 3};
+        globals["loop_set_interval"] = NativeFunction{set_interval_fn, 3};
+        globals["loop_clear_timer"] = NativeFunction{clear_timer_fn, 2};
+        globals["loop_poll"] = NativeFunction{poll_fn, -1};
+        globals["loop_run"] = NativeFunction{run_fn, 1};
+        globals["loop_stop"] = NativeFunction{stop_fn, 1};
+        globals["loop_close"] = NativeFunction{close_fn, 1};
     }
 }
 
@@ -3235,7 +9061,7 @@ namespace Testing {
         if (test_fail_count == 0) {
             std::cout << "  All tests passed!" << std::endl;
         }
-        std::unordered_map<std::string, Value> result;
+        MapValue result;
         result["passed"] = Value(test_pass_count);
         result["failed"] = Value(test_fail_count);
         result["total"] = Value(test_pass_count + test_fail_count);
@@ -3365,159 +9191,124 @@ namespace Color {
 
 // ============ SET LIBRARY ============
 namespace Set {
-    // Helper: check if a value exists in a list (using operator==)
-    static bool listContains(const std::vector<Value>& vec, const Value& val) {
-        for (const auto& item : vec) {
-            if (item == val) return true;
-        }
-        return false;
+    // Sets are SetValue handles (see value.h): hashed, insertion-ordered and
+    // shared by reference, so set_add/set_remove update the set in place and
+    // also return it. Lists are accepted wherever a set is read.
+
+    static std::shared_ptr<SetValue> fromList(const std::vector<Value>& items) {
+        auto set = std::make_shared<SetValue>();
+        set->reserve(items.size());
+        for (const auto& item : items) set->insert(item);
+        return set;
+    }
+
+    // Set argument, or a temporary set built from a list; null otherwise
+    static std::shared_ptr<SetValue> asSet(const std::vector<Value>& args, size_t i) {
+        if (args.size() <= i) return nullptr;
+        if (args[i].holds_alternative<std::shared_ptr<SetValue>>()) return args[i].get<std::shared_ptr<SetValue>>();
+        if (args[i].holds_alternative<std::vector<Value>>()) return fromList(args[i].get<std::vector<Value>>());
+        return nullptr;
+    }
+
+    static std::shared_ptr<SetValue> requireSet(const std::vector<Value>& args, size_t i, const char* fn) {
+        auto set = asSet(args, i);
+        if (!set) throw std::runtime_error(std::string(fn) + ": expected a set or list.");
+        return set;
     }
 
     Value set_new(std::vector<Value>& args) {
-        return std::vector<Value>();
+        if (!args.empty()) return fromList(requireSet(args, 0, "set_new")->toList());
+        return std::make_shared<SetValue>();
     }
 
     Value set_from_list(std::vector<Value>& args) {
         if (args.empty() || !args[0].holds_alternative<std::vector<Value>>())
-            return std::vector<Value>();
-        const auto& input = args[0].get<std::vector<Value>>();
-        std::vector<Value> result;
-        for (const auto& item : input) {
-            if (!listContains(result, item)) {
-                result.push_back(item);
-            }
-        }
-        return result;
+            throw std::runtime_error("set_from_list: expected a list.");
+        return fromList(args[0].get<std::vector<Value>>());
     }
 
     Value set_add(std::vector<Value>& args) {
-        if (args.size() < 2 || !args[0].holds_alternative<std::vector<Value>>())
-            return args.empty() ? Value(std::vector<Value>()) : args[0];
-        auto vec = args[0].get<std::vector<Value>>();
-        if (!listContains(vec, args[1])) {
-            vec.push_back(args[1]);
-        }
-        return vec;
+        if (args.size() < 2 || !args[0].holds_alternative<std::shared_ptr<SetValue>>())
+            throw std::runtime_error("set_add: requires a set and a value.");
+        const auto& set = args[0].get<std::shared_ptr<SetValue>>();
+        set->insert(args[1]);
+        return set;
     }
 
     Value set_remove(std::vector<Value>& args) {
-        if (args.size() < 2 || !args[0].holds_alternative<std::vector<Value>>())
-            return args.empty() ? Value(std::vector<Value>()) : args[0];
-        auto vec = args[0].get<std::vector<Value>>();
-        for (auto it = vec.begin(); it != vec.end(); ++it) {
-            if (*it == args[1]) {
-                vec.erase(it);
-                break;
-            }
-        }
-        return vec;
+        if (args.size() < 2 || !args[0].holds_alternative<std::shared_ptr<SetValue>>())
+            throw std::runtime_error("set_remove: requires a set and a value.");
+        const auto& set = args[0].get<std::shared_ptr<SetValue>>();
+        set->erase(args[1]);
+        return set;
     }
 
     Value set_contains(std::vector<Value>& args) {
-        if (args.size() < 2 || !args[0].holds_alternative<std::vector<Value>>())
-            return false;
-        const auto& vec = args[0].get<std::vector<Value>>();
-        return listContains(vec, args[1]);
+        if (args.size() < 2) return false;
+        if (args[0].holds_alternative<std::shared_ptr<SetValue>>())
+            return args[0].get<std::shared_ptr<SetValue>>()->contains(args[1]);
+        if (args[0].holds_alternative<std::vector<Value>>()) {
+            for (const auto& item : args[0].get<std::vector<Value>>()) {
+                if (item == args[1]) return true;
+            }
+        }
+        return false;
     }
 
     Value set_size(std::vector<Value>& args) {
-        if (args.empty() || !args[0].holds_alternative<std::vector<Value>>()) return 0;
-        return static_cast<int>(args[0].get<std::vector<Value>>().size());
+        auto set = asSet(args, 0);
+        return set ? static_cast<int>(set->size()) : 0;
     }
 
     Value set_union(std::vector<Value>& args) {
-        if (args.size() < 2) return std::vector<Value>();
-        std::vector<Value> result;
-        if (args[0].holds_alternative<std::vector<Value>>()) {
-            result = args[0].get<std::vector<Value>>();
-        }
-        if (args[1].holds_alternative<std::vector<Value>>()) {
-            const auto& b = args[1].get<std::vector<Value>>();
-            for (const auto& item : b) {
-                if (!listContains(result, item)) {
-                    result.push_back(item);
-                }
-            }
-        }
+        auto a = requireSet(args, 0, "set_union");
+        auto b = requireSet(args, 1, "set_union");
+        auto result = fromList(a->toList());
+        b->forEach([&](const Value& item) { result->insert(item); });
         return result;
     }
 
     Value set_intersect(std::vector<Value>& args) {
-        if (args.size() < 2 ||
-            !args[0].holds_alternative<std::vector<Value>>() ||
-            !args[1].holds_alternative<std::vector<Value>>())
-            return std::vector<Value>();
-        const auto& a = args[0].get<std::vector<Value>>();
-        const auto& b = args[1].get<std::vector<Value>>();
-        std::vector<Value> result;
-        for (const auto& item : a) {
-            if (listContains(b, item)) {
-                result.push_back(item);
-            }
-        }
+        auto a = requireSet(args, 0, "set_intersect");
+        auto b = requireSet(args, 1, "set_intersect");
+        auto result = std::make_shared<SetValue>();
+        a->forEach([&](const Value& item) { if (b->contains(item)) result->insert(item); });
         return result;
     }
 
     Value set_difference(std::vector<Value>& args) {
-        if (args.size() < 2 ||
-            !args[0].holds_alternative<std::vector<Value>>() ||
-            !args[1].holds_alternative<std::vector<Value>>())
-            return std::vector<Value>();
-        const auto& a = args[0].get<std::vector<Value>>();
-        const auto& b = args[1].get<std::vector<Value>>();
-        std::vector<Value> result;
-        for (const auto& item : a) {
-            if (!listContains(b, item)) {
-                result.push_back(item);
-            }
-        }
+        auto a = requireSet(args, 0, "set_difference");
+        auto b = requireSet(args, 1, "set_difference");
+        auto result = std::make_shared<SetValue>();
+        a->forEach([&](const Value& item) { if (!b->contains(item)) result->insert(item); });
         return result;
     }
 
     Value set_symmetric_diff(std::vector<Value>& args) {
-        if (args.size() < 2 ||
-            !args[0].holds_alternative<std::vector<Value>>() ||
-            !args[1].holds_alternative<std::vector<Value>>())
-            return std::vector<Value>();
-        const auto& a = args[0].get<std::vector<Value>>();
-        const auto& b = args[1].get<std::vector<Value>>();
-        std::vector<Value> result;
-        // Elements in a but not in b
-        for (const auto& item : a) {
-            if (!listContains(b, item)) {
-                result.push_back(item);
-            }
-        }
-        // Elements in b but not in a
-        for (const auto& item : b) {
-            if (!listContains(a, item)) {
-                result.push_back(item);
-            }
-        }
+        auto a = requireSet(args, 0, "set_symmetric_diff");
+        auto b = requireSet(args, 1, "set_symmetric_diff");
+        auto result = std::make_shared<SetValue>();
+        a->forEach([&](const Value& item) { if (!b->contains(item)) result->insert(item); });
+        b->forEach([&](const Value& item) { if (!a->contains(item)) result->insert(item); });
         return result;
     }
 
     Value set_is_subset(std::vector<Value>& args) {
-        if (args.size() < 2 ||
-            !args[0].holds_alternative<std::vector<Value>>() ||
-            !args[1].holds_alternative<std::vector<Value>>())
-            return false;
-        const auto& a = args[0].get<std::vector<Value>>();
-        const auto& b = args[1].get<std::vector<Value>>();
-        for (const auto& item : a) {
-            if (!listContains(b, item)) return false;
-        }
-        return true;
+        auto a = requireSet(args, 0, "set_is_subset");
+        auto b = requireSet(args, 1, "set_is_subset");
+        if (a->size() > b->size()) return false;
+        bool subset = true;
+        a->forEach([&](const Value& item) { if (subset && !b->contains(item)) subset = false; });
+        return subset;
     }
 
     Value set_to_list(std::vector<Value>& args) {
-        if (args.empty() || !args[0].holds_alternative<std::vector<Value>>())
-            return std::vector<Value>();
-        return args[0];
+        auto set = asSet(args, 0);
+        return set ? set->toList() : std::vector<Value>();
     }
 
     void registerFunctions(std::unordered_map<std::string, Value>& globals) {
-        globals["set_new"] = NativeFunction{set_new, 0};
+        globals["set_new"] = NativeFunction{set_new, -1};
         globals["set_from_list"] = NativeFunction{set_from_list, 1};
         globals["set_add"] = NativeFunction{set_add, 2};
         globals["set_remove"] = NativeFunction{set_remove, 2};
@@ -3529,6 +9320,17 @@ namespace Set {
         globals["set_symmetric_diff"] = NativeFunction{set_symmetric_diff, 2};
         globals["set_is_subset"] = NativeFunction{set_is_subset, 2};
         globals["set_to_list"] = NativeFunction{set_to_list, 1};
+
+        using SetHandle = std::shared_ptr<SetValue>;
+        Methods::add<SetHandle>("add", NativeFunction{set_add, 2});
+        Methods::add<SetHandle>("remove", NativeFunction{set_remove, 2});
+        Methods::add<SetHandle>("contains", NativeFunction{set_contains, 2});
+        Methods::add<SetHandle>("size", NativeFunction{set_size, 1});
+        Methods::add<SetHandle>("union", NativeFunction{set_union, 2});
+        Methods::add<SetHandle>("intersect", NativeFunction{set_intersect, 2});
+        Methods::add<SetHandle>("difference", NativeFunction{set_difference, 2});
+        Methods::add<SetHandle>("is_subset", NativeFunction{set_is_subset, 2});
+        Methods::add<SetHandle>("to_list", NativeFunction{set_to_list, 1});
     }
 }
 
@@ -3623,58 +9425,287 @@ namespace Path {
 
 // ============ CSV LIBRARY ============
 namespace CSV {
-    // Helper: parse a single CSV line handling quoted fields
-    static std::vector<std::string> parseLine(const std::string& line) {
-        std::vector<std::string> fields;
-        std::string field;
-        bool inQuotes = false;
-        for (size_t i = 0; i < line.size(); ++i) {
-            char c = line[i];
-            if (inQuotes) {
-                if (c == '"') {
-                    // Check for escaped quote ("")
-                    if (i + 1 < line.size() && line[i + 1] == '"') {
-                        field += '"';
-                        ++i;
-                    } else {
-                        inQuotes = false;
+    // ---- Record scanner ----
+    //
+    // Works over one contiguous buffer (a string or a mapped file). Unquoted
+    // fields are located with a vector scan for the delimiter and line breaks
+    // and copied in one piece; quoted fields copy the runs between quotes
+    // (memchr). Quoted fields may span lines. Blank lines are skipped.
+
+    // Offset of the next delimiter, '\n' or '\r' in [p, end)
+    static size_t scanField(const char* p, const char* end, char delim) {
+        const char* start = p;
+#if defined(__SSE2__)
+        const __m128i d = _mm_set1_epi8(delim);
+        const __m128i lf = _mm_set1_epi8('\n');
+        const __m128i cr = _mm_set1_epi8('\r');
+        while (end - p >= 16) {
+            __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+            __m128i hit = _mm_or_si128(_mm_cmpeq_epi8(chunk, d),
+                                       _mm_or_si128(_mm_cmpeq_epi8(chunk, lf), _mm_cmpeq_epi8(chunk, cr)));
+            int mask = _mm_movemask_epi8(hit);
+            if (mask) return static_cast<size_t>(p - start) + __builtin_ctz(static_cast<unsigned>(mask));
+            p += 16;
+        }
+#endif
+        while (p < end && *p != delim && *p != '\n' && *p != '\r') ++p;
+        return static_cast<size_t>(p - start);
+    }
+
+    struct Scanner {
+        const char* p;
+        const char* end;
+        char delim;
+
+        Scanner(const char* begin, const char* finish, char d) : p(begin), end(finish), delim(d) {}
+
+        // Reads the next record into fields[0, count); false at end of input.
+        // Field strings are reused between records to keep their capacity.
+        bool next(std::vector<std::string>& fields, size_t& count) {
+            while (p < end && (*p == '\n' || *p == '\r')) ++p;
+            if (p >= end) return false;
+            count = 0;
+            while (true) {
+                if (count == fields.size()) fields.emplace_back();
+                std::string& field = fields[count++];
+                field.clear();
+                if (*p == '"') {
+                    ++p;
+                    while (true) {
+                        const char* q = static_cast<const char*>(std::memchr(p, '"', static_cast<size_t>(end - p)));
+                        if (!q) { field.append(p, static_cast<size_t>(end - p)); p = end; break; }
+                        field.append(p, static_cast<size_t>(q - p));
+                        p = q + 1;
+                        if (p < end && *p == '"') { field += '"'; ++p; continue; }  // Escaped quote ("")
+                        break;
                     }
-                } else {
-                    field += c;
                 }
-            } else {
-                if (c == '"') {
-                    inQuotes = true;
-                } else if (c == ',') {
-                    fields.push_back(field);
-                    field.clear();
-                } else {
-                    field += c;
+                // Unquoted text (or anything trailing a closing quote) up to the separator
+                size_t n = scanField(p, end, delim);
+                field.append(p, n);
+                p += n;
+
+                if (p >= end) return true;
+                if (*p == delim) {
+                    ++p;
+                    if (p >= end) {  // Trailing delimiter: one more empty field
+                        if (count == fields.size()) fields.emplace_back();
+                        fields[count++].clear();
+                        return true;
+                    }
+                    continue;
                 }
+                if (*p == '\r') ++p;
+                if (p < end && *p == '\n') ++p;
+                return true;
             }
         }
-        fields.push_back(field);
-        return fields;
+    };
+
+    enum class ColumnType { String, Int, Float, Infer };
+
+    static ColumnType parseColumnType(const Value& v, const char* fn) {
+        std::string name = v.holds_alternative<std::string>() ? v.get<std::string>() : "";
+        if (name == "string" || name == "str") return ColumnType::String;
+        if (name == "int") return ColumnType::Int;
+        if (name == "float") return ColumnType::Float;
+        if (name == "infer" || name == "auto") return ColumnType::Infer;
+        throw std::runtime_error(std::string(fn) + ": unknown column type '" + name + "' (use int, float, string or infer).");
     }
 
-    // Helper: split text into lines, handling \r\n and \n
-    static std::vector<std::string> splitLines(const std::string& text) {
-        std::vector<std::string> lines;
-        std::string line;
-        for (size_t i = 0; i < text.size(); ++i) {
-            if (text[i] == '\r') {
-                if (i + 1 < text.size() && text[i + 1] == '\n') ++i;
-                lines.push_back(line);
-                line.clear();
-            } else if (text[i] == '\n') {
-                lines.push_back(line);
-                line.clear();
-            } else {
-                line += text[i];
+    static bool looksNumeric(const std::string& f) {
+        char c = f[0];
+        return (c >= '0' && c <= '9') || c == '-' || c == '+' || c == '.';
+    }
+
+    // Converts a field to its column type. Empty typed fields become None.
+    static Value convertField(const std::string& f, ColumnType type, const char* fn, long row, const std::string& column) {
+        if (type == ColumnType::String) return Value(f);
+        if (f.empty()) return type == ColumnType::Infer ? Value(f) : Value();
+        const char* b = f.data() + (f[0] == '+' ? 1 : 0);
+        const char* e = f.data() + f.size();
+        if (type != ColumnType::Float) {
+            int i = 0;
+            auto res = std::from_chars(b, e, i);
+            if (res.ec == std::errc() && res.ptr == e) return Value(i);
+        }
+        if (type == ColumnType::Float || (type == ColumnType::Infer && looksNumeric(f))) {
+            double d = 0;
+            auto res = std::from_chars(b, e, d);
+            if (res.ec == std::errc() && res.ptr == e) return Value(d);
+        }
+        if (type == ColumnType::Infer) return Value(f);
+        throw std::runtime_error(std::string(fn) + ": row " + std::to_string(row) + ", column " + column +
+                                 ": expected " + (type == ColumnType::Int ? "int" : "float") + ", got '" + f + "'.");
+    }
+
+    // Streaming reader over a memory-mapped file
+    struct Reader {
+        std::string text;
+        const char* data = nullptr;
+        size_t size = 0;
+        void* mapping = nullptr;
+        Scanner scanner{nullptr, nullptr, ','};
+
+        bool header = false;
+        std::vector<std::string> columns;
+        std::vector<ColumnType> types;  // Per column; columns beyond it use defaultType
+        ColumnType defaultType = ColumnType::String;
+        std::vector<std::string> fields;
+        long row = 0;
+        std::mutex mutex;
+
+        ~Reader() {
+#ifdef __linux__
+            if (mapping) munmap(mapping, size);
+#endif
+        }
+
+        ColumnType typeOf(size_t i) const { return i < types.size() ? types[i] : defaultType; }
+
+        std::string columnName(size_t i) const { return i < columns.size() ? "'" + columns[i] + "'" : std::to_string(i); }
+
+        // Next row as a list, or a map keyed by the header; None at the end
+        Value next(const char* fn) {
+            size_t count = 0;
+            if (!scanner.next(fields, count)) return Value();
+            ++row;
+            if (!header) {
+                std::vector<Value> out;
+                out.reserve(count);
+                for (size_t i = 0; i < count; ++i) out.push_back(convertField(fields[i], typeOf(i), fn, row, columnName(i)));
+                return Value(std::move(out));
             }
+            MapValue out;
+            out.reserve(columns.size());
+            for (size_t i = 0; i < columns.size(); ++i) {
+                if (i < count) out[columns[i]] = convertField(fields[i], typeOf(i), fn, row, columnName(i));
+                else out[columns[i]] = typeOf(i) == ColumnType::String ? Value(std::string("")) : Value();
+            }
+            return Value(std::move(out));
         }
-        if (!line.empty()) lines.push_back(line);
-        return lines;
+    };
+
+    // Options: {"header": bool, "delimiter": ",", "types": "infer" | [type, ...] | {column: type}}
+    static void configureReader(Reader& r, const std::vector<Value>& args, size_t index, const char* fn) {
+        MapValue opts;
+        if (args.size() > index && args[index].holds_alternative<MapValue>())
+            opts = args[index].get<MapValue>();
+        char delim = ',';
+        auto it = opts.find("delimiter");
+        if (it != opts.end() && it->second.holds_alternative<std::string>() && !it->second.get<std::string>().empty())
+            delim = it->second.get<std::string>()[0];
+        r.scanner = Scanner(r.data, r.data + r.size, delim);
+        it = opts.find("header");
+        r.header = it != opts.end() && it->second.holds_alternative<bool>() && it->second.get<bool>();
+        if (r.header) {
+            size_t count = 0;
+            if (r.scanner.next(r.fields, count)) r.columns.assign(r.fields.begin(), r.fields.begin() + count);
+        }
+        it = opts.find("types");
+        if (it == opts.end()) return;
+        const Value& types = it->second;
+        if (types.holds_alternative<std::string>()) {
+            r.defaultType = parseColumnType(types, fn);
+        } else if (types.holds_alternative<std::vector<Value>>()) {
+            for (const auto& t : types.get<std::vector<Value>>()) r.types.push_back(parseColumnType(t, fn));
+        } else if (types.holds_alternative<MapValue>()) {
+            if (!r.header) throw std::runtime_error(std::string(fn) + ": types by column name require \"header\": true.");
+            r.types.assign(r.columns.size(), ColumnType::String);
+            for (const auto& [k, t] : types.get<MapValue>()) {
+                std::string name = keyToString(k);
+                auto col = std::find(r.columns.begin(), r.columns.end(), name);
+                if (col == r.columns.end()) throw std::runtime_error(std::string(fn) + ": no column named '" + name + "'.");
+                r.types[static_cast<size_t>(col - r.columns.begin())] = parseColumnType(t, fn);
+            }
+        }
+    }
+
+    static std::shared_ptr<Reader> openReader(const std::string& path, const char* fn) {
+        auto r = std::make_shared<Reader>();
+#ifdef __linux__
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) throw std::runtime_error(std::string(fn) + ": cannot open file '" + path + "'.");
+        struct stat st;
+        if (fstat(fd, &st) == 0 && st.st_size > 0) {
+            void* m = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+            if (m != MAP_FAILED) {
+                madvise(m, static_cast<size_t>(st.st_size), MADV_SEQUENTIAL);
+                r->mapping = m;
+                r->data = static_cast<const char*>(m);
+                r->size = static_cast<size_t>(st.st_size);
+            }
+        }
+        ::close(fd);
+        if (r->mapping || r->size == 0) return r;
+#endif
+        std::ifstream file(path, std::ios::binary);
+        if (!file.is_open()) throw std::runtime_error(std::string(fn) + ": cannot open file '" + path + "'.");
+        r->text.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+        r->data = r->text.data();
+        r->size = r->text.size();
+        return r;
+    }
+
+    static std::mutex readerRegistryMutex;
+    static std::unordered_map<int, std::shared_ptr<Reader>> readers;
+    static std::atomic<int> nextReaderId{1};
+
+    static std::shared_ptr<Reader> getReader(const std::vector<Value>& args, const char* fn) {
+        if (args.empty()) throw std::runtime_error(std::string(fn) + ": requires reader handle.");
+        std::lock_guard<std::mutex> lock(readerRegistryMutex);
+        auto it = readers.find(toInt(args[0]));
+        if (it == readers.end()) throw std::runtime_error(std::string(fn) + ": invalid reader handle.");
+        return it->second;
+    }
+
+    // csv_open(path[, opts]) -> reader handle
+    Value csv_open(std::vector<Value>& args) {
+        if (args.empty() || !args[0].holds_alternative<std::string>())
+            throw std::runtime_error("csv_open: requires file path.");
+        auto r = openReader(args[0].get<std::string>(), "csv_open");
+        configureReader(*r, args, 1, "csv_open");
+        std::lock_guard<std::mutex> lock(readerRegistryMutex);
+        int id = nextReaderId++;
+        readers[id] = std::move(r);
+        return Value(id);
+    }
+
+    // csv_next(reader) -> next row, None at the end
+    Value csv_next(std::vector<Value>& args) {
+        auto r = getReader(args, "csv_next");
+        std::lock_guard<std::mutex> lock(r->mutex);
+        return r->next("csv_next");
+    }
+
+    // csv_next_batch(reader, n) -> up to n rows, an empty list at the end
+    Value csv_next_batch(std::vector<Value>& args) {
+        auto r = getReader(args, "csv_next_batch");
+        int n = args.size() > 1 ? std::max(1, toInt(args[1])) : 1000;
+        std::lock_guard<std::mutex> lock(r->mutex);
+        std::vector<Value> batch;
+        batch.reserve(static_cast<size_t>(n));
+        for (int i = 0; i < n; ++i) {
+            Value row = r->next("csv_next_batch");
+            if (row.holds_alternative<std::monostate>()) break;
+            batch.push_back(std::move(row));
+        }
+        return Value(std::move(batch));
+    }
+
+    // csv_columns(reader) -> header names (empty without "header": true)
+    Value csv_columns(std::vector<Value>& args) {
+        auto r = getReader(args, "csv_columns");
+        std::vector<Value> cols;
+        for (const auto& c : r->columns) cols.push_back(Value(c));
+        return Value(std::move(cols));
+    }
+
+    Value csv_close(std::vector<Value>& args) {
+        if (args.empty()) throw std::runtime_error("csv_close: requires reader handle.");
+        std::lock_guard<std::mutex> lock(readerRegistryMutex);
+        readers.erase(toInt(args[0]));
+        return Value();
     }
 
     // Helper: escape a field for CSV output
@@ -3706,48 +9737,44 @@ namespace CSV {
         return "";
     }
 
-    Value csv_parse(std::vector<Value>& args) {
-        if (args.empty() || !args[0].holds_alternative<std::string>())
-            return std::vector<Value>();
-        const auto& text = args[0].get<std::string>();
-        auto lines = splitLines(text);
+    // Reads every remaining row of a configured reader
+    static std::vector<Value> readAll(Reader& r, const char* fn) {
         std::vector<Value> result;
-        for (const auto& line : lines) {
-            if (line.empty()) continue;
-            auto fields = parseLine(line);
-            std::vector<Value> row;
-            for (const auto& f : fields) {
-                row.push_back(Value(f));
-            }
-            result.push_back(Value(row));
+        while (true) {
+            Value row = r.next(fn);
+            if (row.holds_alternative<std::monostate>()) break;
+            result.push_back(std::move(row));
         }
         return result;
     }
 
-    Value csv_parse_header(std::vector<Value>& args) {
+    static std::shared_ptr<Reader> textReader(const std::string& text) {
+        auto r = std::make_shared<Reader>();
+        r->text = text;
+        r->data = r->text.data();
+        r->size = r->text.size();
+        return r;
+    }
+
+    Value csv_parse(std::vector<Value>& args) {
         if (args.empty() || !args[0].holds_alternative<std::string>())
             return std::vector<Value>();
-        const auto& text = args[0].get<std::string>();
-        auto lines = splitLines(text);
-        if (lines.empty()) return std::vector<Value>();
+        auto r = textReader(args[0].get<std::string>());
+        configureReader(*r, args, 1, "csv_parse");
+        return readAll(*r, "csv_parse");
+    }
 
-        // First line is headers
-        auto headers = parseLine(lines[0]);
-        std::vector<Value> result;
-        for (size_t i = 1; i < lines.size(); ++i) {
-            if (lines[i].empty()) continue;
-            auto fields = parseLine(lines[i]);
-            std::unordered_map<std::string, Value> row;
-            for (size_t j = 0; j < headers.size(); ++j) {
-                if (j < fields.size()) {
-                    row[headers[j]] = Value(fields[j]);
-                } else {
-                    row[headers[j]] = Value(std::string(""));
-                }
-            }
-            result.push_back(Value(row));
-        }
-        return result;
+    Value csv_parse_header(std::vector<Value>& args) {
+        if (args.empty() || !args[0].holds_alternative<std::string>())
+            return std::vector<Value>();
+        auto r = textReader(args[0].get<std::string>());
+        MapValue opts;
+        if (args.size() > 1 && args[1].holds_alternative<MapValue>())
+            opts = args[1].get<MapValue>();
+        opts["header"] = Value(true);
+        std::vector<Value> optArgs{Value(std::move(opts))};
+        configureReader(*r, optArgs, 0, "csv_parse_header");
+        return readAll(*r, "csv_parse_header");
     }
 
     Value csv_stringify(std::vector<Value>& args) {
@@ -3771,15 +9798,10 @@ namespace CSV {
         if (args.empty() || !args[0].holds_alternative<std::string>())
             return std::vector<Value>();
         const auto& filepath = args[0].get<std::string>();
-        std::ifstream file(filepath);
-        if (!file.is_open()) return std::vector<Value>();
-        std::string content((std::istreambuf_iterator<char>(file)),
-                            std::istreambuf_iterator<char>());
-        file.close();
-        // Reuse csv_parse
-        std::vector<Value> parseArgs;
-        parseArgs.push_back(Value(content));
-        return csv_parse(parseArgs);
+        if (!std::filesystem::is_regular_file(filepath)) return std::vector<Value>();
+        auto r = openReader(filepath, "csv_read");
+        configureReader(*r, args, 1, "csv_read");
+        return readAll(*r, "csv_read");
     }
 
     Value csv_write(std::vector<Value>& args) {
@@ -3801,142 +9823,217 @@ namespace CSV {
     }
 
     void registerFunctions(std::unordered_map<std::string, Value>& globals) {
-        globals["csv_parse"] = NativeFunction{csv_parse, 1};
-        globals["csv_parse_header"] = NativeFunction{csv_parse_header, 1};
+        globals["csv_parse"] = NativeFunction{csv_parse, -1};
+        globals["csv_parse_header"] = NativeFunction{csv_parse_header, -1};
         globals["csv_stringify"] = NativeFunction{csv_stringify, 1};
-        globals["csv_read"] = NativeFunction{csv_read, 1};
+        globals["csv_read"] = NativeFunction{csv_read, -1};
         globals["csv_write"] = NativeFunction{csv_write, 2};
+        globals["csv_open"] = NativeFunction{csv_open, -1};
+        globals["csv_next"] = NativeFunction{csv_next, 1};
+        globals["csv_next_batch"] = NativeFunction{csv_next_batch, -1};
+        globals["csv_columns"] = NativeFunction{csv_columns, 1};
+        globals["csv_close"] = NativeFunction{csv_close, 1};
     }
 }
 
 // ============ EVENT LIBRARY ============
 namespace Event {
-    // Events use maps as emitters.
-    // Structure: {"__events": {"event_name": [callback1, callback2, ...], ...}}
-    // Since we can't call Yen functions from C++, event_emit returns the list of
-    // callbacks for the given event, allowing Yen code to iterate and call them.
+    // Emitters are handles into a registry, so every copy of the handle sees
+    // the same listeners. Each event name maps to a slot in a listener table;
+    // event_emit and event_emit_async are interpreter builtins (see compiler.cpp)
+    // that fetch the listeners through takeListeners() and call them directly.
+
+    struct Listener {
+        int id;
+        Value callback;
+        bool once;
+    };
 
-    Value event_new(std::vector<Value>& args) {
-        std::unordered_map<std::string, Value> emitter;
-        emitter["__events"] = Value(std::unordered_map<std::string, Value>());
-        return emitter;
+    struct Emitter {
+        std::mutex mtx;
+        std::unordered_map<std::string, size_t> eventIds;
+        std::vector<std::vector<Listener>> listeners;  // Indexed by event id
+        int nextListenerId = 1;
+
+        // Async emits still running, for event_wait
+        std::mutex pendingMtx;
+        std::condition_variable pendingCv;
+        size_t pending = 0;
+    };
+
+    static std::mutex registryMutex;
+    static std::unordered_map<int, std::shared_ptr<Emitter>> emitters;
+    static std::atomic<int> nextEmitterId{1};
+
+    static std::shared_ptr<Emitter> getEmitter(const Value& handle, const char* fn) {
+        if (!handle.holds_alternative<int>())
+            throw std::runtime_error(std::string(fn) + ": expected an emitter handle.");
+        std::lock_guard<std::mutex> lock(registryMutex);
+        auto it = emitters.find(handle.get<int>());
+        if (it == emitters.end()) throw std::runtime_error(std::string(fn) + ": invalid emitter handle.");
+        return it->second;
     }
 
-    Value event_on(std::vector<Value>& args) {
-        if (args.size() < 3 ||
-            !args[0].holds_alternative<std::unordered_map<std::string, Value>>() ||
-            !args[1].holds_alternative<std::string>())
-            return args.empty() ? Value() : args[0];
-        auto emitter = args[0].get<std::unordered_map<std::string, Value>>();
-        const auto& event_name = args[1].get<std::string>();
-        const auto& callback = args[2];
+    static const std::string& eventName(const std::vector<Value>& args, size_t i, const char* fn) {
+        if (args.size() <= i || !args[i].holds_alternative<std::string>())
+            throw std::runtime_error(std::string(fn) + ": event name must be a string.");
+        return args[i].get<std::string>();
+    }
 
-        // Get or create __events map
-        if (emitter.find("__events") == emitter.end()) {
-            emitter["__events"] = Value(std::unordered_map<std::string, Value>());
-        }
-        if (!emitter["__events"].holds_alternative<std::unordered_map<std::string, Value>>()) {
-            emitter["__events"] = Value(std::unordered_map<std::string, Value>());
+    // Fixed pool of worker threads for event_emit_async. Jobs receive the
+    // index of the worker running them so callers can keep per-worker state.
+    struct WorkerPool {
+        std::mutex mtx;
+        std::condition_variable cv;
+        std::deque<std::function<void(size_t)>> jobs;
+        std::vector<std::thread> threads;
+
+        explicit WorkerPool(size_t n) {
+            for (size_t w = 0; w < n; ++w) {
+                threads.emplace_back([this, w]() {
+                    for (;;) {
+                        std::function<void(size_t)> job;
+                        {
+                            std::unique_lock<std::mutex> lock(mtx);
+                            cv.wait(lock, [this]() { return !jobs.empty(); });
+                            job = std::move(jobs.front());
+                            jobs.pop_front();
+                        }
+                        job(w);
+                    }
+                });
+                threads.back().detach();
+            }
         }
-        auto events = emitter["__events"].get<std::unordered_map<std::string, Value>>();
+    };
 
-        // Get or create the listener list for this event
-        std::vector<Value> listeners;
-        if (events.find(event_name) != events.end() &&
-            events[event_name].holds_alternative<std::vector<Value>>()) {
-            listeners = events[event_name].get<std::vector<Value>>();
-        }
-        listeners.push_back(callback);
-        events[event_name] = Value(listeners);
-        emitter["__events"] = Value(events);
-        return emitter;
+    static WorkerPool& pool() {
+        static WorkerPool* instance = new WorkerPool(workerCount());  // Never destroyed: workers are detached
+        return *instance;
     }
 
-    Value event_emit(std::vector<Value>& args) {
-        if (args.size() < 3 ||
-            !args[0].holds_alternative<std::unordered_map<std::string, Value>>() ||
-            !args[1].holds_alternative<std::string>())
-            return std::vector<Value>();
-        const auto& emitter = args[0].get<std::unordered_map<std::string, Value>>();
-        const auto& event_name = args[1].get<std::string>();
-        const auto& data = args[2];
-
-        // Get __events map
-        auto eventsIt = emitter.find("__events");
-        if (eventsIt == emitter.end() ||
-            !eventsIt->second.holds_alternative<std::unordered_map<std::string, Value>>())
-            return std::vector<Value>();
-        const auto& events = eventsIt->second.get<std::unordered_map<std::string, Value>>();
+    size_t workerCount() {
+        return std::max(2u, std::min(8u, std::thread::hardware_concurrency()));
+    }
 
-        // Get listeners for this event
-        auto listIt = events.find(event_name);
-        if (listIt == events.end() ||
-            !listIt->second.holds_alternative<std::vector<Value>>())
-            return std::vector<Value>();
-        const auto& listeners = listIt->second.get<std::vector<Value>>();
+    std::vector<Value> takeListeners(int emitterId, const std::string& event) {
+        auto em = getEmitter(Value(emitterId), "event_emit");
+        std::lock_guard<std::mutex> lock(em->mtx);
+        std::vector<Value> callbacks;
+        auto it = em->eventIds.find(event);
+        if (it == em->eventIds.end()) return callbacks;
+        auto& list = em->listeners[it->second];
+        callbacks.reserve(list.size());
+        for (const auto& l : list) callbacks.push_back(l.callback);
+        list.erase(std::remove_if(list.begin(), list.end(), [](const Listener& l) { return l.once; }), list.end());
+        return callbacks;
+    }
 
-        // Return list of [callback, data] pairs for Yen code to iterate and call
-        std::vector<Value> result;
-        for (const auto& cb : listeners) {
-            std::vector<Value> pair;
-            pair.push_back(cb);
-            pair.push_back(data);
-            result.push_back(Value(pair));
+    void post(int emitterId, std::function<void(size_t)> job) {
+        auto em = getEmitter(Value(emitterId), "event_emit_async");
+        {
+            std::lock_guard<std::mutex> lock(em->pendingMtx);
+            ++em->pending;
         }
-        return result;
+        auto& p = pool();
+        {
+            std::lock_guard<std::mutex> lock(p.mtx);
+            p.jobs.push_back([em, job = std::move(job)](size_t w) {
+                job(w);
+                std::lock_guard<std::mutex> lock(em->pendingMtx);
+                if (--em->pending == 0) em->pendingCv.notify_all();
+            });
+        }
+        p.cv.notify_one();
     }
 
-    Value event_off(std::vector<Value>& args) {
-        if (args.size() < 2 ||
-            !args[0].holds_alternative<std::unordered_map<std::string, Value>>() ||
-            !args[1].holds_alternative<std::string>())
-            return args.empty() ? Value() : args[0];
-        auto emitter = args[0].get<std::unordered_map<std::string, Value>>();
-        const auto& event_name = args[1].get<std::string>();
+    Value event_new(std::vector<Value>& args) {
+        int id = nextEmitterId++;
+        std::lock_guard<std::mutex> lock(registryMutex);
+        emitters[id] = std::make_shared<Emitter>();
+        return id;
+    }
 
-        if (emitter.find("__events") != emitter.end() &&
-            emitter["__events"].holds_alternative<std::unordered_map<std::string, Value>>()) {
-            auto events = emitter["__events"].get<std::unordered_map<std::string, Value>>();
-            events.erase(event_name);
-            emitter["__events"] = Value(events);
+    static Value addListener(std::vector<Value>& args, bool once, const char* fn) {
+        if (args.size() < 3) throw std::runtime_error(std::string(fn) + ": requires emitter, event and callback.");
+        auto em = getEmitter(args[0], fn);
+        const auto& name = eventName(args, 1, fn);
+        std::lock_guard<std::mutex> lock(em->mtx);
+        auto it = em->eventIds.find(name);
+        if (it == em->eventIds.end()) {
+            it = em->eventIds.emplace(name, em->listeners.size()).first;
+            em->listeners.emplace_back();
         }
-        return emitter;
+        int id = em->nextListenerId++;
+        em->listeners[it->second].push_back(Listener{id, args[2], once});
+        return id;
     }
 
-    Value event_once(std::vector<Value>& args) {
-        // Same as event_on for now - one-time removal must be handled at Yen level
-        // after event_emit returns the callbacks
-        return event_on(args);
+    Value event_on(std::vector<Value>& args) { return addListener(args, false, "event_on"); }
+
+    Value event_once(std::vector<Value>& args) { return addListener(args, true, "event_once"); }
+
+    Value event_emit(std::vector<Value>& args) {
+        throw std::runtime_error("event_emit: must be called directly as event_emit(emitter, event, data).");
     }
 
-    Value event_listeners(std::vector<Value>& args) {
-        if (args.size() < 2 ||
-            !args[0].holds_alternative<std::unordered_map<std::string, Value>>() ||
-            !args[1].holds_alternative<std::string>())
-            return 0;
-        const auto& emitter = args[0].get<std::unordered_map<std::string, Value>>();
-        const auto& event_name = args[1].get<std::string>();
+    Value event_emit_async(std::vector<Value>& args) {
+        throw std::runtime_error("event_emit_async: must be called directly as event_emit_async(emitter, event, data).");
+    }
 
-        auto eventsIt = emitter.find("__events");
-        if (eventsIt == emitter.end() ||
-            !eventsIt->second.holds_alternative<std::unordered_map<std::string, Value>>())
-            return 0;
-        const auto& events = eventsIt->second.get<std::unordered_map<std::string, Value>>();
+    // event_off(emitter, event[, listener_id]): returns the number of listeners removed
+    Value event_off(std::vector<Value>& args) {
+        if (args.size() < 2) throw std::runtime_error("event_off: requires emitter and event.");
+        auto em = getEmitter(args[0], "event_off");
+        const auto& name = eventName(args, 1, "event_off");
+        std::lock_guard<std::mutex> lock(em->mtx);
+        auto it = em->eventIds.find(name);
+        if (it == em->eventIds.end()) return 0;
+        auto& list = em->listeners[it->second];
+        size_t before = list.size();
+        if (args.size() >= 3) {
+            int id = toInt(args[2]);
+            list.erase(std::remove_if(list.begin(), list.end(), [id](const Listener& l) { return l.id == id; }), list.end());
+        } else {
+            list.clear();
+        }
+        return static_cast<int>(before - list.size());
+    }
 
-        auto listIt = events.find(event_name);
-        if (listIt == events.end() ||
-            !listIt->second.holds_alternative<std::vector<Value>>())
-            return 0;
-        return static_cast<int>(listIt->second.get<std::vector<Value>>().size());
+    Value event_listeners(std::vector<Value>& args) {
+        if (args.size() < 2) throw std::runtime_error("event_listeners: requires emitter and event.");
+        auto em = getEmitter(args[0], "event_listeners");
+        const auto& name = eventName(args, 1, "event_listeners");
+        std::lock_guard<std::mutex> lock(em->mtx);
+        auto it = em->eventIds.find(name);
+        return it == em->eventIds.end() ? 0 : static_cast<int>(em->listeners[it->second].size());
+    }
+
+    // Blocks until every event_emit_async on this emitter has finished
+    Value event_wait(std::vector<Value>& args) {
+        if (args.empty()) throw std::runtime_error("event_wait: requires an emitter.");
+        auto em = getEmitter(args[0], "event_wait");
+        std::unique_lock<std::mutex> lock(em->pendingMtx);
+        em->pendingCv.wait(lock, [&]() { return em->pending == 0; });
+        return Value();
+    }
+
+    Value event_free(std::vector<Value>& args) {
+        if (args.empty() || !args[0].holds_alternative<int>()) return false;
+        std::lock_guard<std::mutex> lock(registryMutex);
+        return emitters.erase(args[0].get<int>()) > 0;
     }
 
     void registerFunctions(std::unordered_map<std::string, Value>& globals) {
         globals["event_new"] = NativeFunction{event_new, 0};
         globals["event_on"] = NativeFunction{event_on, 3};
-        globals["event_emit"] = NativeFunction{event_emit, 3};
-        globals["event_off"] = NativeFunction{event_off, 2};
         globals["event_once"] = NativeFunction{event_once, 3};
+        globals["event_emit"] = NativeFunction{event_emit, 3};
+        globals["event_emit_async"] = NativeFunction{event_emit_async, 3};
+        globals["event_off"] = NativeFunction{event_off, -1};
         globals["event_listeners"] = NativeFunction{event_listeners, 2};
+        globals["event_wait"] = NativeFunction{event_wait, 1};
+        globals["event_free"] = NativeFunction{event_free, 1};
     }
 }
 
@@ -3957,8 +10054,10 @@ void registerAllLibraries(std::unordered_map<std::string, Value>& globals) {
     Utility::registerFunctions(globals);
     IO::registerFunctions(globals);
     FS::registerFunctions(globals);
+    AsyncIO::registerFunctions(globals);
     Time::registerFunctions(globals);
     Crypto::registerFunctions(globals);
+    Hash::registerFunctions(globals);
     Encoding::registerFunctions(globals);
     Log::registerFunctions(globals);
     Env::registerFunctions(globals);
@@ -3969,6 +10068,7 @@ void registerAllLibraries(std::unordered_map<std::string, Value>& globals) {
     NetHTTP::registerFunctions(globals);
     OS::registerFunctions(globals);
     Async::registerFunctions(globals);
+    EventLoop::registerFunctions(globals);
     Thread::registerFunctions(globals);
     Net::registerFunctions(globals);
     HTTP::registerFunctions(globals);
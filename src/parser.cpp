@@ -124,6 +124,24 @@ std::unique_ptr<Statement> Parser::statement() {
     if (match(TokenType::Func)) return functionStatement();
     if (match(TokenType::Return)) return returnStatement();
     if (match(TokenType::For)) return forStatement();
+    // parallel for / parallel(schedule[, chunk]) for: 'parallel' is contextual, not a keyword
+    if (check(TokenType::Identifier) && peek().lexeme == "parallel" && current + 1 < tokens.size() &&
+        (tokens[current + 1].type == TokenType::For ||
+         (tokens[current + 1].type == TokenType::LParen && current + 2 < tokens.size() &&
+          (tokens[current + 2].type == TokenType::Static ||
+           tokens[current + 2].lexeme == "dynamic" || tokens[current + 2].lexeme == "guided")))) {
+        advance(); // consume 'parallel'
+        return parallelForStatement();
+    }
+    // reduce name op= expr; ('reduce' is contextual, only meaningful inside parallel for)
+    if (check(TokenType::Identifier) && peek().lexeme == "reduce" && current + 2 < tokens.size() &&
+        tokens[current + 1].type == TokenType::Identifier &&
+        (tokens[current + 2].type == TokenType::PlusEqual ||
+         tokens[current + 2].type == TokenType::MinusEqual ||
+         tokens[current + 2].type == TokenType::StarEqual)) {
+        advance(); // consume 'reduce'
+        return reduceStatement();
+    }
     if (match(TokenType::While)) return whileStatement();
     if (match(TokenType::Do)) return doWhileStatement();
     if (match(TokenType::Loop)) return loopStatement();
@@ -465,6 +483,50 @@ std::unique_ptr<Statement> Parser::forStatement() {
     return std::make_unique<ForStmt>(varName, std::move(iterable), std::move(body));
 }
 
+std::unique_ptr<Statement> Parser::parallelForStatement() {
+    // Assumes 'parallel' has already been consumed
+    ParallelSchedule schedule = ParallelSchedule::Static;
+    std::unique_ptr<Expression> chunkSize;
+    if (match(TokenType::LParen)) {
+        if (match(TokenType::Static)) {
+            schedule = ParallelSchedule::Static;
+        } else if (match(TokenType::Identifier) && previous().lexeme == "dynamic") {
+            schedule = ParallelSchedule::Dynamic;
+        } else if (previous().lexeme == "guided") {
+            schedule = ParallelSchedule::Guided;
+        } else {
+            error(previous(), "Expected 'static', 'dynamic' or 'guided' schedule.");
+            throw std::runtime_error("Invalid parallel schedule.");
+        }
+        if (match(TokenType::Comma)) {
+            chunkSize = expression();
+        }
+        consume(TokenType::RParen, "Expected ')' after parallel schedule.");
+    }
+    consume(TokenType::For, "Expected 'for' after 'parallel'.");
+    consume(TokenType::Identifier, "Expected variable name in parallel for loop.");
+    std::string varName = tokens[current - 1].lexeme;
+    consume(TokenType::In, "Expected 'in' after variable name in parallel for loop.");
+    auto iterable = expression();
+    consume(TokenType::LBrace, "Expected '{' to start parallel for loop body.");
+    auto body = blockStatement();
+    return std::make_unique<ParallelForStmt>(varName, std::move(iterable), std::move(body),
+                                             schedule, std::move(chunkSize));
+}
+
+std::unique_ptr<Statement> Parser::reduceStatement() {
+    // Assumes 'reduce' has already been consumed
+    consume(TokenType::Identifier, "Expected variable name after 'reduce'.");
+    std::string name = tokens[current - 1].lexeme;
+    Token opToken = advance();
+    BinaryOp op = BinaryOp::Add;
+    if (opToken.type == TokenType::MinusEqual) op = BinaryOp::Sub;
+    else if (opToken.type == TokenType::StarEqual) op = BinaryOp::Mul;
+    auto value = expression();
+    consume(TokenType::Semicolon, "Expected ';' after reduce statement.");
+    return std::make_unique<ReduceStmt>(name, op, std::move(value));
+}
+
 std::unique_ptr<Statement> Parser::forDestructureStatement() {
     consume(TokenType::LBracket, "Expected '[' for destructuring in for loop.");
     std::vector<std::string> vars;
@@ -38,14 +38,14 @@ Value stdlib_str(std::vector<Value>& args) {
     if (args.size() != 1) throw std::runtime_error("str() expects 1 argument.");
 
     return std::visit(overloaded {
-        [](const std::string& s) -> Value { return s; },
-        [](int i) -> Value { return std::to_string(i); },
-        [](double d) -> Value { return std::to_string(d); },
-        [](float f) -> Value { return std::to_string(f); },
+        [](const StringValue& s) -> Value { return s; },
+        [](int i) -> Value { return numberToString(i); },
+        [](double d) -> Value { return numberToString(d); },
+        [](float f) -> Value { return numberToString(f); },
         [](bool b) -> Value { return b ? "true" : "false"; },
         [](std::monostate) -> Value { return std::string("null"); },
         [](const std::vector<Value>&) -> Value { return std::string("[list]"); },
-        [](const std::unordered_map<std::string, Value>&) -> Value { return std::string("{struct}"); },
+        [](const MapValue&) -> Value { return std::string("{struct}"); },
         [](const std::shared_ptr<ClassInstance>&) -> Value { return std::string("{instance}"); },
         [](const std::shared_ptr<ObjectInstance>&) -> Value { return std::string("{object}"); },
         [](const FunctionStmt*) -> Value { return std::string("{function}"); },
@@ -62,7 +62,8 @@ Value stdlib_int(std::vector<Value>& args) {
         [](double d) -> Value { return static_cast<int>(d); },
         [](float f) -> Value { return static_cast<int>(f); },
         [](bool b) -> Value { return b ? 1 : 0; },
-        [](const std::string& s) -> Value {
+        [](const StringValue& sv) -> Value {
+            const std::string& s = sv.str();
             try {
                 return std::stoi(s);
             } catch (...) {
@@ -81,7 +82,8 @@ Value stdlib_float(std::vector<Value>& args) {
         [](float f) -> Value { return static_cast<double>(f); },
         [](int i) -> Value { return static_cast<double>(i); },
         [](bool b) -> Value { return b ? 1.0 : 0.0; },
-        [](const std::string& s) -> Value {
+        [](const StringValue& sv) -> Value {
+            const std::string& s = sv.str();
             try {
                 return std::stod(s);
             } catch (...) {
@@ -101,13 +103,16 @@ Value stdlib_type(std::vector<Value>& args) {
         [](double) -> Value { return std::string("float"); },
         [](float) -> Value { return std::string("float"); },
         [](bool) -> Value { return std::string("bool"); },
-        [](const std::string&) -> Value { return std::string("string"); },
+        [](const StringValue&) -> Value { return std::string("string"); },
         [](const std::vector<Value>&) -> Value { return std::string("list"); },
-        [](const std::unordered_map<std::string, Value>&) -> Value { return std::string("struct"); },
+        [](const MapValue&) -> Value { return std::string("struct"); },
         [](const std::shared_ptr<ClassInstance>&) -> Value { return std::string("class"); },
         [](const std::shared_ptr<ObjectInstance>&) -> Value { return std::string("object"); },
         [](const FunctionStmt*) -> Value { return std::string("function"); },
         [](const NativeFunction&) -> Value { return std::string("native_function"); },
+        [](const std::shared_ptr<SetValue>&) -> Value { return std::string("set"); },
+        [](const std::shared_ptr<IteratorValue>&) -> Value { return std::string("iterator"); },
+        [](const std::shared_ptr<StringBuilderValue>&) -> Value { return std::string("string_builder"); },
         [](auto) -> Value { return std::string("unknown"); }
     }, args[0].data);
 }
@@ -116,10 +121,12 @@ Value stdlib_len(std::vector<Value>& args) {
     if (args.size() != 1) throw std::runtime_error("len() expects 1 argument.");
 
     return std::visit(overloaded {
-        [](const std::string& s) -> Value { return static_cast<int>(s.length()); },
+        [](const StringValue& s) -> Value { return static_cast<int>(s.size()); },
         [](const std::vector<Value>& v) -> Value { return static_cast<int>(v.size()); },
-        [](const std::unordered_map<std::string, Value>& m) -> Value { return static_cast<int>(m.size()); },
-        [](auto) -> Value { throw std::runtime_error("len() requires string, list, or struct."); }
+        [](const MapValue& m) -> Value { return static_cast<int>(m.size()); },
+        [](const std::shared_ptr<SetValue>& s) -> Value { return static_cast<int>(s->size()); },
+        [](const std::shared_ptr<StringBuilderValue>& b) -> Value { return static_cast<int>(b->buffer.size()); },
+        [](auto) -> Value { throw std::runtime_error("len() requires string, list, set, string builder, or struct."); }
     }, args[0].data);
 }
 